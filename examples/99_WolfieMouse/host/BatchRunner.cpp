@@ -0,0 +1,335 @@
+/*
+ * BatchRunner.cpp
+ *
+ *  Host-side (Linux) batch runner of WolfieMouse. It runs every maze of a
+ *  corpus the same way as the simulator (see Simulation.hpp), spread over a
+ *  pool of worker threads, and writes the statistics as CSV.
+ *
+ *  The mazes are sharded over the workers up front. A worker takes mazes
+ *  from the back of its own deque and, once that is empty, steals from the
+ *  front of the others', so a shard of big or slow mazes does not leave the
+ *  other workers idle. Each run has its own MouseControllers, and the only
+ *  shared data written by the workers is the result slot of its own maze.
+ *
+ *  CSV: one row per maze, then a TOTAL row whose "reached" column is the
+ *  success rate and whose percentiles are over the steps of all mazes. The
+ *  step and cell counts of TOTAL sum the solved mazes only, as a failed run
+ *  reports -1 steps; the failed mazes are listed on stderr.
+ *
+ *  Usage: wolfiemouse-batch [-p flood|incremental] [-j workers] [-o file.csv]
+ *                           <maze file or directory>...
+ *  Build: make wolfiemouse-batch (at the top of the repository)
+ */
+
+#include "Simulation.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A maze to run and its result
+ */
+struct job
+{
+	std::string path; /* maze file */
+	std::string name; /* name in the report */
+	bool isValid; /* the file was a maze that could be run */
+	struct result result;
+	std::vector<float> stepTimes; /* planner CPU time of each step (us) */
+};
+
+/**
+ * @brief A worker thread and the mazes it has not taken yet
+ */
+struct worker
+{
+	std::mutex lock; /* protects jobs */
+	std::deque<int> jobs; /* index of struct job */
+	int ranCount; /* mazes run by this worker */
+	int stolenCount; /* mazes stolen from the others */
+};
+
+static bool
+takeOwnJob (struct worker *pWorker, int *pJob)
+{
+	std::lock_guard<std::mutex> guard(pWorker->lock);
+	if (pWorker->jobs.empty())
+	{
+		return false;
+	}
+	*pJob = pWorker->jobs.back();
+	pWorker->jobs.pop_back();
+	return true;
+}
+
+static bool
+stealJob (struct worker *pVictim, int *pJob)
+{
+	std::lock_guard<std::mutex> guard(pVictim->lock);
+	if (pVictim->jobs.empty())
+	{
+		return false;
+	}
+	*pJob = pVictim->jobs.front();
+	pVictim->jobs.pop_front();
+	return true;
+}
+
+static void
+runWorker (std::vector<struct job> *pJobs, std::vector<struct worker> *pWorkers,
+		   int self, enum planner planner)
+{
+	struct worker *pSelf = &(*pWorkers)[self];
+	int workerCount = (int) pWorkers->size();
+	bool isFound;
+	int index;
+	int i;
+
+	while (1)
+	{
+		isFound = takeOwnJob(pSelf, &index);
+		/* Nothing left of our own: look for a victim, starting next to us
+		 so that thieves spread over the workers */
+		for (i = 1; (i < workerCount) && !isFound; i++)
+		{
+			isFound = stealJob(&(*pWorkers)[(self + i) % workerCount], &index);
+			pSelf->stolenCount += isFound ? 1 : 0;
+		}
+		/* Jobs are never added, so every deque is empty now */
+		if (!isFound)
+		{
+			break;
+		}
+
+		struct job *pJob = &(*pJobs)[index];
+		pJob->isValid = runMazeFile(pJob->path.c_str(), planner, &pJob->result,
+									&pJob->stepTimes);
+		pSelf->ranCount++;
+	}
+}
+
+/**
+ * @brief      Nearest-rank percentile
+ *
+ * @param      pSorted  samples in ascending order
+ * @param[in]  percent  0 to 100
+ */
+static double
+getPercentile (const std::vector<float> *pSorted, double percent)
+{
+	size_t rank;
+
+	if (pSorted->empty())
+	{
+		return 0.0;
+	}
+	rank = (size_t) (percent / 100.0 * (double) pSorted->size() + 0.5);
+	rank = (rank < 1) ? 1 : rank;
+	rank = (rank > pSorted->size()) ? pSorted->size() : rank;
+	return (*pSorted)[rank - 1];
+}
+
+static void
+printCsvHeader (FILE *pFile)
+{
+	fprintf(pFile, "maze,rows,cols,reached,explore_steps,visited_cells,"
+			"speedrun_steps,optimal_steps,plan_steps,plan_avg_us,plan_p50_us,"
+			"plan_p90_us,plan_p99_us,plan_max_us\n");
+}
+
+static void
+printCsvRow (FILE *pFile, const char *name, struct result *pResult,
+			 double reached, std::vector<float> *pSorted)
+{
+	fprintf(pFile, "%s,%d,%d,%g,%d,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f\n", name,
+			pResult->rowSize, pResult->colSize, reached, pResult->exploreSteps,
+			pResult->visitedCells, pResult->speedRunSteps, pResult->optimalSteps,
+			pResult->planSteps,
+			(pResult->planSteps != 0) ? pResult->planTotalUs / pResult->planSteps : 0.0,
+			getPercentile(pSorted, 50.0), getPercentile(pSorted, 90.0),
+			getPercentile(pSorted, 99.0), pResult->planMaxUs);
+}
+
+static void
+printUsage (const char *name)
+{
+	fprintf(stderr, "Usage: %s [-p flood|incremental] [-j workers] [-o file.csv]"
+			" <maze file or directory>...\n", name);
+}
+
+int
+main (int argc, char *argv[])
+{
+	enum planner planner = eFlood;
+	const char *csvName = NULL;
+	int workerCount = (int) std::thread::hardware_concurrency();
+	std::vector<struct job> jobs;
+	std::vector<std::string> paths;
+	std::vector<float> allStepTimes;
+	std::vector<std::string> failedNames;
+	std::vector<std::thread> threads;
+	struct result total;
+	FILE *pCsv = stdout;
+	int mazeCount = 0;
+	int reachedCount = 0;
+	int opt;
+	int i;
+
+	while ((opt = getopt(argc, argv, "p:j:o:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'p':
+			if (strcmp(optarg, "flood") == 0)
+			{
+				planner = eFlood;
+				break;
+			}
+			else if (strcmp(optarg, "incremental") == 0)
+			{
+				planner = eIncremental;
+				break;
+			}
+			printUsage(argv[0]);
+			return EXIT_FAILURE;
+		case 'j':
+			workerCount = atoi(optarg);
+			break;
+		case 'o':
+			csvName = optarg;
+			break;
+		default:
+			printUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind >= argc)
+	{
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	workerCount = (workerCount < 1) ? 1 : workerCount;
+
+	for (i = optind; i < argc; i++)
+	{
+		addMazeFiles(argv[i], &paths);
+	}
+	jobs.resize(paths.size());
+	for (i = 0; i < (int) paths.size(); i++)
+	{
+		jobs[i].path = paths[i];
+		jobs[i].name = paths[i].substr(paths[i].find_last_of('/') + 1);
+	}
+	if (jobs.empty())
+	{
+		fprintf(stderr, "no maze to run\n");
+		return EXIT_FAILURE;
+	}
+	if (workerCount > (int) jobs.size())
+	{
+		workerCount = (int) jobs.size();
+	}
+
+	/* Shard round-robin so that every worker starts with a mix of the
+	 corpus */
+	std::vector<struct worker> workers(workerCount);
+	for (i = 0; i < (int) jobs.size(); i++)
+	{
+		workers[i % workerCount].jobs.push_back(i);
+	}
+	for (i = 0; i < workerCount; i++)
+	{
+		workers[i].ranCount = 0;
+		workers[i].stolenCount = 0;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (i = 0; i < workerCount; i++)
+	{
+		threads.push_back(std::thread(runWorker, &jobs, &workers, i, planner));
+	}
+	for (i = 0; i < workerCount; i++)
+	{
+		threads[i].join();
+	}
+	double wallSeconds = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start).count();
+
+	if (NULL != csvName)
+	{
+		pCsv = fopen(csvName, "w");
+		if (NULL == pCsv)
+		{
+			fprintf(stderr, "%s: failed to open\n", csvName);
+			return EXIT_FAILURE;
+		}
+	}
+
+	/* Report in the order of the corpus, whichever worker ran the maze */
+	memset(&total, 0, sizeof(total));
+	printCsvHeader(pCsv);
+	for (i = 0; i < (int) jobs.size(); i++)
+	{
+		struct job *pJob = &jobs[i];
+		if (!pJob->isValid)
+		{
+			continue;
+		}
+		allStepTimes.insert(allStepTimes.end(), pJob->stepTimes.begin(), pJob->stepTimes.end());
+		std::sort(pJob->stepTimes.begin(), pJob->stepTimes.end());
+		printCsvRow(pCsv, pJob->name.c_str(), &pJob->result,
+					pJob->result.isReached ? 1.0 : 0.0, &pJob->stepTimes);
+
+		mazeCount++;
+		if (pJob->result.isReached)
+		{
+			reachedCount++;
+			total.exploreSteps += pJob->result.exploreSteps;
+			total.visitedCells += pJob->result.visitedCells;
+			total.speedRunSteps += pJob->result.speedRunSteps;
+			total.optimalSteps += pJob->result.optimalSteps;
+		}
+		else
+		{
+			failedNames.push_back(pJob->name);
+		}
+		total.planTotalUs += pJob->result.planTotalUs;
+		total.planSteps += pJob->result.planSteps;
+		if (pJob->result.planMaxUs > total.planMaxUs)
+		{
+			total.planMaxUs = pJob->result.planMaxUs;
+		}
+	}
+	std::sort(allStepTimes.begin(), allStepTimes.end());
+	printCsvRow(pCsv, "TOTAL", &total,
+				(mazeCount != 0) ? (double) reachedCount / mazeCount : 0.0, &allStepTimes);
+	if (pCsv != stdout)
+	{
+		fclose(pCsv);
+	}
+
+	fprintf(stderr, "%d/%d mazes solved with the %s planner\n", reachedCount, mazeCount,
+			(planner == eFlood) ? "flood" : "incremental");
+	for (i = 0; i < (int) failedNames.size(); i++)
+	{
+		fprintf(stderr, "  failed: %s\n", failedNames[i].c_str());
+	}
+	fprintf(stderr, "%d workers, %.3f s wall, %.1f mazes/s\n", workerCount, wallSeconds,
+			(wallSeconds > 0.0) ? mazeCount / wallSeconds : 0.0);
+	for (i = 0; i < workerCount; i++)
+	{
+		fprintf(stderr, "  worker %d: %d mazes, %d stolen\n", i, workers[i].ranCount,
+				workers[i].stolenCount);
+	}
+	return (reachedCount == mazeCount) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
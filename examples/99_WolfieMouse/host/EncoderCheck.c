@@ -0,0 +1,148 @@
+/*
+ * EncoderCheck.c
+ *
+ *  Host-side (Linux) check of the encoder extension of WolfieMouse
+ *  (src/bsp/WolfieMouse/encoder_ext.c). It feeds synthetic sequences of a
+ *  16-bit counter, sampled at 1 kHz, and compares the extended count and the
+ *  M/T velocity with the truth: wraps forward and backward, slow and fast
+ *  wheels, reversals, stops and the wrap of the microsecond clock.
+ *
+ *  Usage: wolfiemouse-encoder
+ *  Build: make wolfiemouse-encoder (at the top of the repository)
+ */
+
+#include "encoder_ext.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define checkPERIOD_US		1000
+#define checkMIN_WINDOW_US	2000
+#define checkMAX_WINDOW_US	100000
+
+/**
+ * @brief A wheel: position in counts as a function of time
+ */
+typedef struct {
+	double start;			/* counts */
+	double velocity;		/* counts per second */
+	double reverse_s;		/* the velocity changes sign at this time. 0 for never */
+	double stop_s;			/* the wheel stops at this time. 0 for never */
+} wheel_t;
+
+static double wheel_position_(const wheel_t *wheel, double time)
+{
+	double position = wheel->start;
+
+	if ((wheel->stop_s > 0.0) && (time > wheel->stop_s))
+	{
+		time = wheel->stop_s;
+	}
+	if ((wheel->reverse_s > 0.0) && (time > wheel->reverse_s))
+	{
+		return position + wheel->velocity * (2.0 * wheel->reverse_s - time);
+	}
+	return position + wheel->velocity * time;
+}
+
+static double wheel_velocity_(const wheel_t *wheel, double time)
+{
+	if ((wheel->stop_s > 0.0) && (time > wheel->stop_s))
+	{
+		return 0.0;
+	}
+	if ((wheel->reverse_s > 0.0) && (time > wheel->reverse_s))
+	{
+		return -wheel->velocity;
+	}
+	return wheel->velocity;
+}
+
+/**
+ * @brief Run a wheel for a while and compare with the truth
+ * @param tolerance	largest relative velocity error, once settled
+ * @return 0 if it passed
+ */
+static int check_(const char *name, const wheel_t *wheel, double duration_s,
+		uint32_t start_us, double tolerance)
+{
+	encoder_ext_t ext;
+	uint32_t now_us = start_us;
+	int64_t truth = (int64_t)floor(wheel->start);
+	int64_t count_errors = 0;
+	double max_velocity_error = 0.0;
+	double velocity_error;
+	double time;
+	double velocity;
+	long sample;
+	long samples = (long)(duration_s * 1000000.0 / checkPERIOD_US);
+	int is_passed;
+
+	encoder_ext_init(&ext, (uint16_t)(int64_t)floor(wheel->start), now_us,
+			checkMIN_WINDOW_US, checkMAX_WINDOW_US);
+	for (sample = 1; sample <= samples; sample++)
+	{
+		time = (double)sample * checkPERIOD_US / 1000000.0;
+		now_us += checkPERIOD_US;
+		truth = (int64_t)floor(wheel_position_(wheel, time));
+		encoder_ext_update(&ext, (uint16_t)truth, now_us);
+
+		if (encoder_ext_count(&ext) != truth - (int64_t)floor(wheel->start))
+		{
+			count_errors++;
+		}
+		/* the velocity is checked away from the changes, after a window */
+		velocity = wheel_velocity_(wheel, time);
+		if ((fabs(time - wheel->reverse_s) < 0.2) || ((wheel->stop_s > 0.0) && (time > wheel->stop_s)
+				&& (time < wheel->stop_s + 0.2)) || (time < 0.2))
+		{
+			continue;
+		}
+		velocity_error = fabs(encoder_ext_velocity(&ext) - velocity)
+				/ ((fabs(velocity) > 1.0) ? fabs(velocity) : 1.0);
+		if (velocity_error > max_velocity_error)
+		{
+			max_velocity_error = velocity_error;
+		}
+	}
+
+	is_passed = (count_errors == 0) && (max_velocity_error <= tolerance);
+	printf("%-28s %12lld %12lld %8lld %9.3f%% %s\r\n", name, (long long)encoder_ext_count(&ext),
+		   (long long)(truth - (int64_t)floor(wheel->start)), (long long)count_errors,
+		   100.0 * max_velocity_error, is_passed ? "PASS" : "FAIL");
+	return is_passed ? 0 : 1;
+}
+
+int main(void)
+{
+	int failures = 0;
+	wheel_t wheel;
+
+	printf("%-28s %12s %12s %8s %10s\r\n", "sequence", "count", "truth", "errors", "max v err");
+
+	wheel = (wheel_t){.start = 10000.0, .velocity = 30000.0};
+	failures += check_("fast forward, 4 wraps", &wheel, 10.0, 0, 0.04);
+	wheel = (wheel_t){.start = 10000.0, .velocity = -30000.0};
+	failures += check_("fast backward, 4 wraps", &wheel, 10.0, 0, 0.04);
+	wheel = (wheel_t){.start = 65530.0, .velocity = 1000.0};
+	failures += check_("forward from 65530", &wheel, 1.0, 0, 0.02);
+	wheel = (wheel_t){.start = 5.0, .velocity = -1000.0};
+	failures += check_("backward from 5", &wheel, 1.0, 0, 0.02);
+	wheel = (wheel_t){.start = 10000.0, .velocity = 32000.0};
+	failures += check_("near the limit, 32 counts/ms", &wheel, 5.0, 0, 0.04);
+	wheel = (wheel_t){.start = 10000.0, .velocity = 37.0};
+	failures += check_("slow, 37 counts/s", &wheel, 5.0, 0, 0.05);
+	/* a count every 83 ms, close to checkMAX_WINDOW_US */
+	wheel = (wheel_t){.start = 10000.0, .velocity = 12.0};
+	failures += check_("crawl, 12 counts/s", &wheel, 5.0, 0, 0.05);
+	wheel = (wheel_t){.start = 65000.0, .velocity = 20000.0, .reverse_s = 2.0};
+	failures += check_("reversal across the wrap", &wheel, 4.0, 0, 0.04);
+	wheel = (wheel_t){.start = 10000.0, .velocity = 5000.0, .stop_s = 1.0};
+	failures += check_("stop", &wheel, 2.0, 0, 0.02);
+	wheel = (wheel_t){.start = 10000.0, .velocity = 8000.0};
+	failures += check_("us clock wrap", &wheel, 3.0, 0xFFFFFFFFUL - 1500000UL, 0.02);
+
+	printf("%d failed\r\n", failures);
+	return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,170 @@
+/*
+ * FloodBenchmark.cpp
+ *
+ *  Host-side (Linux) comparison of the flood fill of WolfieMouse. For each
+ *  maze, with every wall known, it times the breadth-first flood of
+ *  MouseController::getDistanceAllCell against the sweep it replaced, which
+ *  scanned the whole maze once per distance. Both fill the distances from
+ *  the start to the goal and must give the same distances.
+ *
+ *  The sweep is the old getDistanceAllCell on the interface of Maze, with a
+ *  bound on the number of sweeps: the old code never ended if the goal was
+ *  unreachable.
+ *
+ *  Usage: wolfiemouse-flood-bench [-n repeats] <maze file or directory>...
+ *  Build: make wolfiemouse-flood-bench (at the top of the repository)
+ */
+
+#include "Simulation.hpp"
+#include "MouseController.hpp"
+
+#include <stdio.h>
+
+/* The highest distance of the neighbouring cells without a wall between */
+template<int Rows, int Cols>
+static int
+getHighestNeighbouringDistance (Maze<Rows, Cols> *maze, int row, int col)
+{
+	int tmp = UNREACHED;
+	int cmp;
+	int i;
+	/* Check out of bounds first */
+	if (maze->isPosOutOfBounds(row, col))
+	{
+		return mazeERROR;
+	}
+
+	for (i = (int) row_plus; i <= (int) col_minus; i++)
+	{
+		if (maze->getWall(row, col, (dir_e) i) == wall)
+		{
+			continue;
+		}
+		switch ((dir_e) i)
+		{
+			case row_plus:
+				cmp = maze->getDistance(row + 1, col);
+				break;
+			case col_plus:
+				cmp = maze->getDistance(row, col + 1);
+				break;
+			case row_minus:
+				cmp = maze->getDistance(row - 1, col);
+				break;
+			default:
+				cmp = maze->getDistance(row, col - 1);
+				break;
+		}
+		if (cmp > tmp)
+		{
+			tmp = cmp;
+		}
+	}
+	return tmp;
+}
+
+/* The old getDistanceAllCell: one sweep of the whole maze per distance */
+template<int Rows, int Cols>
+static void
+sweepDistanceAllCell (Maze<Rows, Cols> *maze, pos_t start)
+{
+	int currentPathDistance = mazeSTART_DISTANCE + 1;
+	int row;
+	int col;
+
+	for (row = 0; row < Rows; row++)
+	{
+		for (col = 0; col < Cols; col++)
+		{
+			maze->setDistance(row, col, UNREACHED);
+		}
+	}
+	maze->setDistance(start.row, start.col, mazeSTART_DISTANCE);
+
+	while (currentPathDistance <= Rows * Cols)
+	{
+		for (row = 0; row < Rows; row++)
+		{
+			for (col = 0; col < Cols; col++)
+			{
+				if (maze->getDistance(row, col) != UNREACHED)
+				{
+					continue;
+				}
+				if (getHighestNeighbouringDistance(maze, row, col) == (currentPathDistance - 1))
+				{
+					maze->setDistance(row, col, currentPathDistance);
+				}
+			}
+		}
+		if (maze->getDistance(maze->index_goal_row, maze->index_goal_col) != UNREACHED)
+		{
+			break;
+		}
+		currentPathDistance++;
+	}
+}
+
+/* The sweep as the old code, getDistanceAllCell as the new one */
+struct floodBenchmark
+{
+	template<int Rows, int Cols>
+	static bool
+	run (const char *fileName, struct timing *pTiming)
+	{
+		MouseController<Rows, Cols> queueMaze(const_cast<char *>(fileName));
+		Maze<Rows, Cols> sweepKnownMaze(const_cast<char *>(fileName));
+		MouseController<Rows, Cols> *queueMouse = &queueMaze;
+		Maze<Rows, Cols> *sweepMaze = &sweepKnownMaze;
+		pos_t start = {queueMouse->index_start_row, queueMouse->index_start_col};
+		double startUs;
+		bool isSame = true;
+		int row;
+		int col;
+		int i;
+
+		startUs = getCpuTimeUs();
+		for (i = 0; i < pTiming->repeats; i++)
+		{
+			sweepDistanceAllCell(sweepMaze, start);
+		}
+		pTiming->oldUs = (getCpuTimeUs() - startUs) / pTiming->repeats;
+
+		queueMouse->setPos(start);
+		startUs = getCpuTimeUs();
+		for (i = 0; i < pTiming->repeats; i++)
+		{
+			queueMouse->getDistanceAllCell();
+		}
+		pTiming->newUs = (getCpuTimeUs() - startUs) / pTiming->repeats;
+
+		for (row = 0; row < Rows; row++)
+		{
+			for (col = 0; col < Cols; col++)
+			{
+				if (queueMouse->getDistance(row, col) != sweepMaze->getDistance(row, col))
+				{
+					isSame = false;
+				}
+			}
+		}
+		pTiming->rowSize = Rows;
+		pTiming->colSize = Cols;
+		pTiming->distance = queueMouse->getDistance(queueMouse->index_goal_row, queueMouse->index_goal_col);
+
+		if (!isSame)
+		{
+			fprintf(stderr, "%s: the floods give different distances\n", fileName);
+		}
+		return isSame && (pTiming->distance != UNREACHED);
+	}
+};
+
+int
+main (int argc, char *argv[])
+{
+	static const struct benchmark benchmark = {"goal", "sweep", "queue",
+											   runMazeSize<floodBenchmark, struct timing>};
+
+	return runBenchmark(argc, argv, &benchmark);
+}
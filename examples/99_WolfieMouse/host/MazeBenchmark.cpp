@@ -0,0 +1,238 @@
+/*
+ * MazeBenchmark.cpp
+ *
+ *  Host-side (Linux) comparison of the storage of Maze. It prints the size
+ *  of the bit-packed Maze and of the unpacked layout it replaced (an enum
+ *  per wall, and an int distance, an enum and three bools per cell) for
+ *  each size of mazeFOR_EACH_SIZE. Then, for each maze, it times the same
+ *  flood fill from the goal to every cell on both.
+ *
+ *  The unpacked layout is the old Maze storage with its getWall. getWall is
+ *  kept out of line, as Maze::getWall is in Maze.cpp, so that neither is
+ *  inlined into the flood.
+ *
+ *  Usage: wolfiemouse-maze-bench [-n repeats] <maze file or directory>...
+ *  Build: make wolfiemouse-maze-bench (at the top of the repository)
+ */
+
+#include "Simulation.hpp"
+#include "Maze.hpp"
+#include "Queue.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief The storage of Maze before the walls and cells were bit-packed
+ */
+template<int Rows, int Cols>
+class UnpackedMaze
+{
+private:
+	enum wall rowWall[Rows + 1][Cols]; /* walls in y-direction (or row-increasing) */
+	enum wall colWall[Rows][Cols + 1]; /* walls in x-direction (or column-increasing)*/
+	struct cell cell[Rows][Cols]; /* each cells in the maze */
+
+public:
+	int index_goal_row;
+	int index_goal_col;
+	int index_start_row;
+	int index_start_col;
+
+	static inline bool isPosOutOfBounds (int row, int col)
+	{
+		return (row >= Rows) || (row < 0) || (col >= Cols) || (col < 0);
+	}
+
+	/* Copy the walls, the start and the goal */
+	explicit UnpackedMaze (Maze<Rows, Cols> *maze)
+	{
+		int row;
+		int col;
+
+		memset(cell, 0, sizeof(cell));
+		for (row = 0; row < Rows; row++)
+		{
+			for (col = 0; col < Cols; col++)
+			{
+				rowWall[row][col] = maze->getWall(row, col, row_minus);
+				colWall[row][col] = maze->getWall(row, col, col_minus);
+			}
+			colWall[row][Cols] = maze->getWall(row, Cols - 1, col_plus);
+		}
+		for (col = 0; col < Cols; col++)
+		{
+			rowWall[Rows][col] = maze->getWall(Rows - 1, col, row_plus);
+		}
+		index_goal_row = maze->index_goal_row;
+		index_goal_col = maze->index_goal_col;
+		index_start_row = maze->index_start_row;
+		index_start_col = maze->index_start_col;
+	}
+
+	__attribute__((noinline)) enum wall
+	getWall (int row, int col, dir_e dir)
+	{
+		if (isPosOutOfBounds(row, col))
+		{
+			return (enum wall) mazeERROR;
+		}
+		switch (dir)
+		{
+			case row_plus:
+				return rowWall[row + 1][col];
+			case col_plus:
+				return colWall[row][col + 1];
+			case row_minus:
+				return rowWall[row][col];
+			case col_minus:
+				return colWall[row][col];
+			default:
+				return (enum wall) mazeERROR;
+		}
+		return (enum wall) mazeERROR;
+	}
+
+	inline int setDistance (int row, int col, int dis)
+	{
+		if (isPosOutOfBounds(row, col))
+		{
+			printf("invalid cell!\n");
+			return mazeERROR;
+		}
+		cell[row][col].distance = dis;
+		return mazeSUCCESS;
+	}
+
+	inline int getDistance (int row, int col)
+	{
+		if (isPosOutOfBounds(row, col))
+		{
+			printf("invalid cell!\n");
+			return mazeERROR;
+		}
+		return cell[row][col].distance;
+	}
+};
+
+/* Breadth-first flood from the goal to every reachable cell */
+template<class MazeType, int Rows, int Cols>
+static void
+floodFromGoal (MazeType *maze, Queue<pos_t, Rows * Cols> *queue)
+{
+	static const int rowStep[] = {1, 0, -1, 0}; /* row_plus .. col_minus */
+	static const int colStep[] = {0, 1, 0, -1};
+	pos_t current;
+	pos_t next;
+	int distance;
+	int row;
+	int col;
+	int i;
+
+	for (row = 0; row < Rows; row++)
+	{
+		for (col = 0; col < Cols; col++)
+		{
+			maze->setDistance(row, col, UNREACHED);
+		}
+	}
+	queue->init();
+	maze->setDistance(maze->index_goal_row, maze->index_goal_col, mazeSTART_DISTANCE);
+	queue->pushToBack({maze->index_goal_row, maze->index_goal_col});
+
+	while (!queue->isEmpty())
+	{
+		current = queue->popFromFront();
+		distance = maze->getDistance(current.row, current.col);
+		for (i = (int) row_plus; i <= (int) col_minus; i++)
+		{
+			if (wall == maze->getWall(current.row, current.col, (dir_e) i))
+			{
+				continue;
+			}
+			next.row = current.row + rowStep[i];
+			next.col = current.col + colStep[i];
+			if (MazeType::isPosOutOfBounds(next.row, next.col)
+					|| (maze->getDistance(next.row, next.col) != UNREACHED))
+			{
+				continue;
+			}
+			maze->setDistance(next.row, next.col, distance + 1);
+			queue->pushToBack(next);
+		}
+	}
+}
+
+/* The flood on the unpacked layout as the old code, on Maze as the new one */
+struct mazeBenchmark
+{
+	template<int Rows, int Cols>
+	static bool
+	run (const char *fileName, struct timing *pTiming)
+	{
+		Maze<Rows, Cols> *packed = new Maze<Rows, Cols>(const_cast<char *>(fileName));
+		UnpackedMaze<Rows, Cols> *unpacked = new UnpackedMaze<Rows, Cols>(packed);
+		Queue<pos_t, Rows * Cols> *queue = new Queue<pos_t, Rows * Cols>();
+		double startUs;
+		bool isSame = true;
+		int row;
+		int col;
+		int i;
+
+		startUs = getCpuTimeUs();
+		for (i = 0; i < pTiming->repeats; i++)
+		{
+			floodFromGoal<UnpackedMaze<Rows, Cols>, Rows, Cols>(unpacked, queue);
+		}
+		pTiming->oldUs = (getCpuTimeUs() - startUs) / pTiming->repeats;
+
+		startUs = getCpuTimeUs();
+		for (i = 0; i < pTiming->repeats; i++)
+		{
+			floodFromGoal<Maze<Rows, Cols>, Rows, Cols>(packed, queue);
+		}
+		pTiming->newUs = (getCpuTimeUs() - startUs) / pTiming->repeats;
+
+		for (row = 0; row < Rows; row++)
+		{
+			for (col = 0; col < Cols; col++)
+			{
+				if (packed->getDistance(row, col) != unpacked->getDistance(row, col))
+				{
+					isSame = false;
+				}
+			}
+		}
+		pTiming->rowSize = Rows;
+		pTiming->colSize = Cols;
+		pTiming->distance = packed->getDistance(packed->index_start_row, packed->index_start_col);
+
+		delete queue;
+		delete unpacked;
+		delete packed;
+		if (!isSame)
+		{
+			fprintf(stderr, "%s: the floods give different distances\n", fileName);
+		}
+		return isSame && (pTiming->distance != UNREACHED);
+	}
+};
+
+#define simPRINT_SIZE(rows, cols)	\
+	printf("%2dx%-2d %9zu %9zu %7.1f\r\n", rows, cols, \
+		   sizeof(UnpackedMaze<rows, cols>), sizeof(Maze<rows, cols>), \
+		   (double) sizeof(UnpackedMaze<rows, cols>) / sizeof(Maze<rows, cols>));
+
+int
+main (int argc, char *argv[])
+{
+	static const struct benchmark benchmark = {"start", "unpacked", "packed",
+											   runMazeSize<mazeBenchmark, struct timing>};
+
+	printf("%-5s %9s %9s %7s\r\n", "size", "unpacked", "packed", "ratio");
+	printf("%-5s %9s %9s %7s\r\n", "", "(bytes)", "(bytes)", "(x)");
+	mazeFOR_EACH_SIZE(simPRINT_SIZE)
+	printf("\r\n");
+
+	return runBenchmark(argc, argv, &benchmark);
+}
@@ -0,0 +1,331 @@
+/*
+ * MotionPlant.c
+ *
+ *  Host-side (Linux) test of the motion engine of WolfieMouse
+ *  (src/bsp/WolfieMouse/motion.c) against a model of the robot, so that the
+ *  profiles and the gains can be checked without the robot.
+ *
+ *  Each wheel is a DC motor with a first order response to the duty, a
+ *  static friction that eats small duties, and a 16-bit quadrature counter
+ *  that starts near the wrap. It runs a list of moves and prints, for each,
+ *  the time, the largest tracking and velocity errors and the final error of
+ *  each wheel. One move blocks the left wheel for a while, to check that the
+ *  integral does not wind up.
+ *
+ *  The control period can be made to jitter (-j). The period and the
+ *  execution time of motion_tick() are measured like on the robot, with a
+ *  cycle counter in ns: simulated time plus the real time spent in
+ *  motion_tick().
+ *
+ *  With -m the wheel velocities come from the M/T estimate of encoder_ext.c,
+ *  like on the robot, instead of the low-pass of motion.c.
+ *
+ *  Usage: wolfiemouse-motion [-t time constant ms] [-f friction permyriad]
+ *                            [-j jitter us] [-m]
+ *  Build: make wolfiemouse-motion (at the top of the repository)
+ */
+
+#include "motion.h"
+#include "encoder_ext.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define plantSTEPS_PER_TICK		10		/* integration steps per control period */
+#define plantMM_PER_S_PER_DUTY	0.1f	/* steady state velocity per permyriad */
+#define plantENCODER_START		65000	/* close to the wrap of the counter */
+#define plantTIMEOUT_S			10.0f
+
+typedef struct {
+	float position;		/* mm */
+	float velocity;		/* mm/s */
+	int32_t duty;
+	uint16_t count_start;
+	uint8_t is_blocked;
+} plant_wheel_t;
+
+static plant_wheel_t left_;
+static plant_wheel_t right_;
+static float time_constant_ = 0.04f;
+static float friction_ = 400.0f;
+static int jitter_us_ = 0;
+static int is_mt_ = 0;
+static encoder_ext_t left_ext_;
+static encoder_ext_t right_ext_;
+static uint64_t sim_ns_ = 0;
+static uint64_t real_start_ns_ = 0;
+
+static uint64_t get_real_ns_(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief Cycle counter of 1 GHz: simulated time, plus the real time since
+ *        motion_tick() was called
+ */
+static uint32_t read_cycles_(void)
+{
+	return (uint32_t)(sim_ns_ + (get_real_ns_() - real_start_ns_));
+}
+
+static int32_t read_count_(const plant_wheel_t *wheel)
+{
+	/* the 16-bit counter of the timer wraps */
+	return (uint16_t)(wheel->count_start + (int32_t)(wheel->position * motionTICKS_PER_MM));
+}
+
+static int32_t read_left_(void)
+{
+	return read_count_(&left_);
+}
+
+static int32_t read_right_(void)
+{
+	return read_count_(&right_);
+}
+
+static void drive_left_(int32_t duty)
+{
+	left_.duty = duty;
+}
+
+static void drive_right_(int32_t duty)
+{
+	right_.duty = duty;
+}
+
+static float read_left_velocity_(void)
+{
+	return encoder_ext_velocity(&left_ext_);
+}
+
+static float read_right_velocity_(void)
+{
+	return encoder_ext_velocity(&right_ext_);
+}
+
+static motion_io_t plant_io_ = {
+		.read_left = read_left_,
+		.read_right = read_right_,
+		.drive_left = drive_left_,
+		.drive_right = drive_right_,
+		.read_cycles = read_cycles_,
+		.cycles_per_us = 1000
+};
+
+static void wheel_step_(plant_wheel_t *wheel, float dt)
+{
+	float duty = (float)wheel->duty;
+
+	if (wheel->is_blocked)
+	{
+		wheel->velocity = 0.0f;
+		return;
+	}
+	/* static friction: the wheel stays still under a small duty */
+	if ((wheel->velocity == 0.0f) && (duty < friction_) && (duty > -friction_))
+	{
+		return;
+	}
+	if (duty > 0.0f)
+	{
+		duty = (duty > friction_) ? duty - friction_ : 0.0f;
+	}
+	else
+	{
+		duty = (duty < -friction_) ? duty + friction_ : 0.0f;
+	}
+	wheel->velocity += (duty * plantMM_PER_S_PER_DUTY - wheel->velocity) * dt / time_constant_;
+	if ((duty == 0.0f) && (wheel->velocity < 1.0f) && (wheel->velocity > -1.0f))
+	{
+		wheel->velocity = 0.0f;
+	}
+	wheel->position += wheel->velocity * dt;
+}
+
+static void plant_tick_(void)
+{
+	float dt = 1.0f / (float)motionCONTROL_HZ / plantSTEPS_PER_TICK;
+	int jitter = 0;
+	int i;
+
+	if (jitter_us_ > 0)
+	{
+		/* the tick comes up to jitter_us_ early or late */
+		jitter = (rand() % (2 * jitter_us_ + 1)) - jitter_us_;
+		dt += (float)jitter * 1e-6f / plantSTEPS_PER_TICK;
+	}
+	for (i = 0; i < plantSTEPS_PER_TICK; i++)
+	{
+		wheel_step_(&left_, dt);
+		wheel_step_(&right_, dt);
+	}
+	sim_ns_ += (uint64_t)(1000000000 / motionCONTROL_HZ + jitter * 1000);
+	if (is_mt_)
+	{
+		encoder_ext_update(&left_ext_, (uint16_t)read_left_(), (uint32_t)(sim_ns_ / 1000));
+		encoder_ext_update(&right_ext_, (uint16_t)read_right_(), (uint32_t)(sim_ns_ / 1000));
+	}
+	real_start_ns_ = get_real_ns_();
+	motion_tick();
+}
+
+static float absf_(float value)
+{
+	return (value < 0.0f) ? -value : value;
+}
+
+/**
+ * @brief Run a move to the end, then let it settle for 100 ms
+ * @return 0 if it finished in time
+ */
+static int run_move_(const char *name, float distance, float degree, int block_ms)
+{
+	const motion_t *motion = motion_state();
+	float left_start = left_.position;
+	float right_start = right_.position;
+	float max_left_error = 0.0f;
+	float max_right_error = 0.0f;
+	float max_velocity_error = 0.0f;
+	float left_expected;
+	float right_expected;
+	int32_t max_duty = 0;
+	int ticks = 0;
+	int settle;
+
+	if (degree == 0.0f)
+	{
+		motion_move_mm(distance);
+	}
+	else
+	{
+		motion_turn_deg(degree);
+	}
+
+	while (motion_is_busy())
+	{
+		/* block the left wheel from 100 ms on */
+		left_.is_blocked = ((ticks >= motionCONTROL_HZ / 10)
+				&& (ticks < motionCONTROL_HZ / 10 + block_ms * motionCONTROL_HZ / 1000)) ? 1 : 0;
+		plant_tick_();
+		ticks++;
+		if (absf_(motion->right.target_velocity - right_.velocity) > max_velocity_error)
+		{
+			max_velocity_error = absf_(motion->right.target_velocity - right_.velocity);
+		}
+		if (!left_.is_blocked
+				&& (absf_(motion->left.target_velocity - left_.velocity) > max_velocity_error))
+		{
+			max_velocity_error = absf_(motion->left.target_velocity - left_.velocity);
+		}
+		if (absf_(motion->left.target - motion->left.position) > max_left_error)
+		{
+			max_left_error = absf_(motion->left.target - motion->left.position);
+		}
+		if (absf_(motion->right.target - motion->right.position) > max_right_error)
+		{
+			max_right_error = absf_(motion->right.target - motion->right.position);
+		}
+		if (abs(motion->left.duty) > max_duty)
+		{
+			max_duty = abs(motion->left.duty);
+		}
+		if (abs(motion->right.duty) > max_duty)
+		{
+			max_duty = abs(motion->right.duty);
+		}
+		if (ticks > plantTIMEOUT_S * motionCONTROL_HZ)
+		{
+			printf("%-12s timeout\r\n", name);
+			return 1;
+		}
+	}
+	left_.is_blocked = 0;
+	for (settle = 0; settle < motionCONTROL_HZ / 10; settle++)
+	{
+		plant_tick_();
+	}
+
+	left_expected = distance - degree * (motionTRACK_MM * 3.14159265f / 360.0f);
+	right_expected = distance + degree * (motionTRACK_MM * 3.14159265f / 360.0f);
+	printf("%-12s %8.3f %9.2f %9.2f %9.1f %9.2f %9.2f %7ld\r\n", name,
+		   (float)ticks / motionCONTROL_HZ, max_left_error, max_right_error, max_velocity_error,
+		   left_.position - left_start - left_expected,
+		   right_.position - right_start - right_expected, (long)max_duty);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	motion_timing_report_t timing;
+	int failures = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:f:j:m")) != -1)
+	{
+		switch (opt)
+		{
+		case 't':
+			time_constant_ = (float)atof(optarg) / 1000.0f;
+			break;
+		case 'f':
+			friction_ = (float)atof(optarg);
+			break;
+		case 'j':
+			jitter_us_ = atoi(optarg);
+			break;
+		case 'm':
+			is_mt_ = 1;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-t time constant ms] [-f friction permyriad] [-j jitter us] [-m]\n",
+					argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (time_constant_ <= 0.0f)
+	{
+		fprintf(stderr, "The time constant must be positive\n");
+		return EXIT_FAILURE;
+	}
+
+	left_.count_start = plantENCODER_START;
+	right_.count_start = plantENCODER_START;
+	if (is_mt_)
+	{
+		encoder_ext_init(&left_ext_, (uint16_t)read_left_(), 0, 2000, 100000);
+		encoder_ext_init(&right_ext_, (uint16_t)read_right_(), 0, 2000, 100000);
+		plant_io_.read_left_velocity = read_left_velocity_;
+		plant_io_.read_right_velocity = read_right_velocity_;
+	}
+	motion_init(&plant_io_);
+
+	printf("%-12s %8s %9s %9s %9s %9s %9s %7s\r\n", "move", "time", "max err L", "max err R",
+		   "vel err", "end err L", "end err R", "duty");
+	printf("%-12s %8s %9s %9s %9s %9s %9s %7s\r\n", "", "(s)", "(mm)", "(mm)", "(mm/s)", "(mm)",
+		   "(mm)", "(max)");
+	failures += run_move_("1 cell", motionCELL_MM, 0.0f, 0);
+	failures += run_move_("5 cells", 5.0f * motionCELL_MM, 0.0f, 0);
+	failures += run_move_("left 90", 0.0f, 90.0f, 0);
+	failures += run_move_("right 90", 0.0f, -90.0f, 0);
+	failures += run_move_("turn 180", 0.0f, 180.0f, 0);
+	failures += run_move_("back 1 cell", -motionCELL_MM, 0.0f, 0);
+	failures += run_move_("half cell", motionCELL_MM / 2.0f, 0.0f, 0);
+	failures += run_move_("16 cells", 16.0f * motionCELL_MM, 0.0f, 0);
+	failures += run_move_("5 c. blocked", 5.0f * motionCELL_MM, 0.0f, 200);
+
+	motion_get_timing(&timing);
+	printf("\r\nmotion_tick: %lu periods, period %.1f to %.1f us (jitter %.1f us), "
+		   "exec avg %.2f us max %.2f us, %lu overruns\r\n",
+		   (unsigned long)timing.count, timing.period_min_us, timing.period_max_us,
+		   timing.jitter_us, timing.exec_avg_us, timing.exec_max_us,
+		   (unsigned long)timing.overruns);
+
+	return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,422 @@
+/*
+ * PoseReplay.c
+ *
+ *  Host-side (Linux) replay of the pose estimator of WolfieMouse
+ *  (src/bsp/WolfieMouse/pose.c) over sensor logs. It runs the filter over
+ *  each line of a log, as pose_step() runs on the robot, and prints the
+ *  final pose, the errors against the true pose when the log has it, and
+ *  the time per pose_step().
+ *
+ *  A log is a CSV file with one line per control period:
+ *    t_us,left_mm,right_mm,gyro_rad_s,range_left_mm,range_right_mm,
+ *    range_front_mm[,true_x,true_y,true_heading]
+ *  The wheel travels are those of the period. A range is < 0 without a new
+ *  sample, and the gyro is "-" without a gyro. Lines starting with '#' or a
+ *  letter are skipped.
+ *
+ *  -g writes a synthetic log instead. The mouse waits, goes 5 cells along a
+ *  corridor, turns left and goes 3 more cells to a wall. The wheels have a
+ *  scale error and slip, the gyro has a bias and noise, and the mouse starts
+ *  off the centre line with a heading error.
+ *
+ *  Usage: wolfiemouse-pose [-n] [-G] [-o trace.csv] <log>...
+ *         wolfiemouse-pose -g <log to write>
+ *    -n  without the walls (odometry and gyro only)
+ *    -G  without the gyro
+ *    -o  write the estimated pose of every period
+ *  Build: make wolfiemouse-pose (at the top of the repository)
+ */
+
+#include "pose.h"
+#include "motion_profile.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define replayPERIOD_S		0.001f
+#define replayLINE_SIZE		256
+
+/* synthetic log */
+#define synthWALL_MM		84.0f	/* from the centre line to the face of a wall */
+#define synthSIDE_OFFSET_MM	(synthWALL_MM - poseSIDE_CENTRE_MM)
+#define synthFRONT_OFFSET_MM (synthWALL_MM - poseFRONT_CENTRE_MM)
+#define synthRANGE_EVERY	20		/* periods between two samples of a sensor */
+#define synthLEFT_SCALE		1.01f
+#define synthGYRO_BIAS		0.02f	/* rad/s */
+
+static int is_walls_ = 1;
+static int is_gyro_ = 1;
+
+/**
+ * @brief Normal noise of Box-Muller
+ */
+static float noise_(float sigma)
+{
+	double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+	double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+	return sigma * (float)(sqrt(-2.0 * log(u)) * cos(2.0 * 3.14159265358979 * v));
+}
+
+static float wrap_(float angle)
+{
+	while (angle > 3.14159265f)
+	{
+		angle -= 2.0f * 3.14159265f;
+	}
+	while (angle <= -3.14159265f)
+	{
+		angle += 2.0f * 3.14159265f;
+	}
+	return angle;
+}
+
+/**
+ * @brief Distance seen by a sensor looking at a wall
+ * @param gap	distance from the centre of the mouse to the wall, square to it
+ * @param angle	angle between the sensor and the square to the wall
+ */
+static float range_(float gap, float offset, float angle)
+{
+	float range = (gap / cosf(angle)) - offset + noise_(1.0f);
+
+	return (range < 0.0f) ? 0.0f : range;
+}
+
+/**
+ * @brief A segment of the synthetic run
+ */
+typedef struct {
+	float distance;			/* mm, or 0 */
+	float degree;			/* degree to the left, or 0 */
+	float wait_s;			/* standing still, when both are 0 */
+} segment_t;
+
+static int generate_(const char *fileName)
+{
+	static const segment_t segments[] = {
+			{0.0f, 0.0f, 1.0f},
+			{5.0f * motionCELL_MM, 0.0f, 0.0f},
+			{0.0f, 0.0f, 0.2f},
+			{0.0f, 90.0f, 0.0f},
+			{0.0f, 0.0f, 0.2f},
+			{3.0f * motionCELL_MM, 0.0f, 0.0f},
+			{0.0f, 0.0f, 0.5f}
+	};
+	const motion_limits_t translation = {motionMAX_VELOCITY, motionMAX_ACCELERATION, motionMAX_JERK};
+	const motion_limits_t rotation = {motionMAX_ANGULAR_VELOCITY, motionMAX_ANGULAR_ACCELERATION,
+			motionMAX_ANGULAR_JERK};
+	motion_profile_t profile;
+	FILE *pFile;
+	/* true pose: off the centre line, with a heading error */
+	float x = 0.0f;
+	float y = 8.0f;
+	float heading = 0.03f;
+	float last_position;
+	float distance;
+	float turn;
+	float left;
+	float right;
+	float left_count = 0.0f;	/* encoder counts */
+	float right_count = 0.0f;
+	float last_left = 0.0f;
+	float last_right = 0.0f;
+	float left_range;
+	float right_range;
+	float front_range;
+	float error;
+	long period = 0;
+	long wait;
+	size_t i;
+	int is_moving;
+
+	pFile = fopen(fileName, "w");
+	if (NULL == pFile)
+	{
+		fprintf(stderr, "%s: can not open\n", fileName);
+		return 1;
+	}
+	fprintf(pFile, "t_us,left_mm,right_mm,gyro_rad_s,range_left_mm,range_right_mm,range_front_mm,"
+			"true_x,true_y,true_heading\n");
+
+	for (i = 0; i < sizeof(segments) / sizeof(segments[0]); i++)
+	{
+		if (segments[i].degree != 0.0f)
+		{
+			motion_profile_init(&profile, &rotation, replayPERIOD_S);
+			motion_profile_start(&profile, segments[i].degree);
+		}
+		else
+		{
+			motion_profile_init(&profile, &translation, replayPERIOD_S);
+			motion_profile_start(&profile, segments[i].distance);
+		}
+		last_position = 0.0f;
+		wait = (long)(segments[i].wait_s / replayPERIOD_S);
+		do
+		{
+			is_moving = motion_profile_step(&profile);
+			distance = 0.0f;
+			turn = 0.0f;
+			if (segments[i].degree != 0.0f)
+			{
+				turn = (motion_profile_position(&profile) - last_position) * 3.14159265f / 180.0f;
+			}
+			else
+			{
+				distance = motion_profile_position(&profile) - last_position;
+			}
+			last_position = motion_profile_position(&profile);
+
+			/* the truth */
+			heading += turn / 2.0f;
+			x += distance * cosf(heading);
+			y += distance * sinf(heading);
+			heading = wrap_(heading + turn / 2.0f);
+
+			/* the wheels: scale error, slip and the counts of the encoders */
+			left = (distance - turn * motionTRACK_MM / 2.0f) * synthLEFT_SCALE;
+			right = distance + turn * motionTRACK_MM / 2.0f;
+			if ((left != 0.0f) || (right != 0.0f))
+			{
+				left += noise_(0.002f);
+				right += noise_(0.002f);
+			}
+			left_count += left * motionTICKS_PER_MM;
+			right_count += right * motionTICKS_PER_MM;
+			left = (floorf(left_count) - last_left) / motionTICKS_PER_MM;
+			right = (floorf(right_count) - last_right) / motionTICKS_PER_MM;
+			last_left = floorf(left_count);
+			last_right = floorf(right_count);
+
+			/* the walls: a corridor along +x to the wall at row 5, then
+			 along +y from cell (5, 0) to the wall at col 3 */
+			left_range = -1.0f;
+			right_range = -1.0f;
+			front_range = -1.0f;
+			if (x < 4.5f * motionCELL_MM)
+			{
+				error = heading;
+				if ((period % synthRANGE_EVERY) == 0)
+				{
+					left_range = range_(synthWALL_MM - y, synthSIDE_OFFSET_MM, error);
+					right_range = range_(synthWALL_MM + y, synthSIDE_OFFSET_MM, error);
+				}
+				if ((period % synthRANGE_EVERY) == synthRANGE_EVERY / 2)
+				{
+					front_range = range_(5.0f * motionCELL_MM + synthWALL_MM - x, synthFRONT_OFFSET_MM, error);
+				}
+			}
+			else if (heading < 3.14159265f / 4.0f)
+			{
+				/* the end of the corridor: no wall on the left */
+				error = heading;
+				if ((period % synthRANGE_EVERY) == 0)
+				{
+					right_range = range_(synthWALL_MM + y, synthSIDE_OFFSET_MM, error);
+				}
+				if ((period % synthRANGE_EVERY) == synthRANGE_EVERY / 2)
+				{
+					front_range = range_(5.0f * motionCELL_MM + synthWALL_MM - x, synthFRONT_OFFSET_MM, error);
+				}
+			}
+			else
+			{
+				error = heading - 3.14159265f / 2.0f;
+				if ((period % synthRANGE_EVERY) == 0)
+				{
+					left_range = range_(x - (5.0f * motionCELL_MM - synthWALL_MM), synthSIDE_OFFSET_MM, error);
+					right_range = range_(5.0f * motionCELL_MM + synthWALL_MM - x, synthSIDE_OFFSET_MM, error);
+				}
+				if ((period % synthRANGE_EVERY) == synthRANGE_EVERY / 2)
+				{
+					front_range = range_(3.0f * motionCELL_MM + synthWALL_MM - y, synthFRONT_OFFSET_MM, error);
+				}
+			}
+			if (front_range > 200.0f)
+			{
+				/* out of the range of the VL6180X */
+				front_range = -1.0f;
+			}
+
+			fprintf(pFile, "%ld,%.4f,%.4f,%.5f,%.2f,%.2f,%.2f,%.3f,%.3f,%.5f\n",
+					period * 1000, left, right,
+					(turn / replayPERIOD_S) + synthGYRO_BIAS + noise_(0.01f),
+					left_range, right_range, front_range, x, y, heading);
+			period++;
+		} while (is_moving || (wait-- > 0));
+	}
+
+	fclose(pFile);
+	printf("%s: %ld periods\r\n", fileName, period);
+	return 0;
+}
+
+/**
+ * @brief Replay a log
+ * @return 0 if it could be read
+ */
+static int replay_(const char *fileName, FILE *pTrace)
+{
+	char line[replayLINE_SIZE];
+	char gyro[32];
+	FILE *pFile;
+	pose_filter_t filter;
+	pose_input_t input;
+	pose_cell_t cell;
+	float truth[3];
+	float error;
+	double max_error = 0.0;
+	double square_error = 0.0;
+	double max_heading_error = 0.0;
+	double heading_error;
+	double step_ns = 0.0;
+	struct timespec start;
+	struct timespec end;
+	unsigned long t_us;
+	long steps = 0;
+	long truths = 0;
+	int fields;
+
+	pFile = fopen(fileName, "r");
+	if (NULL == pFile)
+	{
+		fprintf(stderr, "%s: can not open\n", fileName);
+		return 1;
+	}
+	pose_init(&filter, replayPERIOD_S);
+
+	while (fgets(line, sizeof(line), pFile) != NULL)
+	{
+		if ((line[0] == '#') || ((line[0] >= 'a') && (line[0] <= 'z')))
+		{
+			continue;
+		}
+		fields = sscanf(line, "%lu,%f,%f,%31[^,],%f,%f,%f,%f,%f,%f", &t_us, &input.left_mm,
+				&input.right_mm, gyro, &input.left_range_mm, &input.right_range_mm,
+				&input.front_range_mm, &truth[0], &truth[1], &truth[2]);
+		if (fields < 7)
+		{
+			fprintf(stderr, "%s: bad line %ld\n", fileName, steps + 1);
+			continue;
+		}
+		input.has_gyro = (is_gyro_ && (gyro[0] != '-')) ? 1 : 0;
+		input.gyro_rad_s = input.has_gyro ? strtof(gyro, NULL) : 0.0f;
+		if (!is_walls_)
+		{
+			input.left_range_mm = -1.0f;
+			input.right_range_mm = -1.0f;
+			input.front_range_mm = -1.0f;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		pose_step(&filter, &input);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		step_ns += (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+		steps++;
+
+		if (fields == 10)
+		{
+			error = hypotf(filter.pose.x - truth[0], filter.pose.y - truth[1]);
+			heading_error = fabs(wrap_(filter.pose.heading - truth[2]));
+			square_error += (double)error * error;
+			max_error = (error > max_error) ? error : max_error;
+			max_heading_error = (heading_error > max_heading_error) ? heading_error : max_heading_error;
+			truths++;
+		}
+		if (pTrace != NULL)
+		{
+			pose_get_cell(&filter, &cell);
+			fprintf(pTrace, "%lu,%.3f,%.3f,%.5f,%ld,%ld,%u,%.3f,%.3f,%.5f\n", t_us, filter.pose.x,
+					filter.pose.y, filter.pose.heading, (long)cell.row, (long)cell.col, cell.dir,
+					cell.along, cell.across, cell.heading_error);
+		}
+	}
+	fclose(pFile);
+
+	if (steps == 0)
+	{
+		fprintf(stderr, "%s: empty\n", fileName);
+		return 1;
+	}
+	pose_get_cell(&filter, &cell);
+	printf("%s: %ld steps, %.1f ns per step, gyro bias %.4f rad/s, %lu side and %lu front corrections\r\n",
+		   fileName, steps, step_ns / steps, filter.gyro_bias, (unsigned long)filter.side_count,
+		   (unsigned long)filter.front_count);
+	printf("  pose (%.1f, %.1f) mm %.2f deg, cell (%ld, %ld) dir %u along %.1f across %.1f mm\r\n",
+		   filter.pose.x, filter.pose.y, filter.pose.heading * 180.0f / 3.14159265f,
+		   (long)cell.row, (long)cell.col, cell.dir, cell.along, cell.across);
+	if (truths > 0)
+	{
+		printf("  true (%.1f, %.1f) mm %.2f deg, error rms %.2f max %.2f mm, heading max %.2f deg\r\n",
+			   truth[0], truth[1], truth[2] * 180.0f / 3.14159265f, sqrt(square_error / truths),
+			   max_error, max_heading_error * 180.0 / 3.14159265);
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *traceName = NULL;
+	const char *generateName = NULL;
+	FILE *pTrace = NULL;
+	int failures = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "nGo:g:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n':
+			is_walls_ = 0;
+			break;
+		case 'G':
+			is_gyro_ = 0;
+			break;
+		case 'o':
+			traceName = optarg;
+			break;
+		case 'g':
+			generateName = optarg;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n] [-G] [-o trace.csv] <log>...\n"
+					"       %s -g <log to write>\n", argv[0], argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (generateName != NULL)
+	{
+		srand(1);
+		return generate_(generateName) ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+	if (optind >= argc)
+	{
+		fprintf(stderr, "Usage: %s [-n] [-G] [-o trace.csv] <log>...\n"
+				"       %s -g <log to write>\n", argv[0], argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (traceName != NULL)
+	{
+		pTrace = fopen(traceName, "w");
+		if (NULL == pTrace)
+		{
+			fprintf(stderr, "%s: can not open\n", traceName);
+			return EXIT_FAILURE;
+		}
+		fprintf(pTrace, "t_us,x,y,heading,row,col,dir,along,across,heading_error\n");
+	}
+	for (opt = optind; opt < argc; opt++)
+	{
+		failures += replay_(argv[opt], pTrace);
+	}
+	if (pTrace != NULL)
+	{
+		fclose(pTrace);
+	}
+	return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
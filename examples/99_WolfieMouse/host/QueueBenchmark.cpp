@@ -0,0 +1,306 @@
+/*
+ * QueueBenchmark.cpp
+ *
+ *  Host-side (Linux) comparison of Queue<T, N> with the queue it replaced,
+ *  which kept N default-constructed objects, wrapped its indexes with a
+ *  compare and copied objects in and out. Each workload runs on both and
+ *  must give the same checksum:
+ *
+ *   - fifo: the cells of a 32x32 maze through pushToBack/popFromFront, as
+ *     the flood fill does
+ *   - stack: pushToBack/popFromBack, as the path stacks of MouseController
+ *   - string: strings longer than the small string buffer through
+ *     pushToBack/popFromFront, where the old queue copies and the new one
+ *     moves
+ *   - construct: a queue of strings constructed and destroyed
+ *
+ *  Usage: wolfiemouse-queue-bench [-n repeats]
+ *  Build: make wolfiemouse-queue-bench (at the top of the repository)
+ */
+
+#include "Simulation.hpp"
+#include "Maze.hpp"
+#include "Queue.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+
+#define benchINCREASE(index) if(index != (N - 1)) \
+        index++; \
+      else \
+        index = 0
+#define benchDECREASE(index) if(index != 0) \
+        index--; \
+      else \
+        index = N - 1
+
+/**
+ * @brief      The Queue before it became a power-of-two ring buffer, less
+ *             the functions the workloads do not use
+ */
+template<class T, int N>
+	class OldQueue
+	{
+	private:
+		T buffer[N]; /* buffer inside the queue */
+		int front; /* index of front */
+		int back; /* index of back */
+		int size; /* number of objects currently stored in the queue */
+
+	public:
+		OldQueue ()
+		{
+			init();
+		}
+
+		void
+		init ()
+		{
+			front = 0;
+			back = 0;
+			size = 0;
+		}
+
+		int
+		pushToBack (T obj)
+		{
+			if (!isFull())
+			{
+				/* Increase the back */
+				benchINCREASE(back);
+				size++; /* Increase the size */
+				buffer[back] = obj; /* fill the object later */
+				return size;
+			}
+			return -1;
+		}
+
+		T
+		popFromBack ()
+		{
+			T temp;
+			if (!isEmpty())
+			{
+				temp = buffer[back];
+				/* decrease back */
+				benchDECREASE(back);
+				size--; /* decrease the size */
+				return temp;
+			}
+			return T();
+		}
+
+		T
+		popFromFront ()
+		{
+			if (!isEmpty())
+			{
+				/* Increase the front */
+				benchINCREASE(front);
+				size--; /* decrease the size */
+				return buffer[front];
+			}
+			return T();
+		}
+
+		bool
+		isEmpty ()
+		{
+			if (size != 0)
+			{
+				return false;
+			}
+			return true;
+		}
+
+		bool
+		isFull ()
+		{
+			if (size != N)
+			{
+				return false;
+			}
+			return true;
+		}
+	};
+
+#define benchCELLS	(32 * 32)
+#define benchSTRINGS	mazeQUEUE_MAX_BUFFER
+
+template<class QueueType>
+static long
+runFifo (QueueType *queue)
+{
+	long sum = 0;
+	pos_t pos;
+	int i;
+
+	queue->init();
+	/* Half full, then one in and one out like a flood */
+	for (i = 0; i < benchCELLS / 2; i++)
+	{
+		queue->pushToBack({i / 32, i % 32});
+	}
+	for (; i < benchCELLS; i++)
+	{
+		queue->pushToBack({i / 32, i % 32});
+		pos = queue->popFromFront();
+		sum += pos.row * 32 + pos.col;
+	}
+	while (!queue->isEmpty())
+	{
+		pos = queue->popFromFront();
+		sum += pos.row * 32 + pos.col;
+	}
+	return sum;
+}
+
+template<class QueueType>
+static long
+runStack (QueueType *queue)
+{
+	long sum = 0;
+	pos_t pos;
+	int i;
+	int j;
+
+	queue->init();
+	/* Down a path and back, deeper each time */
+	for (i = 1; i <= 32; i++)
+	{
+		for (j = 0; j < i; j++)
+		{
+			queue->pushToBack({i, j});
+		}
+		while (!queue->isEmpty())
+		{
+			pos = queue->popFromBack();
+			sum += pos.row * 32 + pos.col;
+		}
+	}
+	return sum;
+}
+
+template<class QueueType>
+static long
+runString (QueueType *queue)
+{
+	const std::string name("a string too long for the small string buffer");
+	long sum = 0;
+	int i;
+
+	queue->init();
+	for (i = 0; i < benchSTRINGS; i++)
+	{
+		queue->pushToBack(name);
+	}
+	while (!queue->isEmpty())
+	{
+		sum += (long) queue->popFromFront().size();
+	}
+	return sum;
+}
+
+template<class QueueType>
+static long
+runConstruct (QueueType *)
+{
+	QueueType *queue = new QueueType();
+	long sum = queue->isEmpty() ? 1 : 0;
+
+	delete queue;
+	return sum;
+}
+
+/* CPU time of one run of the workload, and its checksum */
+template<class QueueType>
+static double
+timeWorkload (long (*workload)(QueueType *), int repeats, long *pSum)
+{
+	QueueType *queue = new QueueType();
+	double startUs;
+	int i;
+
+	*pSum = 0;
+	startUs = getCpuTimeUs();
+	for (i = 0; i < repeats; i++)
+	{
+		*pSum += workload(queue);
+	}
+	startUs = (getCpuTimeUs() - startUs) / repeats;
+	delete queue;
+	return startUs;
+}
+
+typedef OldQueue<pos_t, benchCELLS> OldPosQueue;
+typedef Queue<pos_t, benchCELLS> PosQueue;
+typedef OldQueue<std::string, benchSTRINGS> OldStringQueue;
+typedef Queue<std::string, benchSTRINGS> StringQueue;
+
+static bool
+printWorkload (const char *name, double oldUs, long oldSum, double newUs, long newSum)
+{
+	printf("%-10s %9.3f %9.3f %7.2f\r\n", name, oldUs, newUs,
+		   (newUs > 0.0) ? oldUs / newUs : 0.0);
+	if (oldSum != newSum)
+	{
+		fprintf(stderr, "%s: checksum %ld, expected %ld\n", name, newSum, oldSum);
+		return false;
+	}
+	return true;
+}
+
+int
+main (int argc, char *argv[])
+{
+	double oldUs;
+	double newUs;
+	long oldSum;
+	long newSum;
+	bool isSame = true;
+	int repeats = 10000;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n':
+			repeats = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n repeats]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (repeats < 1)
+	{
+		fprintf(stderr, "Usage: %s [-n repeats]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	printf("%-10s %9s %9s %7s\r\n", "workload", "old", "new", "ratio");
+	printf("%-10s %9s %9s %7s\r\n", "", "(us)", "(us)", "(x)");
+
+	oldUs = timeWorkload<OldPosQueue>(runFifo<OldPosQueue>, repeats, &oldSum);
+	newUs = timeWorkload<PosQueue>(runFifo<PosQueue>, repeats, &newSum);
+	isSame = printWorkload("fifo", oldUs, oldSum, newUs, newSum) && isSame;
+
+	oldUs = timeWorkload<OldPosQueue>(runStack<OldPosQueue>, repeats, &oldSum);
+	newUs = timeWorkload<PosQueue>(runStack<PosQueue>, repeats, &newSum);
+	isSame = printWorkload("stack", oldUs, oldSum, newUs, newSum) && isSame;
+
+	oldUs = timeWorkload<OldStringQueue>(runString<OldStringQueue>, repeats, &oldSum);
+	newUs = timeWorkload<StringQueue>(runString<StringQueue>, repeats, &newSum);
+	isSame = printWorkload("string", oldUs, oldSum, newUs, newSum) && isSame;
+
+	oldUs = timeWorkload<OldStringQueue>(runConstruct<OldStringQueue>, repeats, &oldSum);
+	newUs = timeWorkload<StringQueue>(runConstruct<StringQueue>, repeats, &newSum);
+	isSame = printWorkload("construct", oldUs, oldSum, newUs, newSum) && isSame;
+
+	printf("%d repeats\r\n", repeats);
+	return isSame ? EXIT_SUCCESS : EXIT_FAILURE;
+}
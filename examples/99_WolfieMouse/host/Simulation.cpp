@@ -0,0 +1,366 @@
+/*
+ * Simulation.cpp
+ *
+ *  See Simulation.hpp
+ */
+
+#include "Simulation.hpp"
+#include "MouseController.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+
+double
+getCpuTimeUs (void)
+{
+	struct timespec time;
+	/* per thread, so that runs on the other threads are not counted */
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+	return (double) time.tv_sec * 1e6 + (double) time.tv_nsec / 1e3;
+}
+
+/**
+ * @brief      Let the mouse see the walls around its cell in the world
+ */
+template<int Rows, int Cols>
+static void
+senseWalls (MouseController<Rows, Cols> *world, MouseController<Rows, Cols> *mouse, enum planner planner)
+{
+	pos_t pos = mouse->getCurrentPos();
+	enum wall status;
+	int i;
+
+	for (i = (int) row_plus; i <= (int) col_minus; i++)
+	{
+		status = world->getWall(pos.row, pos.col, (dir_e) i);
+		if (mouse->getWall(pos.row, pos.col, (dir_e) i) == status)
+		{
+			continue;
+		}
+		if (planner == eIncremental)
+		{
+			mouse->updateWall(pos.row, pos.col, (dir_e) i, status);
+		}
+		else
+		{
+			mouse->setWall(pos.row, pos.col, (dir_e) i, status);
+		}
+	}
+}
+
+/**
+ * @brief      Close the walls the mouse has not seen, so that the speed run
+ *             only takes passages found in the exploration
+ */
+template<int Rows, int Cols>
+static void
+closeUnknownWalls (MouseController<Rows, Cols> *mouse, enum planner planner)
+{
+	int row;
+	int col;
+	int i;
+
+	for (row = 0; row < Rows; row++)
+	{
+		for (col = 0; col < Cols; col++)
+		{
+			for (i = (int) row_plus; i <= (int) col_minus; i++)
+			{
+				if (mouse->getWall(row, col, (dir_e) i) != unknown)
+				{
+					continue;
+				}
+				if (planner == eIncremental)
+				{
+					mouse->updateWall(row, col, (dir_e) i, wall);
+				}
+				else
+				{
+					mouse->setWall(row, col, (dir_e) i, wall);
+				}
+			}
+		}
+	}
+}
+
+/**
+ * @brief      Run the mouse from the start until it reaches the goal
+ *
+ * @return     number of cells moved. -1 if the goal is not reached
+ */
+template<int Rows, int Cols>
+static int
+runToGoal (MouseController<Rows, Cols> *world, MouseController<Rows, Cols> *mouse,
+		   enum planner planner, bool visited[Rows][Cols], struct result *pResult,
+		   std::vector<float> *pStepTimes)
+{
+	const int maxSteps = Rows * Cols * 4;
+	double start;
+	double elapsed;
+	dir_e dirToGo;
+	pos_t pos;
+	int steps;
+
+	mouse->setStart(world->index_start_row, world->index_start_col);
+	for (steps = 0; steps < maxSteps; steps++)
+	{
+		pos = mouse->getCurrentPos();
+		visited[pos.row][pos.col] = true;
+
+		start = getCpuTimeUs();
+		senseWalls(world, mouse, planner);
+		if (mouse->isGoal())
+		{
+			return steps;
+		}
+		if (planner == eIncremental)
+		{
+			dirToGo = mouse->getDirectionToGoal();
+			if (dirToGo == eDirError)
+			{
+				return -1;
+			}
+			mouse->setDir(dirToGo);
+			mouse->setPos(mouse->getNextPos());
+		}
+		else
+		{
+			mouse->getDistanceAllCell();
+			if (mouse->getDistance(mouse->index_goal_row, mouse->index_goal_col) == UNREACHED)
+			{
+				return -1;
+			}
+			mouse->getShortestPath();
+			mouse->moveNextCell();
+		}
+		elapsed = getCpuTimeUs() - start;
+
+		pResult->planTotalUs += elapsed;
+		pResult->planSteps++;
+		if (NULL != pStepTimes)
+		{
+			pStepTimes->push_back((float) elapsed);
+		}
+		if (elapsed > pResult->planMaxUs)
+		{
+			pResult->planMaxUs = elapsed;
+		}
+	}
+	return -1;
+}
+
+template<int Rows, int Cols>
+static void
+runMaze (const char *fileName, enum planner planner, struct result *pResult,
+		 std::vector<float> *pStepTimes)
+{
+	/* The world knows every wall from the file */
+	MouseController<Rows, Cols> worldMouse(const_cast<char *>(fileName));
+	MouseController<Rows, Cols> simulatedMouse;
+	MouseController<Rows, Cols> *world = &worldMouse;
+	MouseController<Rows, Cols> *mouse = &simulatedMouse;
+	bool (*visited)[Cols] = new bool[Rows][Cols]();
+	bool (*visitedSpeedRun)[Cols] = new bool[Rows][Cols]();
+	int row;
+	int col;
+
+	memset(pResult, 0, sizeof(*pResult));
+	pResult->rowSize = Rows;
+	pResult->colSize = Cols;
+	pResult->optimalSteps = world->getGoalDistance(world->index_start_row, world->index_start_col);
+
+	mouse->setGoal(world->index_goal_row, world->index_goal_col);
+	pResult->exploreSteps = runToGoal(world, mouse, planner, visited, pResult, pStepTimes);
+	if (pResult->exploreSteps >= 0)
+	{
+		/* The path of the exploration is all known, so the speed run
+		 reaches the goal without guessing at unknown walls */
+		closeUnknownWalls(mouse, planner);
+		pResult->speedRunSteps = runToGoal(world, mouse, planner, visitedSpeedRun, pResult, pStepTimes);
+		pResult->isReached = (pResult->speedRunSteps >= 0);
+	}
+
+	for (row = 0; row < Rows; row++)
+	{
+		for (col = 0; col < Cols; col++)
+		{
+			pResult->visitedCells += visited[row][col] ? 1 : 0;
+		}
+	}
+
+	delete[] visitedSpeedRun;
+	delete[] visited;
+}
+
+void
+addMazeFiles (const char *path, std::vector<std::string> *pPaths)
+{
+	std::vector<std::string> names;
+	struct stat pathStat;
+	struct dirent *entry;
+	DIR *pDir;
+	size_t i;
+
+	if (stat(path, &pathStat) != 0)
+	{
+		fprintf(stderr, "%s: not found\n", path);
+		return;
+	}
+	if (!S_ISDIR(pathStat.st_mode))
+	{
+		pPaths->push_back(path);
+		return;
+	}
+	pDir = opendir(path);
+	if (NULL == pDir)
+	{
+		return;
+	}
+	while ((entry = readdir(pDir)) != NULL)
+	{
+		if (entry->d_name[0] != '.')
+		{
+			names.push_back(entry->d_name);
+		}
+	}
+	closedir(pDir);
+	std::sort(names.begin(), names.end());
+	for (i = 0; i < names.size(); i++)
+	{
+		pPaths->push_back(std::string(path) + "/" + names[i]);
+	}
+}
+
+bool
+getMazeSize (const char *fileName, int *pRows, int *pCols)
+{
+	FILE *pFile = fopen(fileName, "r");
+	int lines = 0;
+	int width = 0;
+	int length = 0;
+	int c;
+
+	if (NULL == pFile)
+	{
+		return false;
+	}
+	while ((c = fgetc(pFile)) != EOF)
+	{
+		if (c == '\n')
+		{
+			if (length > 0)
+			{
+				lines++;
+			}
+			/* readMazeFromFile takes lines trimmed of their trailing spaces,
+			 so the longest one gives the width */
+			width = (length > width) ? length : width;
+			length = 0;
+			continue;
+		}
+		if (c != '\r')
+		{
+			length++;
+		}
+	}
+	if (length > 0)
+	{
+		lines++;
+	}
+	width = (length > width) ? length : width;
+	fclose(pFile);
+
+	*pRows = (lines - 1) / 2;
+	*pCols = (width - 1) / 2;
+	return (*pRows > 0) && (*pCols > 0);
+}
+
+#define simRUN_MAZE(rows, cols)	\
+	if ((rowSize == rows) && (colSize == cols)) \
+	{ \
+		runMaze<rows, cols>(fileName, planner, pResult, pStepTimes); \
+		return true; \
+	}
+
+bool
+runMazeFile (const char *fileName, enum planner planner,
+			 struct result *pResult, std::vector<float> *pStepTimes)
+{
+	int rowSize;
+	int colSize;
+
+	if (!getMazeSize(fileName, &rowSize, &colSize))
+	{
+		return false;
+	}
+	mazeFOR_EACH_SIZE(simRUN_MAZE)
+	fprintf(stderr, "%s: %dx%d maze is not in mazeFOR_EACH_SIZE\n", fileName, rowSize, colSize);
+	return false;
+}
+
+int
+runBenchmark (int argc, char *argv[], const struct benchmark *pBenchmark)
+{
+	std::vector<std::string> paths;
+	struct timing timing;
+	double oldTotal = 0.0;
+	double newTotal = 0.0;
+	int repeats = 100;
+	int mazeCount = 0;
+	int opt;
+	size_t i;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n':
+			repeats = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n repeats] <maze file or directory>...\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if ((optind >= argc) || (repeats < 1))
+	{
+		fprintf(stderr, "Usage: %s [-n repeats] <maze file or directory>...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	for (opt = optind; opt < argc; opt++)
+	{
+		addMazeFiles(argv[opt], &paths);
+	}
+
+	printf("%-32s %5s %6s %9s %9s %7s\r\n", "maze", "size", pBenchmark->distanceName,
+		   pBenchmark->oldName, pBenchmark->newName, "ratio");
+	printf("%-32s %5s %6s %9s %9s %7s\r\n", "", "", "", "(us)", "(us)", "(x)");
+	for (i = 0; i < paths.size(); i++)
+	{
+		memset(&timing, 0, sizeof(timing));
+		timing.repeats = repeats;
+		if (!pBenchmark->timeMazeFile(paths[i].c_str(), &timing))
+		{
+			printf("%-32s unsolved\r\n", paths[i].c_str());
+			continue;
+		}
+		printf("%-32s %2dx%-2d %6d %9.2f %9.2f %7.2f\r\n",
+			   paths[i].substr(paths[i].find_last_of('/') + 1).c_str(), timing.rowSize,
+			   timing.colSize, timing.distance, timing.oldUs, timing.newUs,
+			   (timing.newUs > 0.0) ? timing.oldUs / timing.newUs : 0.0);
+		oldTotal += timing.oldUs;
+		newTotal += timing.newUs;
+		mazeCount++;
+	}
+	printf("%-32s %5s %6s %9.2f %9.2f %7.2f\r\n", "TOTAL", "", "", oldTotal, newTotal,
+		   (newTotal > 0.0) ? oldTotal / newTotal : 0.0);
+	printf("%d mazes, %d repeats\r\n", mazeCount, repeats);
+	return EXIT_SUCCESS;
+}
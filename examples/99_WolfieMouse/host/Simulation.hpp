@@ -0,0 +1,142 @@
+/*
+ * Simulation.hpp
+ *
+ *  Host-side (Linux) simulation of a maze run, shared by the simulator and
+ *  the batch runner. The mouse runs the real MouseController against a
+ *  simulated world: the walls of the world come from a maze file, and the
+ *  mouse only learns a wall when it stands next to it.
+ *
+ *  Everything a run needs lives in the MouseControllers it creates, so runs
+ *  on different threads do not share any state.
+ */
+
+#ifndef Simulation_h
+#define Simulation_h
+
+#include <config_maze.hpp>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+enum planner
+{
+	eFlood, /* getDistanceAllCell -> getShortestPath -> moveNextCell */
+	eIncremental /* updateWall -> getDirectionToGoal */
+};
+
+/**
+ * @brief Result of a run of a maze
+ */
+struct result
+{
+	int rowSize; /* number of rows of the maze */
+	int colSize; /* number of columns of the maze */
+	bool isReached; /* the speed run reached the goal */
+	int exploreSteps; /* cells moved in the exploration */
+	int visitedCells; /* different cells visited in the exploration */
+	int speedRunSteps; /* cells moved in the speed run, through explored passages only */
+	int optimalSteps; /* shortest path in the fully known maze */
+	double planTotalUs; /* planner CPU time of all steps */
+	double planMaxUs; /* planner CPU time of the slowest step */
+	int planSteps; /* number of planner steps */
+};
+
+/**
+ * @brief      CPU time of the calling thread
+ *
+ * @return     time in microseconds
+ */
+double getCpuTimeUs (void);
+
+/**
+ * @brief      Get the size of the maze in the file
+ *
+ * @return     false if the file is not a maze file
+ */
+bool getMazeSize (const char *fileName, int *pRows, int *pCols);
+
+/**
+ * @brief      Add the maze file, or every file of the directory in the order
+ *             of the names, to the list
+ */
+void addMazeFiles (const char *path, std::vector<std::string> *pPaths);
+
+/**
+ * @brief      Explore the maze in the file from the start to the goal, then
+ *             do the speed run
+ *
+ * @param      fileName    maze file in the format of Maze::readMazeFromFile
+ * @param[in]  planner     planner the mouse uses
+ * @param      pResult     result of the run
+ * @param      pStepTimes  if not NULL, the planner CPU time of every step
+ *                         (in microseconds) is appended
+ *
+ * @return     false if the file is not a maze file of a size in
+ *             mazeFOR_EACH_SIZE
+ */
+bool runMazeFile (const char *fileName, enum planner planner,
+				  struct result *pResult, std::vector<float> *pStepTimes);
+
+/**
+ * @brief      Run Benchmark::run<Rows, Cols>(fileName, pArg) with the size of
+ *             the maze in the file
+ *
+ * @return     what run returns. false if the file is not a maze file of a
+ *             size in mazeFOR_EACH_SIZE
+ */
+template<class Benchmark, class Arg>
+bool
+runMazeSize (const char *fileName, Arg *pArg)
+{
+	int rowSize;
+	int colSize;
+
+	if (!getMazeSize(fileName, &rowSize, &colSize))
+	{
+		return false;
+	}
+#define simRUN_MAZE_SIZE(rows, cols)	\
+	if ((rowSize == rows) && (colSize == cols)) \
+	{ \
+		return Benchmark::template run<rows, cols>(fileName, pArg); \
+	}
+	mazeFOR_EACH_SIZE(simRUN_MAZE_SIZE)
+#undef simRUN_MAZE_SIZE
+	fprintf(stderr, "%s: %dx%d maze is not in mazeFOR_EACH_SIZE\n", fileName, rowSize, colSize);
+	return false;
+}
+
+/**
+ * @brief Old and new code timed on a maze
+ */
+struct timing
+{
+	int repeats; /* runs to average over */
+	int rowSize; /* number of rows of the maze */
+	int colSize; /* number of columns of the maze */
+	int distance; /* length of the path the code floods */
+	double oldUs; /* CPU time of a run of the old code */
+	double newUs; /* CPU time of a run of the new code */
+};
+
+/**
+ * @brief A benchmark of old code against new code on every maze given
+ */
+struct benchmark
+{
+	const char *distanceName; /* heading of timing.distance */
+	const char *oldName; /* heading of the old code */
+	const char *newName; /* heading of the new code */
+	/* fill the timing of the maze in the file, e.g. with runMazeSize.
+	 false if the maze is not solved */
+	bool (*timeMazeFile) (const char *fileName, struct timing *pTiming);
+};
+
+/**
+ * @brief      main() of a benchmark: [-n repeats] <maze file or directory>...
+ *             Prints the timings of each maze and the total
+ */
+int runBenchmark (int argc, char *argv[], const struct benchmark *pBenchmark);
+
+#endif
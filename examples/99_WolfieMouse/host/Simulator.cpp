@@ -0,0 +1,118 @@
+/*
+ * Simulator.cpp
+ *
+ *  Host-side (Linux) simulator of WolfieMouse. For each maze, the mouse
+ *  explores from the start to the goal and then does the speed run from the
+ *  start again with what it has learned. See Simulation.hpp.
+ *
+ *  Maze files are in the text format of Maze::readMazeFromFile. The size
+ *  is detected from the file and must be one of mazeFOR_EACH_SIZE.
+ *
+ *  Usage: wolfiemouse-sim [-p flood|incremental] <maze file or directory>...
+ *  Build: make wolfiemouse-sim (at the top of the repository)
+ */
+
+#include "Simulation.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief      Print the header of the report
+ */
+static void
+printHeader (void)
+{
+	printf("%-32s %7s %7s %7s %8s %7s %9s %9s\r\n", "maze", "reached", "explore",
+		   "visited", "speedrun", "optimal", "plan_avg", "plan_max");
+	printf("%-32s %7s %7s %7s %8s %7s %9s %9s\r\n", "", "", "(cells)", "(cells)",
+		   "(cells)", "(cells)", "(us)", "(us)");
+}
+
+static void
+printResult (const char *name, struct result *pResult)
+{
+	printf("%-32s %7s %7d %7d %8d %7d %9.2f %9.2f\r\n", name,
+		   pResult->isReached ? "yes" : "no", pResult->exploreSteps,
+		   pResult->visitedCells, pResult->speedRunSteps, pResult->optimalSteps,
+		   (pResult->planSteps != 0) ? pResult->planTotalUs / pResult->planSteps : 0.0,
+		   pResult->planMaxUs);
+}
+
+int
+main (int argc, char *argv[])
+{
+	enum planner planner = eFlood;
+	std::vector<std::string> paths;
+	struct result result;
+	struct result total;
+	size_t i;
+	int mazeCount = 0;
+	int reachedCount = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "p:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'p':
+			if (strcmp(optarg, "flood") == 0)
+			{
+				planner = eFlood;
+				break;
+			}
+			else if (strcmp(optarg, "incremental") == 0)
+			{
+				planner = eIncremental;
+				break;
+			}
+			/* fall through */
+		default:
+			fprintf(stderr, "Usage: %s [-p flood|incremental] <maze file or directory>...\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind >= argc)
+	{
+		fprintf(stderr, "Usage: %s [-p flood|incremental] <maze file or directory>...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	for (opt = optind; opt < argc; opt++)
+	{
+		addMazeFiles(argv[opt], &paths);
+	}
+
+	memset(&total, 0, sizeof(total));
+	printHeader();
+	for (i = 0; i < paths.size(); i++)
+	{
+		if (runMazeFile(paths[i].c_str(), planner, &result, NULL))
+		{
+			printResult(paths[i].substr(paths[i].find_last_of('/') + 1).c_str(), &result);
+			mazeCount++;
+			reachedCount += result.isReached ? 1 : 0;
+			total.exploreSteps += result.exploreSteps;
+			total.visitedCells += result.visitedCells;
+			total.speedRunSteps += result.speedRunSteps;
+			total.optimalSteps += result.optimalSteps;
+			total.planTotalUs += result.planTotalUs;
+			total.planSteps += result.planSteps;
+			if (result.planMaxUs > total.planMaxUs)
+			{
+				total.planMaxUs = result.planMaxUs;
+			}
+		}
+	}
+
+	total.isReached = (reachedCount == mazeCount);
+	printResult("TOTAL", &total);
+	printf("%d/%d mazes solved with the %s planner\r\n", reachedCount, mazeCount,
+		   (planner == eFlood) ? "flood" : "incremental");
+	return (reachedCount == mazeCount) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
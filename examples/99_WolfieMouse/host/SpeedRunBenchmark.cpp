@@ -0,0 +1,153 @@
+/*
+ * SpeedRunBenchmark.cpp
+ *
+ *  Host-side (Linux) comparison of the speed run paths of WolfieMouse. For
+ *  each maze, with every wall known, it estimates the run time of the
+ *  fewest-cells path of MouseController (90 degree turns only) and of the
+ *  path of SpeedRunPlanner (turn costs and diagonals),
+ *  with the same costs.
+ *
+ *  Costs are the defaults of config_maze.hpp, in units of -u ms (default
+ *  9 ms: a half cell of mazeCOST_STRAIGHT=10 at 1 m/s).
+ *
+ *  Usage: wolfiemouse-speedrun [-u ms per cost] <maze file or directory>...
+ *  Build: make wolfiemouse-speedrun (at the top of the repository)
+ */
+
+#include "Simulation.hpp"
+#include "MouseController.hpp"
+#include "SpeedRunPlanner.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Estimates of a maze
+ */
+struct estimate
+{
+	int cells; /* cells of the shortest path */
+	int floodCost; /* cost of the fewest-cells path */
+	int plannerCost; /* cost of the path of SpeedRunPlanner */
+	int moveCount; /* moves of SpeedRunPlanner */
+	double planUs; /* CPU time of SpeedRunPlanner::plan */
+};
+
+/* The fewest-cells path against the path of SpeedRunPlanner */
+struct speedRunBenchmark
+{
+	template<int Rows, int Cols>
+	static bool
+	run (const char *fileName, struct estimate *pEstimate)
+	{
+		MouseController<Rows, Cols> knownMaze(const_cast<char *>(fileName));
+		MouseController<Rows, Cols> *mouse = &knownMaze;
+		SpeedRunPlanner<Rows, Cols> *planner = new SpeedRunPlanner<Rows, Cols>();
+		std::vector<dir_e> dirs;
+		pos_t start = {mouse->index_start_row, mouse->index_start_col};
+		pos_t goal = {mouse->index_goal_row, mouse->index_goal_col};
+		double startUs;
+		bool isSolved = false;
+		int steps;
+
+		/* The path the mouse takes today: fewest cells, 90 degree turns */
+		mouse->setStart(start.row, start.col);
+		for (steps = 0; steps < Rows * Cols; steps++)
+		{
+			if (mouse->isGoal())
+			{
+				isSolved = true;
+				break;
+			}
+			mouse->getDistanceAllCell();
+			if (mouse->getDistance(goal.row, goal.col) == UNREACHED)
+			{
+				break;
+			}
+			mouse->getShortestPath();
+			mouse->moveNextCell();
+			dirs.push_back(mouse->getCurrentDir());
+		}
+
+		if (isSolved)
+		{
+			pEstimate->cells = (int) dirs.size();
+			pEstimate->floodCost = planner->getCellPathCost(mazeDIRECTION_START, dirs.data(), (int) dirs.size());
+
+			startUs = getCpuTimeUs();
+			pEstimate->plannerCost = planner->plan(mouse, start, mazeDIRECTION_START, goal);
+			pEstimate->planUs = getCpuTimeUs() - startUs;
+			pEstimate->moveCount = planner->getMoveCount();
+			isSolved = (pEstimate->plannerCost != mazeERROR);
+		}
+
+		delete planner;
+		return isSolved;
+	}
+};
+
+int
+main (int argc, char *argv[])
+{
+	std::vector<std::string> paths;
+	struct estimate estimate;
+	double msPerCost = 9.0;
+	double floodTotal = 0.0;
+	double plannerTotal = 0.0;
+	int mazeCount = 0;
+	int opt;
+	size_t i;
+
+	while ((opt = getopt(argc, argv, "u:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'u':
+			msPerCost = atof(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-u ms per cost] <maze file or directory>...\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind >= argc)
+	{
+		fprintf(stderr, "Usage: %s [-u ms per cost] <maze file or directory>...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	for (opt = optind; opt < argc; opt++)
+	{
+		addMazeFiles(argv[opt], &paths);
+	}
+
+	printf("%-32s %6s %9s %9s %7s %6s %9s\r\n", "maze", "cells", "fewest", "planner",
+		   "gain", "moves", "plan");
+	printf("%-32s %6s %9s %9s %7s %6s %9s\r\n", "", "", "(s)", "(s)", "(%)", "", "(us)");
+	for (i = 0; i < paths.size(); i++)
+	{
+		memset(&estimate, 0, sizeof(estimate));
+		if (!runMazeSize<speedRunBenchmark>(paths[i].c_str(), &estimate))
+		{
+			printf("%-32s unsolved\r\n", paths[i].c_str());
+			continue;
+		}
+		printf("%-32s %6d %9.3f %9.3f %7.1f %6d %9.1f\r\n",
+			   paths[i].substr(paths[i].find_last_of('/') + 1).c_str(), estimate.cells,
+			   estimate.floodCost * msPerCost / 1000.0,
+			   estimate.plannerCost * msPerCost / 1000.0,
+			   100.0 * (estimate.floodCost - estimate.plannerCost) / estimate.floodCost,
+			   estimate.moveCount, estimate.planUs);
+		floodTotal += estimate.floodCost * msPerCost / 1000.0;
+		plannerTotal += estimate.plannerCost * msPerCost / 1000.0;
+		mazeCount++;
+	}
+	printf("%-32s %6s %9.3f %9.3f %7.1f\r\n", "TOTAL", "", floodTotal, plannerTotal,
+		   (floodTotal > 0.0) ? 100.0 * (floodTotal - plannerTotal) / floodTotal : 0.0);
+	printf("%d mazes\r\n", mazeCount);
+	return EXIT_SUCCESS;
+}
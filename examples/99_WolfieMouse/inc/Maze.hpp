@@ -3,6 +3,7 @@
 
 #include <config_maze.hpp>
 #include <stdio.h>
+#include <stdint.h>
 
 /**
  * @brief Status of wall
@@ -69,24 +70,129 @@ struct pos_t
 	}
 };
 
+/**
+ * @brief Header of a binary snapshot of Maze. See Maze::snapshot_t
+ */
+struct mazeSnapshotHeader_t
+{
+	uint32_t magic; /* mazeSNAPSHOT_MAGIC */
+	uint16_t version; /* mazeSNAPSHOT_VERSION */
+	uint16_t headerSize; /* sizeof(struct mazeSnapshotHeader_t) */
+	uint16_t rows;
+	uint16_t cols;
+	int16_t startRow;
+	int16_t startCol;
+	int16_t goalRow;
+	int16_t goalCol;
+	uint32_t payloadSize; /* bytes following the header */
+	uint32_t checksum; /* CRC-32 of the bytes following the header */
+};
+
+/**
+ * @brief      Maze of Rows x Cols cells
+ * @details    Member functions are instantiated for the sizes listed in
+ *             mazeFOR_EACH_SIZE (config_maze.hpp).
+ *
+ * @tparam     Rows  number of rows
+ * @tparam     Cols  number of columns
+ */
+template<int Rows = mazeMAX_ROW_SIZE, int Cols = mazeMAX_COL_SIZE>
 class Maze
 {
 private:
-	enum wall rowWall[mazeMAX_ROW_SIZE + 1][mazeMAX_COL_SIZE]; /* walls in y-direction (or row-increasing) */
-	enum wall colWall[mazeMAX_ROW_SIZE][mazeMAX_COL_SIZE + 1]; /* walls in x-direction (or column-increasing)*/
-	struct cell cell[mazeMAX_ROW_SIZE][mazeMAX_COL_SIZE]; /* each cells in the maze */
+	uint32_t rowWall[mazeWALL_WORDS((Rows + 1) * Cols)]; /* walls in y-direction (or row-increasing), mazeWALL_BITS each */
+	uint32_t colWall[mazeWALL_WORDS(Rows * (Cols + 1))]; /* walls in x-direction (or column-increasing), mazeWALL_BITS each */
+	int16_t cellDistance[Rows][Cols]; /* distance of each cells in the maze */
+	uint8_t cellFlag[Rows][Cols]; /* mazeCELL_* flags of each cells in the maze */
+
+	inline enum wall getPackedWall (const uint32_t *words, int index)
+	{
+		int shift = (index % mazeWALLS_PER_WORD) * mazeWALL_BITS;
+		return (enum wall) ((words[index / mazeWALLS_PER_WORD] >> shift) & mazeWALL_MASK);
+	}
+
+	inline void setPackedWall (uint32_t *words, int index, enum wall status)
+	{
+		int shift = (index % mazeWALLS_PER_WORD) * mazeWALL_BITS;
+		uint32_t *word = &words[index / mazeWALLS_PER_WORD];
+		*word = (*word & ~(mazeWALL_MASK << shift))
+				| (((uint32_t) status & mazeWALL_MASK) << shift);
+	}
+
+	/* rowWall[row][col] as if it is (Rows + 1) x Cols array */
+	inline enum wall getRowWall (int row, int col)
+	{
+		return getPackedWall(rowWall, row * Cols + col);
+	}
+	inline void setRowWall (int row, int col, enum wall status)
+	{
+		setPackedWall(rowWall, row * Cols + col, status);
+	}
+
+	/* colWall[row][col] as if it is Rows x (Cols + 1) array */
+	inline enum wall getColWall (int row, int col)
+	{
+		return getPackedWall(colWall, row * (Cols + 1) + col);
+	}
+	inline void setColWall (int row, int col, enum wall status)
+	{
+		setPackedWall(colWall, row * (Cols + 1) + col, status);
+	}
+
+	inline void setCellFlag (int row, int col, uint8_t flag, bool isSet)
+	{
+		if (isSet)
+		{
+			cellFlag[row][col] |= flag;
+		}
+		else
+		{
+			cellFlag[row][col] &= ~flag;
+		}
+	}
 
 	void init();
 
-	void writeMazeToFile(void *pFile, bool isShowMouse);
+	int writeMazeToFile(void *pFile, bool isShowMouse);
 
-	void printCell(int row, int col, bool isShowMouse, void *pFile);
+	char getWallChar(enum wall status, char wallChar);
+	char getCellChar(int row, int col, bool isShowMouse);
 public:
+	/**
+	 * @brief Binary snapshot of the maze. It is the storage of the maze as
+	 *        it is, so it is saved and loaded with a memcpy of each array.
+	 *        It is in the byte order of the machine that saved it.
+	 */
+	struct snapshot_t
+	{
+		struct mazeSnapshotHeader_t header;
+		uint32_t rowWall[mazeWALL_WORDS((Rows + 1) * Cols)];
+		uint32_t colWall[mazeWALL_WORDS(Rows * (Cols + 1))];
+		int16_t cellDistance[Rows][Cols];
+		uint8_t cellFlag[Rows][Cols];
+	};
+
 	int index_goal_row;
 	int index_goal_col;
 	int index_start_row;
 	int index_start_col;
 
+	static const int rowSize = Rows; /**< number of rows */
+	static const int colSize = Cols; /**< number of columns */
+
+	static inline bool isRowOutOfBounds (int row)
+	{
+		return (row >= Rows) || (row < 0);
+	}
+	static inline bool isColOutOfBounds (int col)
+	{
+		return (col >= Cols) || (col < 0);
+	}
+	static inline bool isPosOutOfBounds (int row, int col)
+	{
+		return isRowOutOfBounds(row) || isColOutOfBounds(col);
+	}
+
 	/**
 	 * @brief      maze constructor
 	 */
@@ -137,23 +243,23 @@ public:
 
 	inline int setDistance(int row, int col, int dis)
 	{
-		if (mazeIS_POS_OUT_BOUNDS(row, col))
+		if (isPosOutOfBounds(row, col))
 		{
 			printf("invalid cell!\n");
 			return mazeERROR;
 		}
-		cell[row][col].distance = dis;
+		cellDistance[row][col] = (int16_t) dis;
 		return mazeSUCCESS;
 	}
 
 	inline int getDistance(int row, int col)
 	{
-		if (mazeIS_POS_OUT_BOUNDS(row, col))
+		if (isPosOutOfBounds(row, col))
 		{
 			printf("invalid cell!\n");
 			return mazeERROR;
 		}
-		return cell[row][col].distance;
+		return cellDistance[row][col];
 	}
 
 	/**
@@ -175,8 +281,11 @@ public:
 	 * @brief      construct Maze from file
 	 *
 	 * @param      fileName  filename to construct
+	 *
+	 * @return     mazeERROR if the file cannot be opened or is too short
+	 *             mazeSUCCESS otherwise
 	 */
-	void readMazeFromFile(char* fileName);
+	int readMazeFromFile(char* fileName);
 
 	/**
 	 * @brief      print the current maze
@@ -187,7 +296,52 @@ public:
 	 * @brief      save the maze as file
 	 *
 	 * @param      fileName  filename to save
+	 *
+	 * @return     mazeERROR if failed
+	 *             mazeSUCCESS otherwise
+	 */
+	int saveMazeFile(char* fileName);
+
+	static inline int getSnapshotSize()
+	{
+		return (int) sizeof(struct snapshot_t);
+	}
+
+	/**
+	 * @brief      save the walls, distances, flags, start and goal to a
+	 *             buffer, e.g. to write it to flash
+	 *
+	 * @param      pBuffer     buffer of at least getSnapshotSize() bytes. It
+	 *                         does not need to be aligned
+	 * @param[in]  bufferSize  size of the buffer
+	 *
+	 * @return     mazeERROR if the buffer is too small
+	 *             the size of the snapshot otherwise
+	 */
+	int saveSnapshot(void *pBuffer, int bufferSize);
+
+	/**
+	 * @brief      restore the maze from a snapshot. It can be read from flash
+	 *             or a mmap-ed file directly. The maze is not changed if the
+	 *             snapshot is not valid
+	 *
+	 * @param[in]  pBuffer  snapshot
+	 * @param[in]  size     size of the snapshot
+	 *
+	 * @return     mazeERROR if it is not a snapshot of a Rows x Cols maze of
+	 *             this version, or the checksum does not match
+	 *             mazeSUCCESS otherwise
+	 */
+	int loadSnapshot(const void *pBuffer, int size);
+
+	/**
+	 * @brief      save a snapshot as file, in a single write
+	 */
+	int saveSnapshotFile(char* fileName);
+
+	/**
+	 * @brief      load a snapshot file, in a single read
 	 */
-	void saveMazeFile(char* fileName);
+	int loadSnapshotFile(char* fileName);
 };
 #endif
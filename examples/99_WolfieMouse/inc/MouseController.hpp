@@ -5,6 +5,7 @@
 #include <Maze.hpp>
 #include <PositionController.hpp>
 #include <Queue.hpp>
+#include <PriorityQueue.hpp>
 
 /**
  * @brief      This class it the top level of the mouse control.
@@ -12,42 +13,93 @@
  *  1. call @getDistanceAllCell
  *  2. call @getShortestPath
  *  3. call @moveNextCell
+ *
+ * @tparam     Rows  number of rows of the maze
+ * @tparam     Cols  number of columns of the maze
  */
-class MouseController : public Maze, public PositionController
+template<int Rows = mazeMAX_ROW_SIZE, int Cols = mazeMAX_COL_SIZE>
+class MouseController : public Maze<Rows, Cols>, public PositionController<Rows, Cols>
 {
+public:
+	typedef Maze<Rows, Cols> MazeType;
+	typedef PositionController<Rows, Cols> PositionType;
+
+	/* members of the dependent base classes */
+	using MazeType::index_goal_row;
+	using MazeType::index_goal_col;
+	using MazeType::index_start_row;
+	using MazeType::index_start_col;
+	using MazeType::isPosOutOfBounds;
+	using MazeType::getWall;
+	using MazeType::setWall;
+	using PositionType::setPos;
+	using PositionType::setDir;
+	using PositionType::getCurrentPos;
+	using PositionType::getCurrentDir;
+	using PositionType::getNextPos;
+	using PositionType::getNextDir;
+
 private:
-	Queue<PositionController> pathStack; /**< This is an assistant stack. When @getShortestPath invoked the path to the goal is cunstructed. */
-	Queue<PositionController> availablePositionStack; /**< I don't even know what is this. */
+	static const int infiniteDistance = Rows * Cols; /**< longer than any path in the maze */
+	static const int goalDistanceQueueSize = Rows * Cols / 4;
+
+	Queue<PositionType, Rows * Cols> pathStack; /**< This is an assistant stack. When @getShortestPath invoked the path to the goal is cunstructed. */
+	Queue<pos_t, Rows * Cols> floodQueue; /**< Cells waiting to be flooded. Used by @getDistanceAllCell */
+
+	/* Incremental (LPA*) planner. Distances are rooted at the goal so they
+	 stay valid when the mouse moves. See IncrementalPlanner.cpp */
+	int16_t goalDistance[Rows][Cols]; /**< g: distance to the goal of each cell */
+	int16_t goalDistanceRhs[Rows][Cols]; /**< rhs: one-step lookahead of @goalDistance */
+	/** Inconsistent cells (g != rhs) waiting to be repaired, as
+	 row * Cols + col. A repair that does not fit falls back to
+	 @floodGoalDistance, so it is only as big as most repairs need */
+	PriorityQueue<uint16_t, goalDistanceQueueSize, int16_t> goalDistanceQueue;
+	bool isGoalDistanceOverflowed; /**< @goalDistanceQueue was full during a repair */
+
+	static inline uint16_t getCellIndex (pos_t pos)
+	{
+		return (uint16_t) (pos.row * Cols + pos.col);
+	}
+	static inline pos_t getCellPos (uint16_t index)
+	{
+		return (pos_t){index / Cols, index % Cols};
+	}
 
 	void init();
 
 	inline int getDis(int row, int col)
 	{
-		return Maze::getDistance(row, col);
+		return MazeType::getDistance(row, col);
 	}
 	inline int getDis (struct pos_t pos)
 	{
-		return Maze::getDistance(pos.row, pos.col);
+		return MazeType::getDistance(pos.row, pos.col);
 	}
-	inline int getDis (PositionController pos)
+	inline int getDis (PositionType pos)
 	{
 		pos_t position = pos.getCurrentPos();
-		return Maze::getDistance(position.row, position.col);
+		return MazeType::getDistance(position.row, position.col);
 	}
-	inline int getNextDis (PositionController pos, dir_e dirTo)
+	inline int getNextDis (PositionType pos, dir_e dirTo)
 	{
-		PositionController tmp = PositionController(pos.getCurrentPos(),
-													dirTo);
-		return getDis(tmp.getNextPos());
+		PositionType tmp = PositionType(pos.getCurrentPos(),
+										dirTo);
+		pos_t next = tmp.getNextPos();
+		/* There is no cell beyond the edge */
+		if (isPosOutOfBounds(next.row, next.col))
+		{
+			return UNREACHED;
+		}
+		return getDis(next);
 	}
-	inline int getNextDis (PositionController pos)
+	inline int getNextDis (PositionType pos)
 	{
 		return getDis(pos.getNextPos());
 	}
 
 	inline int setDis(int row, int col, int dis)
 	{
-		return Maze::setDistance(row, col, dis);
+		return MazeType::setDistance(row, col, dis);
 	}
 	inline void setDis (struct pos_t pos, int dis)
 	{
@@ -55,12 +107,16 @@ private:
 	}
 
 	void initDistance ();
-	int getHighestNeighbouringDistance (int row, int col);
 	dir_e getDirectionToGo ();
 	struct cell getCell(pos_t pos);
 	void updateCell();
 
 	void setDirectionToGo ();
+
+	int getGoalRhs (pos_t pos);
+	void updateGoalDistance (pos_t pos);
+	int repairGoalDistance ();
+	int floodGoalDistance ();
 	/** On development
 	 void moveNextCell();
 	 void movingCompleted();
@@ -84,10 +140,61 @@ public:
 	void getShortestPath ();
 
 	void moveNextCell();
+
+	/**
+	 * @brief      move the mouse to the start cell
+	 *
+	 * @param[in]  row   row index of the start cell
+	 * @param[in]  col   column index of the start cell
+	 */
+	void setStart (int row, int col);
+
+	/**
+	 * @brief      change the goal cell and rebuild the distance to the goal
+	 *
+	 * @param[in]  row   row index of the goal cell
+	 * @param[in]  col   column index of the goal cell
+	 */
+	void setGoal (int row, int col);
+
+	/**
+	 * @brief      compute the distance to the goal of all cells from scratch.
+	 *             Call it again when the goal is changed.
+	 *
+	 * @return     number of cells touched
+	 */
+	int initGoalDistance ();
+
+	/**
+	 * @brief      set status of a wall and repair only the distances to the
+	 *             goal that are changed by it
+	 *
+	 * @param[in]  row     row index of cell
+	 * @param[in]  col     column index of cell
+	 * @param[in]  dir     direction of wall you are looking at
+	 * @param[in]  status  staus of wall updating
+	 *
+	 * @return     mazeERROR if failed
+	 *             number of cells touched otherwise
+	 */
+	int updateWall (int row, int col, dir_e dir, enum wall status);
+
+	/**
+	 * @brief      get the distance to the goal kept by @updateWall
+	 *
+	 * @return     UNREACHED if the goal cannot be reached from the cell
+	 */
+	int getGoalDistance (int row, int col);
+
+	/**
+	 * @brief      get the direction to the neighbouring cell closest to the goal
+	 *
+	 * @return     eDirError if the goal cannot be reached or is reached already
+	 */
+	dir_e getDirectionToGoal ();
 	bool isGoal ();
 	bool isStart ();
 
 	void printPathStack();
-	void printAvailablePositionStack();
 };
 #endif
@@ -3,6 +3,13 @@
 
 #include <Maze.hpp>
 
+/**
+ * @brief      Position and direction of the mouse in a Rows x Cols maze
+ *
+ * @tparam     Rows  number of rows
+ * @tparam     Cols  number of columns
+ */
+template<int Rows = mazeMAX_ROW_SIZE, int Cols = mazeMAX_COL_SIZE>
 class PositionController
 {
 private:
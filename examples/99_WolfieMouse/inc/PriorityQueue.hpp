@@ -0,0 +1,172 @@
+#ifndef PriorityQueue_h
+#define PriorityQueue_h
+
+#include <config_maze.hpp>
+
+#ifndef mazePRIORITY_QUEUE_MAX_BUFFER
+#define mazePRIORITY_QUEUE_MAX_BUFFER 1000
+#warning "mazePRIORITY_QUEUE_MAX_BUFFER is not defined to we use default size 1000"
+#endif
+
+/**
+ * @brief      Min-priority queue (binary heap) without using dynamic memory
+ *             allocation
+ *
+ * @tparam     T     type of class
+ * @tparam     N     capacity of the queue
+ * @tparam     K     type of the keys. A smaller one makes a smaller heap
+ */
+template<class T, int N = mazePRIORITY_QUEUE_MAX_BUFFER, class K = int>
+	class PriorityQueue
+	{
+	private:
+		struct node
+		{
+			K key; /* priority. The smallest comes out first */
+			T obj; /* object stored */
+		};
+		node buffer[N]; /* heap inside the queue */
+		int size; /* number of objects currently stored in the queue */
+
+		inline void
+		swap (int a, int b)
+		{
+			node tmp = buffer[a];
+			buffer[a] = buffer[b];
+			buffer[b] = tmp;
+		}
+
+	public:
+
+		/**
+		 * @brief      constructor of the class
+		 */
+		PriorityQueue ()
+		{
+			init();
+		}
+
+		/**
+		 * @brief      initialize the PriorityQueue
+		 */
+		void
+		init ()
+		{
+			size = 0;
+		}
+
+		/**
+		 * @brief      push an object to the PriorityQueue
+		 *
+		 * @param[in]  key   priority of the object
+		 * @param[in]  obj   object to push
+		 *
+		 * @return     On Success: the size of PriorityQueue
+		 *             On failure: -1
+		 */
+		int
+		push (int key, T obj)
+		{
+			int child;
+			int parent;
+			if (isFull())
+			{
+				return -1;
+			}
+			/* put it at the bottom and sift up */
+			child = size;
+			buffer[child].key = (K) key;
+			buffer[child].obj = obj;
+			size++;
+			while (child > 0)
+			{
+				parent = (child - 1) / 2;
+				if (buffer[parent].key <= buffer[child].key)
+				{
+					break;
+				}
+				swap(parent, child);
+				child = parent;
+			}
+			return size;
+		}
+
+		/**
+		 * @brief      pop the object with the smallest key
+		 *
+		 * @return     On Success: an object with the smallest key
+		 *             On failure: T()
+		 */
+		T
+		pop ()
+		{
+			T top;
+			int parent;
+			int child;
+			if (isEmpty())
+			{
+				return T();
+			}
+			top = buffer[0].obj;
+			/* move the bottom to the top and sift down */
+			size--;
+			buffer[0] = buffer[size];
+			parent = 0;
+			while ((child = parent * 2 + 1) < size)
+			{
+				if ((child + 1 < size) && (buffer[child + 1].key < buffer[child].key))
+				{
+					child++;
+				}
+				if (buffer[parent].key <= buffer[child].key)
+				{
+					break;
+				}
+				swap(parent, child);
+				parent = child;
+			}
+			return top;
+		}
+
+		/**
+		 * @brief      peek the smallest key
+		 *
+		 * @return     On Success: the smallest key
+		 *             On failure: -1
+		 */
+		int
+		peekKey ()
+		{
+			if (!isEmpty())
+			{
+				return buffer[0].key;
+			}
+			return -1;
+		}
+
+		/**
+		 * @brief      check if the PriorityQueue is empty
+		 *
+		 * @return     if empty: True
+		 *             if not: false
+		 */
+		bool
+		isEmpty ()
+		{
+			return (size == 0);
+		}
+
+		/**
+		 * @brief      check if the PriorityQueue is full
+		 *
+		 * @return     if full: True
+		 *             if not: false
+		 */
+		bool
+		isFull ()
+		{
+			return (size == N);
+		}
+	};
+
+#endif
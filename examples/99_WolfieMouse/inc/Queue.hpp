@@ -3,54 +3,142 @@
 
 #include <config_maze.hpp>
 #include <stdlib.h>
+#include <new>
+#include <utility>
 
 #ifndef mazeQUEUE_MAX_BUFFER
 #define mazeQUEUE_MAX_BUFFER 1000
 #warning "mazeQUEUE_MAX_BUFFER is not defined to we use default size 1000"
 #endif
 
-#define safeIncrease(index) if(index != (mazeQUEUE_MAX_BUFFER - 1)) \
-        index++; \
-      else \
-        index = 0
-#define safeDecrease(index) if(index != 0) \
-        index--; \
-      else \
-        index = mazeQUEUE_MAX_BUFFER - 1
-
 /**
  * @brief      Double-sided queue without using dynamic memory allocation
+ * @details    Objects are constructed in place in a ring buffer whose size is
+ *             rounded up to a power of two, so wrapping an index is a single
+ *             mask. Popped objects are moved out, not copied.
  *
  * @tparam     T     type of class
+ * @tparam     N     capacity of the queue
  */
-template<class T>
+template<class T, int N = mazeQUEUE_MAX_BUFFER>
 	class Queue
 	{
 	private:
-		T buffer[mazeQUEUE_MAX_BUFFER]; /* buffer inside the queue */
-		int front; /* index of front */
-		int back; /* index of back */
-		int size; /* number of objects currently stored in the queue */
+		/* the smallest power of two that is not less than n */
+		static constexpr unsigned int
+		roundUpPowerOfTwo (unsigned int n, unsigned int power = 1)
+		{
+			return (power >= n) ? power : roundUpPowerOfTwo(n, power << 1);
+		}
+
+		static constexpr unsigned int bufferSize = roundUpPowerOfTwo(N);
+		static constexpr unsigned int mask = bufferSize - 1;
+
+		/* buffer inside the queue. Objects are constructed only when pushed */
+		alignas(T) unsigned char buffer[bufferSize * sizeof(T)];
+		unsigned int front; /* index of front */
+		unsigned int size; /* number of objects currently stored in the queue */
+
+		inline T*
+		slot (unsigned int index)
+		{
+			return reinterpret_cast<T*>(buffer) + (index & mask);
+		}
+
+		inline unsigned int
+		backIndex ()
+		{
+			return front + size - 1;
+		}
 
 	public:
+		static_assert(N > 0, "Queue needs a positive capacity");
 
 		/**
 		 * @brief      constructor of the class
 		 */
 		Queue ()
+		: front(0), size(0)
+		{
+		}
+
+		~Queue ()
 		{
 			init();
 		}
 
+		/* A queue is kilobytes long. Use init() instead of copying a new one */
+		Queue (const Queue&) = delete;
+		Queue& operator= (const Queue&) = delete;
+
 		/**
-		 * @brief      initialize the Queue
+		 * @brief      capacity of the queue
+		 */
+		static constexpr int
+		capacity ()
+		{
+			return N;
+		}
+
+		/**
+		 * @brief      initialize the Queue. Objects left are destroyed.
 		 */
 		void
 		init ()
 		{
+			while (size != 0)
+			{
+				slot(backIndex())->~T();
+				size--;
+			}
 			front = 0;
-			back = 0;
-			size = 0;
+		}
+
+		/**
+		 * @brief      construct an object at the back of the Queue
+		 *
+		 * @param[in]  args  arguments to the constructor of T
+		 *
+		 * @return     On Success: the size of Queue
+		 *             On failure: -1
+		 */
+		template<class... Args>
+		int
+		emplaceBack (Args&&... args)
+		{
+			if (isFull())
+			{
+				return -1;
+			}
+			unsigned int count = size; /* see @popFromFront */
+			new (slot(front + count)) T(std::forward<Args>(args)...);
+			size = count + 1; /* Increase the size */
+			return (int) size;
+		}
+
+		/**
+		 * @brief      construct an object at the front of the Queue
+		 *
+		 * @param[in]  args  arguments to the constructor of T
+		 *
+		 * @return     On Success: the size of Queue
+		 *             On failure: -1
+		 */
+		template<class... Args>
+		int
+		emplaceFront (Args&&... args)
+		{
+			if (isFull())
+			{
+				return -1;
+			}
+			unsigned int index = (front - 1) & mask; /* see @popFromFront */
+			unsigned int count = size;
+			new (slot(index)) T(std::forward<Args>(args)...);
+			/* decrease the front */
+			front = index;
+			size = count + 1; /* Increase the size */
+			return (int) size;
 		}
 
 		/**
@@ -64,15 +152,7 @@ template<class T>
 		int
 		pushToBack (T obj)
 		{
-			if (!isFull())
-			{
-				/* Increase the back */
-				safeIncrease(back);
-				size++; /* Increase the size */
-				buffer[back] = obj; /* fill the object later */
-				return size;
-			}
-			return -1;
+			return emplaceBack(std::move(obj));
 		}
 
 		/**
@@ -86,16 +166,7 @@ template<class T>
 		int
 		pushToFront (T obj)
 		{
-			if (!isFull())
-			{
-				/* fill the object first */
-				buffer[front] = obj;
-				/* decrease the front */
-				safeDecrease(front);
-				size++; /* Increase the size */
-				return size;
-			}
-			return -1;
+			return emplaceFront(std::move(obj));
 		}
 
 		/**
@@ -107,16 +178,16 @@ template<class T>
 		T
 		popFromBack ()
 		{
-			T temp;
-			if (!isEmpty())
+			if (isEmpty())
 			{
-				temp = buffer[back];
-				/* decrease back */
-				safeDecrease(back);
-				size--; /* decrease the size */
-				return temp;
+				return T();
 			}
-			return T();
+			unsigned int count = size; /* see @popFromFront */
+			T *pObj = slot(front + count - 1);
+			T obj(std::move(*pObj));
+			pObj->~T();
+			size = count - 1; /* decrease the size */
+			return obj;
 		}
 
 		/**
@@ -128,20 +199,25 @@ template<class T>
 		T
 		popFromFront ()
 		{
-			T temp;
-			if (!isEmpty())
+			if (isEmpty())
 			{
-				temp = buffer[front + 1];
-				/* Increase the front */
-				safeIncrease(front);
-				size--; /* decrease the size */
-				return temp;
+				return T();
 			}
-			return T();
+			/* The indexes are read before the object is touched: a T may
+			 alias them, so they would be loaded again after each access */
+			unsigned int index = front;
+			unsigned int count = size;
+			T *pObj = slot(index);
+			T obj(std::move(*pObj));
+			pObj->~T();
+			/* Increase the front */
+			front = (index + 1) & mask;
+			size = count - 1; /* decrease the size */
+			return obj;
 		}
 
 		/**
-		 * @brief      pop the Queue from back
+		 * @brief      peek the Queue from back
 		 *
 		 * @return     On Success: an object from the back
 		 *             On failure: T()
@@ -151,13 +227,13 @@ template<class T>
 		{
 			if (!isEmpty())
 			{
-				return buffer[back];
+				return *slot(backIndex());
 			}
 			return T();
 		}
 
 		/**
-		 * @brief      pop the Queue from front
+		 * @brief      peek the Queue from front
 		 *
 		 * @return     On Success: an object from the front
 		 *             On failure: T()
@@ -167,7 +243,7 @@ template<class T>
 		{
 			if (!isEmpty())
 			{
-				return buffer[front + 1];
+				return *slot(front);
 			}
 			return T();
 		}
@@ -181,11 +257,7 @@ template<class T>
 		bool
 		isEmpty ()
 		{
-			if (size != 0)
-			{
-				return false;
-			}
-			return true;
+			return (size == 0);
 		}
 
 		/**
@@ -197,23 +269,26 @@ template<class T>
 		bool
 		isFull ()
 		{
-			if (size != mazeQUEUE_MAX_BUFFER)
-			{
-				return false;
-			}
-			return true;
+			return (size == (unsigned int) N);
+		}
+
+		/**
+		 * @brief      get the number of objects in the Queue
+		 */
+		int
+		getSize ()
+		{
+			return (int) size;
 		}
 
 		void
 		print (void (T::*pvPrint)(T))
 		{
 			T tmp;
-			int i;
-			int j;
-			for(i = 0, j = front; i<size; i++)
+			unsigned int i;
+			for(i = 0; i < size; i++)
 			{
-				(tmp.*pvPrint)(buffer[j]);
-				safeIncrease(j);
+				(tmp.*pvPrint)(*slot(front + i));
 			}
 		}
 	};
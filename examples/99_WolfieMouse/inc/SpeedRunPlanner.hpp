@@ -0,0 +1,166 @@
+#ifndef SpeedRunPlanner_h
+#define SpeedRunPlanner_h
+
+#include <Maze.hpp>
+#include <Queue.hpp>
+#include <PriorityQueue.hpp>
+#include <stdint.h>
+
+/**
+ * @brief Move of the speed run. Left and right are those of
+ *        PositionController::turnLeft() and turnRight()
+ */
+typedef enum
+{
+	eMoveError = -1, /* indicate error */
+	eMoveStraight = 0, /* go straight @count half cells */
+	eMoveDiagonal, /* go diagonal @count half cells (corner to corner of a quarter) */
+	eMoveTurnLeft45,
+	eMoveTurnRight45,
+	eMoveTurnLeft90,
+	eMoveTurnRight90,
+	eMoveTurn180
+} move_e;
+
+struct move_t
+{
+	move_e move;
+	int count; /* half cells of eMoveStraight and eMoveDiagonal. 1 otherwise */
+};
+
+/**
+ * @brief Costs of SpeedRunPlanner. Any unit, as long as it is the same for
+ *        all of them (e.g. estimated ms)
+ */
+struct speedRunCost_t
+{
+	uint16_t straight; /* half a cell of straight */
+	uint16_t diagonal; /* half a cell of diagonal */
+	uint16_t turn45;
+	uint16_t turn90;
+	uint16_t turn180;
+};
+
+/**
+ * @brief      Fastest path for the speed run
+ * @details    Unlike MouseController::getShortestPath, which minimizes the
+ *             number of cells, this minimizes the cost of the moves:
+ *             straights, diagonals and turns. It is a Dijkstra over
+ *             (half-cell point, heading) states. The points are the cell
+ *             centres and the middle of the walls between cells, and the
+ *             heading is one of 8 directions 45 degrees apart:
+ *              - At a cell centre the mouse goes straight in one of the four
+ *                dir_e, and may turn 90 or 180 degrees.
+ *              - At the middle of an open wall it may turn 45 degrees into
+ *                or out of a diagonal, or 90 degrees between diagonals, and
+ *                a diagonal goes to the middle of the next wall.
+ *             A wall that is not `wall` is open, like getDistanceAllCell.
+ *             A 16x16 planner takes about 18 KB, a 32x32 one about 67 KB.
+ *
+ * @tparam     Rows  number of rows of the maze
+ * @tparam     Cols  number of columns of the maze
+ */
+template<int Rows = mazeMAX_ROW_SIZE, int Cols = mazeMAX_COL_SIZE>
+class SpeedRunPlanner
+{
+private:
+	static const int pointRows = Rows * 2 + 1;
+	static const int pointCols = Cols * 2 + 1;
+	static const int headings = 8;
+	/* The states of a cell: 4 headings at its centre, and the 6 headings
+	 that cross each of its row_minus and col_minus walls. Posts and the
+	 headings along a wall have none. The last row and column of walls
+	 take one more row and column of cells */
+	static const int statesPerCell = 4 + 6 + 6;
+	static const int stateSize = (Rows + 1) * (Cols + 1) * statesPerCell;
+	static const uint16_t infiniteCost = 0xFFFF;
+	static const uint8_t fromNone = 0xF; /* start or unreached */
+	static const uint8_t fromMove = headings; /* moved from behind */
+
+	struct speedRunCost_t cost;
+	uint16_t stateCost[stateSize]; /**< cost from the start of each state */
+	uint8_t stateFrom[(stateSize + 1) / 2]; /**< fromMove, or the heading turned from. 4 bits each */
+	PriorityQueue<uint16_t, Rows * Cols * 2, uint16_t> stateQueue; /**< Open states of the Dijkstra */
+	Queue<move_t, Rows * Cols * 2> moveQueue; /**< Moves found by @plan */
+	bool isOverflowed; /**< @stateQueue was full during @plan */
+
+	int getState (int row, int col, int heading);
+	void getPoint (int state, int *pRow, int *pCol, int *pHeading);
+
+	inline uint8_t getFrom (int state)
+	{
+		return (stateFrom[state / 2] >> ((state % 2) * 4)) & 0xF;
+	}
+	inline void setFrom (int state, uint8_t from)
+	{
+		int shift = (state % 2) * 4;
+		stateFrom[state / 2] = (uint8_t) ((stateFrom[state / 2] & ~(0xF << shift)) | (from << shift));
+	}
+
+	bool isOpen (Maze<Rows, Cols> *pMaze, int row, int col);
+	bool isHeadingAllowed (int row, int col, int heading);
+	void relax (int state, int newCost, uint8_t from);
+	int getTurnCost (int turn);
+	move_e getTurnMove (int turn);
+	void buildMoves (int state);
+	int planCells (Maze<Rows, Cols> *pMaze, pos_t start, dir_e startDir, pos_t goal);
+
+public:
+	SpeedRunPlanner ();
+
+	/**
+	 * @brief      set the costs used by @plan
+	 */
+	inline void setCost (struct speedRunCost_t costToSet)
+	{
+		cost = costToSet;
+	}
+
+	/**
+	 * @brief      find the fastest path from the start to the goal
+	 *
+	 * @param      pMaze     maze to plan in
+	 * @param[in]  start     cell to start. The mouse is at the centre
+	 * @param[in]  startDir  heading at the start
+	 * @param[in]  goal      cell to stop at the centre
+	 *
+	 * @return     the estimated cost of the path. Moves are available from
+	 *             @popMove. If the queue overflows, it is the path of the
+	 *             fewest cells instead, with 90 degree turns only.
+	 *             mazeERROR if there is no path
+	 */
+	int plan (Maze<Rows, Cols> *pMaze, pos_t start, dir_e startDir, pos_t goal);
+
+	/**
+	 * @brief      estimated cost of a path of cells (e.g. the path of
+	 *             MouseController::getShortestPath), with the same costs
+	 *
+	 * @param[in]  startDir  heading at the start
+	 * @param[in]  dirs      direction of each cell to cell step
+	 * @param[in]  count     number of steps
+	 */
+	int getCellPathCost (dir_e startDir, const dir_e *dirs, int count);
+
+	inline int getMoveCount ()
+	{
+		return moveQueue.getSize();
+	}
+
+	/**
+	 * @brief      take the next move to execute
+	 *
+	 * @return     {eMoveError, 0} if there is no more move
+	 */
+	inline move_t popMove ()
+	{
+		if (moveQueue.isEmpty())
+		{
+			return (move_t){eMoveError, 0};
+		}
+		return moveQueue.popFromFront();
+	}
+
+	void printMoves ();
+};
+
+#endif
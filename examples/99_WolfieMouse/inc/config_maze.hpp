@@ -2,24 +2,38 @@
 #ifndef __CONFIG_MAZE_H
 #define __CONFIG_MAZE_H
 
+/* Default maze dimensions used by Maze<>, MouseController<> and so on */
 #define mazeMAX_ROW_SIZE	16
 #define mazeMAX_COL_SIZE	16
+/* Maze dimensions compiled into the library. Add X(rows, cols) for another size */
+#define mazeFOR_EACH_SIZE(X)	X(16, 16) X(32, 32)
+/* Default capacity of Queue<T> and PriorityQueue<T> */
 #define mazeQUEUE_MAX_BUFFER (mazeMAX_COL_SIZE*mazeMAX_ROW_SIZE)
+#define mazePRIORITY_QUEUE_MAX_BUFFER (mazeQUEUE_MAX_BUFFER*2)
 #define mazeDIRECTION_START row_plus
 
-#define mazeIS_ROW_SAFE_TO_MOVE_FORWARD(row)	(row < (mazeMAX_ROW_SIZE - 1))
-#define mazeIS_ROW_SAFE_TO_MOVE_BACKWARD(row)	(row > 0)
-#define mazeIS_ROW_SAFE_TO_MOVE(row)	(mazeIS_ROW_SAFE_TO_MOVE_FORWARD(row) && mazeIS_ROW_SAFE_TO_MOVE_BACKWARD(row))		
-
-#define mazeIS_COL_SAFE_TO_MOVE_FORWARD(col)	(col < (mazeMAX_COL_SIZE - 1))
-#define mazeIS_COL_SAFE_TO_MOVE_BACKWARD(col)	(col > 0)
-#define mazeIS_COL_SAFE_TO_MOVE(col)	(mazeIS_COL_SAFE_TO_MOVE_FORWARD(col) && mazeIS_COL_SAFE_TO_MOVE_BACKWARD(col))
-
-#define mazeIS_POS_SAFE_TO_MOVE(row, col)	(mazeIS_ROW_SAFE_TO_MOVE(row) && mazeIS_COL_SAFE_TO_MOVE(col))
-
-#define mazeIS_ROW_OUT_BOUNDS(row)	((row >= mazeMAX_ROW_SIZE) || (row < 0))
-#define mazeIS_COL_OUT_BOUNDS(col)	((col >= mazeMAX_COL_SIZE) || (col < 0))
-#define mazeIS_POS_OUT_BOUNDS(row, col)	(mazeIS_ROW_OUT_BOUNDS(row) || mazeIS_COL_OUT_BOUNDS(col))
+/* Bit-packed storage of the maze */
+#define mazeWALL_BITS	2 /* bits to store a wall */
+#define mazeWALL_MASK	0x3U
+#define mazeWALLS_PER_WORD	(32 / mazeWALL_BITS)
+#define mazeWALL_WORDS(walls)	(((walls) + mazeWALLS_PER_WORD - 1) / mazeWALLS_PER_WORD)
+
+#define mazeCELL_SEARCHED	0x01U /* all walls around a cell are searched */
+#define mazeCELL_MOUSE	0x02U
+#define mazeCELL_GOAL	0x04U
+#define mazeCELL_START	0x08U
+
+/* Binary snapshot of Maze (Maze::saveSnapshot) */
+#define mazeSNAPSHOT_MAGIC	0x315A4D57UL /* "WMZ1" in little endian */
+#define mazeSNAPSHOT_VERSION	1
+
+/* Default costs of SpeedRunPlanner. A half cell of straight costs
+ mazeCOST_STRAIGHT, so the others are relative to it */
+#define mazeCOST_STRAIGHT	10 /* half a cell, orthogonal */
+#define mazeCOST_DIAGONAL	7 /* half a cell diagonal (1/sqrt(2) of a straight) */
+#define mazeCOST_TURN45	6
+#define mazeCOST_TURN90	12
+#define mazeCOST_TURN180	40
 
 #define mazeSTART_DISTANCE 0
 #define UNREACHED	-1
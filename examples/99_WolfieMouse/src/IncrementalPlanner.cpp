@@ -0,0 +1,304 @@
+/*
+ * IncrementalPlanner.cpp
+ *
+ *  Incremental replanning of the distance to the goal (Lifelong Planning A*
+ *  without heuristic). The distance of each cell is g, and rhs is the
+ *  one-step lookahead: rhs = min(g of accessible neighbours) + 1. A cell is
+ *  consistent when g == rhs. When a wall changes, only the two cells beside
+ *  it can become inconsistent, and the repair spreads from them in the order
+ *  of distance until every cell is consistent again. Cells whose distance is
+ *  not changed by the wall are never touched.
+ */
+
+#include "MouseController.hpp"
+
+#define MIN(a, b)	(((a) < (b)) ? (a) : (b))
+
+template<int Rows, int Cols>
+int
+MouseController<Rows, Cols>::initGoalDistance ()
+{
+	int row;
+	int col;
+
+	goalDistanceQueue.init();
+	for (row = 0; row < Rows; row++)
+	{
+		for (col = 0; col < Cols; col++)
+		{
+			goalDistance[row][col] = infiniteDistance;
+			goalDistanceRhs[row][col] = infiniteDistance;
+		}
+	}
+	/* The goal is the only inconsistent cell at first */
+	goalDistanceRhs[index_goal_row][index_goal_col] = mazeSTART_DISTANCE;
+	goalDistanceQueue.push(mazeSTART_DISTANCE, getCellIndex((pos_t){index_goal_row, index_goal_col}));
+	isGoalDistanceOverflowed = false;
+
+	return repairGoalDistance();
+}
+
+template<int Rows, int Cols>
+int
+MouseController<Rows, Cols>::updateWall (int row, int col, dir_e dir, enum wall status)
+{
+	PositionType cursor = PositionType(row, col, dir);
+	pos_t next = cursor.getNextPos();
+
+	if (getWall(row, col, dir) == status)
+	{
+		/* nothing changed */
+		return 0;
+	}
+	if (setWall(row, col, dir, status) == mazeERROR)
+	{
+		return mazeERROR;
+	}
+	MazeType::updateCell(row, col);
+	MazeType::updateCell(next.row, next.col);
+	MazeType::setMouse(getCurrentPos().row, getCurrentPos().col);
+
+	/* Only the cells on the both sides of the wall can be inconsistent */
+	updateGoalDistance((pos_t){row, col});
+	if (!isPosOutOfBounds(next.row, next.col))
+	{
+		updateGoalDistance(next);
+	}
+	return repairGoalDistance();
+}
+
+template<int Rows, int Cols>
+int
+MouseController<Rows, Cols>::getGoalDistance (int row, int col)
+{
+	if (isPosOutOfBounds(row, col))
+	{
+		return mazeERROR;
+	}
+	if (goalDistance[row][col] >= infiniteDistance)
+	{
+		return UNREACHED;
+	}
+	return goalDistance[row][col];
+}
+
+template<int Rows, int Cols>
+dir_e
+MouseController<Rows, Cols>::getDirectionToGoal ()
+{
+	pos_t current = getCurrentPos();
+	pos_t next;
+	dir_e dirToGo = eDirError;
+	int minDistance = goalDistance[current.row][current.col];
+	int i;
+
+	/* Look around in counter-clockwise */
+	for (i = (int) row_plus; i <= (int) col_minus; i++)
+	{
+		if (wall == getWall(current.row, current.col, (dir_e) i))
+		{
+			continue;
+		}
+		next = getNextPos((dir_e) i);
+		if (isPosOutOfBounds(next.row, next.col))
+		{
+			continue;
+		}
+		if (goalDistance[next.row][next.col] < minDistance)
+		{
+			minDistance = goalDistance[next.row][next.col];
+			dirToGo = (dir_e) i;
+		}
+	}
+	return dirToGo;
+}
+
+template<int Rows, int Cols>
+int
+MouseController<Rows, Cols>::getGoalRhs (pos_t pos)
+{
+	PositionType cursor = PositionType(pos, row_plus);
+	pos_t next;
+	int rhs = infiniteDistance;
+	int i;
+
+	if ((pos.row == index_goal_row) && (pos.col == index_goal_col))
+	{
+		return mazeSTART_DISTANCE;
+	}
+	for (i = (int) row_plus; i <= (int) col_minus; i++)
+	{
+		if (wall == getWall(pos.row, pos.col, (dir_e) i))
+		{
+			continue;
+		}
+		next = cursor.getNextPos((dir_e) i);
+		if (isPosOutOfBounds(next.row, next.col))
+		{
+			continue;
+		}
+		rhs = MIN(rhs, goalDistance[next.row][next.col] + 1);
+	}
+	return MIN(rhs, infiniteDistance);
+}
+
+template<int Rows, int Cols>
+void
+MouseController<Rows, Cols>::updateGoalDistance (pos_t pos)
+{
+	int16_t *g = &goalDistance[pos.row][pos.col];
+	int16_t *rhs = &goalDistanceRhs[pos.row][pos.col];
+	/* the key of the cell in the queue. -1 if it is not queued */
+	int oldKey = (*g != *rhs) ? MIN(*g, *rhs) : -1;
+	int newKey;
+
+	*rhs = getGoalRhs(pos);
+	newKey = (*g != *rhs) ? MIN(*g, *rhs) : -1;
+	/* The old queue entry is still valid if the key is not changed */
+	if ((newKey != -1) && (newKey != oldKey))
+	{
+		if (goalDistanceQueue.push(newKey, getCellIndex(pos)) == -1)
+		{
+			isGoalDistanceOverflowed = true;
+		}
+	}
+}
+
+template<int Rows, int Cols>
+int
+MouseController<Rows, Cols>::repairGoalDistance ()
+{
+	PositionType cursor;
+	pos_t current;
+	pos_t next;
+	int key;
+	int16_t *g;
+	int16_t *rhs;
+	int touched = 0;
+	int i;
+
+	while (!goalDistanceQueue.isEmpty())
+	{
+		key = goalDistanceQueue.peekKey();
+		current = getCellPos(goalDistanceQueue.pop());
+		g = &goalDistance[current.row][current.col];
+		rhs = &goalDistanceRhs[current.row][current.col];
+		/* Skip the entry if it is out-dated */
+		if ((*g == *rhs) || (key != MIN(*g, *rhs)))
+		{
+			continue;
+		}
+		touched++;
+
+		if (*g > *rhs)
+		{
+			/* The cell got closer: settle it */
+			*g = *rhs;
+		}
+		else
+		{
+			/* The cell got farther: forget it and find it again */
+			*g = infiniteDistance;
+			if (*g != *rhs)
+			{
+				if (goalDistanceQueue.push(*rhs, getCellIndex(current)) == -1)
+				{
+					isGoalDistanceOverflowed = true;
+				}
+			}
+		}
+		/* neighbours depend on the distance of this cell */
+		cursor.setPos(current);
+		for (i = (int) row_plus; i <= (int) col_minus; i++)
+		{
+			if (wall == getWall(current.row, current.col, (dir_e) i))
+			{
+				continue;
+			}
+			next = cursor.getNextPos((dir_e) i);
+			if (isPosOutOfBounds(next.row, next.col))
+			{
+				continue;
+			}
+			updateGoalDistance(next);
+		}
+	}
+
+	if (isGoalDistanceOverflowed)
+	{
+		/* Some cells are lost. Start over with the flood, which does not need
+		 the priority queue and so cannot overflow again */
+		return touched + floodGoalDistance();
+	}
+	return touched;
+}
+
+template<int Rows, int Cols>
+int
+MouseController<Rows, Cols>::floodGoalDistance ()
+{
+	PositionType cursor;
+	pos_t current;
+	pos_t next;
+	int reached = 0;
+	int row;
+	int col;
+	int i;
+
+	goalDistanceQueue.init();
+	floodQueue.init();
+	for (row = 0; row < Rows; row++)
+	{
+		for (col = 0; col < Cols; col++)
+		{
+			goalDistance[row][col] = infiniteDistance;
+		}
+	}
+	/* Breadth-first from the goal: each cell is pushed once, so @floodQueue
+	 of Rows * Cols cells is always enough */
+	goalDistance[index_goal_row][index_goal_col] = mazeSTART_DISTANCE;
+	floodQueue.pushToBack((pos_t){index_goal_row, index_goal_col});
+	while (!floodQueue.isEmpty())
+	{
+		current = floodQueue.popFromFront();
+		reached++;
+		cursor.setPos(current);
+		for (i = (int) row_plus; i <= (int) col_minus; i++)
+		{
+			if (wall == getWall(current.row, current.col, (dir_e) i))
+			{
+				continue;
+			}
+			next = cursor.getNextPos((dir_e) i);
+			if (isPosOutOfBounds(next.row, next.col)
+					|| (goalDistance[next.row][next.col] != infiniteDistance))
+			{
+				continue;
+			}
+			goalDistance[next.row][next.col] = goalDistance[current.row][current.col] + 1;
+			floodQueue.pushToBack(next);
+		}
+	}
+	/* every cell is consistent */
+	for (row = 0; row < Rows; row++)
+	{
+		for (col = 0; col < Cols; col++)
+		{
+			goalDistanceRhs[row][col] = goalDistance[row][col];
+		}
+	}
+	isGoalDistanceOverflowed = false;
+	return reached;
+}
+
+/* Explicit instantiation of the sizes in mazeFOR_EACH_SIZE */
+#define mazeINSTANTIATE(rows, cols)	\
+	template int MouseController<rows, cols>::initGoalDistance(); \
+	template int MouseController<rows, cols>::updateWall(int row, int col, dir_e dir, enum wall status); \
+	template int MouseController<rows, cols>::getGoalDistance(int row, int col); \
+	template dir_e MouseController<rows, cols>::getDirectionToGoal(); \
+	template int MouseController<rows, cols>::getGoalRhs(pos_t pos); \
+	template void MouseController<rows, cols>::updateGoalDistance(pos_t pos); \
+	template int MouseController<rows, cols>::repairGoalDistance(); \
+	template int MouseController<rows, cols>::floodGoalDistance();
+mazeFOR_EACH_SIZE(mazeINSTANTIATE)
@@ -1,8 +1,9 @@
-#include "Maze.h"
+#include "Maze.hpp"
 #include <stdio.h>
 
+template<int Rows, int Cols>
 void
-Maze::init()
+Maze<Rows, Cols>::init()
 {
 	int i = 0;
 	int j = 0;
@@ -10,13 +11,14 @@ Maze::init()
 
 	index_start_row = 0;
 	index_start_col = 0;
-	index_goal_row = 7;
-	index_goal_col = 7;
+	/* the goal is at the center of the maze */
+	index_goal_row = (Rows - 1) / 2;
+	index_goal_col = (Cols - 1) / 2;
 
 	/* init the wall with unknown */
-	for (i = 0; i < mazeMAX_ROW_SIZE; i++)
+	for (i = 0; i < Rows; i++)
 	{
-		for (j = 0; j < mazeMAX_COL_SIZE; j++)
+		for (j = 0; j < Cols; j++)
 		{
 			setDistance(i,j,UNREACHED);
 			for (k = (int) row_plus; k <= (int) col_minus; k++)
@@ -27,15 +29,15 @@ Maze::init()
 	}
 
 	/* wrap the wall */
-	for (i = 0; i < mazeMAX_ROW_SIZE; i++)
+	for (i = 0; i < Rows; i++)
 	{
 		setWall(i, 0, col_minus, wall);
-		setWall(i, mazeMAX_ROW_SIZE - 1, col_plus, wall);
+		setWall(i, Cols - 1, col_plus, wall);
 	}
-	for (j = 0; j < mazeMAX_COL_SIZE; j++)
+	for (j = 0; j < Cols; j++)
 	{
 		setWall(0, j, row_minus, wall);
-		setWall(mazeMAX_COL_SIZE - 1, j, row_plus, wall);
+		setWall(Rows - 1, j, row_plus, wall);
 	}
 
 	/* fill the first cell */
@@ -48,141 +50,149 @@ Maze::init()
 	updateCell();
 }
 
-Maze::Maze ()
+template<int Rows, int Cols>
+Maze<Rows, Cols>::Maze ()
 {
 	init();
 }
 
-Maze::Maze(char *filename)
+template<int Rows, int Cols>
+Maze<Rows, Cols>::Maze(char *filename)
 {
 	init();
 	readMazeFromFile(filename);
 }
 
+template<int Rows, int Cols>
 enum wall
-Maze::getWall (int row, int col, dir_e dir)
+Maze<Rows, Cols>::getWall (int row, int col, dir_e dir)
 {
-	if (mazeIS_POS_OUT_BOUNDS(row, col))
+	if (isPosOutOfBounds(row, col))
 	{
 		return (enum wall) mazeERROR;
 	}
 	switch (dir)
 	{
 		case row_plus:
-			return rowWall[row + 1][col];
+			return getRowWall(row + 1, col);
 		case col_plus:
-			return colWall[row][col + 1];
+			return getColWall(row, col + 1);
 		case row_minus:
-			return rowWall[row][col];
+			return getRowWall(row, col);
 		case col_minus:
-			return colWall[row][col];
+			return getColWall(row, col);
 		default:
 			return (enum wall) mazeERROR;
 	}
 	return (enum wall) mazeERROR;
 }
 
+template<int Rows, int Cols>
 struct cell
-Maze::getCell (int row, int col)
+Maze<Rows, Cols>::getCell (int row, int col)
 {
-	if (mazeIS_POS_OUT_BOUNDS(row,col))
+	if (isPosOutOfBounds(row,col))
 	{
 		return (struct cell){-2, eCellerror, false, false, false};
 	}
-	return cell[row][col];
+	struct cell result;
+	uint8_t flag = cellFlag[row][col];
+
+	result.distance = cellDistance[row][col];
+	result.status = (flag & mazeCELL_SEARCHED) ? searched : unsearched;
+	result.isMouse = (flag & mazeCELL_MOUSE) ? true : false;
+	result.isGoal = (flag & mazeCELL_GOAL) ? true : false;
+	result.isStart = (flag & mazeCELL_START) ? true : false;
+	return result;
 }
 
+template<int Rows, int Cols>
 int
-Maze::setWall (int row, int col, dir_e dir, enum wall status)
+Maze<Rows, Cols>::setWall (int row, int col, dir_e dir, enum wall status)
 {
-	if (mazeIS_POS_OUT_BOUNDS(row, col))
+	if (isPosOutOfBounds(row, col))
 	{
 		return mazeERROR;
 	}
+	if ((status != empty) && (status != wall) && (status != unknown))
+	{
+		/* Only these fit in mazeWALL_BITS */
+		return mazeERROR;
+	}
 	switch (dir)
 	{
 		case row_plus:
-			rowWall[row + 1][col] = status;
+			setRowWall(row + 1, col, status);
 			return mazeSUCCESS;
 		case col_plus:
-			colWall[row][col + 1] = status;
+			setColWall(row, col + 1, status);
 			return mazeSUCCESS;
 		case row_minus:
-			rowWall[row][col] = status;
+			setRowWall(row, col, status);
 			return mazeSUCCESS;
 		case col_minus:
-			colWall[row][col] = status;
+			setColWall(row, col, status);
 			return mazeSUCCESS;
 		default:
 			return mazeERROR;
 	}
 }
 
+template<int Rows, int Cols>
 int
-Maze::updateCell (int row, int col)
+Maze<Rows, Cols>::updateCell (int row, int col)
 {
-	if (mazeIS_POS_OUT_BOUNDS(row, col))
+	if (isPosOutOfBounds(row, col))
 	{
 		return mazeERROR;
 	}
 	/* checking status */
-	if (Maze::getWall(row, col, row_plus) != unknown
-			&& Maze::getWall(row, col, col_plus) != unknown
-			&& Maze::getWall(row, col, row_minus) != unknown
-			&& Maze::getWall(row, col, col_minus) != unknown)
-	{
-		cell[row][col].status = searched;
-	}
-	else
-	{
-		cell[row][col].status = unsearched;
-	}
+	setCellFlag(row, col, mazeCELL_SEARCHED,
+			getWall(row, col, row_plus) != unknown
+			&& getWall(row, col, col_plus) != unknown
+			&& getWall(row, col, row_minus) != unknown
+			&& getWall(row, col, col_minus) != unknown);
 	/* checking goal */
-	if ((row == index_goal_row) && (col == index_goal_col))
-	{
-		cell[row][col].isGoal = true;
-	}
-	else
-	{
-		cell[row][col].isGoal = false;
-	}
+	setCellFlag(row, col, mazeCELL_GOAL,
+			(row == index_goal_row) && (col == index_goal_col));
 	/* checking start */
-	if ((row == index_start_row) && (col == index_start_col))
-	{
-		cell[row][col].isStart = true;
-	}
-	else
-	{
-		cell[row][col].isStart = false;
-	}
+	setCellFlag(row, col, mazeCELL_START,
+			(row == index_start_row) && (col == index_start_col));
 	/* TODO: checking mouse */
-	cell[row][col].isMouse = false;
+	setCellFlag(row, col, mazeCELL_MOUSE, false);
 
 	return mazeSUCCESS;
 }
 
+template<int Rows, int Cols>
 void
-Maze::updateCell ()
+Maze<Rows, Cols>::updateCell ()
 {
 	int i = 0;
 	int j = 0;
-	for (i = 0; i < mazeMAX_ROW_SIZE; i++)
+	for (i = 0; i < Rows; i++)
 	{
-		for (j = 0; j < mazeMAX_COL_SIZE; j++)
+		for (j = 0; j < Cols; j++)
 		{
-			Maze::updateCell(i, j);
+			updateCell(i, j);
 		}
 	}
 }
 
+template<int Rows, int Cols>
 void
-Maze::setMouse(int row, int col)
+Maze<Rows, Cols>::setMouse(int row, int col)
 {
-	cell[row][col].isMouse = true;
+	setCellFlag(row, col, mazeCELL_MOUSE, true);
 }
 
+template<int Rows, int Cols>
 void
-Maze::resetMouse(int row, int col)
+Maze<Rows, Cols>::resetMouse(int row, int col)
 {
-	cell[row][col].isMouse = false;
+	setCellFlag(row, col, mazeCELL_MOUSE, false);
 }
+
+/* Explicit instantiation of the sizes in mazeFOR_EACH_SIZE */
+#define mazeINSTANTIATE(rows, cols)	template class Maze<rows, cols>;
+mazeFOR_EACH_SIZE(mazeINSTANTIATE)
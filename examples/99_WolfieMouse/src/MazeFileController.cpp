@@ -5,38 +5,56 @@
  *      Author: Bumsik Kim
  */
 
-#include "Maze.h"
+#include "Maze.hpp"
 
 #include <stdio.h>
 #include <stddef.h>
+#include <string.h>
 
 static void
 clearLine (FILE *pFile);
 
 /** FIXME: dynamically decide the starting dirction */
 
-void
-Maze::readMazeFromFile (char* fileName)
+template<int Rows, int Cols>
+int
+Maze<Rows, Cols>::readMazeFromFile (char* fileName)
 {
 	FILE *pFile;
+	/* a line, "\r\n" and '\0' */
+	char line[Cols * 2 + 4];
 	char buf;
 
 	pFile = fopen(fileName, "r");
 	if (NULL == pFile)
 	{
-		printf("Failed to open file");
+		printf("Failed to open file\r\n");
+		return mazeERROR;
 	}
 	/**
 	 * Reading part
 	 */
 	enum wall wallToPut;
-	for (int i = 0; i < (mazeMAX_ROW_SIZE * 2 + 1); i++)
+	for (int i = 0; i < (Rows * 2 + 1); i++)
 	{
-		for (int j = 0; j < (mazeMAX_COL_SIZE * 2 + 1); j++)
+		if (NULL == fgets(line, sizeof(line), pFile))
+		{
+			printf("Unexpected end of file\r\n");
+			fclose(pFile);
+			return mazeERROR;
+		}
+		/* Ignore what is beyond the maze */
+		if (NULL == strchr(line, '\n'))
+		{
+			clearLine(pFile);
+		}
+		for (int j = 0; j < (Cols * 2 + 1); j++)
 		{
-			if ((buf = fgetc(pFile)) == EOF)
+			buf = line[j];
+			/* The trailing spaces may be trimmed */
+			if ((buf == '\0') || (buf == '\r') || (buf == '\n'))
 			{
-				printf("error?"); /* TODO: check error condition of fgets */
+				break;
 			}
 			switch (buf)
 			{
@@ -53,125 +71,128 @@ Maze::readMazeFromFile (char* fileName)
 			case 'S': /* Starting point */
 				index_start_row = i / 2;
 				index_start_col = j / 2;
-				wallToPut = eWallError;
 				continue;
 			case 'G':
 				index_goal_row = i / 2;
 				index_goal_col = j / 2;
-				wallToPut = eWallError;
 				continue;
 			case ' ':
 			default:
-				wallToPut = eWallError;
 				continue;
-			break;
 			}
 			if ((i % 2 == 0) && (j % 2 == 1))
 			{
-				rowWall[i / 2][j / 2] = wallToPut;
+				setRowWall(i / 2, j / 2, wallToPut);
 			}
 			else if ((i % 2 == 1) && (j % 2 == 0))
 			{
-				colWall[i / 2][j / 2] = wallToPut;
+				setColWall(i / 2, j / 2, wallToPut);
 			}
 		}
-		clearLine(pFile);
 	}
+	fclose(pFile);
 
 	/* update the cell */
 	updateCell();
+	return mazeSUCCESS;
 }
 
+template<int Rows, int Cols>
 void
-Maze::printMaze ()
+Maze<Rows, Cols>::printMaze ()
 {
 	writeMazeToFile(stdout, true);
 }
 
-void
-Maze::saveMazeFile (char* fileName)
+template<int Rows, int Cols>
+int
+Maze<Rows, Cols>::saveMazeFile (char* fileName)
 {
 	FILE *pFile;
-	char buf;
+	int result;
 
 	pFile = fopen(fileName, "w");
 	if (NULL == pFile)
 	{
-		printf("Failed to open file");
+		printf("Failed to open file\r\n");
+		return mazeERROR;
 	}
-	writeMazeToFile(pFile, false);
+	result = writeMazeToFile(pFile, false);
+	if (fclose(pFile) != 0)
+	{
+		return mazeERROR;
+	}
+	return result;
 }
 
-void
-Maze::writeMazeToFile (void *pFile, bool isShowMouse)
+template<int Rows, int Cols>
+char
+Maze<Rows, Cols>::getWallChar (enum wall status, char wallChar)
 {
-	char buf;
+	switch (status)
+	{
+	case empty:
+		return '.';
+	case wall:
+		return wallChar;
+	case unknown:
+		return '*';
+	case eWallError:
+	default:
+		printf("Error on wall!");
+		return '?';
+	}
+}
+
+template<int Rows, int Cols>
+int
+Maze<Rows, Cols>::writeMazeToFile (void *pFile, bool isShowMouse)
+{
+	/* a line, "\r\n" and '\0' */
+	char line[Cols * 2 + 4];
+	int length;
 
-	for (int i = 0; i < (mazeMAX_ROW_SIZE * 2 + 1); i++)
+	/* A line is built and written at once */
+	for (int i = 0; i < (Rows * 2 + 1); i++)
 	{
+		length = 0;
 		if (i % 2 == 0)
 		{
-			for (int j = 0; j < mazeMAX_COL_SIZE; j++)
+			for (int j = 0; j < Cols; j++)
 			{
-				switch (rowWall[i / 2][j])
-				{
-				case empty:
-					buf = '.';
-				break;
-				case wall:
-					buf = '_';
-				break;
-				case unknown:
-					buf = '*';
-				break;
-				case eWallError:
-				default:
-					printf("Error on rowWall!");
-				break;
-				}
-				fputc(' ', (FILE*) pFile);
-				fputc(buf, (FILE*) pFile);
+				line[length++] = ' ';
+				line[length++] = getWallChar(getRowWall(i / 2, j), '_');
 			}
-			fputc(' ', (FILE*) pFile);
+			line[length++] = ' ';
 		}
 		else
 		{
-			for (int j = 0; j < mazeMAX_COL_SIZE + 1; j++)
+			for (int j = 0; j < Cols + 1; j++)
 			{
-				switch (colWall[i / 2][j])
-				{
-				case empty:
-					buf = '.';
-				break;
-				case wall:
-					buf = '|';
-				break;
-				case unknown:
-					buf = '*';
-				break;
-				case eWallError:
-				default:
-					printf("Error on rowWall!");
-				break;
-				}
 				/* print wall first */
-				fputc(buf, (FILE*) pFile);
-				if(!(j >= mazeMAX_COL_SIZE))
+				line[length++] = getWallChar(getColWall(i / 2, j), '|');
+				if (!(j >= Cols))
 				{
-					printCell(i/2, j, isShowMouse, pFile);
+					line[length++] = getCellChar(i / 2, j, isShowMouse);
 				}
 			}
 		}
 		/* print newline */
-		fputc('\r', (FILE*) pFile);
-		fputc('\n', (FILE*) pFile);
+		line[length++] = '\r';
+		line[length++] = '\n';
+		line[length] = '\0';
+		if (fputs(line, (FILE*) pFile) == EOF)
+		{
+			return mazeERROR;
+		}
 	}
+	return mazeSUCCESS;
 }
 
 static void
 clearLine (FILE *pFILE)
 {
-	char buf;
+	int buf;
 	while ((buf = fgetc(pFILE)) != '\n')
 	{
 		if (buf == EOF)
@@ -179,29 +200,38 @@ clearLine (FILE *pFILE)
 	}
 }
 
-void
-Maze::printCell(int row, int col, bool isShowMouse, void *pFile)
+template<int Rows, int Cols>
+char
+Maze<Rows, Cols>::getCellChar(int row, int col, bool isShowMouse)
 {
+	struct cell cell = getCell(row, col);
+
 	/* Check if this is mouse position */
-	if (getCell(row, col).isMouse && isShowMouse)
+	if (cell.isMouse && isShowMouse)
 	{
-		fputc('M', (FILE*) pFile);
+		return 'M';
 	}
-	else if (getCell(row, col).isStart)
+	else if (cell.isStart)
 	{
-		fputc('S', (FILE*) pFile);
+		return 'S';
 	}
-	else if (getCell(row, col).isGoal)
+	else if (cell.isGoal)
 	{
-		fputc('G', (FILE*) pFile);
+		return 'G';
 	}
 	else if (isShowMouse)
 	{
-		fputc((getCell(row, col).distance == UNREACHED)
-			  ? 'x' : '0'+getCell(row, col).distance, (FILE*) pFile);
-	}
-	else if (col != mazeMAX_COL_SIZE)
-	{
-		fputc(' ', (FILE*) pFile);
+		return (cell.distance == UNREACHED) ? 'x' : '0' + cell.distance;
 	}
+	return ' ';
 }
+
+/* Explicit instantiation of the sizes in mazeFOR_EACH_SIZE */
+#define mazeINSTANTIATE(rows, cols)	\
+	template int Maze<rows, cols>::readMazeFromFile(char* fileName); \
+	template void Maze<rows, cols>::printMaze(); \
+	template int Maze<rows, cols>::saveMazeFile(char* fileName); \
+	template int Maze<rows, cols>::writeMazeToFile(void *pFile, bool isShowMouse); \
+	template char Maze<rows, cols>::getWallChar(enum wall status, char wallChar); \
+	template char Maze<rows, cols>::getCellChar(int row, int col, bool isShowMouse);
+mazeFOR_EACH_SIZE(mazeINSTANTIATE)
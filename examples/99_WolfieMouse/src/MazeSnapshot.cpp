@@ -0,0 +1,165 @@
+/*
+ * MazeSnapshot.cpp
+ *
+ *  Binary snapshot of Maze. Unlike the text file of MazeFileController.cpp,
+ *  it keeps the distances and the flags too, and it is saved and loaded
+ *  with a memcpy of each array, so the mouse can keep what it explored in
+ *  flash between runs.
+ */
+
+#include "Maze.hpp"
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * @brief      CRC-32 (IEEE 802.3, reflected) with a table of 16 entries,
+ *             small enough for the flash and fast enough for a snapshot
+ */
+static uint32_t
+getCrc32 (const uint8_t *pData, size_t size)
+{
+	static const uint32_t table[16] =
+	{
+		0x00000000UL, 0x1DB71064UL, 0x3B6E20C8UL, 0x26D930ACUL,
+		0x76DC4190UL, 0x6B6B51F4UL, 0x4DB26158UL, 0x5005713CUL,
+		0xEDB88320UL, 0xF00F9344UL, 0xD6D6A3E8UL, 0xCB61B38CUL,
+		0x9B64C2B0UL, 0x86D3D2D4UL, 0xA00AE278UL, 0xBDBDF21CUL
+	};
+	uint32_t crc = 0xFFFFFFFFUL;
+	size_t i;
+
+	for (i = 0; i < size; i++)
+	{
+		crc = (crc >> 4) ^ table[(crc ^ pData[i]) & 0x0F];
+		crc = (crc >> 4) ^ table[(crc ^ (pData[i] >> 4)) & 0x0F];
+	}
+	return ~crc;
+}
+
+template<int Rows, int Cols>
+int
+Maze<Rows, Cols>::saveSnapshot (void *pBuffer, int bufferSize)
+{
+	uint8_t *pBytes = (uint8_t *) pBuffer;
+	struct mazeSnapshotHeader_t header;
+
+	if ((NULL == pBuffer) || (bufferSize < getSnapshotSize()))
+	{
+		return mazeERROR;
+	}
+
+	memcpy(pBytes + offsetof(struct snapshot_t, rowWall), rowWall, sizeof(rowWall));
+	memcpy(pBytes + offsetof(struct snapshot_t, colWall), colWall, sizeof(colWall));
+	memcpy(pBytes + offsetof(struct snapshot_t, cellDistance), cellDistance, sizeof(cellDistance));
+	memcpy(pBytes + offsetof(struct snapshot_t, cellFlag), cellFlag, sizeof(cellFlag));
+
+	header.magic = mazeSNAPSHOT_MAGIC;
+	header.version = mazeSNAPSHOT_VERSION;
+	header.headerSize = sizeof(struct mazeSnapshotHeader_t);
+	header.rows = Rows;
+	header.cols = Cols;
+	header.startRow = (int16_t) index_start_row;
+	header.startCol = (int16_t) index_start_col;
+	header.goalRow = (int16_t) index_goal_row;
+	header.goalCol = (int16_t) index_goal_col;
+	header.payloadSize = getSnapshotSize() - sizeof(struct mazeSnapshotHeader_t);
+	header.checksum = getCrc32(pBytes + sizeof(struct mazeSnapshotHeader_t), header.payloadSize);
+	memcpy(pBytes, &header, sizeof(header));
+
+	return getSnapshotSize();
+}
+
+template<int Rows, int Cols>
+int
+Maze<Rows, Cols>::loadSnapshot (const void *pBuffer, int size)
+{
+	const uint8_t *pBytes = (const uint8_t *) pBuffer;
+	struct mazeSnapshotHeader_t header;
+
+	if ((NULL == pBuffer) || (size < (int) sizeof(header)))
+	{
+		return mazeERROR;
+	}
+	memcpy(&header, pBytes, sizeof(header));
+	if ((header.magic != mazeSNAPSHOT_MAGIC)
+			|| (header.version != mazeSNAPSHOT_VERSION)
+			|| (header.headerSize != sizeof(struct mazeSnapshotHeader_t))
+			|| (header.rows != Rows) || (header.cols != Cols)
+			|| (header.payloadSize != getSnapshotSize() - sizeof(struct mazeSnapshotHeader_t))
+			|| (size < getSnapshotSize()))
+	{
+		return mazeERROR;
+	}
+	if (isPosOutOfBounds(header.startRow, header.startCol)
+			|| isPosOutOfBounds(header.goalRow, header.goalCol))
+	{
+		return mazeERROR;
+	}
+	if (header.checksum != getCrc32(pBytes + sizeof(struct mazeSnapshotHeader_t), header.payloadSize))
+	{
+		return mazeERROR;
+	}
+
+	memcpy(rowWall, pBytes + offsetof(struct snapshot_t, rowWall), sizeof(rowWall));
+	memcpy(colWall, pBytes + offsetof(struct snapshot_t, colWall), sizeof(colWall));
+	memcpy(cellDistance, pBytes + offsetof(struct snapshot_t, cellDistance), sizeof(cellDistance));
+	memcpy(cellFlag, pBytes + offsetof(struct snapshot_t, cellFlag), sizeof(cellFlag));
+	index_start_row = header.startRow;
+	index_start_col = header.startCol;
+	index_goal_row = header.goalRow;
+	index_goal_col = header.goalCol;
+
+	return mazeSUCCESS;
+}
+
+template<int Rows, int Cols>
+int
+Maze<Rows, Cols>::saveSnapshotFile (char* fileName)
+{
+	struct snapshot_t snapshot;
+	FILE *pFile;
+	size_t written;
+
+	saveSnapshot(&snapshot, sizeof(snapshot));
+	pFile = fopen(fileName, "wb");
+	if (NULL == pFile)
+	{
+		printf("Failed to open file\r\n");
+		return mazeERROR;
+	}
+	written = fwrite(&snapshot, sizeof(snapshot), 1, pFile);
+	if ((fclose(pFile) != 0) || (written != 1))
+	{
+		return mazeERROR;
+	}
+	return mazeSUCCESS;
+}
+
+template<int Rows, int Cols>
+int
+Maze<Rows, Cols>::loadSnapshotFile (char* fileName)
+{
+	struct snapshot_t snapshot;
+	FILE *pFile;
+	size_t read;
+
+	pFile = fopen(fileName, "rb");
+	if (NULL == pFile)
+	{
+		printf("Failed to open file\r\n");
+		return mazeERROR;
+	}
+	read = fread(&snapshot, 1, sizeof(snapshot), pFile);
+	fclose(pFile);
+	return loadSnapshot(&snapshot, (int) read);
+}
+
+/* Explicit instantiation of the sizes in mazeFOR_EACH_SIZE */
+#define mazeINSTANTIATE(rows, cols)	\
+	template int Maze<rows, cols>::saveSnapshot(void *pBuffer, int bufferSize); \
+	template int Maze<rows, cols>::loadSnapshot(const void *pBuffer, int size); \
+	template int Maze<rows, cols>::saveSnapshotFile(char* fileName); \
+	template int Maze<rows, cols>::loadSnapshotFile(char* fileName);
+mazeFOR_EACH_SIZE(mazeINSTANTIATE)
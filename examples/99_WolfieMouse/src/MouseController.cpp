@@ -1,249 +1,223 @@
-#include "MouseController.h"
+#include "MouseController.hpp"
 
+template<int Rows, int Cols>
 void
-MouseController::init()
+MouseController<Rows, Cols>::init()
 {
-	pathStack = Queue<PositionController>();
-	availablePositionStack = Queue<PositionController>();
+	pathStack.init();
 	/* FIXME: Set the default start point */
 	setPos({index_start_row, index_start_col});
 	setDir(mazeDIRECTION_START);
 	updateCell();
+	initGoalDistance();
 }
 
-MouseController::MouseController ()
-: Maze()
+template<int Rows, int Cols>
+MouseController<Rows, Cols>::MouseController ()
+: MazeType()
 {
 	init();
 }
 
-MouseController::MouseController (char *filename)
-: Maze(filename)
+template<int Rows, int Cols>
+MouseController<Rows, Cols>::MouseController (char *filename)
+: MazeType(filename)
 {
 	init();
 }
 
+template<int Rows, int Cols>
 void
-MouseController::initDistance ()
+MouseController<Rows, Cols>::initDistance ()
 {
 	int row;
 	int col;
 	//Fill the last
-	for (row = 0; row < mazeMAX_ROW_SIZE; row++)
+	for (row = 0; row < Rows; row++)
 	{
-		for (col = 0; col < mazeMAX_COL_SIZE; col++)
+		for (col = 0; col < Cols; col++)
 		{
 			setDis(row, col, UNREACHED);
 		}
 	}
 }
 
+template<int Rows, int Cols>
 void
-MouseController::getDistanceAllCell ()
+MouseController<Rows, Cols>::getDistanceAllCell ()
 {
-	int currentPathDistance = mazeSTART_DISTANCE + 1; /* This is how far the 'water' has flowed */
-	int row;
-	int col;
+	PositionType cursor; /* used to look around the cell popped from the queue */
+	pos_t current;
+	pos_t next;
+	int currentDistance;
+	int i;
 
 	/* set all distance as UNREACHED */
 	initDistance();
+	floodQueue.init();
 
 	/* Firstly set the distance of the current opsition to 0 */
 	setDis(getCurrentPos(), mazeSTART_DISTANCE);
+	floodQueue.pushToBack(getCurrentPos());
 
-	while (1)
+	while (!floodQueue.isEmpty())
 	{
-		/* Creating a loop which scans the whole maze */
-		for (row = 0; row < mazeMAX_ROW_SIZE; row++)
+		current = floodQueue.popFromFront();
+		currentDistance = getDis(current);
+		/* If the goal has a value and every cell of the goal distance is
+		 reached, the algorithm ends */
+		if ((getDis(index_goal_row, index_goal_col) != UNREACHED)
+				&& (currentDistance >= getDis(index_goal_row, index_goal_col)))
 		{
-			for (col = 0; col < mazeMAX_COL_SIZE; col++)
-			{
-				/* If the cell has already been reached, then continue to the next cell */
-				if (getDis(row, col) != UNREACHED)
-				{
-					continue;
-				}
-				/* If there is a neighbouring cell which has been */
-				if (getHighestNeighbouringDistance(row, col) == (currentPathDistance -1))
-				{
-					/* you have reached the current cell */
-					setDis(row, col, currentPathDistance);
-				}
-			}
+			break;
 		}
-		if (getDis(index_goal_row, index_goal_col) != UNREACHED) //If the destination cell has a value after a sweep, the algorithm ends
+		cursor.setPos(current);
+		/* Look around in counter-clockwise */
+		for (i = (int) row_plus; i <= (int) col_minus; i++)
 		{
-			break;
+			if (wall == getWall(current.row, current.col, (dir_e) i))
+			{
+				continue;
+			}
+			next = cursor.getNextPos((dir_e) i);
+			if (isPosOutOfBounds(next.row, next.col))
+			{
+				continue;
+			}
+			/* If the cell has already been reached, then continue to the next cell */
+			if (getDis(next) != UNREACHED)
+			{
+				continue;
+			}
+			setDis(next, currentDistance + 1);
+			floodQueue.pushToBack(next);
 		}
-		/* Increment the distance because we are scanning again. */
-		currentPathDistance++;
 	}
 	/**
-	 * The highestNeighbouringCell(x,y) function returns the value of the highest,
-	 * accessible (ie there are no separating walls) neighbouring cell. Initially,
-	 * all the cells are given a value of UNREACHED(which is -1), except the
-	 * micromouse's current cell, which is given value 0.
-	 * Then the grid of cell values is scanned. On the first scan, only the cells
-	 * next to, and accessible to the cellwhere the micromouse is, will be given
-	 * a (non-UNREACHED) value. That value is 1. This is repeated untill the
-	 * destination cell has been given a (non-UNREACHED) value.
+	 * This is a breadth-first flood fill. Initially, all the cells are given
+	 * a value of UNREACHED(which is -1), except the micromouse's current cell,
+	 * which is given value 0 and pushed to @floodQueue.
+	 * Each cell popped from the queue gives its distance + 1 to the accessible
+	 * (ie there are no separating walls) neighbouring cells that are still
+	 * UNREACHED, and pushes them to the queue. Because the cells come out in
+	 * the order of distance, each cell is visited only once. This is repeated
+	 * untill every cell with the distance of the destination cell has been
+	 * given a value, or there is no more reachable cell.
 	 */
 }
 
-/* TODO: Could be a bottleneck */
-int
-MouseController::getHighestNeighbouringDistance (int row, int col)
-{
-	int tmp = UNREACHED;
-	int cmp;
-	/* Check out of bounds first */
-	if (mazeIS_POS_OUT_BOUNDS(row, col))
-	{
-		return mazeERROR;
-	}
-
-	if (getWall(row, col, row_plus) != wall)
-	{
-		cmp = Maze::getDistance(row + 1, col);
-		if (cmp > tmp)
-		{
-			tmp = cmp;
-		}
-	}
-	if (getWall(row, col, col_plus) != wall)
-	{
-		cmp = getDis(row, col + 1);
-		if (cmp > tmp)
-		{
-			tmp = cmp;
-		}
-	}
-	if (getWall(row, col, row_minus) != wall)
-	{
-		cmp = getDis(row - 1, col);
-		if (cmp > tmp)
-		{
-			tmp = cmp;
-		}
-	}
-	if (getWall(row, col, col_minus) != wall)
-	{
-		cmp = getDis(row, col - 1);
-		if (cmp > tmp)
-		{
-			tmp = cmp;
-		}
-	}
-	return tmp;
-}
-
+template<int Rows, int Cols>
 void
-MouseController::getShortestPath ()
+MouseController<Rows, Cols>::getShortestPath ()
 {
-	/* init all variables */
-	PositionController position;
-	bool isFound;
-	int currentDistance = 0;
-	int i = 0;
+	PositionType cursor; /* used to look around the cell on the path */
+	pos_t current = {index_goal_row, index_goal_col};
+	pos_t previous;
+	int currentDistance = getDis(current);
+	int i;
 
-	availablePositionStack.init();
 	pathStack.init();
+	if (currentDistance == UNREACHED)
+	{
+		return;
+	}
 
-	/* set first stack = the current position */
-	availablePositionStack.pushToBack(PositionController(getCurrentPos(),getCurrentDir()));
-
-	while (1)
+	/* Walk back from the goal to the current position. Each cell on the way
+	 has a neighbour without a wall between that is one step closer */
+	while (currentDistance > mazeSTART_DISTANCE)
 	{
-		isFound = false;
-		//copy the next position
-		position = availablePositionStack.peekFromBack();
-		currentDistance = getDis(position);
-		//if currentposition is goal, break
-		if (position.getCurrentPos() == (pos_t){index_goal_row, index_goal_col})
-		{
-			isFound = true;
-			pathStack.pushToBack(availablePositionStack.popFromBack());
-			break;
-		}
-		/* Now look for next available cells, meaning neighbour cells that has
-		 distance of 1 more */
+		cursor.setPos(current);
 		/* Look around in counter-clockwise */
 		for (i = (int) row_plus; i <= (int) col_minus; i++)
 		{
-			if (getNextDis(position, (dir_e) i)
-					== (currentDistance + 1)) /* FIXME: check walls too */
+			if (wall == getWall(current.row, current.col, (dir_e) i))
 			{
-				if (wall == getWall(position.getCurrentPos().row, position.getCurrentPos().col, (dir_e)i))
-				{
-					continue;
-				}
-				if (!isFound)
-				{
-					pathStack.pushToBack(availablePositionStack.popFromBack());
-					isFound = true;
-				}
-				availablePositionStack.pushToBack(
-											PositionController(
-													position.getNextPos((dir_e) i),
-													(dir_e) i));
-
+				continue;
 			}
-		}
-
-		if (!isFound)
-		{
-			/* if no available next cell */
-			position = availablePositionStack.popFromBack();
-			/* pop pathstack until it meet next availableStack */
-			while (!(
-					   ( (pathStack.peekFromBack().getNextPos(row_plus) == availablePositionStack.peekFromBack().getCurrentPos()) && (wall != getWall(pathStack.peekFromBack().getCurrentPos().row, pathStack.peekFromBack().getCurrentPos().col, row_plus))  )
-					|| ( (pathStack.peekFromBack().getNextPos(col_plus) == availablePositionStack.peekFromBack().getCurrentPos()) && (wall != getWall(pathStack.peekFromBack().getCurrentPos().row, pathStack.peekFromBack().getCurrentPos().col, col_plus))  )
-					|| ( (pathStack.peekFromBack().getNextPos(row_minus)== availablePositionStack.peekFromBack().getCurrentPos()) && (wall != getWall(pathStack.peekFromBack().getCurrentPos().row, pathStack.peekFromBack().getCurrentPos().col, row_minus)) )
-					|| ( (pathStack.peekFromBack().getNextPos(col_minus)== availablePositionStack.peekFromBack().getCurrentPos()) && (wall != getWall(pathStack.peekFromBack().getCurrentPos().row, pathStack.peekFromBack().getCurrentPos().col, col_minus)) )
-					))
+			previous = cursor.getNextPos((dir_e) i);
+			if (!isPosOutOfBounds(previous.row, previous.col)
+					&& (getDis(previous) == (currentDistance - 1)))
 			{
-				pathStack.popFromBack();
+				break;
 			}
 		}
+		if (i > (int) col_minus)
+		{
+			/* The distances are not from getDistanceAllCell */
+			pathStack.init();
+			return;
+		}
+		/* The mouse moves into the cell the opposite way of the walk back */
+		pathStack.emplaceFront(current, (dir_e) ((i + 2) % 4));
+		current = previous;
+		currentDistance--;
 	}
-	/* Delete the top element - it is the current position! */
-	pathStack.popFromFront();
+	/**
+	 * The path is built backwards from the goal along the distances of
+	 * @getDistanceAllCell, so it takes as many steps as the path is long.
+	 * @pathStack holds the cells from the next one to the goal, each with
+	 * the direction the mouse moves to get into it.
+	 */
 }
 
+template<int Rows, int Cols>
 dir_e
-MouseController::getDirectionToGo ()
+MouseController<Rows, Cols>::getDirectionToGo ()
 {
 	/* get the next position */
-	PositionController nextPosition = pathStack.peekFromFront();
+	PositionType nextPosition = pathStack.peekFromFront();
 	return getNextDir(nextPosition);
 }
 
+template<int Rows, int Cols>
 void
-MouseController::setDirectionToGo ()
+MouseController<Rows, Cols>::setDirectionToGo ()
 {
 	setDir(getDirectionToGo());
 }
 
+template<int Rows, int Cols>
+void
+MouseController<Rows, Cols>::setStart (int row, int col)
+{
+	index_start_row = row;
+	index_start_col = col;
+	setPos({row, col});
+	setDir(mazeDIRECTION_START);
+	updateCell();
+}
+
+template<int Rows, int Cols>
+void
+MouseController<Rows, Cols>::setGoal (int row, int col)
+{
+	index_goal_row = row;
+	index_goal_col = col;
+	updateCell();
+	initGoalDistance();
+}
+
+template<int Rows, int Cols>
 bool
-MouseController::isGoal ()
+MouseController<Rows, Cols>::isGoal ()
 {
 	return (getCell(getCurrentPos()).isGoal) ?
 			true : false;
 }
 
+template<int Rows, int Cols>
 bool
-MouseController::isStart ()
+MouseController<Rows, Cols>::isStart ()
 {
 	return (getCell(getCurrentPos()).isStart) ?
 			true : false;
 }
 
+template<int Rows, int Cols>
 void
-MouseController::moveNextCell()
+MouseController<Rows, Cols>::moveNextCell()
 {
 	/* 1. turn first */
-	dir_e tmp_d = getDirectionToGo();
-		/* before setting direction we need to set how much trun */
 	setDirectionToGo();
 	/* 2. scan side wall */
 	/* 3. move */
@@ -256,33 +230,33 @@ MouseController::moveNextCell()
 }
 
 
+template<int Rows, int Cols>
 struct cell
-MouseController::getCell(pos_t pos)
+MouseController<Rows, Cols>::getCell(pos_t pos)
 {
-	return Maze::getCell(pos.row, pos.col);
+	return MazeType::getCell(pos.row, pos.col);
 }
 
+template<int Rows, int Cols>
 void
-MouseController::updateCell()
+MouseController<Rows, Cols>::updateCell()
 {
 	pos_t tmp = getCurrentPos();
-	Maze::updateCell();
-	Maze::setMouse(tmp.row, tmp.col);
+	MazeType::updateCell();
+	MazeType::setMouse(tmp.row, tmp.col);
 }
 
 
+template<int Rows, int Cols>
 void
-MouseController::printPathStack()
+MouseController<Rows, Cols>::printPathStack()
 {
-	void (PositionController::*pvFunc)(PositionController) = &PositionController::print;
+	void (PositionType::*pvFunc)(PositionType) = &PositionType::print;
 	printf("pathStack: ");
 	pathStack.print(pvFunc);
 	printf("\r\n");
 }
-void
-MouseController::printAvailablePositionStack()
-{
-	printf("availableStack: ");
-	availablePositionStack.print(&PositionController::print);
-	printf("\r\n");
-}
+
+/* Explicit instantiation of the sizes in mazeFOR_EACH_SIZE */
+#define mazeINSTANTIATE(rows, cols)	template class MouseController<rows, cols>;
+mazeFOR_EACH_SIZE(mazeINSTANTIATE)
@@ -1,4 +1,4 @@
-#include "PositionController.h"
+#include "PositionController.hpp"
 
 // prefix (++direction)
 Direction&
@@ -42,51 +42,58 @@ operator-- (Direction& orig, int)
 	return rVal;
 }
 
+template<int Rows, int Cols>
 void
-PositionController::init(int row, int col, dir_e dirTo)
+PositionController<Rows, Cols>::init(int row, int col, dir_e dirTo)
 {
 	pos.row = row;
 	pos.col = col;
 	dir = dirTo;
 }
 
-PositionController::PositionController (int row, int col, dir_e dirTo)
+template<int Rows, int Cols>
+PositionController<Rows, Cols>::PositionController (int row, int col, dir_e dirTo)
 {
 	init(row, col, dirTo);
 }
 
-PositionController::PositionController (struct pos_t pos,
+template<int Rows, int Cols>
+PositionController<Rows, Cols>::PositionController (struct pos_t pos,
 										dir_e dirTo)
 {
 	init(pos.row, pos.col, dirTo);
 }
 
-PositionController::PositionController ()
+template<int Rows, int Cols>
+PositionController<Rows, Cols>::PositionController ()
 {
 	init(0, 0, mazeDIRECTION_START);
 }
 
+template<int Rows, int Cols>
 void
-PositionController::turnRight ()
+PositionController<Rows, Cols>::turnRight ()
 {
 	/* TODO: Do turn operation of the mouse */
 	dir--;
 }
 
+template<int Rows, int Cols>
 void
-PositionController::turnLeft ()
+PositionController<Rows, Cols>::turnLeft ()
 {
 	/* TODO: Do turn operation of the mouse */
 	dir++;
 }
 
+template<int Rows, int Cols>
 int
-PositionController::goForward ()
+PositionController<Rows, Cols>::goForward ()
 {
 	switch (dir)
 	{
 		case row_plus:
-			if (mazeIS_ROW_SAFE_TO_MOVE_FORWARD(pos.row))
+			if (!Maze<Rows, Cols>::isRowOutOfBounds(pos.row + 1))
 			{
 				/* TODO: Do move operation of the mouse */
 				pos.row++;
@@ -94,7 +101,7 @@ PositionController::goForward ()
 			}
 		break;
 		case col_plus:
-			if (mazeIS_COL_SAFE_TO_MOVE_FORWARD(pos.col))
+			if (!Maze<Rows, Cols>::isColOutOfBounds(pos.col + 1))
 			{
 				/* TODO: Do move operation of the mouse */
 				pos.col++;
@@ -102,7 +109,7 @@ PositionController::goForward ()
 			}
 		break;
 		case row_minus:
-			if (mazeIS_ROW_SAFE_TO_MOVE_BACKWARD(pos.row))
+			if (!Maze<Rows, Cols>::isRowOutOfBounds(pos.row - 1))
 			{
 				/* TODO: Do move operation of the mouse */
 				pos.row--;
@@ -110,7 +117,7 @@ PositionController::goForward ()
 			}
 		break;
 		case col_minus:
-			if (mazeIS_COL_SAFE_TO_MOVE_BACKWARD(pos.col))
+			if (!Maze<Rows, Cols>::isColOutOfBounds(pos.col - 1))
 			{
 				/* TODO: Do move operation of the mouse */
 				pos.col--;
@@ -123,8 +130,9 @@ PositionController::goForward ()
 	return mazeERROR;
 }
 
+template<int Rows, int Cols>
 pos_t
-PositionController::getNextPos (dir_e dirTo)
+PositionController<Rows, Cols>::getNextPos (dir_e dirTo)
 {
 	pos_t tmp = pos;
 	switch (dirTo)
@@ -147,8 +155,9 @@ PositionController::getNextPos (dir_e dirTo)
 	}
 }
 
+template<int Rows, int Cols>
 dir_e
-PositionController::getNextDir (pos_t posTo)
+PositionController<Rows, Cols>::getNextDir (pos_t posTo)
 {
 	/* get the next position */
 	pos_t nextPosition = posTo;
@@ -180,8 +189,13 @@ PositionController::getNextDir (pos_t posTo)
 	return eDirError;
 }
 
+template<int Rows, int Cols>
 void
-PositionController::print(PositionController obj)
+PositionController<Rows, Cols>::print(PositionController obj)
 {
 	printf("(%d,%d) ", obj.pos.row, obj.pos.col);
 }
+
+/* Explicit instantiation of the sizes in mazeFOR_EACH_SIZE */
+#define mazeINSTANTIATE(rows, cols)	template class PositionController<rows, cols>;
+mazeFOR_EACH_SIZE(mazeINSTANTIATE)
@@ -0,0 +1,475 @@
+/*
+ * SpeedRunPlanner.cpp
+ *
+ *  Dijkstra over (point, heading) states. See SpeedRunPlanner.hpp.
+ *
+ *  The points are on a grid of half cells: (row * 2 + 1, col * 2 + 1) is
+ *  the centre of a cell, (row * 2, col * 2 + 1) is the middle of its
+ *  row_minus wall and (row * 2 + 1, col * 2) is the middle of its col_minus
+ *  wall. The heading is dir_e * 2, and the odd headings are the diagonals
+ *  between them, so a left turn (turnLeft) adds to the heading.
+ *
+ *  Only the states that can be reached are stored: the 4 straight headings
+ *  at a cell centre and the 6 headings that cross a wall. They are grouped
+ *  per cell, which also owns its row_minus and col_minus walls.
+ */
+
+#include "SpeedRunPlanner.hpp"
+
+/* Step of each heading on the grid of half cells */
+static const int headingRow[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+static const int headingCol[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+/* Index of each heading among the states of a point, and back. -1 if the
+ heading is not allowed there */
+static const int centreIndex[8] = {0, -1, 1, -1, 2, -1, 3, -1};
+static const int rowWallIndex[8] = {0, 1, -1, 2, 3, 4, -1, 5};
+static const int colWallIndex[8] = {-1, 0, 1, 2, -1, 3, 4, 5};
+static const int centreHeading[4] = {0, 2, 4, 6};
+static const int rowWallHeading[6] = {0, 1, 3, 4, 5, 7};
+static const int colWallHeading[6] = {1, 2, 3, 5, 6, 7};
+
+/* Step of each dir_e from cell to cell */
+static const int dirRow[4] = {1, 0, -1, 0};
+static const int dirCol[4] = {0, 1, 0, -1};
+
+template<int Rows, int Cols>
+SpeedRunPlanner<Rows, Cols>::SpeedRunPlanner ()
+{
+	static_assert(stateSize <= 0x10000, "states do not fit in uint16_t");
+	cost.straight = mazeCOST_STRAIGHT;
+	cost.diagonal = mazeCOST_DIAGONAL;
+	cost.turn45 = mazeCOST_TURN45;
+	cost.turn90 = mazeCOST_TURN90;
+	cost.turn180 = mazeCOST_TURN180;
+}
+
+template<int Rows, int Cols>
+int
+SpeedRunPlanner<Rows, Cols>::getState (int row, int col, int heading)
+{
+	int state = ((row / 2) * (Cols + 1) + col / 2) * statesPerCell;
+
+	if ((row % 2 == 1) && (col % 2 == 1))
+	{
+		return state + centreIndex[heading];
+	}
+	if (row % 2 == 0)
+	{
+		return state + 4 + rowWallIndex[heading];
+	}
+	return state + 10 + colWallIndex[heading];
+}
+
+template<int Rows, int Cols>
+void
+SpeedRunPlanner<Rows, Cols>::getPoint (int state, int *pRow, int *pCol, int *pHeading)
+{
+	int cell = state / statesPerCell;
+	int index = state % statesPerCell;
+
+	*pRow = (cell / (Cols + 1)) * 2;
+	*pCol = (cell % (Cols + 1)) * 2;
+	if (index < 4)
+	{
+		*pRow += 1;
+		*pCol += 1;
+		*pHeading = centreHeading[index];
+	}
+	else if (index < 10)
+	{
+		*pCol += 1;
+		*pHeading = rowWallHeading[index - 4];
+	}
+	else
+	{
+		*pRow += 1;
+		*pHeading = colWallHeading[index - 10];
+	}
+}
+
+template<int Rows, int Cols>
+bool
+SpeedRunPlanner<Rows, Cols>::isOpen (Maze<Rows, Cols> *pMaze, int row, int col)
+{
+	if ((row < 0) || (row >= pointRows) || (col < 0) || (col >= pointCols))
+	{
+		return false;
+	}
+	if ((row % 2 == 1) && (col % 2 == 1))
+	{
+		/* centre of a cell */
+		return true;
+	}
+	if ((row % 2 == 0) && (col % 2 == 1))
+	{
+		/* the last row of walls is only the row_plus of the last cells */
+		return (row / 2 < Rows) ?
+				(wall != pMaze->getWall(row / 2, col / 2, row_minus)) :
+				(wall != pMaze->getWall(Rows - 1, col / 2, row_plus));
+	}
+	if ((row % 2 == 1) && (col % 2 == 0))
+	{
+		return (col / 2 < Cols) ?
+				(wall != pMaze->getWall(row / 2, col / 2, col_minus)) :
+				(wall != pMaze->getWall(row / 2, Cols - 1, col_plus));
+	}
+	/* a post */
+	return false;
+}
+
+template<int Rows, int Cols>
+bool
+SpeedRunPlanner<Rows, Cols>::isHeadingAllowed (int row, int col, int heading)
+{
+	if ((row % 2 == 1) && (col % 2 == 1))
+	{
+		/* no diagonal at the centre */
+		return (heading % 2 == 0);
+	}
+	if (row % 2 == 0)
+	{
+		/* must cross the row wall, not go along it */
+		return (headingRow[heading] != 0);
+	}
+	return (headingCol[heading] != 0);
+}
+
+template<int Rows, int Cols>
+int
+SpeedRunPlanner<Rows, Cols>::getTurnCost (int turn)
+{
+	switch (turn)
+	{
+		case 1:
+		case 7:
+			return cost.turn45;
+		case 2:
+		case 6:
+			return cost.turn90;
+		case 4:
+			return cost.turn180;
+		default:
+			return 0;
+	}
+}
+
+template<int Rows, int Cols>
+move_e
+SpeedRunPlanner<Rows, Cols>::getTurnMove (int turn)
+{
+	switch (turn)
+	{
+		case 1:
+			return eMoveTurnLeft45;
+		case 7:
+			return eMoveTurnRight45;
+		case 2:
+			return eMoveTurnLeft90;
+		case 6:
+			return eMoveTurnRight90;
+		case 4:
+			return eMoveTurn180;
+		default:
+			return eMoveError;
+	}
+}
+
+template<int Rows, int Cols>
+void
+SpeedRunPlanner<Rows, Cols>::relax (int state, int newCost, uint8_t from)
+{
+	if ((newCost >= infiniteCost) || (newCost >= stateCost[state]))
+	{
+		return;
+	}
+	stateCost[state] = (uint16_t) newCost;
+	setFrom(state, from);
+	/* The old entry of the state stays in the queue and is skipped when it
+	 comes out with the old cost */
+	if (stateQueue.push(newCost, (uint16_t) state) < 0)
+	{
+		isOverflowed = true;
+	}
+}
+
+template<int Rows, int Cols>
+int
+SpeedRunPlanner<Rows, Cols>::plan (Maze<Rows, Cols> *pMaze, pos_t start,
+								   dir_e startDir, pos_t goal)
+{
+	int state;
+	int stateCostNow;
+	int heading;
+	int newHeading;
+	int row;
+	int col;
+	int turn;
+	int i;
+	/* turns to try, as heading differences */
+	static const int turns[5] = {1, 7, 2, 6, 4};
+
+	if (Maze<Rows, Cols>::isPosOutOfBounds(start.row, start.col)
+			|| Maze<Rows, Cols>::isPosOutOfBounds(goal.row, goal.col)
+			|| (startDir < row_plus) || (startDir > col_minus))
+	{
+		return mazeERROR;
+	}
+
+	for (i = 0; i < stateSize; i++)
+	{
+		stateCost[i] = infiniteCost;
+	}
+	for (i = 0; i < (int) sizeof(stateFrom); i++)
+	{
+		stateFrom[i] = (fromNone << 4) | fromNone;
+	}
+	stateQueue.init();
+	moveQueue.init();
+	isOverflowed = false;
+
+	state = getState(start.row * 2 + 1, start.col * 2 + 1, (int) startDir * 2);
+	stateCost[state] = 0;
+	stateQueue.push(0, (uint16_t) state);
+
+	while (!stateQueue.isEmpty() && !isOverflowed)
+	{
+		stateCostNow = stateQueue.peekKey();
+		state = stateQueue.pop();
+		if (stateCostNow > stateCost[state])
+		{
+			continue;
+		}
+		getPoint(state, &row, &col, &heading);
+
+		if ((row == goal.row * 2 + 1) && (col == goal.col * 2 + 1))
+		{
+			buildMoves(state);
+			return stateCostNow;
+		}
+
+		/* go ahead */
+		if (isOpen(pMaze, row + headingRow[heading], col + headingCol[heading])
+				&& isHeadingAllowed(row + headingRow[heading], col + headingCol[heading], heading))
+		{
+			relax(getState(row + headingRow[heading], col + headingCol[heading], heading),
+				  stateCostNow + ((heading % 2 == 0) ? cost.straight : cost.diagonal),
+				  fromMove);
+		}
+
+		/* turn on the spot */
+		for (i = 0; i < 5; i++)
+		{
+			turn = turns[i];
+			newHeading = (heading + turn) % headings;
+			if (!isHeadingAllowed(row, col, newHeading))
+			{
+				continue;
+			}
+			if ((row % 2 == 0) || (col % 2 == 0))
+			{
+				/* On a wall the mouse keeps crossing it the same way, and
+				 turns at most 90 degrees */
+				if ((turn == 4)
+						|| ((row % 2 == 0) && (headingRow[heading] != headingRow[newHeading]))
+						|| ((col % 2 == 0) && (headingCol[heading] != headingCol[newHeading])))
+				{
+					continue;
+				}
+			}
+			relax(getState(row, col, newHeading), stateCostNow + getTurnCost(turn),
+				  (uint8_t) heading);
+		}
+	}
+	if (isOverflowed)
+	{
+		/* Some states are lost. Fall back to the path of the fewest cells,
+		 which does not need more of the queue than there are cells */
+		return planCells(pMaze, start, startDir, goal);
+	}
+	return mazeERROR;
+}
+
+template<int Rows, int Cols>
+int
+SpeedRunPlanner<Rows, Cols>::planCells (Maze<Rows, Cols> *pMaze, pos_t start,
+										dir_e startDir, pos_t goal)
+{
+	move_t move;
+	int heading = (int) startDir * 2;
+	int total = 0;
+	int state;
+	int nextState = 0;
+	int row;
+	int col;
+	int turn;
+	int i;
+
+	for (i = 0; i < stateSize; i++)
+	{
+		stateCost[i] = infiniteCost;
+	}
+	stateQueue.init();
+	moveQueue.init();
+	isOverflowed = false;
+
+	/* Breadth-first from the goal, with the distance in the cost of the
+	 centre states. Each cell is pushed once, when it is reached, so
+	 @stateQueue never holds more than Rows * Cols states */
+	state = getState(goal.row * 2 + 1, goal.col * 2 + 1, 0);
+	stateCost[state] = 0;
+	stateQueue.push(0, (uint16_t) state);
+	while (!stateQueue.isEmpty())
+	{
+		state = stateQueue.pop();
+		getPoint(state, &row, &col, &turn);
+		row /= 2;
+		col /= 2;
+		for (i = (int) row_plus; i <= (int) col_minus; i++)
+		{
+			if ((wall == pMaze->getWall(row, col, (dir_e) i))
+					|| Maze<Rows, Cols>::isPosOutOfBounds(row + dirRow[i], col + dirCol[i]))
+			{
+				continue;
+			}
+			nextState = getState((row + dirRow[i]) * 2 + 1, (col + dirCol[i]) * 2 + 1, 0);
+			if (stateCost[nextState] == infiniteCost)
+			{
+				stateCost[nextState] = stateCost[state] + 1;
+				stateQueue.push(stateCost[nextState], (uint16_t) nextState);
+			}
+		}
+	}
+
+	row = start.row;
+	col = start.col;
+	state = getState(row * 2 + 1, col * 2 + 1, 0);
+	if (stateCost[state] == infiniteCost)
+	{
+		return mazeERROR;
+	}
+	/* Down the distance to the goal, a straight of two half cells per cell */
+	while (stateCost[state] != 0)
+	{
+		for (i = (int) row_plus; i <= (int) col_minus; i++)
+		{
+			if ((wall == pMaze->getWall(row, col, (dir_e) i))
+					|| Maze<Rows, Cols>::isPosOutOfBounds(row + dirRow[i], col + dirCol[i]))
+			{
+				continue;
+			}
+			nextState = getState((row + dirRow[i]) * 2 + 1, (col + dirCol[i]) * 2 + 1, 0);
+			if (stateCost[nextState] + 1 == stateCost[state])
+			{
+				break;
+			}
+		}
+		turn = (i * 2 - heading + headings) % headings;
+		if (turn != 0)
+		{
+			moveQueue.pushToBack((move_t){getTurnMove(turn), 1});
+			total += getTurnCost(turn);
+		}
+		if (!moveQueue.isEmpty() && (moveQueue.peekFromBack().move == eMoveStraight))
+		{
+			move = moveQueue.popFromBack();
+			move.count += 2;
+			moveQueue.pushToBack(move);
+		}
+		else
+		{
+			moveQueue.pushToBack((move_t){eMoveStraight, 2});
+		}
+		total += cost.straight * 2;
+		heading = i * 2;
+		row += dirRow[i];
+		col += dirCol[i];
+		state = nextState;
+	}
+	return total;
+}
+
+template<int Rows, int Cols>
+void
+SpeedRunPlanner<Rows, Cols>::buildMoves (int state)
+{
+	move_t move;
+	move_e moveType;
+	int heading;
+	int row;
+	int col;
+
+	/* Walk back from the goal, so the moves are pushed to the front */
+	while (getFrom(state) != fromNone)
+	{
+		getPoint(state, &row, &col, &heading);
+
+		if (getFrom(state) == fromMove)
+		{
+			moveType = (heading % 2 == 0) ? eMoveStraight : eMoveDiagonal;
+			if (!moveQueue.isEmpty() && (moveQueue.peekFromFront().move == moveType))
+			{
+				move = moveQueue.popFromFront();
+				move.count++;
+				moveQueue.pushToFront(move);
+			}
+			else
+			{
+				moveQueue.pushToFront((move_t){moveType, 1});
+			}
+			state = getState(row - headingRow[heading], col - headingCol[heading], heading);
+		}
+		else
+		{
+			moveQueue.pushToFront((move_t){getTurnMove((heading - getFrom(state) + headings) % headings), 1});
+			state = getState(row, col, getFrom(state));
+		}
+	}
+}
+
+template<int Rows, int Cols>
+int
+SpeedRunPlanner<Rows, Cols>::getCellPathCost (dir_e startDir, const dir_e *dirs, int count)
+{
+	int total = 0;
+	int heading = (int) startDir * 2;
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		total += getTurnCost(((int) dirs[i] * 2 - heading + headings) % headings);
+		/* from centre to centre */
+		total += cost.straight * 2;
+		heading = (int) dirs[i] * 2;
+	}
+	return total;
+}
+
+template<int Rows, int Cols>
+void
+SpeedRunPlanner<Rows, Cols>::printMoves ()
+{
+	static const char *names[] = {"S", "D", "L45", "R45", "L90", "R90", "U"};
+	move_t move;
+	int i;
+
+	/* Rotate the queue once so that the moves stay */
+	for (i = 0; i < moveQueue.getSize(); i++)
+	{
+		move = moveQueue.popFromFront();
+		if ((move.move == eMoveStraight) || (move.move == eMoveDiagonal))
+		{
+			printf("%s%d ", names[move.move], move.count);
+		}
+		else
+		{
+			printf("%s ", names[move.move]);
+		}
+		moveQueue.pushToBack(move);
+	}
+	printf("\r\n");
+}
+
+/* Explicit instantiation of the sizes in mazeFOR_EACH_SIZE */
+#define mazeINSTANTIATE(rows, cols)	template class SpeedRunPlanner<rows, cols>;
+mazeFOR_EACH_SIZE(mazeINSTANTIATE)
@@ -0,0 +1,458 @@
+/*
+ * I2cBusSim.c
+ *
+ *  Host-side (Linux) check of the I2C transaction queue
+ *  (src/peripheral/kb_i2c_queue.c) against a simulated 400 kHz bus. The
+ *  devices are register files with an auto-incremented register pointer,
+ *  as most sensors have; a device can be missing or NACK a number of
+ *  attempts, and the bus can refuse to start. A transaction ends after its
+ *  bus time, as the DMA and the I2C interrupts would end it.
+ *  It checks the order of the transactions (including those submitted from
+ *  a completion callback), the register bursts, the retries, the errors, the
+ *  abort and the cancel of a waiting transaction.
+ *
+ *  Usage: kb-i2c
+ *  Build: make kb-i2c (at the top of the repository)
+ */
+
+#include "kb_i2c_queue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_DEVICE_NUM      4
+#define SIM_LOG_NUM         64
+#define SIM_BIT_NS          2500    // 400 kHz
+
+// kb_status_t
+#define SIM_OK              0
+#define SIM_ERROR           (-1)
+#define SIM_BUSY            (-2)
+#define SIM_TIMEOUT         (-3)
+
+typedef struct {
+    uint16_t address;
+    uint8_t reg[256];
+    uint8_t pointer;
+    int nack_num;                   // NACK this many attempts
+} sim_device_t;
+
+typedef struct {
+    sim_device_t device[SIM_DEVICE_NUM];
+    int device_num;
+    kb_i2c_xfer_t *running;
+    uint64_t now_ns;
+    uint64_t end_ns;                // of the running transaction
+    int refuse_num;                 // refuse to start this many times
+    kb_i2c_queue_t *queue;
+    // what was started and what completed, by the id in xfer->context
+    int start_log[SIM_LOG_NUM];
+    int start_num;
+    int done_log[SIM_LOG_NUM];
+    int done_status[SIM_LOG_NUM];
+    int done_num;
+} sim_bus_t;
+
+static int failures_ = 0;
+
+#define check_(condition) \
+    do { \
+        if (!(condition)) \
+        { \
+            printf("%s:%d: %s failed\r\n", __FILE__, __LINE__, #condition); \
+            failures_++; \
+        } \
+    } while (0)
+
+static int id_(const kb_i2c_xfer_t *xfer)
+{
+    return (int)(intptr_t)xfer->context;
+}
+
+static int sim_start_(void *bus, kb_i2c_xfer_t *xfer)
+{
+    sim_bus_t *sim = (sim_bus_t *)bus;
+    uint32_t bytes;
+
+    if (sim->running != NULL)
+    {
+        printf("the queue started a transaction on a busy bus\r\n");
+        failures_++;
+        return SIM_BUSY;
+    }
+    if (sim->refuse_num > 0)
+    {
+        sim->refuse_num--;
+        return SIM_BUSY;
+    }
+    if (sim->start_num < SIM_LOG_NUM)
+    {
+        sim->start_log[sim->start_num++] = id_(xfer);
+    }
+    // address byte per start, the data, 9 bits each with the ACK
+    bytes = xfer->tx_size + xfer->rx_size + ((xfer->tx_size != 0) ? 1 : 0) + ((xfer->rx_size != 0) ? 1 : 0);
+    if (xfer->mem_address_size != 0)
+    {
+        // the write of the register address, before the data or the read
+        bytes += xfer->mem_address_size + ((xfer->rx_size != 0) ? 1 : 0);
+    }
+    sim->running = xfer;
+    sim->end_ns = sim->now_ns + (uint64_t)bytes * 9 * SIM_BIT_NS;
+    return SIM_OK;
+}
+
+static const kb_i2c_queue_ops_t sim_ops_ = {sim_start_, NULL, NULL};
+
+static sim_device_t *sim_find_(sim_bus_t *sim, uint16_t address)
+{
+    int i;
+    for (i = 0; i < sim->device_num; i++)
+    {
+        if (sim->device[i].address == address)
+        {
+            return &sim->device[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief The running transaction reaches its end: apply it to the device
+ *        and tell the queue, as the interrupt handler does
+ */
+static void sim_finish_(sim_bus_t *sim)
+{
+    kb_i2c_xfer_t *xfer = sim->running;
+    sim_device_t *device = sim_find_(sim, xfer->address);
+    uint16_t i;
+
+    sim->now_ns = sim->end_ns;
+    sim->running = NULL;
+    if ((device == NULL) || (device->nack_num > 0))
+    {
+        if (device != NULL)
+        {
+            device->nack_num--;
+        }
+        kb_i2c_queue_done(sim->queue, SIM_ERROR);
+        return;
+    }
+    // the register address, or else the first byte written, is the register pointer
+    if (xfer->mem_address_size != 0)
+    {
+        device->pointer = (uint8_t)xfer->mem_address;
+    }
+    for (i = 0; i < xfer->tx_size; i++)
+    {
+        if ((i == 0) && (xfer->mem_address_size == 0))
+        {
+            device->pointer = xfer->tx_buf[0];
+        }
+        else
+        {
+            device->reg[device->pointer++] = xfer->tx_buf[i];
+        }
+    }
+    for (i = 0; i < xfer->rx_size; i++)
+    {
+        xfer->rx_buf[i] = device->reg[device->pointer++];
+    }
+    kb_i2c_queue_done(sim->queue, SIM_OK);
+}
+
+static void sim_run_(sim_bus_t *sim)
+{
+    while (sim->running != NULL)
+    {
+        sim_finish_(sim);
+    }
+}
+
+static sim_bus_t sim_;
+static kb_i2c_queue_t queue_;
+
+static void sim_reset_(void)
+{
+    memset(&sim_, 0, sizeof(sim_));
+    sim_.device_num = 2;
+    sim_.device[0].address = 0x29;  // VL6180X
+    sim_.device[1].address = 0x70;  // TCA9545A
+    sim_.queue = &queue_;
+    kb_i2c_queue_init(&queue_, &sim_ops_, &sim_);
+}
+
+static void log_done_(kb_i2c_xfer_t *xfer)
+{
+    if (sim_.done_num < SIM_LOG_NUM)
+    {
+        sim_.done_status[sim_.done_num] = xfer->status;
+        sim_.done_log[sim_.done_num++] = id_(xfer);
+    }
+}
+
+static void xfer_(kb_i2c_xfer_t *xfer, int id, uint16_t address, const uint8_t *tx, uint16_t tx_size,
+        uint8_t *rx, uint16_t rx_size)
+{
+    memset(xfer, 0, sizeof(*xfer));
+    xfer->address = address;
+    xfer->tx_buf = tx;
+    xfer->tx_size = tx_size;
+    xfer->rx_buf = rx;
+    xfer->rx_size = rx_size;
+    xfer->callback = log_done_;
+    xfer->context = (void *)(intptr_t)id;
+}
+
+static void check_order_(void)
+{
+    kb_i2c_xfer_t xfer[5];
+    uint8_t tx[5][3];
+    uint8_t rx[5][2];
+    int i;
+
+    sim_reset_();
+    for (i = 0; i < 5; i++)
+    {
+        tx[i][0] = (uint8_t)(0x10 * i);
+        tx[i][1] = (uint8_t)i;
+        tx[i][2] = (uint8_t)(i + 100);
+        xfer_(&xfer[i], i, (i % 2) ? 0x70 : 0x29, tx[i], 3, NULL, 0);
+        check_(kb_i2c_queue_submit(&queue_, &xfer[i]) == SIM_OK);
+    }
+    // only the first one runs while the others wait
+    check_(sim_.start_num == 1);
+    check_(kb_i2c_queue_is_busy(&queue_));
+    check_(xfer[4].status == SIM_BUSY);
+    sim_run_(&sim_);
+    check_(!kb_i2c_queue_is_busy(&queue_));
+    check_(sim_.done_num == 5);
+    for (i = 0; i < 5; i++)
+    {
+        check_(sim_.start_log[i] == i);
+        check_(sim_.done_log[i] == i);
+        check_(xfer[i].status == SIM_OK);
+    }
+    check_(queue_.done_count == 5);
+
+    // read the registers back, write then read with a repeated start
+    for (i = 0; i < 5; i++)
+    {
+        xfer_(&xfer[i], 10 + i, (i % 2) ? 0x70 : 0x29, tx[i], 1, rx[i], 2);
+        kb_i2c_queue_submit(&queue_, &xfer[i]);
+    }
+    sim_run_(&sim_);
+    for (i = 0; i < 5; i++)
+    {
+        check_((rx[i][0] == i) && (rx[i][1] == i + 100));
+    }
+    printf("order: 10 transactions, %.1f us of bus time\r\n", sim_.now_ns / 1000.0);
+}
+
+static void mem_xfer_(kb_i2c_xfer_t *xfer, int id, uint16_t address, uint8_t mem_address,
+        const uint8_t *tx, uint16_t tx_size, uint8_t *rx, uint16_t rx_size)
+{
+    xfer_(xfer, id, address, tx, tx_size, rx, rx_size);
+    xfer->mem_address = mem_address;
+    xfer->mem_address_size = 1;
+}
+
+static void check_mem_(void)
+{
+    kb_i2c_xfer_t xfer[2];
+    uint8_t tx[6] = {1, 2, 3, 4, 5, 6};
+    uint8_t rx[6] = {0};
+    uint8_t byte;
+    uint64_t start_ns;
+    int i;
+
+    sim_reset_();
+    // a burst of 6 registers each way, one transaction each
+    mem_xfer_(&xfer[0], 0, 0x29, 0x40, tx, 6, NULL, 0);
+    mem_xfer_(&xfer[1], 1, 0x29, 0x40, NULL, 0, rx, 6);
+    check_(kb_i2c_queue_submit(&queue_, &xfer[0]) == SIM_OK);
+    check_(kb_i2c_queue_submit(&queue_, &xfer[1]) == SIM_OK);
+    sim_run_(&sim_);
+    check_(sim_.start_num == 2);
+    check_((xfer[0].status == SIM_OK) && (xfer[1].status == SIM_OK));
+    check_(memcmp(tx, rx, sizeof(tx)) == 0);
+    check_(sim_.device[0].reg[0x45] == 6);
+    printf("mem: 6 registers written and read back in 2 transactions, %.1f us\r\n", sim_.now_ns / 1000.0);
+
+    // a register one by one: 1 transaction instead of a write then a read
+    start_ns = sim_.now_ns;
+    for (i = 0; i < 6; i++)
+    {
+        mem_xfer_(&xfer[0], 10 + i, 0x29, (uint8_t)(0x40 + i), NULL, 0, &byte, 1);
+        kb_i2c_queue_submit(&queue_, &xfer[0]);
+        sim_run_(&sim_);
+        check_(byte == tx[i]);
+    }
+    check_(sim_.start_num == 8);
+    printf("mem: 6 single registers in 6 transactions, %.1f us\r\n", (sim_.now_ns - start_ns) / 1000.0);
+
+    // a register address with both a write and a read, or too long, is refused
+    mem_xfer_(&xfer[0], 20, 0x29, 0x40, tx, 1, rx, 1);
+    check_(kb_i2c_queue_submit(&queue_, &xfer[0]) == SIM_ERROR);
+    mem_xfer_(&xfer[0], 21, 0x29, 0x40, NULL, 0, rx, 1);
+    xfer[0].mem_address_size = 3;
+    check_(kb_i2c_queue_submit(&queue_, &xfer[0]) == SIM_ERROR);
+}
+
+/* A callback that queues a follow-up, as a sensor driver chains its reads */
+
+static kb_i2c_xfer_t follow_up_;
+static uint8_t follow_up_tx_ = 0x42;
+
+static void submit_follow_up_(kb_i2c_xfer_t *xfer)
+{
+    log_done_(xfer);
+    xfer_(&follow_up_, 99, 0x29, &follow_up_tx_, 1, NULL, 0);
+    check_(kb_i2c_queue_submit(&queue_, &follow_up_) == SIM_OK);
+}
+
+static void check_callback_submit_(void)
+{
+    kb_i2c_xfer_t a, b;
+    uint8_t tx = 1;
+
+    sim_reset_();
+    xfer_(&a, 1, 0x29, &tx, 1, NULL, 0);
+    a.callback = submit_follow_up_;
+    xfer_(&b, 2, 0x70, &tx, 1, NULL, 0);
+    kb_i2c_queue_submit(&queue_, &a);
+    kb_i2c_queue_submit(&queue_, &b);
+    sim_run_(&sim_);
+    // the follow-up goes behind what was already queued
+    check_(sim_.done_num == 3);
+    check_((sim_.done_log[0] == 1) && (sim_.done_log[1] == 2) && (sim_.done_log[2] == 99));
+}
+
+static void check_errors_(void)
+{
+    kb_i2c_xfer_t xfer[4];
+    uint8_t tx = 0;
+    uint8_t rx[4];
+
+    sim_reset_();
+    // NACKs twice: 3 retries are enough, 1 is not
+    sim_.device[0].nack_num = 2;
+    xfer_(&xfer[0], 0, 0x29, &tx, 1, &rx[0], 1);
+    xfer[0].retries = 3;
+    kb_i2c_queue_submit(&queue_, &xfer[0]);
+    sim_run_(&sim_);
+    check_(xfer[0].status == SIM_OK);
+    check_(queue_.retry_count == 2);
+
+    sim_.device[0].nack_num = 2;
+    xfer_(&xfer[0], 0, 0x29, &tx, 1, &rx[0], 1);
+    xfer[0].retries = 1;
+    // a missing device, then one that works
+    xfer_(&xfer[1], 1, 0x31, &tx, 1, NULL, 0);
+    xfer_(&xfer[2], 2, 0x70, NULL, 0, &rx[2], 1);
+    kb_i2c_queue_submit(&queue_, &xfer[0]);
+    kb_i2c_queue_submit(&queue_, &xfer[1]);
+    kb_i2c_queue_submit(&queue_, &xfer[2]);
+    sim_run_(&sim_);
+    check_(xfer[0].status == SIM_ERROR);
+    check_(xfer[1].status == SIM_ERROR);
+    check_(xfer[2].status == SIM_OK);
+    check_(queue_.error_count == 2);
+
+    // the bus refuses to start: that one fails and the next runs
+    sim_.refuse_num = 1;
+    xfer_(&xfer[0], 0, 0x29, &tx, 1, NULL, 0);
+    xfer_(&xfer[1], 1, 0x29, &tx, 1, NULL, 0);
+    check_(kb_i2c_queue_submit(&queue_, &xfer[0]) == SIM_OK);
+    check_(xfer[0].status == SIM_ERROR);
+    kb_i2c_queue_submit(&queue_, &xfer[1]);
+    sim_run_(&sim_);
+    check_(xfer[1].status == SIM_OK);
+
+    // a queued descriptor cannot be queued again; an empty one is refused
+    xfer_(&xfer[0], 0, 0x29, &tx, 1, NULL, 0);
+    kb_i2c_queue_submit(&queue_, &xfer[0]);
+    check_(kb_i2c_queue_submit(&queue_, &xfer[0]) == SIM_BUSY);
+    sim_run_(&sim_);
+    xfer_(&xfer[3], 3, 0x29, NULL, 0, NULL, 0);
+    check_(kb_i2c_queue_submit(&queue_, &xfer[3]) == SIM_ERROR);
+    xfer_(&xfer[3], 3, 0x29, NULL, 1, NULL, 0);
+    check_(kb_i2c_queue_submit(&queue_, &xfer[3]) == SIM_ERROR);
+}
+
+static void check_abort_(void)
+{
+    kb_i2c_xfer_t xfer[4];
+    uint8_t tx = 0;
+    int i;
+
+    sim_reset_();
+    for (i = 0; i < 3; i++)
+    {
+        xfer_(&xfer[i], i, 0x29, &tx, 1, NULL, 0);
+        kb_i2c_queue_submit(&queue_, &xfer[i]);
+    }
+    // the bus hangs on the first one: stop it and abort
+    sim_.running = NULL;
+    kb_i2c_queue_abort(&queue_, SIM_TIMEOUT);
+    check_(sim_.done_num == 3);
+    for (i = 0; i < 3; i++)
+    {
+        check_(xfer[i].status == SIM_TIMEOUT);
+    }
+    check_(!kb_i2c_queue_is_busy(&queue_));
+    // a late end of the stopped transaction is ignored
+    kb_i2c_queue_done(&queue_, SIM_OK);
+    check_(sim_.done_num == 3);
+
+    // and the queue works again
+    xfer_(&xfer[3], 3, 0x29, &tx, 1, NULL, 0);
+    kb_i2c_queue_submit(&queue_, &xfer[3]);
+    sim_run_(&sim_);
+    check_(xfer[3].status == SIM_OK);
+}
+
+static void check_cancel_(void)
+{
+    kb_i2c_xfer_t xfer[4];
+    uint8_t tx = 0;
+    int i;
+
+    sim_reset_();
+    for (i = 0; i < 3; i++)
+    {
+        xfer_(&xfer[i], i, 0x29, &tx, 1, NULL, 0);
+        kb_i2c_queue_submit(&queue_, &xfer[i]);
+    }
+    // the running one stays with the bus
+    check_(kb_i2c_queue_cancel(&queue_, &xfer[0], SIM_TIMEOUT) == SIM_BUSY);
+    check_(xfer[0].status == SIM_BUSY);
+    // waiting ones leave, the middle and then the tail
+    check_(kb_i2c_queue_cancel(&queue_, &xfer[1], SIM_TIMEOUT) == SIM_OK);
+    check_(kb_i2c_queue_cancel(&queue_, &xfer[2], SIM_TIMEOUT) == SIM_OK);
+    check_((xfer[1].status == SIM_TIMEOUT) && (xfer[2].status == SIM_TIMEOUT));
+    check_(kb_i2c_queue_cancel(&queue_, &xfer[1], SIM_TIMEOUT) == SIM_ERROR);
+    check_((sim_.done_num == 2) && (sim_.done_log[0] == 1) && (sim_.done_log[1] == 2));
+    check_(sim_.start_num == 1);
+    // a new one goes behind the running one, at the fixed tail
+    xfer_(&xfer[3], 3, 0x29, &tx, 1, NULL, 0);
+    check_(kb_i2c_queue_submit(&queue_, &xfer[3]) == SIM_OK);
+    sim_run_(&sim_);
+    check_((xfer[0].status == SIM_OK) && (xfer[3].status == SIM_OK));
+    check_((sim_.start_num == 2) && (sim_.start_log[0] == 0) && (sim_.start_log[1] == 3));
+    check_((queue_.done_count == 2) && (queue_.error_count == 2));
+    check_(!kb_i2c_queue_is_busy(&queue_));
+}
+
+int main(void)
+{
+    check_order_();
+    check_mem_();
+    check_callback_submit_();
+    check_errors_();
+    check_abort_();
+    check_cancel_();
+
+    printf("%d failed\r\n", failures_);
+    return (failures_ == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
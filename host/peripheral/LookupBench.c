@@ -0,0 +1,220 @@
+/*
+ * LookupBench.c
+ *
+ *  Host-side (Linux) benchmark of the handle lookup of the kb_* drivers:
+ *  the if/else chains they used before against the tables now in use:
+ *  - UART: kb_uart_send() compared the instance with USART1 to USART6; now
+ *    the slot table of kb_periph.h. The instances are the STM32F446 base
+ *    addresses; they are compared, never dereferenced.
+ *  - Timer: get_handler() compared the kb_timer_t with TIMER1 to TIMER14;
+ *    now it indexes the table with it.
+ *  Each lookup runs with one instance all the time (the chains at their
+ *  best, with the branches predicted) and with instances in random order.
+ *
+ *  Usage: kb-lookup [iterations]
+ *  Build: make kb-lookup (at the top of the repository)
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
+// From stm32f446xx.h
+#define PERIPH_BASE         0x40000000U
+#define APB1PERIPH_BASE     PERIPH_BASE
+#define APB2PERIPH_BASE     (PERIPH_BASE + 0x00010000U)
+#define USART2_BASE         (APB1PERIPH_BASE + 0x4400U)
+#define USART3_BASE         (APB1PERIPH_BASE + 0x4800U)
+#define UART4_BASE          (APB1PERIPH_BASE + 0x4C00U)
+#define UART5_BASE          (APB1PERIPH_BASE + 0x5000U)
+#define USART1_BASE         (APB2PERIPH_BASE + 0x1000U)
+#define USART6_BASE         (APB2PERIPH_BASE + 0x1400U)
+
+#include "kb_periph.h"
+
+#define INSTANCE(base)      ((void *)(uintptr_t)(base))
+#define SEQUENCE_NUM        4096
+
+typedef struct {
+    int dummy;
+} handle_t;
+
+static handle_t uart_h_[6];
+static handle_t timer_h_[14];
+
+static void * const uart_list_[6] = {
+    INSTANCE(USART1_BASE), INSTANCE(USART2_BASE), INSTANCE(USART3_BASE),
+    INSTANCE(UART4_BASE), INSTANCE(UART5_BASE), INSTANCE(USART6_BASE)
+};
+
+// kb_timer_t
+static void * const timer_list_[14] = {
+    INSTANCE(0), INSTANCE(1), INSTANCE(2), INSTANCE(3), INSTANCE(4), INSTANCE(5), INSTANCE(6),
+    INSTANCE(7), INSTANCE(8), INSTANCE(9), INSTANCE(10), INSTANCE(11), INSTANCE(12), INSTANCE(13)
+};
+
+/* Before: the chains */
+
+__attribute__((noinline)) static handle_t *uart_chain_(void *uart)
+{
+    if (uart == INSTANCE(USART1_BASE))      return &uart_h_[0];
+    else if (uart == INSTANCE(USART2_BASE)) return &uart_h_[1];
+    else if (uart == INSTANCE(USART3_BASE)) return &uart_h_[2];
+    else if (uart == INSTANCE(UART4_BASE))  return &uart_h_[3];
+    else if (uart == INSTANCE(UART5_BASE))  return &uart_h_[4];
+    else if (uart == INSTANCE(USART6_BASE)) return &uart_h_[5];
+    return NULL;
+}
+
+__attribute__((noinline)) static handle_t *timer_chain_(void *key)
+{
+    uintptr_t timer = (uintptr_t)key;
+    if (timer == 0)         return &timer_h_[0];
+    else if (timer == 1)    return &timer_h_[1];
+    else if (timer == 2)    return &timer_h_[2];
+    else if (timer == 3)    return &timer_h_[3];
+    else if (timer == 4)    return &timer_h_[4];
+    else if (timer == 5)    return &timer_h_[5];
+    else if (timer == 6)    return &timer_h_[6];
+    else if (timer == 7)    return &timer_h_[7];
+    else if (timer == 8)    return &timer_h_[8];
+    else if (timer == 9)    return &timer_h_[9];
+    else if (timer == 10)   return &timer_h_[10];
+    else if (timer == 11)   return &timer_h_[11];
+    else if (timer == 12)   return &timer_h_[12];
+    else if (timer == 13)   return &timer_h_[13];
+    return NULL;
+}
+
+/* After: the tables, as in kb_uart.c and kb_timer.c */
+
+static const uint8_t uart_slot_list_[] = {
+    [KB_PERIPH_SLOT(USART1_BASE)] = 1,
+    [KB_PERIPH_SLOT(USART2_BASE)] = 2,
+    [KB_PERIPH_SLOT(USART3_BASE)] = 3,
+    [KB_PERIPH_SLOT(UART4_BASE)] = 4,
+    [KB_PERIPH_SLOT(UART5_BASE)] = 5,
+    [KB_PERIPH_SLOT(USART6_BASE)] = 6
+};
+
+__attribute__((noinline)) static handle_t *uart_table_(void *uart)
+{
+    int idx = kb_periph_index(uart, uart_slot_list_, sizeof(uart_slot_list_));
+    return (idx < 0) ? NULL : &uart_h_[idx];
+}
+
+__attribute__((noinline)) static handle_t *timer_table_(void *key)
+{
+    uintptr_t timer = (uintptr_t)key;
+    return (timer >= 14) ? NULL : &timer_h_[timer];
+}
+
+/* Measurement */
+
+static uint64_t now_(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static void *sequence_[SEQUENCE_NUM];
+
+/**
+ * @return ticks per lookup, the best of 5 runs
+ */
+static double run_(handle_t *(*lookup)(void *), long iterations)
+{
+    double best = 1e30;
+    uintptr_t sum = 0;
+    uint64_t start;
+    double ticks;
+    long i;
+    int run;
+
+    for (run = 0; run < 5; run++)
+    {
+        start = now_();
+        for (i = 0; i < iterations; i++)
+        {
+            sum += (uintptr_t)lookup(sequence_[i & (SEQUENCE_NUM - 1)]);
+        }
+        ticks = (double)(now_() - start) / (double)iterations;
+        if (ticks < best)
+        {
+            best = ticks;
+        }
+    }
+    if (sum == 0)
+    {
+        printf("no handle found\r\n");
+    }
+    return best;
+}
+
+/**
+ * @return 0 if both lookups give the same handles
+ */
+static int compare_(const char *name, handle_t *(*chain)(void *), handle_t *(*table)(void *),
+        void * const *list, int num, long iterations)
+{
+    double fixed_chain, fixed_table, random_chain, random_table;
+    int i;
+
+    for (i = 0; i < num; i++)
+    {
+        if (chain(list[i]) != table(list[i]))
+        {
+            printf("%s: the lookups differ at %d\r\n", name, i);
+            return 1;
+        }
+    }
+    if ((table(INSTANCE(PERIPH_BASE + 0x3C00U)) != NULL) || (table(INSTANCE(0x20000000U)) != NULL)
+            || (table(INSTANCE(USART1_BASE + 4)) != NULL) || (table(INSTANCE(14)) != NULL))
+    {
+        printf("%s: the table found a wrong instance\r\n", name);
+        return 1;
+    }
+
+    // the last one is the worst case of the chain
+    for (i = 0; i < SEQUENCE_NUM; i++)
+    {
+        sequence_[i] = list[num - 1];
+    }
+    fixed_chain = run_(chain, iterations);
+    fixed_table = run_(table, iterations);
+    for (i = 0; i < SEQUENCE_NUM; i++)
+    {
+        sequence_[i] = list[rand() % num];
+    }
+    random_chain = run_(chain, iterations);
+    random_table = run_(table, iterations);
+
+    printf("%-6s  last: chain %5.2f table %5.2f   random: chain %5.2f table %5.2f\r\n",
+            name, fixed_chain, fixed_table, random_chain, random_table);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    long iterations = (argc > 1) ? atol(argv[1]) : 10000000L;
+    int failures = 0;
+
+    srand(1);
+#if defined(__x86_64__) || defined(__i386__)
+    printf("TSC ticks per lookup\r\n");
+#else
+    printf("ns per lookup\r\n");
+#endif
+    failures += compare_("uart", uart_chain_, uart_table_, uart_list_, 6, iterations);
+    failures += compare_("timer", timer_chain_, timer_table_, timer_list_, 14, iterations);
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
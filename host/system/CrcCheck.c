@@ -0,0 +1,245 @@
+/*
+ * CrcCheck.c
+ *
+ *  Host-side (Linux) check and benchmark of the CRCs (src/system/kb_crc.c):
+ *  published check values, then the byte-at-a-time and slice-by-4 paths
+ *  against a bit-at-a-time reference over every length, alignment and split
+ *  point up to 64 bytes and over random blocks. The benchmark times each
+ *  path on an 8K WINC1500 data packet and on 7-byte commands, in bytes per
+ *  TSC cycle on x86 (bytes per ns otherwise). Host cycles are not
+ *  Cortex-M4 cycles; the ratio between the paths is what carries over.
+ *
+ *  Usage: kb-crc [megabytes]
+ *  Build: make kb-crc (at the top of the repository)
+ */
+
+#include "kb_crc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define CHECK_CYCLES    1
+#else
+    #define CHECK_CYCLES    0
+#endif
+
+#define CHECK_PKT_SZ    (8 * 1024)
+
+static int failures_ = 0;
+static volatile uint32_t sink_;
+
+#define check_(condition) \
+    do { \
+        if (!(condition)) \
+        { \
+            printf("%s:%d: %s failed\r\n", __FILE__, __LINE__, #condition); \
+            failures_++; \
+        } \
+    } while (0)
+
+static uint8_t crc7_bitwise_(uint8_t crc, const uint8_t *buf, uint32_t len)
+{
+    int bit;
+
+    while (len--)
+    {
+        for (bit = 7; bit >= 0; bit--)
+        {
+            uint8_t in = ((*buf >> bit) & 1) ^ ((crc >> 6) & 1);
+            crc = (uint8_t)((crc << 1) & 0x7f);
+            if (in)
+            {
+                crc ^= 0x09;
+            }
+        }
+        buf++;
+    }
+    return crc;
+}
+
+static uint16_t crc16_bitwise_(uint16_t crc, const uint8_t *buf, uint32_t len)
+{
+    int bit;
+
+    while (len--)
+    {
+        crc ^= (uint16_t)(*buf++ << 8);
+        for (bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void check_vectors_(void)
+{
+    static const uint8_t digits[] = "123456789";
+    static const uint8_t cmd0[] = {0x40, 0x00, 0x00, 0x00, 0x00};
+    static const uint8_t cmd8[] = {0x48, 0x00, 0x00, 0x01, 0xaa};
+
+    // CRC-7/MMC and the SD commands with their well-known CRC bytes
+    check_(kb_crc7_sw(0, digits, 9) == 0x75);
+    check_(kb_crc7_bytewise(0, digits, 9) == 0x75);
+    check_(((kb_crc7_sw(0, cmd0, 5) << 1) | 1) == 0x95);
+    check_(((kb_crc7_sw(0, cmd8, 5) << 1) | 1) == 0x87);
+    // CRC-16/IBM-3740 (CCITT-FALSE) and CRC-16/XMODEM
+    check_(kb_crc16_sw(KB_CRC16_INIT, digits, 9) == 0x29b1);
+    check_(kb_crc16_bytewise(KB_CRC16_INIT, digits, 9) == 0x29b1);
+    check_(kb_crc16_sw(0, digits, 9) == 0x31c3);
+    // no bytes
+    check_(kb_crc7_sw(KB_CRC7_INIT, digits, 0) == KB_CRC7_INIT);
+    check_(kb_crc16_sw(KB_CRC16_INIT, digits, 0) == KB_CRC16_INIT);
+    // without KB_CRC_HW the dispatch stays in software
+    check_(kb_crc_init() != 0);
+    check_(kb_crc16(KB_CRC16_INIT, digits, 9) == 0x29b1);
+}
+
+static void check_reference_(void)
+{
+    uint8_t buf[64 + 4];
+    uint32_t offset, len, split, i;
+    int mismatch7 = 0, mismatch16 = 0;
+
+    srand(1);
+    for (i = 0; i < sizeof(buf); i++)
+    {
+        buf[i] = (uint8_t)rand();
+    }
+    for (offset = 0; offset < 4; offset++)
+    {
+        for (len = 0; len <= 64; len++)
+        {
+            const uint8_t *p = &buf[offset];
+            uint8_t ref7 = crc7_bitwise_(KB_CRC7_INIT, p, len);
+            uint16_t ref16 = crc16_bitwise_(KB_CRC16_INIT, p, len);
+
+            mismatch7 += (kb_crc7_bytewise(KB_CRC7_INIT, p, len) != ref7);
+            mismatch7 += (kb_crc7_sw(KB_CRC7_INIT, p, len) != ref7);
+            mismatch16 += (kb_crc16_bytewise(KB_CRC16_INIT, p, len) != ref16);
+            mismatch16 += (kb_crc16_sw(KB_CRC16_INIT, p, len) != ref16);
+            // continuing over two parts gives the CRC of the whole
+            for (split = 0; split <= len; split++)
+            {
+                mismatch7 += (kb_crc7_sw(kb_crc7_sw(KB_CRC7_INIT, p, split),
+                        p + split, len - split) != ref7);
+                mismatch16 += (kb_crc16_sw(kb_crc16_sw(KB_CRC16_INIT, p, split),
+                        p + split, len - split) != ref16);
+            }
+        }
+    }
+    check_(mismatch7 == 0);
+    check_(mismatch16 == 0);
+}
+
+static void check_random_(void)
+{
+    static uint8_t buf[CHECK_PKT_SZ + 3];
+    uint32_t round, i;
+    int mismatch = 0;
+
+    for (round = 0; round < 200; round++)
+    {
+        uint32_t len = (uint32_t)rand() % CHECK_PKT_SZ;
+        uint32_t offset = (uint32_t)rand() % 4;
+        uint8_t init7 = (uint8_t)(rand() & 0x7f);
+        uint16_t init16 = (uint16_t)rand();
+
+        for (i = 0; i < len + offset; i++)
+        {
+            buf[i] = (uint8_t)rand();
+        }
+        mismatch += (kb_crc7_sw(init7, buf + offset, len)
+                != crc7_bitwise_(init7, buf + offset, len));
+        mismatch += (kb_crc16_sw(init16, buf + offset, len)
+                != crc16_bitwise_(init16, buf + offset, len));
+    }
+    check_(mismatch == 0);
+    printf("reference: 4 alignments x 65 lengths with every split, 200 random blocks\r\n");
+}
+
+/******************************************************************************
+ * Benchmark
+ ******************************************************************************/
+
+typedef uint32_t (*bench_fn_t)(const uint8_t *buf, uint32_t len);
+
+static uint32_t crc7_bitwise_fn_(const uint8_t *b, uint32_t n)  { return crc7_bitwise_(KB_CRC7_INIT, b, n); }
+static uint32_t crc7_bytewise_fn_(const uint8_t *b, uint32_t n) { return kb_crc7_bytewise(KB_CRC7_INIT, b, n); }
+static uint32_t crc7_sw_fn_(const uint8_t *b, uint32_t n)       { return kb_crc7_sw(KB_CRC7_INIT, b, n); }
+static uint32_t crc16_bitwise_fn_(const uint8_t *b, uint32_t n) { return crc16_bitwise_(KB_CRC16_INIT, b, n); }
+static uint32_t crc16_bytewise_fn_(const uint8_t *b, uint32_t n){ return kb_crc16_bytewise(KB_CRC16_INIT, b, n); }
+static uint32_t crc16_sw_fn_(const uint8_t *b, uint32_t n)      { return kb_crc16_sw(KB_CRC16_INIT, b, n); }
+
+static double now_ns_(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench_(const char *name, bench_fn_t fn, const uint8_t *buf, uint32_t len, uint32_t total)
+{
+    uint32_t rounds = total / len;
+    uint32_t i;
+    double start_ns, ns;
+#if CHECK_CYCLES
+    uint64_t start_cycles, cycles;
+#endif
+
+    fn(buf, len);
+    start_ns = now_ns_();
+#if CHECK_CYCLES
+    start_cycles = __rdtsc();
+#endif
+    for (i = 0; i < rounds; i++)
+    {
+        sink_ += fn(buf, len);
+        __asm__ volatile("" ::: "memory");  // no hoisting out of the loop
+    }
+#if CHECK_CYCLES
+    cycles = __rdtsc() - start_cycles;
+#endif
+    ns = now_ns_() - start_ns;
+#if CHECK_CYCLES
+    printf("%-16s %5u B: %7.3f B/cycle, %7.3f B/ns\r\n", name, len,
+            (double)rounds * len / cycles, rounds * len / ns);
+#else
+    printf("%-16s %5u B: %7.3f B/ns\r\n", name, len, rounds * len / ns);
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+    static uint8_t buf[CHECK_PKT_SZ];
+    uint32_t total = 64u * 1024u * 1024u;
+    uint32_t i;
+
+    if (argc > 1)
+    {
+        total = (uint32_t)atoi(argv[1]) * 1024u * 1024u;
+    }
+
+    check_vectors_();
+    check_reference_();
+    check_random_();
+
+    for (i = 0; i < sizeof(buf); i++)
+    {
+        buf[i] = (uint8_t)(i * 31 + 5);
+    }
+    bench_("crc7 bitwise", crc7_bitwise_fn_, buf, CHECK_PKT_SZ, total / 8);
+    bench_("crc7 bytewise", crc7_bytewise_fn_, buf, CHECK_PKT_SZ, total);
+    bench_("crc7 slice-by-4", crc7_sw_fn_, buf, CHECK_PKT_SZ, total);
+    bench_("crc7 bytewise", crc7_bytewise_fn_, buf, 7, total / 8);
+    bench_("crc7 slice-by-4", crc7_sw_fn_, buf, 7, total / 8);
+    bench_("crc16 bitwise", crc16_bitwise_fn_, buf, CHECK_PKT_SZ, total / 8);
+    bench_("crc16 bytewise", crc16_bytewise_fn_, buf, CHECK_PKT_SZ, total);
+    bench_("crc16 slice-by-4", crc16_sw_fn_, buf, CHECK_PKT_SZ, total);
+
+    printf("%d failed\r\n", failures_);
+    return (failures_ == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,260 @@
+/*
+ * LogCheck.c
+ *
+ *  Host-side (Linux) check of the deferred log (src/system/kb_log.c): the
+ *  text of records against snprintf(), a full ring dropping and counting
+ *  records, threads logging while another reads, where every record must
+ *  come out whole and in the order of its thread, and kb-log-decode, run on
+ *  this program as the ELF file, against kb_log_format().
+ *
+ *  Usage: kb-log (with kb-log-decode next to it)
+ *  Build: make kb-log (at the top of the repository)
+ */
+
+#include "kb_log.h"
+#include "kb_time.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK_THREADS       3
+#define CHECK_RECORDS       200000
+#define CHECK_MAGIC         0x5a5a5a5au
+#define TEXT_SIZE           128
+
+static int failures_ = 0;
+
+#define check_(condition) \
+    do { \
+        if (!(condition)) \
+        { \
+            printf("%s:%d: %s failed\r\n", __FILE__, __LINE__, #condition); \
+            failures_++; \
+        } \
+    } while (0)
+
+/* The simulated counter: a cycle per read */
+static uint32_t counter_ = 0;
+
+uint32_t kb_time_sim_counter(void)
+{
+    return __atomic_fetch_add(&counter_, 1, __ATOMIC_RELAXED);
+}
+
+static void check_format_(void)
+{
+    static const char *expected[] = {
+        "      1000 plain",
+        "      1001 -5 7 beef CAFE 10",
+        "      1002 ok|   42|a   |00001234|%",
+        "      1003 1 2 3 4 5 6 7 8",
+        "      1004 KB_LIB:SPI:12:Error: line end",
+    };
+    uint32_t words[KB_LOG_SIZE];
+    char text[TEXT_SIZE];
+    uint32_t count;
+    uint32_t i;
+    int n = 0;
+
+    kb_log_reset();
+    counter_ = 1000;
+    KB_LOG("plain");
+    KB_LOG("%d %u %x %X %o", -5, 7u, 0xbeefu, 0xcafeu, 8u);
+    KB_LOG("%c%c|%5d|%-4x|%08x|%%", 'o', 'k', 42, 0xau, 0x1234u);
+    KB_LOG("%d %d %d %d %d %d %d %d", 1, 2, 3, 4, 5, 6, 7, 8);
+    KB_LOG("KB_LIB:" "SPI" ":%d:Error: " "line end\r\n", 12);
+
+    // whole records only
+    check_(kb_log_read(words, 3) == 2);
+    check_((KB_LOG_RECORD_WORDS(words[0]) == 2) && (words[1] == 1000));
+    kb_log_format(words, text, sizeof(text));
+    check_(strcmp(text, expected[n++]) == 0);
+    count = kb_log_read(words, KB_LOG_SIZE);
+    check_(count == 7 + 7 + 10 + 3);
+    for (i = 0; i < count; i += KB_LOG_RECORD_WORDS(words[i]))
+    {
+        kb_log_format(&words[i], text, sizeof(text));
+        check_((n < 5) && (strcmp(text, expected[n]) == 0));
+        n++;
+    }
+    check_(n == 5);
+    check_(kb_log_read(words, KB_LOG_SIZE) == 0);
+}
+
+static int flushed_ = 0;
+static char last_line_[TEXT_SIZE];
+
+static int write_line_(const char *line)
+{
+    flushed_++;
+    snprintf(last_line_, sizeof(last_line_), "%s", line);
+    return 0;
+}
+
+static void check_full_(void)
+{
+    uint32_t words[KB_LOG_SIZE];
+    int i;
+
+    kb_log_reset();
+    // 3 words each
+    for (i = 0; i < KB_LOG_SIZE; i++)
+    {
+        KB_LOG("%d", i);
+    }
+    check_(kb_log_dropped() == KB_LOG_SIZE - KB_LOG_SIZE / 3);
+    // a record does not fit in less than its size
+    check_(kb_log_read(words, 2) == 0);
+    check_(kb_log_read(words, 4) == 3);
+    check_(words[2] == 0);
+    // room for one more
+    KB_LOG("%d", -1);
+    check_(kb_log_dropped() == KB_LOG_SIZE - KB_LOG_SIZE / 3);
+
+    kb_log_flush(write_line_);
+    check_(flushed_ == KB_LOG_SIZE / 3 + 1);
+    check_(strcmp(last_line_, "kb_log: 342 dropped") == 0);
+    check_(kb_log_read(words, KB_LOG_SIZE) == 0);
+    // reported once
+    kb_log_flush(write_line_);
+    check_(flushed_ == KB_LOG_SIZE / 3 + 1);
+}
+
+/* Producers: id, sequence number and a check word. A record that does not
+ * fit is written again after the others ran */
+static const char thread_format_[] __attribute__((section("kb_log_fmt"), used)) = "%u %u %u";
+static uint32_t retries_ = 0;
+
+static void *produce_(void *arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+    uint32_t seq;
+
+    for (seq = 0; seq < CHECK_RECORDS; seq++)
+    {
+        while (kb_log_write(thread_format_, 3, id, seq, (seq * 7) ^ id ^ CHECK_MAGIC) != 0)
+        {
+            __atomic_fetch_add(&retries_, 1, __ATOMIC_RELAXED);
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void check_threads_(void)
+{
+    pthread_t threads[CHECK_THREADS];
+    uint32_t next[CHECK_THREADS] = {0};
+    uint32_t received = 0;
+    uint32_t words[64];
+    uint32_t count;
+    uint32_t i;
+
+    kb_log_reset();
+    for (i = 0; i < CHECK_THREADS; i++)
+    {
+        pthread_create(&threads[i], NULL, produce_, (void *)(uintptr_t)i);
+    }
+    while (received < CHECK_THREADS * CHECK_RECORDS)
+    {
+        count = kb_log_read(words, 64);
+        if (count == 0)
+        {
+            sched_yield();
+        }
+        for (i = 0; i < count; i += KB_LOG_RECORD_WORDS(words[i]))
+        {
+            uint32_t id = words[i + 2];
+            uint32_t seq = words[i + 3];
+            if ((KB_LOG_RECORD_WORDS(words[i]) != 5) || (id >= CHECK_THREADS))
+            {
+                check_(KB_LOG_RECORD_WORDS(words[i]) == 5);
+                check_(id < CHECK_THREADS);
+                return;
+            }
+            check_(seq == next[id]);
+            check_(words[i + 4] == ((seq * 7) ^ id ^ CHECK_MAGIC));
+            next[id] = seq + 1;
+            received++;
+        }
+    }
+    for (i = 0; i < CHECK_THREADS; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    check_(kb_log_read(words, 64) == 0);
+    check_(kb_log_dropped() == retries_);
+    printf("threads: %u records, %u retried\r\n", received, retries_);
+}
+
+static void check_decoder_(const char *program)
+{
+    uint32_t words[KB_LOG_SIZE];
+    uint32_t count;
+    uint32_t bad = 0xffffffffu;
+    char path[1024];
+    char command[3 * 1024];
+    char line[TEXT_SIZE];
+    char text[TEXT_SIZE];
+    const char *dir_end = strrchr(program, '/');
+    FILE *file;
+    FILE *decoder;
+    uint32_t i;
+
+    kb_log_reset();
+    counter_ = 4000000000u;
+    KB_LOG("decoded %d", 1);
+    KB_LOG("%c%c|%5d|%-4x|%08x|%%", 'o', 'k', 42, 0xau, 0x1234u);
+    KB_LOG("KB_LIB:" "SPI" ":%d:Error: " "line end\r\n", 12);
+    count = kb_log_read(words, KB_LOG_SIZE);
+
+    snprintf(path, sizeof(path), "%s.bin", program);
+    file = fopen(path, "wb");
+    check_(file != NULL);
+    if (file == NULL)
+    {
+        return;
+    }
+    // a broken word between the first two records
+    fwrite(words, 4, 3, file);
+    fwrite(&bad, 4, 1, file);
+    fwrite(words + 3, 4, count - 3, file);
+    fclose(file);
+
+    snprintf(command, sizeof(command), "%.*skb-log-decode %s %s",
+            (dir_end != NULL) ? (int)(dir_end - program + 1) : 0, program, program, path);
+    decoder = popen(command, "r");
+    check_(decoder != NULL);
+    if (decoder == NULL)
+    {
+        return;
+    }
+    for (i = 0; i < count; i += KB_LOG_RECORD_WORDS(words[i]))
+    {
+        kb_log_format(&words[i], text, sizeof(text));
+        check_(fgets(line, sizeof(line), decoder) != NULL);
+        line[strcspn(line, "\n")] = '\0';
+        check_(strcmp(line, text) == 0);
+        if (i == 0)
+        {
+            check_(fgets(line, sizeof(line), decoder) != NULL);
+            check_(strcmp(line, "? ffffffff\n") == 0);
+        }
+    }
+    check_(fgets(line, sizeof(line), decoder) == NULL);
+    check_(pclose(decoder) == 0);
+}
+
+int main(int argc, char *argv[])
+{
+    check_format_();
+    check_full_();
+    check_threads_();
+    check_decoder_(argv[0]);
+
+    printf("%d failed\r\n", failures_);
+    return (failures_ == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
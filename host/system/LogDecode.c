@@ -0,0 +1,392 @@
+/*
+ * LogDecode.c
+ *
+ *  Linux decoder of the deferred log (src/system/kb_log.c). It reads the
+ *  records as kb_log_read() gives them, 32-bit little-endian words, and
+ *  prints a line each as kb_log_format() does, with the format strings
+ *  from the section kb_log_fmt of the ELF file of the firmware (32 or 64
+ *  bits). %s arguments are looked up in the loaded sections of the file.
+ *  With -f the time is in seconds from the first record, the 32-bit cycle
+ *  count unwrapped, instead of cycles.
+ *
+ *  Usage: kb-log-decode [-f f_cpu_hz] firmware.elf [log.bin]
+ *         (the records from stdin without log.bin)
+ *  Build: make kb-log-decode (at the top of the repository)
+ */
+
+#include <elf.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RECORD_MAX      10      // KB_LOG_RECORD_MAX
+#define TEXT_SIZE       1024
+
+typedef struct {
+    const char *name;
+    uint32_t name_offset;
+    uint64_t addr;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t flags;
+    uint32_t type;
+} section_t;
+
+static uint8_t *elf_;
+static size_t elf_size_;
+static section_t *sections_;
+static int section_num_;
+static const section_t *formats_;
+
+static uint8_t *read_file_(FILE *file, size_t *size)
+{
+    size_t capacity = 1 << 16;
+    uint8_t *data = malloc(capacity);
+    size_t n;
+
+    *size = 0;
+    while (data != NULL && (n = fread(data + *size, 1, capacity - *size, file)) > 0)
+    {
+        *size += n;
+        if (*size == capacity)
+        {
+            capacity *= 2;
+            data = realloc(data, capacity);
+        }
+    }
+    return data;
+}
+
+static int in_file_(uint64_t offset, uint64_t size)
+{
+    return (offset <= elf_size_) && (size <= elf_size_ - offset);
+}
+
+/* The section table of a 32-bit or 64-bit little-endian ELF file */
+static int load_sections_(void)
+{
+    uint64_t shoff;
+    int shnum;
+    int shstrndx;
+    int i;
+
+    if ((elf_size_ < EI_NIDENT) || (memcmp(elf_, ELFMAG, SELFMAG) != 0)
+            || (elf_[EI_DATA] != ELFDATA2LSB))
+    {
+        return -1;
+    }
+    if (elf_[EI_CLASS] == ELFCLASS32)
+    {
+        Elf32_Ehdr *header = (Elf32_Ehdr *)elf_;
+        if (!in_file_(0, sizeof(*header)))
+        {
+            return -1;
+        }
+        shoff = header->e_shoff;
+        shnum = header->e_shnum;
+        shstrndx = header->e_shstrndx;
+        if (!in_file_(shoff, (uint64_t)shnum * sizeof(Elf32_Shdr)))
+        {
+            return -1;
+        }
+    }
+    else if (elf_[EI_CLASS] == ELFCLASS64)
+    {
+        Elf64_Ehdr *header = (Elf64_Ehdr *)elf_;
+        if (!in_file_(0, sizeof(*header)))
+        {
+            return -1;
+        }
+        shoff = header->e_shoff;
+        shnum = header->e_shnum;
+        shstrndx = header->e_shstrndx;
+        if (!in_file_(shoff, (uint64_t)shnum * sizeof(Elf64_Shdr)))
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        return -1;
+    }
+    if (shstrndx >= shnum)
+    {
+        return -1;
+    }
+    sections_ = calloc(shnum, sizeof(section_t));
+    if (sections_ == NULL)
+    {
+        return -1;
+    }
+    section_num_ = shnum;
+    for (i = 0; i < shnum; i++)
+    {
+        section_t *section = &sections_[i];
+        uint32_t name;
+
+        if (elf_[EI_CLASS] == ELFCLASS32)
+        {
+            Elf32_Shdr *shdr = (Elf32_Shdr *)(elf_ + shoff) + i;
+            name = shdr->sh_name;
+            section->addr = shdr->sh_addr;
+            section->offset = shdr->sh_offset;
+            section->size = shdr->sh_size;
+            section->flags = shdr->sh_flags;
+            section->type = shdr->sh_type;
+        }
+        else
+        {
+            Elf64_Shdr *shdr = (Elf64_Shdr *)(elf_ + shoff) + i;
+            name = shdr->sh_name;
+            section->addr = shdr->sh_addr;
+            section->offset = shdr->sh_offset;
+            section->size = shdr->sh_size;
+            section->flags = shdr->sh_flags;
+            section->type = shdr->sh_type;
+        }
+        section->name_offset = name;
+    }
+    // names once the string table is known
+    for (i = 0; i < shnum; i++)
+    {
+        uint64_t name = sections_[shstrndx].offset + sections_[i].name_offset;
+        if (!in_file_(name, 1) || (memchr(elf_ + name, '\0', elf_size_ - name) == NULL))
+        {
+            return -1;
+        }
+        sections_[i].name = (const char *)elf_ + name;
+        if ((strcmp(sections_[i].name, "kb_log_fmt") == 0) && (sections_[i].type == SHT_PROGBITS)
+                && in_file_(sections_[i].offset, sections_[i].size))
+        {
+            formats_ = &sections_[i];
+        }
+    }
+    return (formats_ != NULL) ? 0 : -1;
+}
+
+/* A NUL-terminated string at @addr of a loaded section, or NULL */
+static const char *string_at_(uint64_t addr)
+{
+    int i;
+
+    for (i = 0; i < section_num_; i++)
+    {
+        const section_t *section = &sections_[i];
+        if ((section->flags & SHF_ALLOC) && (section->type == SHT_PROGBITS)
+                && (addr >= section->addr) && (addr - section->addr < section->size)
+                && in_file_(section->offset, section->size))
+        {
+            const char *start = (const char *)elf_ + section->offset + (addr - section->addr);
+            if (memchr(start, '\0', section->size - (addr - section->addr)) != NULL)
+            {
+                return start;
+            }
+        }
+    }
+    return NULL;
+}
+
+/* printf of @format with 32-bit words as the arguments */
+static void render_(char *text, size_t size, const char *format, const uint32_t *args, int argc)
+{
+    size_t len = 0;
+    int arg = 0;
+
+#define NEXT_()     ((arg < argc) ? args[arg++] : 0)
+#define APPEND_(...) \
+    do { \
+        int n_ = snprintf(text + len, size - len, __VA_ARGS__); \
+        len += (n_ > 0) ? (size_t)n_ : 0; \
+        if (len >= size) \
+        { \
+            return; \
+        } \
+    } while (0)
+
+    text[0] = '\0';
+    while (*format != '\0')
+    {
+        char spec[48];
+        size_t spec_len = 0;
+        char conversion;
+
+        if (*format != '%')
+        {
+            APPEND_("%c", *format++);
+            continue;
+        }
+        spec[spec_len++] = *format++;
+        // flags, width, precision; '*' takes an argument
+        while ((*format != '\0') && (strchr("-+ #0123456789.*", *format) != NULL)
+                && (spec_len < 24))
+        {
+            if (*format == '*')
+            {
+                spec_len += snprintf(spec + spec_len, sizeof(spec) - spec_len, "%d",
+                        (int)NEXT_());
+                format++;
+            }
+            else
+            {
+                spec[spec_len++] = *format++;
+            }
+        }
+        // lengths up to long are 32 bits on the target
+        while ((*format != '\0') && (strchr("hlzjtL", *format) != NULL))
+        {
+            format++;
+        }
+        conversion = *format;
+        if (conversion == '\0')
+        {
+            break;
+        }
+        format++;
+        spec[spec_len++] = conversion;
+        spec[spec_len] = '\0';
+        switch (conversion)
+        {
+        case 'd':
+        case 'i':
+        case 'c':
+            APPEND_(spec, (int)NEXT_());
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            APPEND_(spec, (unsigned int)NEXT_());
+            break;
+        case 'p':
+            APPEND_("0x%08x", (unsigned int)NEXT_());
+            break;
+        case 's':
+        {
+            uint32_t addr = NEXT_();
+            const char *string = string_at_(addr);
+            if (string != NULL)
+            {
+                APPEND_(spec, string);
+            }
+            else
+            {
+                APPEND_("(0x%08x)", (unsigned int)addr);
+            }
+            break;
+        }
+        case '%':
+            APPEND_("%%");
+            break;
+        default:
+            // floating point is not logged
+            (void)NEXT_();
+            APPEND_("?");
+            break;
+        }
+    }
+#undef NEXT_
+#undef APPEND_
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *file;
+    uint8_t *log;
+    size_t log_size;
+    double f_cpu_hz = 0;
+    uint64_t time = 0;
+    uint32_t last = 0;
+    int first = 1;
+    size_t word_num;
+    size_t i;
+    int opt = 1;
+
+    if ((argc > 2) && (strcmp(argv[1], "-f") == 0))
+    {
+        f_cpu_hz = atof(argv[2]);
+        opt = 3;
+    }
+    if ((argc - opt < 1) || (argc - opt > 2) || ((opt == 3) && (f_cpu_hz <= 0)))
+    {
+        fprintf(stderr, "Usage: %s [-f f_cpu_hz] firmware.elf [log.bin]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    file = fopen(argv[opt], "rb");
+    if (file == NULL)
+    {
+        perror(argv[opt]);
+        return EXIT_FAILURE;
+    }
+    elf_ = read_file_(file, &elf_size_);
+    fclose(file);
+    if ((elf_ == NULL) || (load_sections_() != 0))
+    {
+        fprintf(stderr, "%s: not a little-endian ELF file with a kb_log_fmt section\n", argv[opt]);
+        return EXIT_FAILURE;
+    }
+    file = (argc - opt == 2) ? fopen(argv[opt + 1], "rb") : stdin;
+    if (file == NULL)
+    {
+        perror(argv[opt + 1]);
+        return EXIT_FAILURE;
+    }
+    log = read_file_(file, &log_size);
+    if (log == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    word_num = log_size / 4;
+    i = 0;
+    while (i < word_num)
+    {
+        uint32_t record[RECORD_MAX];
+        char text[TEXT_SIZE];
+        uint32_t n;
+        uint32_t offset;
+        uint32_t k;
+
+        record[0] = log[4 * i] | (log[4 * i + 1] << 8) | (log[4 * i + 2] << 16)
+                | ((uint32_t)log[4 * i + 3] << 24);
+        n = record[0] >> 24;
+        offset = record[0] & 0xffffffu;
+        if ((n < 2) || (n > RECORD_MAX) || (i + n > word_num) || (offset >= formats_->size)
+                || (memchr(elf_ + formats_->offset + offset, '\0', formats_->size - offset) == NULL))
+        {   // lost sync: look for a record at the next word
+            printf("? %08x\n", record[0]);
+            i++;
+            continue;
+        }
+        for (k = 1; k < n; k++)
+        {
+            const uint8_t *word = log + 4 * (i + k);
+            record[k] = word[0] | (word[1] << 8) | (word[2] << 16) | ((uint32_t)word[3] << 24);
+        }
+        render_(text, sizeof(text), (const char *)elf_ + formats_->offset + offset,
+                &record[2], n - 2);
+        // the line ending is ours
+        for (k = strlen(text); (k > 0) && ((text[k - 1] == '\r') || (text[k - 1] == '\n')); k--)
+        {
+            text[k - 1] = '\0';
+        }
+        if (f_cpu_hz > 0)
+        {
+            time += first ? 0 : (uint32_t)(record[1] - last);
+            printf("%12.6f %s\n", time / f_cpu_hz, text);
+        }
+        else
+        {
+            printf("%10lu %s\n", (unsigned long)record[1], text);
+        }
+        last = record[1];
+        first = 0;
+        i += n;
+    }
+    if (log_size % 4 != 0)
+    {
+        fprintf(stderr, "%zu bytes left over\n", log_size % 4);
+    }
+    return EXIT_SUCCESS;
+}
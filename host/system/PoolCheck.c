@@ -0,0 +1,201 @@
+/*
+ * PoolCheck.c
+ *
+ *  Host-side (Linux) check of the block pool (src/system/kb_pool.c): the
+ *  limits, reference counts, pointers into the middle of a block and
+ *  outside the pool, and a producer thread handing blocks to two consumer
+ *  threads that each hold a reference, as a receive callback and the
+ *  application would. The bytes of every block are checked before its
+ *  last release, so a block freed early would show up as corrupted data.
+ *
+ *  Usage: kb-pool
+ *  Build: make kb-pool (at the top of the repository)
+ */
+
+#include "kb_pool.h"
+#include "kb_ring.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK_BLOCK_SIZE    64
+#define CHECK_BLOCK_NUM     8
+#define CHECK_STREAM_BLOCKS 200000u
+
+static int failures_ = 0;
+
+#define check_(condition) \
+    do { \
+        if (!(condition)) \
+        { \
+            printf("%s:%d: %s failed\r\n", __FILE__, __LINE__, #condition); \
+            failures_++; \
+        } \
+    } while (0)
+
+static uint8_t memory_[CHECK_BLOCK_SIZE * KB_POOL_MAX_BLOCKS];
+
+static void check_limits_(void)
+{
+    kb_pool_t pool;
+    uint8_t *block[KB_POOL_MAX_BLOCKS];
+    int i;
+
+    check_(kb_pool_init(&pool, memory_, CHECK_BLOCK_SIZE, 0) != 0);
+    check_(kb_pool_init(&pool, memory_, CHECK_BLOCK_SIZE, KB_POOL_MAX_BLOCKS + 1) != 0);
+    check_(kb_pool_init(&pool, NULL, CHECK_BLOCK_SIZE, 4) != 0);
+
+    // all 32 blocks, each once
+    check_(kb_pool_init(&pool, memory_, CHECK_BLOCK_SIZE, KB_POOL_MAX_BLOCKS) == 0);
+    for (i = 0; i < KB_POOL_MAX_BLOCKS; i++)
+    {
+        block[i] = kb_pool_alloc(&pool);
+        check_(block[i] != NULL);
+        check_((i == 0) || (block[i] != block[i - 1]));
+    }
+    check_(kb_pool_alloc(&pool) == NULL);
+    check_(pool.empty_num == 1);
+    check_(kb_pool_in_use(&pool) == KB_POOL_MAX_BLOCKS);
+    check_(pool.in_use_max == KB_POOL_MAX_BLOCKS);
+    for (i = 0; i < KB_POOL_MAX_BLOCKS; i++)
+    {
+        check_(kb_pool_release(&pool, block[i]) == 0);
+    }
+    check_(kb_pool_in_use(&pool) == 0);
+}
+
+static void check_refs_(void)
+{
+    kb_pool_t pool;
+    uint8_t outside[4];
+    uint8_t *a, *b;
+
+    check_(kb_pool_init(&pool, memory_, CHECK_BLOCK_SIZE, 2) == 0);
+    a = kb_pool_alloc(&pool);
+    b = kb_pool_alloc(&pool);
+    check_((a != NULL) && (b != NULL));
+    check_(kb_pool_alloc(&pool) == NULL);
+
+    // a view into the middle keeps the block
+    check_(kb_pool_retain(&pool, a + 10) == 0);
+    check_(kb_pool_release(&pool, a) == 0);
+    check_(kb_pool_in_use(&pool) == 2);
+    check_(kb_pool_release(&pool, a + CHECK_BLOCK_SIZE - 1) == 0);
+    check_(kb_pool_in_use(&pool) == 1);
+    // a free block and pointers outside the pool
+    check_(kb_pool_release(&pool, a) != 0);
+    check_(kb_pool_retain(&pool, a) != 0);
+    check_(kb_pool_release(&pool, memory_ + 2 * CHECK_BLOCK_SIZE) != 0);
+    check_(kb_pool_release(&pool, outside) != 0);
+    // the freed block is the one handed out again
+    check_(kb_pool_alloc(&pool) == a);
+    check_(pool.in_use_max == 2);
+}
+
+/******************************************************************************
+ * Producer and consumers
+ ******************************************************************************/
+
+typedef struct {
+    kb_ring_t ring;
+    uint8_t buffer[64];             // block pointers
+    uint32_t corrupt_num;
+} consumer_t;
+
+static kb_pool_t pool_;
+static consumer_t consumer_[2];
+static uint32_t stall_num_;
+
+static void *produce_(void *arg)
+{
+    uint32_t n;
+    int k;
+
+    for (n = 0; n < CHECK_STREAM_BLOCKS; n++)
+    {
+        uint8_t *block;
+
+        while ((block = kb_pool_alloc(&pool_)) == NULL)
+        {
+            stall_num_++;
+            sched_yield();
+        }
+        memset(block, (uint8_t)n, CHECK_BLOCK_SIZE);
+        // one reference per consumer, then drop the producer's
+        for (k = 0; k < 2; k++)
+        {
+            kb_pool_retain(&pool_, block);
+            while (kb_ring_space(&consumer_[k].ring) < sizeof(block))
+            {
+                sched_yield();
+            }
+            kb_ring_write(&consumer_[k].ring, (uint8_t *)&block, sizeof(block));
+        }
+        kb_pool_release(&pool_, block);
+    }
+    return NULL;
+}
+
+static void *consume_(void *arg)
+{
+    consumer_t *consumer = (consumer_t *)arg;
+    uint32_t n, i;
+
+    for (n = 0; n < CHECK_STREAM_BLOCKS; n++)
+    {
+        uint8_t *block;
+
+        while (kb_ring_count(&consumer->ring) < sizeof(block))
+        {
+            sched_yield();
+        }
+        kb_ring_read(&consumer->ring, (uint8_t *)&block, sizeof(block));
+        for (i = 0; i < CHECK_BLOCK_SIZE; i++)
+        {
+            if (block[i] != (uint8_t)n)
+            {
+                consumer->corrupt_num++;
+                break;
+            }
+        }
+        kb_pool_release(&pool_, block);
+    }
+    return NULL;
+}
+
+static void check_threads_(void)
+{
+    pthread_t producer, consumer[2];
+    int k;
+
+    check_(kb_pool_init(&pool_, memory_, CHECK_BLOCK_SIZE, CHECK_BLOCK_NUM) == 0);
+    for (k = 0; k < 2; k++)
+    {
+        kb_ring_init(&consumer_[k].ring, consumer_[k].buffer, sizeof(consumer_[k].buffer));
+        pthread_create(&consumer[k], NULL, consume_, &consumer_[k]);
+    }
+    pthread_create(&producer, NULL, produce_, NULL);
+    pthread_join(producer, NULL);
+    for (k = 0; k < 2; k++)
+    {
+        pthread_join(consumer[k], NULL);
+        check_(consumer_[k].corrupt_num == 0);
+    }
+    check_(kb_pool_in_use(&pool_) == 0);
+    check_(pool_.in_use_max <= CHECK_BLOCK_NUM);
+    printf("threads: %u blocks to 2 consumers, %u of %u blocks in use at most, %u stalls\r\n",
+            CHECK_STREAM_BLOCKS, pool_.in_use_max, CHECK_BLOCK_NUM, stall_num_);
+}
+
+int main(int argc, char *argv[])
+{
+    check_limits_();
+    check_refs_();
+    check_threads_();
+
+    printf("%d failed\r\n", failures_);
+    return (failures_ == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,225 @@
+/*
+ * ProfCheck.c
+ *
+ *  Host-side (Linux) check of the zone profiler (src/system/kb_prof.c) on
+ *  a simulated cycle counter: min, max and mean of known measurements, the
+ *  99th percentile against the exact one of random sets, zones left by
+ *  return, across a wrap of the counter and over the histogram range,
+ *  zones shared by name, a full table, reset and the dump.
+ *
+ *  Usage: kb-prof
+ *  Build: make kb-prof (at the top of the repository)
+ */
+
+#include "kb_prof.h"
+#include "kb_time.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK_SETS          200
+#define CHECK_SET_SIZE      1000
+
+static int failures_ = 0;
+
+#define check_(condition) \
+    do { \
+        if (!(condition)) \
+        { \
+            printf("%s:%d: %s failed\r\n", __FILE__, __LINE__, #condition); \
+            failures_++; \
+        } \
+    } while (0)
+
+/* The simulated counter, moved by the zones below */
+static uint32_t counter_ = 0;
+
+uint32_t kb_time_sim_counter(void)
+{
+    return counter_;
+}
+
+static void work_(uint32_t cycles)
+{
+    KB_PROF_ZONE("work");
+    counter_ += cycles;
+}
+
+static int early_(uint32_t cycles, int leave)
+{
+    KB_PROF_ZONE("early");
+    counter_ += cycles;
+    if (leave)
+    {
+        return 1;
+    }
+    counter_ += cycles;
+    return 0;
+}
+
+static void shared_a_(void)
+{
+    KB_PROF_ZONE("shared");
+    counter_ += 10;
+}
+
+static void shared_b_(void)
+{
+    KB_PROF_ZONE("shared");
+    counter_ += 30;
+}
+
+static int find_(const char *name, kb_prof_stats_t *stats)
+{
+    int i;
+
+    for (i = 0; kb_prof_stats(i, stats) == 0; i++)
+    {
+        if (strcmp(stats->name, name) == 0)
+        {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int compare_(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void check_basic_(void)
+{
+    kb_prof_stats_t stats;
+
+    work_(100);
+    work_(300);
+    work_(200);
+    check_(find_("work", &stats) == 0);
+    check_(stats.num == 3);
+    check_(stats.min == 100);
+    check_(stats.max == 300);
+    check_(stats.mean == 200);
+    check_(stats.p99 == 300);
+
+    // left by return, and not
+    check_(early_(50, 1) == 1);
+    check_(early_(50, 0) == 0);
+    check_(find_("early", &stats) == 0);
+    check_((stats.num == 2) && (stats.min == 50) && (stats.max == 100));
+
+    // two places, one zone
+    shared_a_();
+    shared_b_();
+    check_(find_("shared", &stats) == 0);
+    check_((stats.num == 2) && (stats.min == 10) && (stats.max == 30));
+
+    // across the wrap of the counter
+    kb_prof_reset();
+    counter_ = UINT32_MAX - 5;
+    work_(20);
+    check_(find_("work", &stats) == 0);
+    check_((stats.num == 1) && (stats.min == 20));
+
+    // beyond the histogram, in the last bucket
+    kb_prof_reset();
+    work_(1u << 30);
+    work_(3u << 30);
+    check_(find_("work", &stats) == 0);
+    check_((stats.max == (3u << 30)) && (stats.p99 == (3u << 30)));
+    check_(stats.mean == (2u << 30));
+
+    // reset keeps the zones
+    kb_prof_reset();
+    check_(find_("work", &stats) == 0);
+    check_((stats.num == 0) && (stats.p99 == 0));
+}
+
+static void check_percentile_(void)
+{
+    static uint32_t set[CHECK_SET_SIZE];
+    kb_prof_zone_t *zone = kb_prof_zone("random");
+    kb_prof_stats_t stats;
+    uint32_t exact;
+    int n;
+    int i;
+
+    check_(zone != NULL);
+    srand(1);
+    for (n = 0; n < CHECK_SETS; n++)
+    {
+        // from a few cycles to 2^27, below the last bucket
+        uint32_t scale = 1u << (rand() % 26);
+        kb_prof_reset();
+        for (i = 0; i < CHECK_SET_SIZE; i++)
+        {
+            set[i] = (uint32_t)(((uint64_t)scale * (rand() % 1024)) / 256) + (uint32_t)(rand() % 4);
+            kb_prof_record(zone, set[i]);
+        }
+        qsort(set, CHECK_SET_SIZE, sizeof(set[0]), compare_);
+        exact = set[(CHECK_SET_SIZE * 99 + 99) / 100 - 1];
+        check_(find_("random", &stats) == 0);
+        check_(stats.p99 >= exact);
+        check_(stats.p99 <= exact + exact / 4);
+        check_((stats.min == set[0]) && (stats.max == set[CHECK_SET_SIZE - 1]));
+    }
+}
+
+static void check_full_(void)
+{
+    static const char *names[] = {"z0", "z1", "z2", "z3", "z4", "z5", "z6", "z7", "z8"};
+    kb_prof_stats_t stats;
+    int zone_num;
+    int i;
+
+    for (zone_num = 0; kb_prof_stats(zone_num, &stats) == 0; zone_num++)
+    {
+    }
+    for (i = zone_num; i < KB_PROF_ZONE_NUM; i++)
+    {
+        check_(kb_prof_zone(names[i - zone_num]) != NULL);
+    }
+    check_(kb_prof_zone(names[KB_PROF_ZONE_NUM - zone_num]) == NULL);
+    // a known name still has its zone
+    check_(kb_prof_zone("work") != NULL);
+    // a zone that did not fit measures nothing
+    {
+        KB_PROF_ZONE("left out");
+        counter_ += 10;
+    }
+    check_(find_("left out", &stats) == -1);
+}
+
+static int lines_ = 0;
+
+static int write_line_(const char *line)
+{
+    check_(strlen(line) < 80);
+    check_(strchr(line, '\n') == NULL);
+    lines_++;
+    return puts(line);
+}
+
+static void check_dump_(void)
+{
+    kb_prof_reset();
+    work_(1234);
+    kb_prof_dump(write_line_);
+    // header, the zones, the clock
+    check_(lines_ == KB_PROF_ZONE_NUM + 2);
+}
+
+int main(int argc, char *argv[])
+{
+    kb_time_init(180000000u);
+    check_basic_();
+    check_percentile_();
+    check_full_();
+    check_dump_();
+
+    printf("%d failed\r\n", failures_);
+    return (failures_ == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,193 @@
+/*
+ * RingCheck.c
+ *
+ *  Host-side (Linux) check of the SPSC byte ring (src/system/kb_ring.c):
+ *  wrap of the buffer and of the 32-bit indices, full and empty rings,
+ *  in-place reads as the TX DMA of kb_uart does them, the high-water mark,
+ *  and a producer and a consumer thread streaming a known sequence.
+ *
+ *  Usage: kb-ring
+ *  Build: make kb-ring (at the top of the repository)
+ */
+
+#include "kb_ring.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK_STREAM_BYTES  (4u * 1024u * 1024u)
+
+static int failures_ = 0;
+
+#define check_(condition) \
+    do { \
+        if (!(condition)) \
+        { \
+            printf("%s:%d: %s failed\r\n", __FILE__, __LINE__, #condition); \
+            failures_++; \
+        } \
+    } while (0)
+
+static void check_init_(void)
+{
+    kb_ring_t ring;
+    uint8_t buffer[16];
+
+    check_(kb_ring_init(&ring, buffer, 16) == 0);
+    check_(kb_ring_init(&ring, buffer, 12) != 0);
+    check_(kb_ring_init(&ring, buffer, 0) != 0);
+    check_(kb_ring_init(&ring, NULL, 16) != 0);
+}
+
+static void check_full_empty_(void)
+{
+    kb_ring_t ring;
+    uint8_t buffer[8];
+    uint8_t data[12];
+    uint8_t out[12];
+    int i;
+
+    for (i = 0; i < 12; i++)
+    {
+        data[i] = (uint8_t)i;
+    }
+    kb_ring_init(&ring, buffer, sizeof(buffer));
+    check_(kb_ring_count(&ring) == 0);
+    check_(kb_ring_space(&ring) == 8);
+    check_(kb_ring_read(&ring, out, 4) == 0);
+
+    // only what fits is written
+    check_(kb_ring_write(&ring, data, 12) == 8);
+    check_(kb_ring_count(&ring) == 8);
+    check_(kb_ring_space(&ring) == 0);
+    check_(kb_ring_write(&ring, data, 1) == 0);
+    check_(ring.high_water == 8);
+
+    check_(kb_ring_read(&ring, out, 12) == 8);
+    check_(memcmp(out, data, 8) == 0);
+    check_(kb_ring_count(&ring) == 0);
+    check_(ring.high_water == 8);
+}
+
+static void check_wrap_(uint32_t start)
+{
+    kb_ring_t ring;
+    uint8_t buffer[8];
+    uint8_t data[5] = {1, 2, 3, 4, 5};
+    uint8_t out[5];
+    const uint8_t *peek;
+    int i;
+
+    kb_ring_init(&ring, buffer, sizeof(buffer));
+    ring.head = start;
+    ring.tail = start;
+    // 5 bytes at a time through 8 bytes: every position of the wrap
+    for (i = 0; i < 16; i++)
+    {
+        memset(out, 0, sizeof(out));
+        check_(kb_ring_write(&ring, data, 5) == 5);
+        check_(kb_ring_count(&ring) == 5);
+        check_(kb_ring_read(&ring, out, 5) == 5);
+        check_(memcmp(out, data, 5) == 0);
+        data[i % 5]++;
+    }
+
+    // an in-place read stops at the end of the buffer
+    ring.head = (start & ~7u) + 6;
+    ring.tail = ring.head;
+    check_(kb_ring_write(&ring, data, 5) == 5);
+    check_(kb_ring_peek(&ring, &peek) == 2);
+    check_(memcmp(peek, data, 2) == 0);
+    kb_ring_skip(&ring, 2);
+    check_(kb_ring_peek(&ring, &peek) == 3);
+    check_(memcmp(peek, &data[2], 3) == 0);
+    kb_ring_skip(&ring, 3);
+    check_(kb_ring_peek(&ring, &peek) == 0);
+    check_(kb_ring_count(&ring) == 0);
+}
+
+/* Two threads: the producer as the main loop, the consumer as the DMA */
+
+static kb_ring_t stream_ring_;
+static uint8_t stream_buffer_[64];
+
+static void *producer_(void *arg)
+{
+    uint8_t chunk[23];
+    uint32_t sent = 0;
+    uint32_t size;
+    uint32_t i;
+
+    (void)arg;
+    while (sent < CHECK_STREAM_BYTES)
+    {
+        size = 1 + (sent % sizeof(chunk));
+        if (size > CHECK_STREAM_BYTES - sent)
+        {
+            size = CHECK_STREAM_BYTES - sent;
+        }
+        for (i = 0; i < size; i++)
+        {
+            chunk[i] = (uint8_t)((sent + i) * 7u);
+        }
+        size = kb_ring_write(&stream_ring_, chunk, size);
+        if (size == 0)
+        {
+            sched_yield();  // full: let the consumer run, even on one core
+        }
+        sent += size;
+    }
+    return NULL;
+}
+
+static void check_stream_(void)
+{
+    pthread_t producer;
+    const uint8_t *data;
+    uint32_t received = 0;
+    uint32_t errors = 0;
+    uint32_t size;
+    uint32_t i;
+
+    kb_ring_init(&stream_ring_, stream_buffer_, sizeof(stream_buffer_));
+    pthread_create(&producer, NULL, producer_, NULL);
+    while (received < CHECK_STREAM_BYTES)
+    {
+        size = kb_ring_peek(&stream_ring_, &data);
+        if (size == 0)
+        {
+            sched_yield();
+            continue;
+        }
+        for (i = 0; i < size; i++)
+        {
+            if (data[i] != (uint8_t)((received + i) * 7u))
+            {
+                errors++;
+            }
+        }
+        kb_ring_skip(&stream_ring_, size);
+        received += size;
+    }
+    pthread_join(producer, NULL);
+    check_(errors == 0);
+    check_(kb_ring_count(&stream_ring_) == 0);
+    check_(stream_ring_.high_water <= sizeof(stream_buffer_));
+    printf("stream: %u bytes, high water %u of %u\r\n", (unsigned)received,
+            (unsigned)stream_ring_.high_water, (unsigned)sizeof(stream_buffer_));
+}
+
+int main(void)
+{
+    check_init_();
+    check_full_empty_();
+    check_wrap_(0);
+    check_wrap_(0xFFFFFFFFu - 9u);
+    check_stream_();
+
+    printf("%d failed\r\n", failures_);
+    return (failures_ == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,204 @@
+/*
+ * TimeCheck.c
+ *
+ *  Host-side (Linux) check of the 64-bit timebase (src/system/kb_time.c)
+ *  on a simulated cycle counter: the wrap of the 32-bit counter and of each
+ *  half of it, the longest gap between two reads, the conversions against
+ *  exact 128-bit arithmetic, and threads reading the time while others
+ *  advance the counter, where every value read must lie between the true
+ *  time just before and just after the read.
+ *
+ *  Usage: kb-time
+ *  Build: make kb-time (at the top of the repository)
+ */
+
+#include "kb_time.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK_THREADS       4
+#define CHECK_READS         1000000u
+#define CHECK_STEP_MAX      (1u << 16)
+
+static int failures_ = 0;
+
+#define check_(condition) \
+    do { \
+        if (!(condition)) \
+        { \
+            printf("%s:%d: %s failed\r\n", __FILE__, __LINE__, #condition); \
+            failures_++; \
+        } \
+    } while (0)
+
+/* The simulated counter: the low 32 bits of the true time */
+static uint64_t true_ = 0;
+static uint32_t read_num_ = 0;
+
+uint32_t kb_time_sim_counter(void)
+{
+    uint32_t counter = (uint32_t)__atomic_load_n(&true_, __ATOMIC_SEQ_CST);
+
+    // now and then let the others run right after the counter is read, as
+    // an interrupt would
+    if ((__atomic_fetch_add(&read_num_, 1, __ATOMIC_RELAXED) & 63) == 0)
+    {
+        sched_yield();
+    }
+    return counter;
+}
+
+static void set_(uint64_t cycles)
+{
+    __atomic_store_n(&true_, cycles, __ATOMIC_SEQ_CST);
+}
+
+static void check_wrap_(void)
+{
+    uint64_t t;
+    int mismatch = 0;
+
+    kb_time_init(180000000u);
+    set_(0);
+    check_(kb_time_cycles() == 0);
+
+    // across 10 wraps of the counter in steps just under half of it
+    for (t = 0; t < 10ull << 32; t += 0x7ffffff0u)
+    {
+        set_(t);
+        mismatch += (kb_time_cycles() != t);
+    }
+    check_(mismatch == 0);
+
+    // exactly at the half and full wraps
+    for (t = (10ull << 32) - 2; t < (10ull << 32) + (1u << 31) + 2; t += 1)
+    {
+        set_(t);
+        mismatch += (kb_time_cycles() != t);
+        if (t == (10ull << 32) + 2)
+        {
+            t = (10ull << 32) + (1u << 31) - 3;
+        }
+    }
+    check_(mismatch == 0);
+
+    // the longest gap without a read: 2^31 - 1 cycles
+    t += (1u << 31) - 1;
+    set_(t);
+    check_(kb_time_cycles() == t);
+    printf("wrap: 10 wraps of the counter, longest gap 2^31 - 1 cycles\r\n");
+}
+
+static void check_convert_(void)
+{
+    static const uint32_t clocks[] = {16000000u, 84000000u, 168000000u, 180000000u};
+    uint32_t i, n;
+    int bad_ns = 0, bad_us = 0;
+
+    srand(1);
+    for (i = 0; i < sizeof(clocks) / sizeof(clocks[0]); i++)
+    {
+        kb_time_init(clocks[i]);
+        for (n = 0; n < 100000; n++)
+        {
+            // up to 2^48 cycles, 18 days at 180 MHz
+            uint64_t cycles = (((uint64_t)rand() << 31) ^ (uint64_t)rand()) & ((1ull << 48) - 1);
+            unsigned __int128 ns = (unsigned __int128)cycles * 1000000000u / clocks[i];
+            unsigned __int128 us = (unsigned __int128)cycles * 1000000u / clocks[i];
+            uint64_t got_ns = kb_time_cycles_to_ns(cycles);
+            uint64_t got_us = kb_time_cycles_to_us(cycles);
+            // the factor is exact to 2^-32 of itself, plus truncation
+            uint64_t tol_ns = (uint64_t)(ns >> 30) + 1;
+            uint64_t tol_us = (uint64_t)(us >> 30) + 1;
+
+            bad_ns += ((got_ns > ns + tol_ns) || (got_ns + tol_ns < ns));
+            bad_us += ((got_us > us + tol_us) || (got_us + tol_us < us));
+        }
+        check_(kb_time_us_to_cycles(1000000u) == clocks[i]);
+        check_(kb_time_us_to_cycles(1) == clocks[i] / 1000000u);
+    }
+    check_(bad_ns == 0);
+    check_(bad_us == 0);
+
+    // a year within 10 ms
+    kb_time_init(180000000u);
+    check_(llabs((long long)kb_time_cycles_to_us(180000000ull * 3600 * 24 * 365)
+            - 1000000ll * 3600 * 24 * 365) < 10000);
+    check_(llabs((long long)kb_time_cycles_to_ns(180000000ull * 3600 * 24 * 365)
+            - 1000000000ll * 3600 * 24 * 365) < 10000000);
+}
+
+/******************************************************************************
+ * Concurrent readers
+ ******************************************************************************/
+
+static volatile int stop_ = 0;
+static uint32_t wrong_[CHECK_THREADS];
+static uint32_t backward_[CHECK_THREADS];
+
+static void *read_(void *arg)
+{
+    long id = (long)arg;
+    uint32_t seed = (uint32_t)id;
+    uint64_t last = 0;
+    uint32_t n;
+
+    for (n = 0; n < CHECK_READS; n++)
+    {
+        uint64_t before, now, after;
+
+        // every thread also moves the counter on, as time passing
+        seed = seed * 1103515245u + 12345u;
+        __atomic_fetch_add(&true_, (seed >> 8) % CHECK_STEP_MAX, __ATOMIC_SEQ_CST);
+
+        before = __atomic_load_n(&true_, __ATOMIC_SEQ_CST);
+        now = kb_time_cycles();
+        after = __atomic_load_n(&true_, __ATOMIC_SEQ_CST);
+        if ((now < before) || (now > after))
+        {
+            wrong_[id]++;
+        }
+        if (now < last)
+        {
+            backward_[id]++;
+        }
+        last = now;
+    }
+    return NULL;
+}
+
+static void check_threads_(void)
+{
+    pthread_t thread[CHECK_THREADS];
+    long i;
+
+    uint64_t start = true_;
+
+    // on from where the wrap check left the counter
+    kb_time_init(180000000u);
+    for (i = 0; i < CHECK_THREADS; i++)
+    {
+        pthread_create(&thread[i], NULL, read_, (void *)i);
+    }
+    for (i = 0; i < CHECK_THREADS; i++)
+    {
+        pthread_join(thread[i], NULL);
+        check_(wrong_[i] == 0);
+        check_(backward_[i] == 0);
+    }
+    printf("threads: %d x %u reads over %.1f wraps of the counter\r\n",
+            CHECK_THREADS, CHECK_READS, (double)(true_ - start) / 4294967296.0);
+}
+
+int main(int argc, char *argv[])
+{
+    check_wrap_();
+    check_convert_();
+    check_threads_();
+
+    printf("%d failed\r\n", failures_);
+    return (failures_ == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
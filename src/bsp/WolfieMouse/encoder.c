@@ -6,8 +6,18 @@
  */
 
 #include "encoder.h"
+#include "encoder_ext.h"
 #include "kb_common_source.h"
 #include "kb_timer.h"
+#include "kb_tick.h"
+
+/* M/T velocity: windows of 2 ms at least, 0 after 100 ms without a count */
+#define encoderMIN_WINDOW_US	2000
+#define encoderMAX_WINDOW_US	100000
+
+/* TIM3 and TIM4 are 16-bit: they are extended to 64 bits by encoder_sample() */
+static encoder_ext_t right_ext_;
+static encoder_ext_t left_ext_;
 
 void encoder_init(void)
 {
@@ -62,9 +72,44 @@ int32_t encoder_left_count(void)
 void encoder_right_reset(void)
 {
 	kb_encoder_set(TIMER4, 10000);
+	encoder_ext_init(&right_ext_, 10000, kb_tick_us(), encoderMIN_WINDOW_US, encoderMAX_WINDOW_US);
 }
 
 void encoder_left_reset(void)
 {
 	kb_encoder_set(TIMER3, 10000);
+	encoder_ext_init(&left_ext_, 10000, kb_tick_us(), encoderMIN_WINDOW_US, encoderMAX_WINDOW_US);
+}
+
+
+void encoder_sample(void)
+{
+	uint32_t now_us = kb_tick_us();
+
+	encoder_ext_update(&right_ext_, (uint16_t)kb_encoder_count(TIMER4), now_us);
+	encoder_ext_update(&left_ext_, (uint16_t)kb_encoder_count(TIMER3), now_us);
+}
+
+
+int64_t encoder_right_position(void)
+{
+	return encoder_ext_count(&right_ext_);
+}
+
+
+int64_t encoder_left_position(void)
+{
+	return encoder_ext_count(&left_ext_);
+}
+
+
+float encoder_right_velocity(void)
+{
+	return encoder_ext_velocity(&right_ext_);
+}
+
+
+float encoder_left_velocity(void)
+{
+	return encoder_ext_velocity(&left_ext_);
 }
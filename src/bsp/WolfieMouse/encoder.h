@@ -20,6 +20,15 @@ int32_t encoder_left_count(void);
 void encoder_right_reset(void);
 void encoder_left_reset(void);
 
+/* Extended counts and M/T velocity, updated by encoder_sample().
+ * Call encoder_sample() at least every 32768 counts (e.g. at 1 kHz), and
+ * read the positions from the same context: they are 64-bit. */
+void encoder_sample(void);
+int64_t encoder_right_position(void);
+int64_t encoder_left_position(void);
+float encoder_right_velocity(void);	/* counts per second */
+float encoder_left_velocity(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,77 @@
+/*
+ * encoder_ext.c
+ *
+ *  The count is extended with the signed 16-bit difference of two samples,
+ *  which is right as long as the counter moves less than half of its range
+ *  between them.
+ *
+ *  A velocity of counts over a fixed period has a resolution of one count
+ *  per period, which is poor at low speed. The M/T method measures the time
+ *  between moves of the counter instead: the window of a measurement starts
+ *  and ends on samples that saw the counter move, so it holds a whole number
+ *  of counts however slow the wheel is. While the counter does not move, the
+ *  velocity can not be more than 1 count over the time since the last move.
+ */
+
+#include "encoder_ext.h"
+
+void encoder_ext_init(encoder_ext_t *ext, uint16_t raw, uint32_t now_us,
+		uint32_t min_window_us, uint32_t max_window_us)
+{
+	ext->count = 0;
+	ext->last_raw = raw;
+	ext->last_us = now_us;
+	ext->edge_count = 0;
+	ext->edge_us = now_us;
+	ext->min_window_us = min_window_us;
+	ext->max_window_us = max_window_us;
+	ext->velocity = 0.0f;
+}
+
+void encoder_ext_update(encoder_ext_t *ext, uint16_t raw, uint32_t now_us)
+{
+	int16_t delta = (int16_t)(raw - ext->last_raw);
+	uint32_t window = now_us - ext->edge_us;
+	float bound;
+
+	ext->last_raw = raw;
+	ext->last_us = now_us;
+	ext->count += delta;
+
+	if (delta != 0)
+	{
+		if (window >= ext->min_window_us)
+		{
+			ext->velocity = (float)(ext->count - ext->edge_count) * 1000000.0f / (float)window;
+			ext->edge_count = ext->count;
+			ext->edge_us = now_us;
+		}
+		return;
+	}
+
+	if (ext->count != ext->edge_count)
+	{
+		/* moved within the window, which is still open */
+		return;
+	}
+	if (window == 0)
+	{
+		return;
+	}
+	if (window >= ext->max_window_us)
+	{
+		ext->velocity = 0.0f;
+		/* the next move is measured from a recent sample */
+		ext->edge_us = now_us - ext->max_window_us;
+		return;
+	}
+	bound = 1000000.0f / (float)window;
+	if (ext->velocity > bound)
+	{
+		ext->velocity = bound;
+	}
+	else if (ext->velocity < -bound)
+	{
+		ext->velocity = -bound;
+	}
+}
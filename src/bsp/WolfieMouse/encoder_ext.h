@@ -0,0 +1,64 @@
+/*
+ * encoder_ext.h
+ *
+ *  Software extension of a 16-bit quadrature counter to 64 bits, and its
+ *  velocity with the M/T method. The counter is sampled periodically, at
+ *  least once per 32768 counts, with a timestamp in microseconds.
+ *  Plain C without the HAL, so it also runs on the host.
+ */
+
+#ifndef ENCODER_EXT_H_
+#define ENCODER_EXT_H_
+
+#include <stdint.h>
+
+typedef struct {
+	int64_t count;			/* extended count */
+	uint16_t last_raw;		/* counter at the last sample */
+	uint32_t last_us;		/* time of the last sample */
+	/* M/T: counts between two samples that saw the counter move, over the
+	 * time between them. The window grows until min_window_us has passed */
+	int64_t edge_count;
+	uint32_t edge_us;
+	uint32_t min_window_us;
+	uint32_t max_window_us;	/* slower than 1 count per max_window_us is 0 */
+	float velocity;			/* counts per second */
+} encoder_ext_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Start the extension at count 0
+ * @param raw			current value of the 16-bit counter
+ * @param now_us		current time in microseconds
+ * @param min_window_us	shortest time of a velocity measurement. Longer is
+ *						smoother, shorter has less delay
+ * @param max_window_us	longest time without a count before the velocity is 0
+ */
+void encoder_ext_init(encoder_ext_t *ext, uint16_t raw, uint32_t now_us,
+		uint32_t min_window_us, uint32_t max_window_us);
+
+/**
+ * @brief Add a sample of the counter
+ * @param raw		value of the 16-bit counter
+ * @param now_us	time of the sample in microseconds. It may wrap
+ */
+void encoder_ext_update(encoder_ext_t *ext, uint16_t raw, uint32_t now_us);
+
+static inline int64_t encoder_ext_count(const encoder_ext_t *ext)
+{
+	return ext->count;
+}
+
+static inline float encoder_ext_velocity(const encoder_ext_t *ext)
+{
+	return ext->velocity;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ENCODER_EXT_H_ */
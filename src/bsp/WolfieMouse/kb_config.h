@@ -30,7 +30,9 @@
 #define KB_DEBUG
     #define KB_DEBUG_TO_TERMINAL
     //#define KB_DEBUG_TO_SEMIHOSTING
+    //#define KB_DEBUG_TO_LOG // deferred, see kb_log.h
 #define KB_PRINTF_TO_TERMINAL
+//#define KB_PROF // KB_PROF_ZONE() cycle profiler, see kb_prof.h
 
 
 /******************************************************************************
@@ -0,0 +1,341 @@
+/*
+ * motion.c
+ *
+ *  A move is a translation profile or a rotation profile. Each period the
+ *  profiles give the setpoints of the robot, which are mixed into the
+ *  setpoints of each wheel. Each wheel adds its position error to its
+ *  velocity setpoint, and a PID on the velocity error, with a velocity and
+ *  acceleration feed-forward, gives the duty.
+ */
+
+#include "motion.h"
+
+#define motionPERIOD			(1.0f / (float)motionCONTROL_HZ)
+/* wheel travel of 1 degree of in-place rotation */
+#define motionMM_PER_DEGREE		(motionTRACK_MM * 3.14159265f / 360.0f)
+
+static motion_t motion_;
+
+static void run_profiles_(void);
+
+static void wheel_reset_(motion_wheel_t *wheel, int32_t count)
+{
+	const pid_gains_t gains = {
+			.kp = motionVELOCITY_KP,
+			.ki = motionVELOCITY_KI,
+			.kd = motionVELOCITY_KD,
+			.output_min = -(float)motionMAX_DUTY,
+			.output_max = (float)motionMAX_DUTY,
+			.integral_max = motionVELOCITY_I_MAX
+	};
+
+	wheel->last_count = (uint16_t)count;
+	wheel->position = 0.0f;
+	wheel->target = 0.0f;
+	wheel->velocity = 0.0f;
+	wheel->target_velocity = 0.0f;
+	pid_init(&wheel->pid, &gains, motionPERIOD);
+	wheel->duty = 0;
+}
+
+/**
+ * @brief Add the encoder travel since the last period.
+ *        The 16-bit difference stays right across the counter wrap.
+ */
+static void wheel_update_(motion_wheel_t *wheel, int32_t count, float (*read_velocity)(void))
+{
+	int16_t delta = (int16_t)((uint16_t)count - wheel->last_count);
+	float travel = (float)delta / motionTICKS_PER_MM;
+
+	wheel->last_count = (uint16_t)count;
+	wheel->position += travel;
+	if (read_velocity != 0)
+	{
+		wheel->velocity = read_velocity() / motionTICKS_PER_MM;
+	}
+	else
+	{
+		wheel->velocity += motionVELOCITY_FILTER * ((travel / motionPERIOD) - wheel->velocity);
+	}
+}
+
+static int32_t wheel_control_(motion_wheel_t *wheel, float target, float velocity, float acceleration)
+{
+	wheel->target = target;
+	wheel->target_velocity = velocity + (motionKP_POSITION * (target - wheel->position));
+	wheel->duty = (int32_t)pid_update(&wheel->pid, wheel->target_velocity - wheel->velocity,
+			(motionKV * velocity) + (motionKA * acceleration));
+	return wheel->duty;
+}
+
+static void wheel_stop_(motion_wheel_t *wheel)
+{
+	pid_reset(&wheel->pid);
+	wheel->duty = 0;
+}
+
+/**
+ * @brief Measure the period and the execution time of motion_tick()
+ * @param start	cycles at the start of this motion_tick()
+ */
+static void timing_update_(uint32_t start)
+{
+	motion_timing_t *timing = &motion_.timing;
+	uint32_t period = start - timing->last_start;
+	uint32_t exec = motion_.io->read_cycles() - start;
+
+	if (motion_.timing_reset)
+	{
+		motion_.timing_reset = 0;
+		timing->count = 0;
+		timing->exec_max = 0;
+		timing->exec_total = 0;
+		timing->overruns = 0;
+	}
+	else if (timing->last_start != 0)
+	{
+		if ((timing->count == 0) || (period < timing->period_min))
+		{
+			timing->period_min = period;
+		}
+		if ((timing->count == 0) || (period > timing->period_max))
+		{
+			timing->period_max = period;
+		}
+		if (period > (motion_.io->cycles_per_us * (1500000U / motionCONTROL_HZ)))
+		{
+			timing->overruns++;
+		}
+		if (exec > timing->exec_max)
+		{
+			timing->exec_max = exec;
+		}
+		timing->exec_total += exec;
+		timing->count++;
+	}
+	/* 0 is "no start yet" */
+	timing->last_start = (start != 0) ? start : 1;
+}
+
+static void drive_(int32_t left, int32_t right)
+{
+	motion_.io->drive_left(left);
+	motion_.io->drive_right(right);
+}
+
+/**
+ * @brief Start the commanded move. It keeps the error left by the last move
+ *        so that it is corrected during this one.
+ */
+static void start_move_(void)
+{
+	motion_.left.position -= motion_.left.target;
+	motion_.left.target = 0.0f;
+	motion_.right.position -= motion_.right.target;
+	motion_.right.target = 0.0f;
+	if (!motion_.is_enabled)
+	{
+		motion_.left.position = 0.0f;
+		motion_.right.position = 0.0f;
+	}
+
+	motion_profile_start(&motion_.translation, motion_.command_translation);
+	motion_profile_start(&motion_.rotation, motion_.command_rotation);
+	motion_.is_enabled = 1;
+	motion_.is_busy = 1;
+}
+
+void motion_init(const motion_io_t *io)
+{
+	const motion_limits_t translation = {
+			.max_velocity = motionMAX_VELOCITY,
+			.max_acceleration = motionMAX_ACCELERATION,
+			.max_jerk = motionMAX_JERK
+	};
+	const motion_limits_t rotation = {
+			.max_velocity = motionMAX_ANGULAR_VELOCITY,
+			.max_acceleration = motionMAX_ANGULAR_ACCELERATION,
+			.max_jerk = motionMAX_ANGULAR_JERK
+	};
+
+	motion_.io = io;
+	motion_profile_init(&motion_.translation, &translation, motionPERIOD);
+	motion_profile_init(&motion_.rotation, &rotation, motionPERIOD);
+	wheel_reset_(&motion_.left, io->read_left());
+	wheel_reset_(&motion_.right, io->read_right());
+	motion_.command_translation = 0.0f;
+	motion_.command_rotation = 0.0f;
+	motion_.command_count = 0;
+	motion_.command_done = 0;
+	motion_.stop_count = 0;
+	motion_.stop_done = 0;
+	motion_.is_busy = 0;
+	motion_.is_enabled = 0;
+	motion_.timing.last_start = 0;
+	motion_.timing_reset = 1;
+	drive_(0, 0);
+}
+
+/**
+ * @brief Hand a move over to motion_tick(). command_count is odd while the
+ *        move is written, so that motion_tick(), which interrupts this, never
+ *        takes half of an old move and half of the new one
+ */
+static void publish_command_(float translation, float rotation)
+{
+	motion_.command_count++;
+	motion_.command_translation = translation;
+	motion_.command_rotation = rotation;
+	motion_.command_count++;
+}
+
+void motion_move_mm(float distance)
+{
+	publish_command_(distance, 0.0f);
+}
+
+void motion_move_cells(int32_t cells)
+{
+	motion_move_mm((float)cells * motionCELL_MM);
+}
+
+void motion_turn_deg(float degree)
+{
+	publish_command_(0.0f, degree);
+}
+
+int motion_is_busy(void)
+{
+	return (motion_.is_busy || (motion_.command_count != motion_.command_done)) ? 1 : 0;
+}
+
+void motion_stop(void)
+{
+	motion_.stop_count++;
+	drive_(0, 0);
+}
+
+const motion_t *motion_state(void)
+{
+	return &motion_;
+}
+
+void motion_get_timing(motion_timing_report_t *report)
+{
+	/* a copy, so that the numbers agree with each other */
+	motion_timing_t timing = motion_.timing;
+	float us_per_cycle;
+	float early;
+	float late;
+
+	report->count = timing.count;
+	report->overruns = timing.overruns;
+	if ((timing.count == 0) || (motion_.io->cycles_per_us == 0))
+	{
+		report->period_min_us = 0.0f;
+		report->period_max_us = 0.0f;
+		report->jitter_us = 0.0f;
+		report->exec_avg_us = 0.0f;
+		report->exec_max_us = 0.0f;
+		return;
+	}
+	us_per_cycle = 1.0f / (float)motion_.io->cycles_per_us;
+	report->period_min_us = (float)timing.period_min * us_per_cycle;
+	report->period_max_us = (float)timing.period_max * us_per_cycle;
+	early = (1000000.0f / motionCONTROL_HZ) - report->period_min_us;
+	late = report->period_max_us - (1000000.0f / motionCONTROL_HZ);
+	report->jitter_us = (early > late) ? early : late;
+	report->exec_avg_us = (float)timing.exec_total * us_per_cycle / (float)timing.count;
+	report->exec_max_us = (float)timing.exec_max * us_per_cycle;
+}
+
+void motion_timing_reset(void)
+{
+	motion_.timing_reset = 1;
+}
+
+void motion_tick(void)
+{
+	uint8_t count;
+	uint32_t start = 0;
+
+	if (motion_.io == 0)
+	{
+		return;
+	}
+	if (motion_.io->read_cycles != 0)
+	{
+		start = motion_.io->read_cycles();
+	}
+
+	wheel_update_(&motion_.left, motion_.io->read_left(), motion_.io->read_left_velocity);
+	wheel_update_(&motion_.right, motion_.io->read_right(), motion_.io->read_right_velocity);
+
+	/* the counters are only written on one side, so no command is lost */
+	count = motion_.stop_count;
+	if (count != motion_.stop_done)
+	{
+		motion_.stop_done = count;
+		/* drop a command that is not applied yet too */
+		motion_.command_done = motion_.command_count;
+		motion_.is_busy = 0;
+		motion_.is_enabled = 0;
+	}
+	count = motion_.command_count;
+	/* an odd count is a command being written: take it next period */
+	if (!(count & 1) && (count != motion_.command_done))
+	{
+		motion_.command_done = count;
+		start_move_();
+	}
+
+	if (!motion_.is_enabled)
+	{
+		wheel_stop_(&motion_.left);
+		wheel_stop_(&motion_.right);
+		drive_(0, 0);
+	}
+	else
+	{
+		run_profiles_();
+	}
+
+	if (motion_.io->read_cycles != 0)
+	{
+		timing_update_(start);
+	}
+}
+
+/**
+ * @brief Step the profiles and drive the wheels to their setpoints
+ */
+static void run_profiles_(void)
+{
+	float translation;
+	float rotation;
+	float velocity;
+	float angular_velocity;
+	float acceleration;
+	float angular_acceleration;
+
+	if (motion_.is_busy)
+	{
+		/* a finished profile keeps its final position, with 0 velocity */
+		motion_.is_busy = (motion_profile_step(&motion_.translation)
+				| motion_profile_step(&motion_.rotation)) ? 1 : 0;
+	}
+
+	/* + rotation is to the left: the right wheel goes forward */
+	translation = motion_profile_position(&motion_.translation);
+	velocity = motion_profile_velocity(&motion_.translation);
+	rotation = motion_profile_position(&motion_.rotation) * motionMM_PER_DEGREE;
+	angular_velocity = motion_profile_velocity(&motion_.rotation) * motionMM_PER_DEGREE;
+	acceleration = motion_profile_acceleration(&motion_.translation);
+	angular_acceleration = motion_profile_acceleration(&motion_.rotation) * motionMM_PER_DEGREE;
+
+	/* once the move is done it keeps holding the final position */
+	drive_(wheel_control_(&motion_.left, translation - rotation,
+					velocity - angular_velocity, acceleration - angular_acceleration),
+			wheel_control_(&motion_.right, translation + rotation,
+					velocity + angular_velocity, acceleration + angular_acceleration));
+}
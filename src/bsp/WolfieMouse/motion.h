@@ -0,0 +1,223 @@
+/*
+ * motion.h
+ *
+ *  Motion engine of WolfieMouse. It turns "move N cells" and "turn N
+ *  degrees" commands into wheel velocity setpoints with motion_profile.h and
+ *  closes the loop of each wheel with pid.h from the encoder feedback, one
+ *  control period at a time.
+ *  Plain C without the HAL: the hardware is reached through motion_io_t, so
+ *  the same code runs on the host against a plant model. See motion_hw.h for
+ *  the binding to motor.c and encoder.c.
+ */
+
+#ifndef MOTION_H_
+#define MOTION_H_
+
+#include <stdint.h>
+#include "motion_profile.h"
+#include "pid.h"
+
+/* Control rate. motion_tick() must be called at this rate */
+#ifndef motionCONTROL_HZ
+	#define motionCONTROL_HZ		1000
+#endif
+
+/* Mechanical constants, nominal: the 180 mm cell of the micromouse maze
+ * rules, and a track and encoder resolution of the order of a small
+ * two-wheel mouse, which the host plant model (MotionPlant.c) shares.
+ * Override them with measured values of the robot */
+#ifndef motionCELL_MM
+	#define motionCELL_MM			180.0f
+#endif
+#ifndef motionTRACK_MM
+	#define motionTRACK_MM			72.0f	/* distance between the wheels */
+#endif
+#ifndef motionTICKS_PER_MM
+	#define motionTICKS_PER_MM		2.0f	/* encoder counts per mm of a wheel */
+#endif
+
+/* Limits of the translation (mm) and the rotation (degree) */
+#ifndef motionMAX_VELOCITY
+	#define motionMAX_VELOCITY		600.0f
+#endif
+#ifndef motionMAX_ACCELERATION
+	#define motionMAX_ACCELERATION	3000.0f
+#endif
+#ifndef motionMAX_JERK
+	#define motionMAX_JERK			60000.0f	/* 0 for trapezoidal profiles */
+#endif
+#ifndef motionMAX_ANGULAR_VELOCITY
+	#define motionMAX_ANGULAR_VELOCITY		720.0f
+#endif
+#ifndef motionMAX_ANGULAR_ACCELERATION
+	#define motionMAX_ANGULAR_ACCELERATION	4000.0f
+#endif
+#ifndef motionMAX_ANGULAR_JERK
+	#define motionMAX_ANGULAR_JERK			80000.0f
+#endif
+
+/* Wheel controller. The position error adds to the velocity setpoint
+ * (motionKP_POSITION, per second), then a PID on the velocity error with a
+ * feed-forward gives the duty in permyriad:
+ * KV * velocity (mm/s) + KA * acceleration (mm/s^2) + PID(velocity error) */
+#ifndef motionKV
+	#define motionKV				10.0f
+#endif
+#ifndef motionKA
+	#define motionKA				0.4f
+#endif
+#ifndef motionKP_POSITION
+	#define motionKP_POSITION		20.0f
+#endif
+#ifndef motionVELOCITY_KP
+	#define motionVELOCITY_KP		8.0f
+#endif
+#ifndef motionVELOCITY_KI
+	#define motionVELOCITY_KI		200.0f
+#endif
+#ifndef motionVELOCITY_KD
+	#define motionVELOCITY_KD		0.0f
+#endif
+#ifndef motionVELOCITY_I_MAX
+	#define motionVELOCITY_I_MAX	3000.0f		/* permyriad */
+#endif
+/* Low-pass of the measured velocity, without read_left_velocity: weight of
+ * the new sample (0 to 1) */
+#ifndef motionVELOCITY_FILTER
+	#define motionVELOCITY_FILTER	0.2f
+#endif
+#define motionMAX_DUTY				10000
+
+/**
+ * @brief Hardware of the motion engine
+ */
+typedef struct {
+	int32_t (*read_left)(void);		/* encoder counts. Only the lower 16 bits are used */
+	int32_t (*read_right)(void);
+	void (*drive_left)(int32_t duty);	/* signed duty in permyriad, + is forward */
+	void (*drive_right)(int32_t duty);
+	/* velocity of the encoders in counts per second (e.g. encoder_ext.h).
+	 * Optional: a low-pass of the count per period otherwise */
+	float (*read_left_velocity)(void);
+	float (*read_right_velocity)(void);
+	/* free running cycle counter for the timing of motion_tick(). Optional */
+	uint32_t (*read_cycles)(void);
+	uint32_t cycles_per_us;
+} motion_io_t;
+
+/**
+ * @brief State of a wheel, in mm along the wheel
+ */
+typedef struct {
+	uint16_t last_count;
+	float position;			/* measured since the start of the move */
+	float target;			/* setpoint since the start of the move */
+	float velocity;			/* measured, filtered */
+	float target_velocity;	/* setpoint of the velocity PID */
+	pid_controller_t pid;
+	int32_t duty;			/* last command */
+} motion_wheel_t;
+
+/**
+ * @brief Timing of motion_tick(), in cycles of motion_io_t::read_cycles
+ */
+typedef struct {
+	uint32_t count;			/* measured periods */
+	uint32_t period_min;	/* between the starts of two motion_tick() */
+	uint32_t period_max;
+	uint32_t exec_max;		/* execution time of motion_tick() */
+	uint64_t exec_total;
+	uint32_t overruns;		/* periods longer than 1.5 control period */
+	uint32_t last_start;
+} motion_timing_t;
+
+/**
+ * @brief Timing of motion_tick(), in microseconds
+ */
+typedef struct {
+	uint32_t count;
+	float period_min_us;
+	float period_max_us;
+	float jitter_us;		/* largest distance of a period to the control period */
+	float exec_avg_us;
+	float exec_max_us;
+	uint32_t overruns;
+} motion_timing_report_t;
+
+typedef struct {
+	const motion_io_t *io;
+	motion_profile_t translation;	/* mm */
+	motion_profile_t rotation;		/* degree, + is left (counter-clockwise) */
+	motion_wheel_t left;
+	motion_wheel_t right;
+	/* commands are handed over to motion_tick(), which may be an interrupt */
+	/* volatile, so that they are stored between the two increments of
+	 * command_count, which publish them */
+	volatile float command_translation;
+	volatile float command_rotation;
+	volatile uint8_t command_count;	/* odd while a command is written */
+	uint8_t command_done;			/* command_count applied by motion_tick() */
+	volatile uint8_t stop_count;
+	uint8_t stop_done;
+	volatile uint8_t is_busy;		/* a profile is running */
+	uint8_t is_enabled;			/* the motors are driven */
+	motion_timing_t timing;
+	volatile uint8_t timing_reset;
+} motion_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initialize the engine with the motors stopped
+ * @param io	hardware. It must stay valid
+ */
+void motion_init(const motion_io_t *io);
+
+/**
+ * @brief Start a straight move. Negative values go backward.
+ *        Any move in progress is replaced.
+ */
+void motion_move_mm(float distance);
+void motion_move_cells(int32_t cells);
+
+/**
+ * @brief Start an in-place turn. Positive values turn left.
+ *        Any move in progress is replaced.
+ */
+void motion_turn_deg(float degree);
+
+/**
+ * @brief 1 while a move is in progress
+ */
+int motion_is_busy(void);
+
+/**
+ * @brief Stop the motors at once and drop the move, and any command that
+ *        motion_tick() has not started yet
+ */
+void motion_stop(void);
+
+/**
+ * @brief Run one control period. Call it at motionCONTROL_HZ
+ */
+void motion_tick(void);
+
+/**
+ * @brief State of the engine, for logging and tests
+ */
+const motion_t *motion_state(void);
+
+/**
+ * @brief Loop jitter and execution time of motion_tick() since the start
+ *        or the last motion_timing_reset(). All 0 without read_cycles.
+ */
+void motion_get_timing(motion_timing_report_t *report);
+void motion_timing_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MOTION_H_ */
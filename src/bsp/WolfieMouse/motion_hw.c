@@ -0,0 +1,83 @@
+/*
+ * motion_hw.c
+ *
+ *  Binding of the motion engine to motor.c and encoder.c.
+ */
+
+#include "motion_hw.h"
+#include "motor.h"
+#include "encoder.h"
+#include "kb_time.h"
+
+#if (motionCONTROL_HZ != 1000)
+	#error "motion_tick() runs in SysTick, which is at 1 kHz"
+#endif
+
+static void drive_left_(int32_t duty)
+{
+	motor_speed_permyriad(CH_LEFT, duty);
+}
+
+static void drive_right_(int32_t duty)
+{
+	motor_speed_permyriad(CH_RIGHT, duty);
+}
+
+static int32_t read_left_(void)
+{
+	return (int32_t)encoder_left_position();
+}
+
+static int32_t read_right_(void)
+{
+	return (int32_t)encoder_right_position();
+}
+
+static motion_io_t motion_hw_io_ = {
+		.read_left = read_left_,
+		.read_right = read_right_,
+		.drive_left = drive_left_,
+		.drive_right = drive_right_,
+		.read_left_velocity = encoder_left_velocity,
+		.read_right_velocity = encoder_right_velocity,
+		.read_cycles = kb_time_counter /* the timing of motion_tick() */
+};
+
+static volatile uint8_t is_running_ = 0;
+
+kb_status_t motion_hw_init(void)
+{
+	kb_status_t result;
+
+	is_running_ = 0;
+	encoder_init();
+	result = motor_init();
+	if (result != KB_OK)
+	{
+		return result;
+	}
+	result = motor_start(CH_BOTH);
+	if (result != KB_OK)
+	{
+		return result;
+	}
+	/* kb_tick_update_f_cpu_mhz() has started the counter of kb_time_counter()
+	 and updated SystemCoreClock */
+	motion_hw_io_.cycles_per_us = SystemCoreClock / 1000000;
+
+	motion_init(&motion_hw_io_);
+	is_running_ = 1;
+	return KB_OK;
+}
+
+/**
+ * @brief Called by HAL_SYSTICK_IRQHandler() every 1 ms
+ */
+void HAL_SYSTICK_Callback(void)
+{
+	if (is_running_)
+	{
+		encoder_sample();
+		motion_tick();
+	}
+}
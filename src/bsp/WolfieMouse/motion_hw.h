@@ -0,0 +1,30 @@
+/*
+ * motion_hw.h
+ *
+ *  Binding of the motion engine (motion.h) to the motors (motor.c) and the
+ *  encoders (encoder.c) of WolfieMouse. motion_tick() runs in the SysTick
+ *  interrupt, through HAL_SYSTICK_Callback(), at 1 kHz, and its timing is
+ *  measured with the cycle counter of the DWT (see motion_get_timing()).
+ */
+
+#ifndef MOTION_HW_H_
+#define MOTION_HW_H_
+
+#include "kb_common_source.h"
+#include "motion.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initialize the encoders and the motors, and start the motion engine.
+ *        Use the functions of motion.h after this.
+ */
+kb_status_t motion_hw_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MOTION_HW_H_ */
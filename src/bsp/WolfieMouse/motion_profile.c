@@ -0,0 +1,170 @@
+/*
+ * motion_profile.c
+ *
+ *  Each period the profile decides to accelerate, cruise or brake from the
+ *  distance left and the distance needed to stop from the current velocity
+ *  and acceleration. With a jerk limit the acceleration slews toward the
+ *  decision instead of jumping, which gives the S-curve.
+ */
+
+#include "motion_profile.h"
+#include <math.h>
+
+#define profileABS(x)	(((x) < 0.0f) ? -(x) : (x))
+
+/**
+ * @brief Distance to stop from velocity and acceleration within the limits
+ */
+static float stopping_distance_(const motion_profile_t *profile, float velocity, float acceleration)
+{
+	const float max_acc = profile->limits.max_acceleration;
+	const float jerk = profile->limits.max_jerk;
+	float time;
+	float distance = 0.0f;
+
+	if (jerk <= 0.0f)
+	{
+		return (velocity * velocity) / (2.0f * max_acc);
+	}
+
+	/* bring a positive acceleration down to 0 first */
+	if (acceleration > 0.0f)
+	{
+		time = acceleration / jerk;
+		distance = (velocity * time) + (acceleration * time * time / 2.0f)
+				- (jerk * time * time * time / 6.0f);
+		velocity += acceleration * time / 2.0f;
+	}
+
+	/* symmetric S-curve down to 0: the average velocity is half */
+	if (velocity >= (max_acc * max_acc / jerk))
+	{
+		time = (velocity / max_acc) + (max_acc / jerk);
+	}
+	else
+	{
+		time = 2.0f * sqrtf(velocity / jerk);
+	}
+	return distance + (velocity * time / 2.0f);
+}
+
+/**
+ * @brief Move the acceleration toward the target within the jerk limit
+ */
+static float slew_acceleration_(const motion_profile_t *profile, float target)
+{
+	float step = profile->limits.max_jerk * profile->period;
+	float acceleration = profile->acceleration;
+
+	if (profile->limits.max_jerk <= 0.0f)
+	{
+		return target;
+	}
+	if (target > acceleration + step)
+	{
+		return acceleration + step;
+	}
+	if (target < acceleration - step)
+	{
+		return acceleration - step;
+	}
+	return target;
+}
+
+void motion_profile_init(motion_profile_t *profile, const motion_limits_t *limits, float period)
+{
+	profile->limits = *limits;
+	profile->period = period;
+	profile->distance = 0.0f;
+	profile->sign = 1.0f;
+	profile->position = 0.0f;
+	profile->velocity = 0.0f;
+	profile->acceleration = 0.0f;
+	profile->is_braking = 0;
+	profile->is_done = 1;
+}
+
+void motion_profile_start(motion_profile_t *profile, float distance)
+{
+	profile->sign = (distance < 0.0f) ? -1.0f : 1.0f;
+	profile->distance = profileABS(distance);
+	profile->position = 0.0f;
+	profile->velocity = 0.0f;
+	profile->acceleration = 0.0f;
+	profile->is_braking = 0;
+	profile->is_done = (profile->distance == 0.0f) ? 1 : 0;
+}
+
+int motion_profile_step(motion_profile_t *profile)
+{
+	const float period = profile->period;
+	const float max_vel = profile->limits.max_velocity;
+	const float max_acc = profile->limits.max_acceleration;
+	const float jerk = profile->limits.max_jerk;
+	/* never stall before the end, even if braking was a bit early */
+	const float min_vel = max_acc * period;
+	float remaining = profile->distance - profile->position;
+	float velocity = profile->velocity;
+	float target;
+
+	if (profile->is_done)
+	{
+		return 0;
+	}
+
+	if (profile->is_braking
+			|| (remaining <= stopping_distance_(profile, velocity, profile->acceleration) + velocity * period))
+	{
+		/* brake, with the deceleration that stops exactly at the end */
+		profile->is_braking = 1;
+		target = -(velocity * velocity) / (2.0f * remaining);
+		if (target < -max_acc)
+		{
+			target = -max_acc;
+		}
+		if ((jerk > 0.0f)
+				&& (velocity <= (profile->acceleration * profile->acceleration) / (2.0f * jerk)))
+		{
+			/* release the brake so that it ends with 0 acceleration */
+			target = 0.0f;
+		}
+	}
+	else if ((jerk > 0.0f) && (profile->acceleration > 0.0f)
+			&& (velocity + (profile->acceleration * profile->acceleration) / (2.0f * jerk) >= max_vel))
+	{
+		/* release the throttle so that it reaches max_velocity smoothly */
+		target = 0.0f;
+	}
+	else if (velocity < max_vel)
+	{
+		target = max_acc;
+	}
+	else
+	{
+		target = 0.0f;
+	}
+
+	profile->acceleration = slew_acceleration_(profile, target);
+	velocity += profile->acceleration * period;
+	if (velocity > max_vel)
+	{
+		velocity = max_vel;
+	}
+	if (velocity < min_vel)
+	{
+		velocity = min_vel;
+	}
+	profile->velocity = velocity;
+
+	if (velocity * period >= remaining)
+	{
+		/* reached: stop exactly at the end */
+		profile->position = profile->distance;
+		profile->velocity = 0.0f;
+		profile->acceleration = 0.0f;
+		profile->is_done = 1;
+		return 0;
+	}
+	profile->position += velocity * period;
+	return 1;
+}
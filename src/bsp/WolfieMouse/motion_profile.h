@@ -0,0 +1,78 @@
+/*
+ * motion_profile.h
+ *
+ *  Velocity profile generator with acceleration (and optionally jerk)
+ *  limits. It is computed online, one control period at a time, so it only
+ *  needs the current state and can be retargeted at any time.
+ *  Plain C without the HAL, so it also runs on the host.
+ */
+
+#ifndef MOTION_PROFILE_H_
+#define MOTION_PROFILE_H_
+
+#include <stdint.h>
+
+typedef struct {
+	float max_velocity;		/* unit/s */
+	float max_acceleration;	/* unit/s^2 */
+	float max_jerk;			/* unit/s^3. 0 for a trapezoidal profile, S-curve otherwise */
+} motion_limits_t;
+
+typedef struct {
+	motion_limits_t limits;
+	float period;			/* control period in seconds */
+	float distance;			/* distance to go, always positive */
+	float sign;				/* +1.0f or -1.0f: direction of the move */
+	/* setpoints of the current period, along the move (always positive) */
+	float position;
+	float velocity;
+	float acceleration;
+	uint8_t is_braking;		/* braking until the end of the move */
+	uint8_t is_done;
+} motion_profile_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initialize a profile at rest
+ * @param profile	profile to initialize
+ * @param limits	velocity, acceleration and jerk limits
+ * @param period	control period in seconds (e.g. 0.001f for 1 kHz)
+ */
+void motion_profile_init(motion_profile_t *profile, const motion_limits_t *limits, float period);
+
+/**
+ * @brief Start a move from rest
+ * @param distance	signed distance to move
+ */
+void motion_profile_start(motion_profile_t *profile, float distance);
+
+/**
+ * @brief Advance the profile by one control period
+ * @return 1 while moving, 0 when the distance is reached
+ */
+int motion_profile_step(motion_profile_t *profile);
+
+/**
+ * @brief Signed setpoints of the current period
+ */
+static inline float motion_profile_position(const motion_profile_t *profile)
+{
+	return profile->sign * profile->position;
+}
+static inline float motion_profile_velocity(const motion_profile_t *profile)
+{
+	return profile->sign * profile->velocity;
+}
+static inline float motion_profile_acceleration(const motion_profile_t *profile)
+{
+	return profile->sign * profile->acceleration;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MOTION_PROFILE_H_ */
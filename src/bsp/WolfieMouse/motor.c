@@ -118,6 +118,66 @@ int32_t motor_speed_percent(motor_ch_t channel, int32_t speed)
 	return speed;
 }
 
+int32_t motor_speed_permyriad(motor_ch_t channel, int32_t speed)
+{
+	uint16_t duty;
+
+	if (speed > 10000)
+	{
+		speed = 10000;
+	}
+	else if (speed < -10000)
+	{
+		speed = -10000;
+	}
+	duty = (uint16_t)((speed < 0) ? -speed : speed);
+
+	switch (channel) {
+	case CH_LEFT:
+		if (speed < 0)
+		{
+			left_set_backward_();
+		}
+		else
+		{
+			left_set_forward_();
+		}
+		kb_pwm_permyriad(TIMER1, CH_1, duty);
+		break;
+
+	case CH_RIGHT:
+		if (speed < 0)
+		{
+			right_set_backward_();
+		}
+		else
+		{
+			right_set_forward_();
+		}
+		kb_pwm_permyriad(TIMER1, CH_4, duty);
+		break;
+
+	case CH_BOTH:
+		if (speed < 0)
+		{
+			motor_go_backward();
+		}
+		else
+		{
+			motor_go_forward();
+		}
+		kb_pwm_permyriad(TIMER1, CH_1, duty);
+		kb_pwm_permyriad(TIMER1, CH_4, duty);
+		break;
+
+	default:
+		/* Return Error in other cases */
+		return 0;
+	}
+
+	return speed;
+}
+
 void motor_go_forward(void)
 {
 	right_set_forward_();
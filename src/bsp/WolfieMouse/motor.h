@@ -27,6 +27,8 @@ void motor_turn_right(void);
 void motor_turn_left(void);
 
 int32_t motor_speed_percent(motor_ch_t channel, int32_t speed);
+/* Signed speed in permyriad (-10000 to 10000). It sets the direction too */
+int32_t motor_speed_permyriad(motor_ch_t channel, int32_t speed);
 kb_status_t motor_start(motor_ch_t eChannel);
 kb_status_t motor_stop(motor_ch_t eChannel);
 
@@ -0,0 +1,76 @@
+/*
+ * pid.c
+ */
+
+#include "pid.h"
+
+void pid_init(pid_controller_t *pid, const pid_gains_t *gains, float period)
+{
+	pid->gains = *gains;
+	pid->period = period;
+	pid_reset(pid);
+}
+
+void pid_reset(pid_controller_t *pid)
+{
+	pid->integral = 0.0f;
+	pid->last_error = 0.0f;
+	pid->output = 0.0f;
+	pid->is_saturated = 0;
+	pid->is_first = 1;
+}
+
+float pid_update(pid_controller_t *pid, float error, float feed_forward)
+{
+	const pid_gains_t *gains = &pid->gains;
+	float integral = pid->integral + (gains->ki * error * pid->period);
+	float derivative = 0.0f;
+	float output;
+
+	if (!pid->is_first)
+	{
+		derivative = gains->kd * (error - pid->last_error) / pid->period;
+	}
+	pid->is_first = 0;
+	pid->last_error = error;
+
+	if (integral > gains->integral_max)
+	{
+		integral = gains->integral_max;
+	}
+	else if (integral < -gains->integral_max)
+	{
+		integral = -gains->integral_max;
+	}
+
+	output = feed_forward + (gains->kp * error) + integral + derivative;
+	pid->is_saturated = 1;
+	if ((output > gains->output_max) && (error > 0.0f))
+	{
+		/* keep the last integral: integrating would only wind up */
+		output -= integral - pid->integral;
+	}
+	else if ((output < gains->output_min) && (error < 0.0f))
+	{
+		output -= integral - pid->integral;
+	}
+	else
+	{
+		pid->integral = integral;
+	}
+
+	if (output > gains->output_max)
+	{
+		output = gains->output_max;
+	}
+	else if (output < gains->output_min)
+	{
+		output = gains->output_min;
+	}
+	else
+	{
+		pid->is_saturated = 0;
+	}
+	pid->output = output;
+	return output;
+}
@@ -0,0 +1,64 @@
+/*
+ * pid.h
+ *
+ *  Discrete PID controller with feed-forward and anti-windup, run at a
+ *  fixed period. Plain C without the HAL, so it also runs on the host.
+ */
+
+#ifndef PID_H_
+#define PID_H_
+
+#include <stdint.h>
+
+typedef struct {
+	float kp;
+	float ki;				/* per second */
+	float kd;				/* times second */
+	float output_min;
+	float output_max;
+	float integral_max;		/* limit of |integral term|, in output unit */
+} pid_gains_t;
+
+typedef struct {
+	pid_gains_t gains;
+	float period;			/* seconds */
+	float integral;			/* integral term, in output unit */
+	float last_error;
+	float output;			/* last output, after the limits */
+	uint8_t is_saturated;	/* the last output was limited */
+	uint8_t is_first;		/* no last_error for the derivative yet */
+} pid_controller_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initialize a controller
+ * @param pid		controller to initialize
+ * @param gains		gains and limits
+ * @param period	control period in seconds (e.g. 0.001f for 1 kHz)
+ */
+void pid_init(pid_controller_t *pid, const pid_gains_t *gains, float period);
+
+/**
+ * @brief Clear the integral and the derivative history
+ */
+void pid_reset(pid_controller_t *pid);
+
+/**
+ * @brief Run one period.
+ *        The integral does not grow while the output is limited in the
+ *        direction of the error (conditional integration), so it does not
+ *        wind up when the motor cannot follow.
+ * @param error			setpoint - measurement
+ * @param feed_forward	added to the output before the limits
+ * @return output within [output_min, output_max]
+ */
+float pid_update(pid_controller_t *pid, float error, float feed_forward);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PID_H_ */
@@ -0,0 +1,239 @@
+/*
+ * pose.c
+ *
+ *  Each period:
+ *   1. The heading moves by the gyro and is pulled toward the heading of
+ *      the wheels. The gyro is right over a short time but drifts with its
+ *      bias; the wheels do not drift but slip.
+ *   2. The position moves by the mean wheel travel along the mean heading
+ *      of the period.
+ *   3. A new distance to a wall is turned into the position it implies
+ *      across (side walls) or along (front wall) the cell, and the position
+ *      moves by a fraction of the difference.
+ */
+
+#include "pose.h"
+#include <math.h>
+
+#if defined(ARM_MATH_CM4)
+	#include "arm_math.h"
+	#define poseSIN(x)		arm_sin_f32(x)
+	#define poseCOS(x)		arm_cos_f32(x)
+#else
+	#define poseSIN(x)		sinf(x)
+	#define poseCOS(x)		cosf(x)
+#endif
+
+#define posePI				3.14159265f
+#define poseHALF_PI			(posePI / 2.0f)
+/* periods standing still before the gyro bias is learnt */
+#define poseSTILL_PERIODS	100
+#define poseBIAS_GAIN		0.01f
+
+/* forward and left unit vectors of each dir_e */
+static const int8_t forward_x_[4] = {1, 0, -1, 0};
+static const int8_t forward_y_[4] = {0, 1, 0, -1};
+
+static float wrap_angle_(float angle)
+{
+	while (angle > posePI)
+	{
+		angle -= 2.0f * posePI;
+	}
+	while (angle <= -posePI)
+	{
+		angle += 2.0f * posePI;
+	}
+	return angle;
+}
+
+void pose_init(pose_filter_t *filter, float period)
+{
+	const pose_t origin = {0.0f, 0.0f, 0.0f};
+
+	filter->period = period;
+	filter->gyro_bias = 0.0f;
+	filter->side_count = 0;
+	filter->front_count = 0;
+	pose_reset(filter, &origin);
+}
+
+void pose_reset(pose_filter_t *filter, const pose_t *pose)
+{
+	filter->pose = *pose;
+	filter->pose.heading = wrap_angle_(pose->heading);
+	filter->wheel_heading = filter->pose.heading;
+	filter->still_count = 0;
+	filter->has_wall = 0;
+}
+
+void pose_get_cell(const pose_filter_t *filter, pose_cell_t *cell)
+{
+	const pose_t *pose = &filter->pose;
+	float dx;
+	float dy;
+	int32_t dir;
+
+	cell->row = (int32_t)floorf(pose->x / motionCELL_MM + 0.5f);
+	cell->col = (int32_t)floorf(pose->y / motionCELL_MM + 0.5f);
+	dir = (int32_t)floorf(pose->heading / poseHALF_PI + 0.5f);
+	cell->heading_error = pose->heading - (float)dir * poseHALF_PI;
+	cell->dir = (uint8_t)(dir & 0x3);
+
+	/* left of forward (fx, fy) is (-fy, fx) */
+	dx = pose->x - (float)cell->row * motionCELL_MM;
+	dy = pose->y - (float)cell->col * motionCELL_MM;
+	cell->along = (forward_x_[cell->dir] * dx) + (forward_y_[cell->dir] * dy);
+	cell->across = (-forward_y_[cell->dir] * dx) + (forward_x_[cell->dir] * dy);
+}
+
+/**
+ * @brief Move the position along and across the current cell
+ */
+static void shift_(pose_filter_t *filter, uint8_t dir, float along, float across)
+{
+	filter->pose.x += (forward_x_[dir] * along) - (forward_y_[dir] * across);
+	filter->pose.y += (forward_y_[dir] * along) + (forward_x_[dir] * across);
+}
+
+/**
+ * @brief Pull the heading parallel to the side walls. Moving @base along
+ *        the walls, the distance to them changes by base * sin(heading error)
+ * @param across	position across the cell measured from the walls
+ */
+static void correct_heading_(pose_filter_t *filter, const pose_cell_t *cell, float across)
+{
+	float base;
+	float error;
+
+	if (!filter->has_wall || (filter->wall_dir != cell->dir)
+			|| (filter->wall_row != cell->row) || (filter->wall_col != cell->col))
+	{
+		filter->has_wall = 1;
+		filter->wall_across = across;
+		filter->wall_along = cell->along;
+		filter->wall_row = cell->row;
+		filter->wall_col = cell->col;
+		filter->wall_dir = cell->dir;
+		return;
+	}
+	base = cell->along - filter->wall_along;
+	if ((base < poseHEADING_BASE_MM) && (base > -poseHEADING_BASE_MM))
+	{
+		return;
+	}
+	/* small angles: sin(error) is error */
+	error = ((across - filter->wall_across) / base) - cell->heading_error;
+	filter->pose.heading = wrap_angle_(filter->pose.heading + poseHEADING_GAIN * error);
+	filter->wheel_heading = wrap_angle_(filter->wheel_heading + poseHEADING_GAIN * error);
+	filter->wall_across = across;
+	filter->wall_along = cell->along;
+}
+
+/**
+ * @brief Pull the position toward the walls seen in this period
+ */
+static void correct_walls_(pose_filter_t *filter, const pose_input_t *input)
+{
+	pose_cell_t cell;
+	float cos_error;
+	float across = 0.0f;
+	int walls = 0;
+
+	pose_get_cell(filter, &cell);
+	if ((cell.heading_error > poseALIGN_RAD) || (cell.heading_error < -poseALIGN_RAD))
+	{
+		return;
+	}
+	/* the sensors look across the walls at the heading error */
+	cos_error = poseCOS(cell.heading_error);
+
+	if ((cell.along < poseSIDE_ALONG_MM) && (cell.along > -poseSIDE_ALONG_MM))
+	{
+		if ((input->left_range_mm >= 0.0f) && (input->left_range_mm < poseSIDE_MAX_MM))
+		{
+			across += poseSIDE_CENTRE_MM - (input->left_range_mm * cos_error);
+			walls++;
+		}
+		if ((input->right_range_mm >= 0.0f) && (input->right_range_mm < poseSIDE_MAX_MM))
+		{
+			across += (input->right_range_mm * cos_error) - poseSIDE_CENTRE_MM;
+			walls++;
+		}
+		if (walls > 0)
+		{
+			across /= (float)walls;
+			correct_heading_(filter, &cell, across);
+			shift_(filter, cell.dir, 0.0f, poseSIDE_GAIN * (across - cell.across));
+			filter->side_count++;
+		}
+		else
+		{
+			filter->has_wall = 0;
+		}
+	}
+	else
+	{
+		filter->has_wall = 0;
+	}
+
+	if ((input->front_range_mm >= 0.0f) && (input->front_range_mm < poseFRONT_MAX_MM))
+	{
+		/* the wall ahead of the current cell, or of the next one */
+		float along = poseFRONT_CENTRE_MM - (input->front_range_mm * cos_error);
+
+		if (along < -motionCELL_MM / 2.0f)
+		{
+			along += motionCELL_MM;
+		}
+		shift_(filter, cell.dir, poseFRONT_GAIN * (along - cell.along), 0.0f);
+		filter->front_count++;
+	}
+}
+
+void pose_step(pose_filter_t *filter, const pose_input_t *input)
+{
+	pose_t *pose = &filter->pose;
+	float distance = (input->left_mm + input->right_mm) / 2.0f;
+	float turn = (input->right_mm - input->left_mm) / motionTRACK_MM;
+	float heading;
+	int is_still;
+
+	is_still = (input->left_mm < poseSTILL_MM) && (input->left_mm > -poseSTILL_MM)
+			&& (input->right_mm < poseSTILL_MM) && (input->right_mm > -poseSTILL_MM);
+	if (input->has_gyro && ((input->gyro_rad_s - filter->gyro_bias > poseSTILL_RAD_S)
+			|| (input->gyro_rad_s - filter->gyro_bias < -poseSTILL_RAD_S)))
+	{
+		is_still = 0;
+	}
+	filter->still_count = is_still ? filter->still_count + 1 : 0;
+
+	filter->wheel_heading = wrap_angle_(filter->wheel_heading + turn);
+	if (input->has_gyro)
+	{
+		if (filter->still_count >= poseSTILL_PERIODS)
+		{
+			/* standing still: all the gyro reads is its bias */
+			filter->gyro_bias += poseBIAS_GAIN * (input->gyro_rad_s - filter->gyro_bias);
+			turn = 0.0f;
+		}
+		else
+		{
+			turn = (input->gyro_rad_s - filter->gyro_bias) * filter->period;
+		}
+		/* the complementary blend */
+		turn += (1.0f - poseGYRO_WEIGHT)
+				* wrap_angle_(filter->wheel_heading - (pose->heading + turn));
+	}
+
+	heading = pose->heading + (turn / 2.0f);
+	pose->x += distance * poseCOS(heading);
+	pose->y += distance * poseSIN(heading);
+	pose->heading = wrap_angle_(pose->heading + turn);
+
+	if ((input->left_range_mm >= 0.0f) || (input->right_range_mm >= 0.0f)
+			|| (input->front_range_mm >= 0.0f))
+	{
+		correct_walls_(filter, input);
+	}
+}
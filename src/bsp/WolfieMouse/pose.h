@@ -0,0 +1,164 @@
+/*
+ * pose.h
+ *
+ *  Pose estimator of WolfieMouse: a fixed-rate complementary filter of the
+ *  wheel odometry, the gyro and the VL6180X distances to the walls.
+ *   - The heading follows the gyro over a short time and the wheels over a
+ *     long time. The gyro bias is learnt while the wheels stand still.
+ *   - The side and front distances pull the position toward the walls of
+ *     the cell when the mouse is nearly aligned with the maze. The change of
+ *     the side distances along the travel pulls the heading parallel to the
+ *     walls.
+ *  Plain C without the HAL, so it also runs on the host (see
+ *  examples/99_WolfieMouse/host/PoseReplay.c). Single precision only. With
+ *  ARM_MATH_CM4 defined (and the CMSIS-DSP library linked), sin and cos come
+ *  from CMSIS-DSP.
+ *
+ *  Coordinates: x along the rows (dir_e row_plus) and y along the columns
+ *  (col_plus), in mm, with the centre of cell (0, 0) at the origin. The
+ *  heading is in radians, counter-clockwise from +x: 0 is row_plus and
+ *  pi/2 is col_plus, like the left turn of PositionController.
+ */
+
+#ifndef POSE_H_
+#define POSE_H_
+
+#include <stdint.h>
+#include "motion.h"
+
+/* Distance from a side sensor to the wall, centred in a cell. Nominal: 84 mm
+ * from the centre line to a wall face (180 mm cell, 12 mm walls) less 30 mm
+ * from the centre of the robot to the sensor, the geometry PoseReplay.c
+ * simulates. Override it with the value measured on the robot */
+#ifndef poseSIDE_CENTRE_MM
+	#define poseSIDE_CENTRE_MM		54.0f
+#endif
+/* A side distance above this is no wall */
+#ifndef poseSIDE_MAX_MM
+	#define poseSIDE_MAX_MM			110.0f
+#endif
+/* Distance from the front sensor to the front wall, at the centre of a cell */
+#ifndef poseFRONT_CENTRE_MM
+	#define poseFRONT_CENTRE_MM		50.0f
+#endif
+#ifndef poseFRONT_MAX_MM
+	#define poseFRONT_MAX_MM		150.0f
+#endif
+/* Weight of the gyro heading against the wheel heading, per period (0 to
+ * 1). The time constant of the blend is period * W / (1 - W): 10 s at 1 kHz,
+ * long enough that a 1 % wheel mismatch does not pull the heading in a turn */
+#ifndef poseGYRO_WEIGHT
+	#define poseGYRO_WEIGHT			0.9999f
+#endif
+/* Fraction of the wall error corrected per sample of the distances */
+#ifndef poseSIDE_GAIN
+	#define poseSIDE_GAIN			0.1f
+#endif
+#ifndef poseFRONT_GAIN
+	#define poseFRONT_GAIN			0.1f
+#endif
+/* The heading to the side walls is measured over this travel along them,
+ * and this fraction of its error is corrected */
+#ifndef poseHEADING_BASE_MM
+	#define poseHEADING_BASE_MM		30.0f
+#endif
+#ifndef poseHEADING_GAIN
+	#define poseHEADING_GAIN		0.2f
+#endif
+/* The walls are only used within this of a cardinal heading */
+#ifndef poseALIGN_RAD
+	#define poseALIGN_RAD			0.17f
+#endif
+/* The side walls are only used within this of the cell centre, along the
+ * move, away from the gaps at the posts */
+#ifndef poseSIDE_ALONG_MM
+	#define poseSIDE_ALONG_MM		50.0f
+#endif
+/* The mouse stands still under this wheel travel per period, and this yaw
+ * rate: the wheels alone miss the start of a turn between two counts */
+#ifndef poseSTILL_MM
+	#define poseSTILL_MM			0.001f
+#endif
+#ifndef poseSTILL_RAD_S
+	#define poseSTILL_RAD_S			0.1f
+#endif
+
+typedef struct {
+	float x;				/* mm */
+	float y;				/* mm */
+	float heading;			/* rad, in (-pi, pi] */
+} pose_t;
+
+/**
+ * @brief Pose relative to the nearest cell, for the wall-following
+ */
+typedef struct {
+	int32_t row;
+	int32_t col;
+	uint8_t dir;			/* nearest cardinal heading, as dir_e */
+	float along;			/* mm ahead of the cell centre, along dir */
+	float across;			/* mm left of the cell centre */
+	float heading_error;	/* rad from dir, + is to the left */
+} pose_cell_t;
+
+/**
+ * @brief Sensors of one period. A distance is < 0 when there is no new
+ *        sample in this period
+ */
+typedef struct {
+	float left_mm;			/* wheel travel in this period */
+	float right_mm;
+	float gyro_rad_s;		/* yaw rate, + is counter-clockwise */
+	uint8_t has_gyro;
+	float left_range_mm;	/* distances measured by the VL6180X */
+	float right_range_mm;
+	float front_range_mm;
+} pose_input_t;
+
+typedef struct {
+	pose_t pose;
+	float wheel_heading;	/* heading from the wheels only */
+	float period;			/* seconds */
+	float gyro_bias;		/* rad/s */
+	uint32_t still_count;	/* periods standing still */
+	/* last side measurement, for the heading to the walls */
+	float wall_across;
+	float wall_along;
+	int32_t wall_row;
+	int32_t wall_col;
+	uint8_t wall_dir;
+	uint8_t has_wall;
+	uint32_t side_count;	/* corrections from the walls */
+	uint32_t front_count;
+} pose_filter_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Start at the centre of cell (0, 0), heading row_plus
+ * @param period	period of pose_step() in seconds
+ */
+void pose_init(pose_filter_t *filter, float period);
+
+/**
+ * @brief Set the pose, e.g. at the start cell. The gyro bias is kept
+ */
+void pose_reset(pose_filter_t *filter, const pose_t *pose);
+
+/**
+ * @brief Run one period
+ */
+void pose_step(pose_filter_t *filter, const pose_input_t *input);
+
+/**
+ * @brief Pose relative to the nearest cell
+ */
+void pose_get_cell(const pose_filter_t *filter, pose_cell_t *cell);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POSE_H_ */
@@ -42,6 +42,13 @@ int VL6180x_I2CRead(VL6180xDev_t addr, uint8_t *buff, uint8_t len) {
 }
 
 
+int VL6180x_I2CMemRead(VL6180xDev_t addr, uint16_t index, uint8_t *buff, uint8_t len) {
+    int status;
+    status = kb_i2c_mem_read_timeout(VL6180X_I2C, addr, index, 2, buff, len, TIMEOUT_);
+    return status;
+}
+
+
 int VL6180x_I2CWrite(VL6180xDev_t addr, uint8_t *buff, uint8_t len) {
     int status;
     status = kb_i2c_send_timeout(VL6180X_I2C, addr, buff, len, TIMEOUT_);
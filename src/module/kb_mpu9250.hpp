@@ -9,7 +9,15 @@
 #define MODULE_KB_MPU9250_HPP_
 
 #include <math.h>
-#include "I2C.h"
+#include "kb_i2c.h"
+
+#ifndef MPU9250_I2C
+    #define MPU9250_I2C         I2C3
+    #define MPU9250_SDA_PORT    GPIOC
+    #define MPU9250_SDA_PIN     GPIO_PIN_9
+    #define MPU9250_SCL_PORT    GPIOA
+    #define MPU9250_SCL_PIN     GPIO_PIN_8
+#endif
 
 /* custom macro for a use of FreeRTOS */
 #define wait(NUM)  vTaskDelay((uint32_t) (NUM * 1000) / portTICK_RATE_MS)
@@ -200,9 +208,6 @@ uint8_t Mscale = MFS_16BITS; // MFS_14BITS or MFS_16BITS, 14-bit or 16-bit magne
 uint8_t Mmode = 0x06;        // Either 8 Hz 0x02) or 100 Hz (0x06) magnetometer data ODR
 float aRes, gRes, mRes;      // scale resolutions per LSB for the sensors
 
-//Set up I2C, (SDA,SCL)
-mbed::I2C i2c(confI2C_SDA_Pin, confI2C_SCL_Pin);
-
 // Pin definitions
 int intPin = 12;  // These can be changed, 2 and 3 are the Arduinos ext int pins
 
@@ -243,35 +248,23 @@ public:
 //====== Set of useful function to access acceleratio, gyroscope, and temperature data
 //===================================================================================================================
 
+  // The addresses are eight-bit (see MPU9250_ADDRESS), kb_i2c takes seven-bit ones
   void writeByte(uint8_t address, uint8_t subAddress, uint8_t data)
   {
-    char data_write[2];
-    data_write[0] = subAddress;
-    data_write[1] = data;
-    i2c.write(address, data_write, 2, 0);
+    kb_i2c_mem_write(MPU9250_I2C, address >> 1, subAddress, 1, &data, 1);
   }
 
   char readByte(uint8_t address, uint8_t subAddress)
   {
-    char data[1]; // `data` will store the register data
-    char data_write[1];
-    data_write[0] = subAddress;
-    i2c.write(address, data_write, 1, 1); // no stop
-    i2c.read(address, data, 1, 0);
-    return data[0];
+    uint8_t data = 0; // `data` will store the register data
+    kb_i2c_mem_read(MPU9250_I2C, address >> 1, subAddress, 1, &data, 1); // repeated start, one transaction
+    return data;
   }
 
+  // Burst read of count registers from subAddress, in one transaction
   void readBytes(uint8_t address, uint8_t subAddress, uint8_t count, uint8_t * dest)
   {
-    char data[14];
-    char data_write[1];
-    data_write[0] = subAddress;
-    i2c.write(address, data_write, 1, 1); // no stop
-    i2c.read(address, data, count, 0);
-    for (int ii = 0; ii < count; ii++)
-    {
-      dest[ii] = data[ii];
-    }
+    kb_i2c_mem_read(MPU9250_I2C, address >> 1, subAddress, 1, dest, count);
   }
 
   void getMres()
@@ -354,6 +347,20 @@ public:
     destination[2] = (int16_t) (((int16_t) rawData[4] << 8) | rawData[5]);
   }
 
+  // Accel, temperature and gyro are contiguous from ACCEL_XOUT_H: one burst of 14 registers
+  void readMotionData(int16_t * accel, int16_t * gyro, int16_t * temp)
+  {
+    uint8_t rawData[14];
+    readBytes(MPU9250_ADDRESS, ACCEL_XOUT_H, 14, &rawData[0]);
+    accel[0] = (int16_t) (((int16_t) rawData[0] << 8) | rawData[1]);
+    accel[1] = (int16_t) (((int16_t) rawData[2] << 8) | rawData[3]);
+    accel[2] = (int16_t) (((int16_t) rawData[4] << 8) | rawData[5]);
+    *temp = (int16_t) (((int16_t) rawData[6] << 8) | rawData[7]);
+    gyro[0] = (int16_t) (((int16_t) rawData[8] << 8) | rawData[9]);
+    gyro[1] = (int16_t) (((int16_t) rawData[10] << 8) | rawData[11]);
+    gyro[2] = (int16_t) (((int16_t) rawData[12] << 8) | rawData[13]);
+  }
+
   void readMagData(int16_t * destination)
   {
     uint8_t rawData[7]; // x/y/z gyro register data, ST2 register stored here, must read ST2 at end of data acquisition
@@ -917,7 +924,12 @@ void vUpdateMPU9250(void *pvParameters)
 
 
   //Set up I2C
-  i2c.frequency(400000);  // use fast (400 kHz) I2C
+  kb_i2c_sda_pin(MPU9250_I2C, MPU9250_SDA_PORT, MPU9250_SDA_PIN, PULLUP);
+  kb_i2c_scl_pin(MPU9250_I2C, MPU9250_SCL_PORT, MPU9250_SCL_PIN, PULLUP);
+  kb_i2c_init_t i2c_setting = {
+          .frequency = 400000  // use fast (400 kHz) I2C
+  };
+  kb_i2c_init(MPU9250_I2C, &i2c_setting);
 
   hi2c3.Instance = I2C3;
 
@@ -961,13 +973,12 @@ void vUpdateMPU9250(void *pvParameters)
     if (mpu9250.readByte(MPU9250_ADDRESS, INT_STATUS) & 0x01)
     {  // On interrupt, check if data ready interrupt
 
-      mpu9250.readAccelData(accelCount);  // Read the x/y/z adc values
+      mpu9250.readMotionData(accelCount, gyroCount, &tempCount);  // Read the x/y/z adc values of both
       // Now we'll calculate the accleration value into actual g's
       ax = (float) accelCount[0] * aRes - accelBias[0]; // get actual g value, this depends on scale being set
       ay = (float) accelCount[1] * aRes - accelBias[1];
       az = (float) accelCount[2] * aRes - accelBias[2];
 
-      mpu9250.readGyroData(gyroCount);  // Read the x/y/z adc values
       // Calculate the gyro value into actual degrees per second
       gx = (float) gyroCount[0] * gRes - gyroBias[0]; // get actual gyro value, this depends on scale being set
       gy = (float) gyroCount[1] * gRes - gyroBias[1];
@@ -8,15 +8,31 @@
 #include "kb_terminal.h"
 #include "kb_module_config.h"
 #include "kb_uart.h"
+#include <string.h>
 
 char kb_terminal_tx_buffer[80];
 char kb_terminal_rx_buffer[80];
 
+#if (TERMINAL_TX_RING_SIZE > 0) && (TERMINAL_RX_RING_SIZE > 0)
+    #define TERMINAL_ASYNC
+    static uint8_t tx_ring_[TERMINAL_TX_RING_SIZE];
+    static uint8_t rx_ring_[TERMINAL_RX_RING_SIZE];
+    static uint32_t rx_length_;  // bytes of the line in kb_terminal_rx_buffer
+#endif
+
 int kb_terminal_init(void)
 {
     kb_uart_tx_pin(TERMINAL_UART, TERMINAL_TX_PORT, TERMINAL_TX_PIN, NOPULL);
     kb_uart_rx_pin(TERMINAL_UART, TERMINAL_RX_PORT, TERMINAL_RX_PIN, NOPULL);
-    return kb_uart_init(TERMINAL_UART, TERMINAL_BAUD_RATE);
+    int result = kb_uart_init(TERMINAL_UART, TERMINAL_BAUD_RATE);
+#ifdef TERMINAL_ASYNC
+    if (result == KB_OK)
+    {
+        result = kb_uart_async_init(TERMINAL_UART, tx_ring_, sizeof(tx_ring_),
+                rx_ring_, sizeof(rx_ring_));
+    }
+#endif
+    return result;
 }
 
 int kb_terminal_puts(char *str)
@@ -24,6 +40,32 @@ int kb_terminal_puts(char *str)
     return kb_uart_send_str(TERMINAL_UART, str, TIMEOUT_MAX);
 }
 
+#ifdef TERMINAL_ASYNC
+/**
+ * @brief Non-blocking: collects the received bytes into a line
+ * @return @str with the line, without '\n', or NULL until a line is complete
+ */
+char *kb_terminal_gets(char *str)
+{
+    uint8_t c;
+    while (kb_uart_read(TERMINAL_UART, &c, 1) == 1)
+    {
+        if ((c != '\n') && (c != '\r'))
+        {
+            kb_terminal_rx_buffer[rx_length_++] = (char)c;
+        }
+        // a line ends at '\n', or when the buffer is full
+        if ((c == '\n') || (rx_length_ == sizeof(kb_terminal_rx_buffer) - 1))
+        {
+            memcpy(str, kb_terminal_rx_buffer, rx_length_);
+            str[rx_length_] = '\0';
+            rx_length_ = 0;
+            return str;
+        }
+    }
+    return NULL;
+}
+#else
 char *kb_terminal_gets(char *str)
 {
     int result = kb_uart_receive(TERMINAL_UART, (uint8_t *)str, 80, TIMEOUT_MAX); // FIXME: more nice gets
@@ -33,3 +75,4 @@ char *kb_terminal_gets(char *str)
     }
     return str;
 }
+#endif
@@ -21,6 +21,17 @@
 	#define TERMINAL_RX_PIN 		GPIO_PIN_3
 #endif
 
+// Ring sizes of the non-blocking UART (powers of two), so that printing does
+// not wait for the bytes to go out. 0, the default, for the blocking UART.
+// Non-blocking, a print from an interrupt handler that does not fit in the
+// TX ring is cut short instead of waiting (see kb_uart_async_init()).
+#ifndef TERMINAL_TX_RING_SIZE
+	#define TERMINAL_TX_RING_SIZE	0
+#endif
+#ifndef TERMINAL_RX_RING_SIZE
+	#define TERMINAL_RX_RING_SIZE	128
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
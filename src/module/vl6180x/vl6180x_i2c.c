@@ -136,14 +136,11 @@ int VL6180x_UpdateByte(VL6180xDev_t dev, uint16_t index, uint8_t AndData, uint8_
     buffer[0]=index>>8;
     buffer[1]=index&0xFF;
 
-    status=VL6180x_I2CWrite(dev, (uint8_t *)buffer,(uint8_t)2);
+    /* read data direct onto buffer, index and read in one transaction */
+    status=VL6180x_I2CMemRead(dev, index, &buffer[2],1);
     if( !status ){
-        /* read data direct onto buffer */
-        status=VL6180x_I2CRead(dev, &buffer[2],1);
-        if( !status ){
-            buffer[2]=(buffer[2]&AndData)|OrData;
-            status=VL6180x_I2CWrite(dev, buffer, (uint8_t)3);
-        }
+        buffer[2]=(buffer[2]&AndData)|OrData;
+        status=VL6180x_I2CWrite(dev, buffer, (uint8_t)3);
     }
 
     VL6180x_DoneI2CAcces(dev);
@@ -159,16 +156,11 @@ int VL6180x_RdByte(VL6180xDev_t dev, uint16_t index, uint8_t *data){
 
     VL6180x_GetI2CAccess(dev);
 
-    buffer=VL6180x_GetI2cBuffer(dev,2);
-    buffer[0]=index>>8;
-    buffer[1]=index&0xFF;
+    buffer=VL6180x_GetI2cBuffer(dev,1);
 
-    status=VL6180x_I2CWrite(dev, buffer, (uint8_t)2);
+    status=VL6180x_I2CMemRead(dev, index, buffer,1);
     if( !status ){
-        status=VL6180x_I2CRead(dev, buffer,1);
-        if( !status ){
-            *data=buffer[0];
-        }
+        *data=buffer[0];
     }
     VL6180x_DoneI2CAcces(dev);
 
@@ -184,16 +176,11 @@ int VL6180x_RdWord(VL6180xDev_t dev, uint16_t index, uint16_t *data){
     VL6180x_GetI2CAccess(dev);
 
     buffer=VL6180x_GetI2cBuffer(dev,2);
-    buffer[0]=index>>8;
-    buffer[1]=index&0xFF;
 
-    status=VL6180x_I2CWrite(dev, buffer, (uint8_t)2);
-    if( !status){
-        status=VL6180x_I2CRead(dev, buffer,2);
-        if( !status ){
-            /* VL6180x register are Big endian if cpu is be direct read direct into *data is possible */
-            *data=((uint16_t)buffer[0]<<8)|(uint16_t)buffer[1];
-        }
+    status=VL6180x_I2CMemRead(dev, index, buffer,2);
+    if( !status ){
+        /* VL6180x register are Big endian if cpu is be direct read direct into *data is possible */
+        *data=((uint16_t)buffer[0]<<8)|(uint16_t)buffer[1];
     }
     VL6180x_DoneI2CAcces(dev);
     return status;
@@ -208,16 +195,10 @@ int  VL6180x_RdDWord(VL6180xDev_t dev, uint16_t index, uint32_t *data){
     VL6180x_GetI2CAccess(dev);
     buffer=VL6180x_GetI2cBuffer(dev,4);
 
-    buffer[0]=index>>8;
-    buffer[1]=index&0xFF;
-
-    status=VL6180x_I2CWrite(dev, (uint8_t *) buffer, (uint8_t)2);
+    status=VL6180x_I2CMemRead(dev, index, buffer,4);
     if( !status ){
-        status=VL6180x_I2CRead(dev, buffer,4);
-        if( !status ){
-            /* VL6180x register are Big endian if cpu is be direct read direct into data is possible */
-            *data=((uint32_t)buffer[0]<<24)|((uint32_t)buffer[1]<<16)|((uint32_t)buffer[2]<<8)|((uint32_t)buffer[3]);
-        }
+        /* VL6180x register are Big endian if cpu is be direct read direct into data is possible */
+        *data=((uint32_t)buffer[0]<<24)|((uint32_t)buffer[1]<<16)|((uint32_t)buffer[2]<<8)|((uint32_t)buffer[3]);
     }
     VL6180x_DoneI2CAcces(dev);
     return status;
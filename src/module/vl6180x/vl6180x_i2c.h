@@ -98,6 +98,19 @@ int  VL6180x_I2CWrite(VL6180xDev_t dev, uint8_t  *buff, uint8_t len);
  */
 int VL6180x_I2CRead(VL6180xDev_t dev, uint8_t *buff, uint8_t len);
 
+/**
+ * @brief       Read registers from VL6180x device via i2c: the 16-bit register
+ *              index is written, then the data read after a repeated start, in
+ *              one transaction. len > 1 reads the following registers
+ * @param dev   The device to read from
+ * @param index The first register
+ * @param buff  The data buffer to fill
+ * @param len   The length of the transaction in byte
+ * @return      0 on success
+ * @ingroup  cci_i2c
+ */
+int VL6180x_I2CMemRead(VL6180xDev_t dev, uint16_t index, uint8_t *buff, uint8_t len);
+
 
 /**
  * @brief Declare any required variables used by i2c lock (@a VL6180x_DoneI2CAccess() and @a VL6180x_GetI2CAccess())
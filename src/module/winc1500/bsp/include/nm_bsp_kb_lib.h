@@ -15,5 +15,65 @@
 #define NM_DEBUG                CONF_WINC_DEBUG
 #define NM_BSP_PRINTF           CONF_WINC_PRINTF
 
+/* HIF service task. See nm_bsp_hif_task_start() */
+#ifndef NM_BSP_HIF_TASK_STACK
+    #define NM_BSP_HIF_TASK_STACK   512         // words
+#endif
+#ifndef NM_BSP_HIF_TASK_PRIORITY
+    #define NM_BSP_HIF_TASK_PRIORITY 3
+#endif
+// The task also looks for events this often, in case an edge was lost
+#ifndef NM_BSP_HIF_POLL_MS
+    #define NM_BSP_HIF_POLL_MS      1000
+#endif
+
+/*
+ * Time from the IRQ line of the WINC1500 to the HIF events being handled,
+ * either by the HIF task or by a loop calling nm_bsp_hif_handle_events().
+ * Compare the two by running an application both ways.
+ */
+typedef struct {
+    uint32_t irq_num;                   // falling edges of the IRQ line
+    uint32_t dispatch_num;              // nm_bsp_hif_handle_events() with events
+    uint32_t empty_num;                 // ... with none: polled for nothing
+    uint32_t batch_max;                 // most edges handled in one call
+    uint32_t latency_min_us;            // edge to start of handling
+    uint32_t latency_max_us;
+    uint64_t latency_sum_us;            // over dispatch_num
+    uint64_t busy_us;                   // in calls with events
+    uint64_t empty_us;                  // in calls without: the CPU a polled loop wastes
+} nm_bsp_hif_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Handle every pending HIF event (m2m_wifi_handle_events()) and
+ *        count the time it took. For a polled main loop, instead of calling
+ *        m2m_wifi_handle_events() directly
+ */
+int8_t nm_bsp_hif_handle_events(void);
+
+void nm_bsp_hif_stats(nm_bsp_hif_stats_t *stats);
+void nm_bsp_hif_stats_reset(void);
+
+#ifdef KB_USE_FREERTOS
+/**
+ * @brief Handle the HIF events in a task woken by the IRQ line, so nothing
+ *        polls. After m2m_wifi_init(). The Wi-Fi and socket callbacks then
+ *        run in that task; other tasks calling the driver take
+ *        nm_bsp_hif_lock() around the calls
+ * @return 0, or -1 if the task could not be created
+ */
+int8_t nm_bsp_hif_task_start(void);
+void nm_bsp_hif_lock(void);
+void nm_bsp_hif_unlock(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
 
 #endif /* MODULE_WINC1500_BSP_INCLUDE_NM_BSP_KB_LIB_H_ */
@@ -53,6 +53,48 @@
 #include "kb_common_source.h"   // TODO: include it in conf_winc.h
 #include "kb_gpio.h"
 #include "kb_tick.h"
+#include <string.h>
+#include "driver/include/m2m_wifi.h"
+
+#ifdef KB_USE_FREERTOS
+    #include "FreeRTOS.h"
+    #include "task.h"
+    #include "semphr.h"
+
+static TaskHandle_t hif_task_ = NULL;
+static SemaphoreHandle_t hif_mutex_ = NULL;
+#endif
+
+static tpfNmBspIsr isr_ = NULL;
+static volatile uint8_t irq_pending_ = 0;   // edges since the last handling
+static volatile uint32_t irq_us_;           // time of the first of them
+static nm_bsp_hif_stats_t stats_;
+
+/*
+ *  @fn     irq_isr_
+ *  @brief  IRQ line of the WINC1500: the driver's ISR, then wake the HIF task
+ */
+static void irq_isr_(void)
+{
+    if (irq_pending_ == 0)
+    {
+        irq_us_ = kb_tick_us();
+    }
+    irq_pending_++;
+    stats_.irq_num++;
+    if (isr_ != NULL)
+    {
+        isr_();
+    }
+#ifdef KB_USE_FREERTOS
+    if (hif_task_ != NULL)
+    {
+        BaseType_t is_woken = pdFALSE;
+        vTaskNotifyGiveFromISR(hif_task_, &is_woken);
+        portYIELD_FROM_ISR(is_woken);
+    }
+#endif
+}
 
 /*
  *  @fn     init_chip_pins
@@ -79,7 +121,7 @@ static void init_chip_pins(void)
 sint8 nm_bsp_init(void)
 {
     /* Clear ISR function pointer */
-    kb_gpio_isr_delete(WINC_INT_PORT, WINC_INT_PIN);
+    kb_gpio_isr_deregister(WINC_INT_PORT, WINC_INT_PIN);
 
     /* Initialize chip IOs. */
     init_chip_pins();
@@ -148,11 +190,8 @@ void nm_bsp_sleep(uint32 u32TimeMsec)
 void nm_bsp_register_isr(tpfNmBspIsr pfIsr)
 {
     /* Register function pointer for ISR */
-    kb_gpio_init_t gpio_setting = {
-        .Pull = PULLUP,
-        .Speed = GPIO_SPEED_FREQ_VERY_HIGH // 50MHz
-    };
-    kb_gpio_isr_register(WINC_RESET_PORT, WINC_RESET_PIN, pfIsr);
+    isr_ = pfIsr;
+    kb_gpio_isr_register(WINC_INT_PORT, WINC_INT_PIN, irq_isr_);
 }
 
 /*
@@ -171,10 +210,121 @@ void nm_bsp_interrupt_ctrl(uint8 u8Enable)
             .Pull = PULLUP,
             .Speed = GPIO_SPEED_FREQ_VERY_HIGH // 50MHz
         };
-        kb_gpio_isr_enable(WINC_RESET_PORT, WINC_RESET_PIN, &gpio_setting, FALLING_EDGE);
+        kb_gpio_isr_enable(WINC_INT_PORT, WINC_INT_PIN, &gpio_setting, FALLING_EDGE);
     }
     else
     {
-        kb_gpio_isr_disable(WINC_RESET_PORT, WINC_RESET_PIN);
+        kb_gpio_isr_disable(WINC_INT_PORT, WINC_INT_PIN);
+    }
+}
+
+/*
+ *  @fn     nm_bsp_hif_handle_events
+ *  @brief  Handle the pending HIF events and count the time
+ */
+int8_t nm_bsp_hif_handle_events(void)
+{
+    uint32_t start = kb_tick_us();
+    uint32_t batch = irq_pending_;
+    uint32_t latency;
+    sint8 ret;
+
+    if (batch == 0)
+    {
+        // the driver only reads its own counter of edges, nothing else to do
+        ret = m2m_wifi_handle_events(NULL);
+        stats_.empty_num++;
+        stats_.empty_us += kb_tick_us() - start;
+        return ret;
+    }
+    latency = start - irq_us_;
+    irq_pending_ = 0;
+    ret = m2m_wifi_handle_events(NULL);
+
+    stats_.dispatch_num++;
+    if (batch > stats_.batch_max)
+    {
+        stats_.batch_max = batch;
+    }
+    if ((stats_.dispatch_num == 1) || (latency < stats_.latency_min_us))
+    {
+        stats_.latency_min_us = latency;
+    }
+    if (latency > stats_.latency_max_us)
+    {
+        stats_.latency_max_us = latency;
+    }
+    stats_.latency_sum_us += latency;
+    stats_.busy_us += kb_tick_us() - start;
+    return ret;
+}
+
+void nm_bsp_hif_stats(nm_bsp_hif_stats_t *stats)
+{
+    *stats = stats_;
+}
+
+void nm_bsp_hif_stats_reset(void)
+{
+    uint32_t irq_num = stats_.irq_num;
+
+    memset(&stats_, 0, sizeof(stats_));
+    stats_.irq_num = irq_num;
+}
+
+#ifdef KB_USE_FREERTOS
+static void hif_service_(void *arg)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(NM_BSP_HIF_POLL_MS));
+        // all events pending by now in one go; edges during it notify again
+        xSemaphoreTakeRecursive(hif_mutex_, portMAX_DELAY);
+        nm_bsp_hif_handle_events();
+        xSemaphoreGiveRecursive(hif_mutex_);
+    }
+}
+
+/*
+ *  @fn     nm_bsp_hif_task_start
+ *  @brief  Handle the HIF events in a task woken by the IRQ line
+ */
+int8_t nm_bsp_hif_task_start(void)
+{
+    if (hif_task_ != NULL)
+    {
+        return 0;
+    }
+    hif_mutex_ = xSemaphoreCreateRecursiveMutex();
+    if (hif_mutex_ == NULL)
+    {
+        return -1;
+    }
+    if (xTaskCreate(hif_service_, "winc_hif", NM_BSP_HIF_TASK_STACK, NULL,
+            NM_BSP_HIF_TASK_PRIORITY, &hif_task_) != pdPASS)
+    {
+        vSemaphoreDelete(hif_mutex_);
+        hif_mutex_ = NULL;
+        return -1;
+    }
+    // edges before the task existed
+    xTaskNotifyGive(hif_task_);
+    return 0;
+}
+
+void nm_bsp_hif_lock(void)
+{
+    if (hif_mutex_ != NULL)
+    {
+        xSemaphoreTakeRecursive(hif_mutex_, portMAX_DELAY);
+    }
+}
+
+void nm_bsp_hif_unlock(void)
+{
+    if (hif_mutex_ != NULL)
+    {
+        xSemaphoreGiveRecursive(hif_mutex_);
     }
 }
+#endif
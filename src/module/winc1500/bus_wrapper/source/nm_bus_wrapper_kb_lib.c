@@ -53,6 +53,7 @@
 
 #include "kb_spi.h"
 #include "kb_gpio.h"
+#include "kb_crc.h"
 
 #define NM_BUS_MAX_TRX_SZ   256
 
@@ -123,31 +124,30 @@ static sint8 nm_i2c_write_special(uint8 *wb1, uint16 sz1, uint8 *wb2, uint16 sz2
 
 #ifdef CONF_WINC_USE_SPI
 
+/*
+ * The dummy bytes clocked out while reading, and the bytes clocked in while
+ * writing. Static so that a DMA can reach them whatever the stack is.
+ */
+static uint8 gau8TxDummy[NM_BUS_MAX_TRX_SZ];
+static uint8 gau8RxDummy[NM_BUS_MAX_TRX_SZ];
+
 /**
- * @brief      write (send) data stream
+ * @brief      Full-duplex transfer of a data stream under one CS assertion,
+ *             in chunks of NM_BUS_MAX_TRX_SZ bytes (one DMA transfer each
+ *             when kb_spi runs in DMA mode)
  *
- * @param      pu8Mosi  1-byte MOSI stream, meaning output(to WINC1500) buffer
- * @param      pu8Miso  1-byte MISO stream, meaning input(from WINC1500) buffer
+ * @param      pu8Mosi  MOSI stream, meaning output(to WINC1500) buffer. NULL to send zeros
+ * @param      pu8Miso  MISO stream, meaning input(from WINC1500) buffer. NULL to discard
  * @param[in]  u16Sz    number of bytes to transfer
  *
  * @return     ZERO in case of success and M2M_ERR_BUS_FAIL in case of failure
  */
 static sint8 spi_rw(uint8* pu8Mosi, uint8* pu8Miso, uint16 u16Sz)
 {
-    uint8 u8Dummy = 0;
-    uint8 u8SkipMosi = 0, u8SkipMiso = 0;
-    uint16_t txd_data = 0;
-    uint16_t rxd_data = 0;
-
-    if (!pu8Mosi) {
-        pu8Mosi = &u8Dummy;
-        u8SkipMosi = 1;
-    }
-    else if(!pu8Miso) {
-        pu8Miso = &u8Dummy;
-        u8SkipMiso = 1;
-    }
-    else {
+    sint8 s8Ret = M2M_SUCCESS;
+    uint16 u16Chunk;
+
+    if ((!pu8Mosi) && (!pu8Miso)) {
         return M2M_ERR_BUS_FAIL;
     }
 
@@ -155,35 +155,26 @@ static sint8 spi_rw(uint8* pu8Mosi, uint8* pu8Miso, uint16 u16Sz)
     kb_gpio_set(WINC_SPI_CS_PORT, WINC_SPI_CS_PIN, GPIO_PIN_RESET);
 
     while (u16Sz) {
+        u16Chunk = (u16Sz > NM_BUS_MAX_TRX_SZ) ? NM_BUS_MAX_TRX_SZ : u16Sz;
+        if (kb_spi_sendreceive(WINC_SPI, (pu8Mosi) ? pu8Mosi : gau8TxDummy,
+                (pu8Miso) ? pu8Miso : gau8RxDummy, u16Chunk) != KB_OK) {
+            s8Ret = M2M_ERR_BUS_FAIL;
+            break;
+        }
 
-        /* Write Start */
-        txd_data = *pu8Mosi;
-        kb_spi_send(WINC_SPI, (uint8_t*)(&txd_data), 1);
-        /* Write End */
-
-        /* Read */
-        /* Read SPI master data register. */
-        kb_spi_receive(WINC_SPI, (uint8_t*)(&rxd_data), 1);
-        *pu8Miso = rxd_data;
-        /* Read end */
-
-        u16Sz--;
-        if (!u8SkipMiso) {
-            pu8Miso++;
+        u16Sz -= u16Chunk;
+        if (pu8Mosi) {
+            pu8Mosi += u16Chunk;
         }
-        if (!u8SkipMosi) {
-            pu8Mosi++;
+        if (pu8Miso) {
+            pu8Miso += u16Chunk;
         }
     }
-    /* ignore this code
-    while (!spi_is_write_complete(&master))
-        ;
-    */
 
     /* Deselect WINC1500 module by deselecting SS pin */
     kb_gpio_set(WINC_SPI_CS_PORT, WINC_SPI_CS_PIN, GPIO_PIN_SET);
 
-    return M2M_SUCCESS;
+    return s8Ret;
 }
 #endif
 
@@ -234,6 +225,10 @@ sint8 nm_bus_init(void *pvinit)
             .frequency = 12000000   // MAX 48MHz
     };
     kb_spi_init(WINC_SPI, &spi_init);
+    /* Whole chunks by DMA. Blocking transfers if its streams are taken */
+    kb_spi_dma_init(WINC_SPI);
+    // CRC unit for the protocol CRCs if there is one, software otherwise
+    kb_crc_init();
 
 
     nm_bsp_reset();
@@ -36,6 +36,8 @@
 #define WINC_SPI_MOSI_PIN              GPIO_PIN_5  /**< for SPI_MOSI pin */
 #define WINC_SPI_MISO_PORT             GPIOB /**< for SPI_MISO pin */
 #define WINC_SPI_MISO_PIN              GPIO_PIN_4  /**< for SPI_MISO pin */
+/** CRC7 of the commands and CRC16 of the data checked on both sides */
+#define CONF_WINC_SPI_CRC              (1)
 
 /* GPIO Pin Settings */
 /*
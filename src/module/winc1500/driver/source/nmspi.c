@@ -46,6 +46,11 @@
 
 #include "bus_wrapper/include/nm_bus_wrapper.h"
 #include "nmspi.h"
+#include "kb_crc.h"
+
+#ifndef CONF_WINC_SPI_CRC
+#define CONF_WINC_SPI_CRC		0
+#endif
 
 #define NMI_PERIPH_REG_BASE 0x1000
 #define NMI_INTR_REG_BASE (NMI_PERIPH_REG_BASE+0xa00)
@@ -117,53 +122,9 @@ static sint8 nmi_spi_write(uint8* b, uint16 sz)
 
 ********************************************/
 
-static const uint8 crc7_syndrome_table[256] = {
-	0x00, 0x09, 0x12, 0x1b, 0x24, 0x2d, 0x36, 0x3f,
-	0x48, 0x41, 0x5a, 0x53, 0x6c, 0x65, 0x7e, 0x77,
-	0x19, 0x10, 0x0b, 0x02, 0x3d, 0x34, 0x2f, 0x26,
-	0x51, 0x58, 0x43, 0x4a, 0x75, 0x7c, 0x67, 0x6e,
-	0x32, 0x3b, 0x20, 0x29, 0x16, 0x1f, 0x04, 0x0d,
-	0x7a, 0x73, 0x68, 0x61, 0x5e, 0x57, 0x4c, 0x45,
-	0x2b, 0x22, 0x39, 0x30, 0x0f, 0x06, 0x1d, 0x14,
-	0x63, 0x6a, 0x71, 0x78, 0x47, 0x4e, 0x55, 0x5c,
-	0x64, 0x6d, 0x76, 0x7f, 0x40, 0x49, 0x52, 0x5b,
-	0x2c, 0x25, 0x3e, 0x37, 0x08, 0x01, 0x1a, 0x13,
-	0x7d, 0x74, 0x6f, 0x66, 0x59, 0x50, 0x4b, 0x42,
-	0x35, 0x3c, 0x27, 0x2e, 0x11, 0x18, 0x03, 0x0a,
-	0x56, 0x5f, 0x44, 0x4d, 0x72, 0x7b, 0x60, 0x69,
-	0x1e, 0x17, 0x0c, 0x05, 0x3a, 0x33, 0x28, 0x21,
-	0x4f, 0x46, 0x5d, 0x54, 0x6b, 0x62, 0x79, 0x70,
-	0x07, 0x0e, 0x15, 0x1c, 0x23, 0x2a, 0x31, 0x38,
-	0x41, 0x48, 0x53, 0x5a, 0x65, 0x6c, 0x77, 0x7e,
-	0x09, 0x00, 0x1b, 0x12, 0x2d, 0x24, 0x3f, 0x36,
-	0x58, 0x51, 0x4a, 0x43, 0x7c, 0x75, 0x6e, 0x67,
-	0x10, 0x19, 0x02, 0x0b, 0x34, 0x3d, 0x26, 0x2f,
-	0x73, 0x7a, 0x61, 0x68, 0x57, 0x5e, 0x45, 0x4c,
-	0x3b, 0x32, 0x29, 0x20, 0x1f, 0x16, 0x0d, 0x04,
-	0x6a, 0x63, 0x78, 0x71, 0x4e, 0x47, 0x5c, 0x55,
-	0x22, 0x2b, 0x30, 0x39, 0x06, 0x0f, 0x14, 0x1d,
-	0x25, 0x2c, 0x37, 0x3e, 0x01, 0x08, 0x13, 0x1a,
-	0x6d, 0x64, 0x7f, 0x76, 0x49, 0x40, 0x5b, 0x52,
-	0x3c, 0x35, 0x2e, 0x27, 0x18, 0x11, 0x0a, 0x03,
-	0x74, 0x7d, 0x66, 0x6f, 0x50, 0x59, 0x42, 0x4b,
-	0x17, 0x1e, 0x05, 0x0c, 0x33, 0x3a, 0x21, 0x28,
-	0x5f, 0x56, 0x4d, 0x44, 0x7b, 0x72, 0x69, 0x60,
-	0x0e, 0x07, 0x1c, 0x15, 0x2a, 0x23, 0x38, 0x31,
-	0x46, 0x4f, 0x54, 0x5d, 0x62, 0x6b, 0x70, 0x79
-};
-
-
-static uint8 crc7_byte(uint8 crc, uint8 data)
-{
-	return crc7_syndrome_table[(crc << 1) ^ data];
-}
-
-static uint8 crc7(uint8 crc, const uint8 *buffer, uint32 len)
-{
-	while (len--)
-		crc = crc7_byte(crc, *buffer++);
-	return crc;
-}
+/* CRC7 of the commands, CRC16 of the data packets. See kb_crc.h */
+#define crc7(crc, buffer, len)		kb_crc7(crc, buffer, len)
+#define crc16(crc, buffer, len)		kb_crc16(crc, buffer, len)
 
 /********************************************
 
@@ -322,6 +283,7 @@ static sint8 spi_data_read(uint8 *b, uint16 sz,uint8 clockless)
 	sint16 retry, ix, nbytes;
 	sint8 result = N_OK;
 	uint8 crc[2];
+	uint16 u16Crc;
 	uint8 rsp;
 
 	/**
@@ -376,6 +338,13 @@ static sint8 spi_data_read(uint8 *b, uint16 sz,uint8 clockless)
 					result = N_FAIL;
 					break;
 				}
+				u16Crc = crc16(KB_CRC16_INIT, &b[ix], nbytes);
+				if ((crc[0] != (uint8)(u16Crc >> 8)) || (crc[1] != (uint8)u16Crc)) {
+					M2M_ERR("[nmi spi]: Failed data block crc check (%02x%02x, %04x)\n",
+						crc[0], crc[1], u16Crc);
+					result = N_FAIL;
+					break;
+				}
 			}
 		}
 		ix += nbytes;
@@ -392,6 +361,7 @@ static sint8 spi_data_write(uint8 *b, uint16 sz)
 	uint16 nbytes;
 	sint8 result = 1;
 	uint8 cmd, order, crc[2] = {0};
+	uint16 u16Crc;
 	//uint8 rsp;
 
 	/**
@@ -439,6 +409,9 @@ static sint8 spi_data_write(uint8 *b, uint16 sz)
 			Write Crc
 		**/
 		if (!gu8Crc_off) {
+			u16Crc = crc16(KB_CRC16_INIT, &b[ix], nbytes);
+			crc[0] = (uint8)(u16Crc >> 8);
+			crc[1] = (uint8)u16Crc;
 			if (M2M_SUCCESS != nmi_spi_write(crc, 2)) {
 				M2M_ERR("[nmi spi]: Failed data block crc write, bus error...\n");
 				result = N_FAIL;
@@ -713,17 +686,18 @@ sint8 nm_spi_init(void)
 			return 0;
 		}
 	}
-	if(gu8Crc_off == 0)
-	{
-		reg &= ~0xc;	/* disable crc checking */
-		reg &= ~0x70;
-		reg |= (0x5 << 4);
-		if (!spi_write_reg(NMI_SPI_PROTOCOL_CONFIG, reg)) {
-			M2M_ERR( "[nmi spi]: Failed internal write protocol reg...\n");
-			return 0;
-		}
-		gu8Crc_off = 1;
+#if CONF_WINC_SPI_CRC
+	reg |= 0xc;		/* enable crc7 of commands and crc16 of data */
+#else
+	reg &= ~0xc;	/* disable crc checking */
+#endif
+	reg &= ~0x70;
+	reg |= (0x5 << 4);
+	if (!spi_write_reg(NMI_SPI_PROTOCOL_CONFIG, reg)) {
+		M2M_ERR( "[nmi spi]: Failed internal write protocol reg...\n");
+		return 0;
 	}
+	gu8Crc_off = !CONF_WINC_SPI_CRC;
 
 	/**
 		make sure can read back chip id correctly
@@ -0,0 +1,539 @@
+/*
+ * SpiBench.c
+ *
+ *  Host-side (Linux) throughput benchmark of nm_spi_read_block() and
+ *  nm_spi_write_block(). The real nmspi.c and SPI bus wrapper
+ *  (nm_bus_wrapper_kb_lib.c) run against a simulated WINC1500: kb_spi
+ *  feeds each byte to a model of its SPI slave, which checks the command
+ *  CRC7 and the data CRC16, answers the commands with the CRC16 of the data
+ *  and keeps the memory the blocks go to. The CRCs and the data packet size
+ *  follow the protocol register as nm_spi_init() writes it; at reset the
+ *  model has the CRCs on and 256-byte packets, so a missed write shows.
+ *  Every block is written, read back and compared.
+ *
+ *  The time of a block is modeled from what the wrapper asks of kb_spi
+ *  (calls and bytes): 12 MHz SCK, plus a cost per call. The costs are
+ *  estimates for a 180 MHz STM32F446, to be replaced by measurements on
+ *  the target. For comparison, the per-byte wrapper this one replaced made
+ *  a kb_spi_send() and a kb_spi_receive() of 1 byte for each byte, which
+ *  clocked 2 bytes on the bus.
+ *
+ *  Usage: winc-spi [call_ns] [dma_ns]
+ *      call_ns  cost of a blocking HAL_SPI_* call besides its bytes (1500)
+ *      dma_ns   cost of starting a DMA transfer and taking its end (3000)
+ *  Build: make winc-spi (at the top of the repository)
+ */
+
+#include "common/include/nm_common.h"
+#include "bus_wrapper/include/nm_bus_wrapper.h"
+#include "driver/source/nmspi.h"
+#include "conf_winc.h"
+#include "kb_spi.h"
+#include "kb_gpio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_MEM_SIZE        (64 * 1024)
+#define SIM_OUT_SIZE        (32 * 1024)
+#define SIM_REG_CHIPID      0x1000
+#define SIM_REG_PROTOCOL    0xe824          // NMI_SPI_PROTOCOL_CONFIG
+#define SIM_CHIPID          0x1503a0
+#define SIM_PROTOCOL_RESET  0x0c            // CRCs on, 256-byte packets
+#define SIM_PROTOCOL_CRC    0x0c            // CRC7 of commands and CRC16 of data
+#define SIM_PROTOCOL_8K     (0x5 << 4)      // DATA_PKT_SZ of nmspi.c
+#define SIM_BYTE_NS         (8000.0 / 12.0) // 12 MHz
+
+GPIO_TypeDef host_gpio_[8];
+SPI_TypeDef host_spi_[4];
+
+typedef enum {
+    SIM_IDLE,
+    SIM_CMD,                        // receiving a command
+    SIM_DATA_CMD,                   // waiting for the data packet command of a write
+    SIM_DATA,                       // receiving the data of a write
+    SIM_DATA_CRC
+} sim_state_t;
+
+// WINC1500 SPI slave
+typedef struct {
+    uint8_t mem[SIM_MEM_SIZE];
+    uint8_t out[SIM_OUT_SIZE];      // MISO bytes to answer
+    uint32_t out_head;
+    uint32_t out_tail;
+    sim_state_t state;
+    uint8_t cmd[9];
+    uint8_t cmd_len;
+    uint8_t cmd_num;
+    uint32_t protocol;              // SIM_REG_PROTOCOL
+    uint32_t address;
+    uint32_t left;                  // of the write
+    uint32_t pkt_left;
+    uint8_t crc_left;
+    uint16_t crc;                   // of the data packet being written
+    uint16_t crc_rx;
+    uint32_t error_num;
+    uint32_t reset_num;
+    uint8_t is_corrupt;             // flip a bit of the next data read
+} sim_winc_t;
+
+// what the wrapper asked of kb_spi
+typedef struct {
+    uint32_t cs_num;
+    uint32_t call_num;
+    uint32_t byte_num;
+    uint8_t is_selected;
+} sim_bus_t;
+
+static sim_winc_t winc_;
+static sim_bus_t bus_;
+
+/* The CRC7 of the commands, bit by bit to cross-check the table of nmspi.c */
+static uint8_t crc7_(const uint8_t *buf, uint32_t len)
+{
+    uint8_t crc = 0x7f;
+    uint32_t i;
+    int bit;
+
+    for (i = 0; i < len; i++)
+    {
+        for (bit = 7; bit >= 0; bit--)
+        {
+            uint8_t in = ((buf[i] >> bit) & 1) ^ ((crc >> 6) & 1);
+            crc = (uint8_t)((crc << 1) & 0x7f);
+            if (in)
+            {
+                crc ^= 0x09;
+            }
+        }
+    }
+    return crc;
+}
+
+/* The CRC16 of the data, bit by bit */
+static uint16_t crc16_(uint16_t crc, uint8_t byte)
+{
+    int bit;
+
+    crc ^= (uint16_t)(byte << 8);
+    for (bit = 0; bit < 8; bit++)
+    {
+        crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+static int crc_on_(void)
+{
+    return (winc_.protocol & SIM_PROTOCOL_CRC) != 0;
+}
+
+static uint32_t pkt_sz_(void)
+{
+    return 256u << ((winc_.protocol >> 4) & 0x7);
+}
+
+/* With the CRC7 byte, which is left out with the CRCs off */
+static uint8_t cmd_len_(uint8_t cmd)
+{
+    switch (cmd)
+    {
+    case 0xc1: case 0xc2:                       return 7;
+    case 0xc3: case 0xc7: case 0xc8:            return 8;
+    case 0xc9:                                  return 9;
+    case 0xc4: case 0xc5: case 0xc6: case 0xca: case 0xcf:
+                                                return 5;
+    default:                                    return 0;
+    }
+}
+
+static void out_(uint8_t byte)
+{
+    if ((winc_.out_tail - winc_.out_head) >= SIM_OUT_SIZE)
+    {
+        winc_.error_num++;
+        return;
+    }
+    winc_.out[winc_.out_tail++ % SIM_OUT_SIZE] = byte;
+}
+
+/* Data packets of a read: a header, the data and, with the CRCs on, a CRC16 */
+static void out_data_(const uint8_t *data, uint32_t wrap, uint32_t start, uint32_t size)
+{
+    uint32_t pkt_sz = pkt_sz_();
+    uint16_t crc = 0xffff;
+    uint32_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        uint8_t byte = data[(start + i) % wrap];
+
+        if ((i % pkt_sz) == 0)
+        {
+            out_(0xf3);
+            crc = 0xffff;
+        }
+        crc = crc16_(crc, byte);
+        if (winc_.is_corrupt)
+        {
+            byte ^= 0x10;
+            winc_.is_corrupt = 0;
+        }
+        out_(byte);
+        if (crc_on_() && (((i + 1) % pkt_sz == 0) || (i + 1 == size)))
+        {
+            out_((uint8_t)(crc >> 8));
+            out_((uint8_t)crc);
+        }
+    }
+}
+
+static void sim_register_(uint8_t cmd, uint32_t address, uint32_t value)
+{
+    uint8_t data[4];
+
+    if (cmd == 0xc9)
+    {
+        // in effect from the next command
+        if (address == SIM_REG_PROTOCOL)
+        {
+            winc_.protocol = value;
+        }
+        return;
+    }
+    value = (address == SIM_REG_CHIPID) ? SIM_CHIPID
+            : (address == SIM_REG_PROTOCOL) ? winc_.protocol : 0;
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+    data[2] = (uint8_t)(value >> 16);
+    data[3] = (uint8_t)(value >> 24);
+    out_data_(data, 4, 0, 4);
+}
+
+static void sim_command_(void)
+{
+    uint8_t *c = winc_.cmd;
+    uint32_t size;
+
+    if (crc_on_() && ((c[winc_.cmd_len - 1] >> 1) != crc7_(c, winc_.cmd_len - 1)))
+    {
+        printf("command %02x: bad CRC7\r\n", c[0]);
+        winc_.error_num++;
+        winc_.state = SIM_IDLE;
+        return;
+    }
+    winc_.cmd_num++;
+    winc_.state = SIM_IDLE;
+    if (c[0] == 0xcf)
+    {
+        // nmspi resets the slave after a failed transfer
+        winc_.out_head = winc_.out_tail;
+        winc_.reset_num++;
+        return;
+    }
+    // the command and state responses
+    out_(c[0]);
+    out_(0x00);
+    winc_.address = ((uint32_t)c[1] << 16) | ((uint32_t)c[2] << 8) | c[3];
+    if ((c[0] == 0xc9) || (c[0] == 0xca))
+    {
+        // single registers, by nm_spi_init()
+        sim_register_(c[0], winc_.address, ((uint32_t)c[4] << 24) | ((uint32_t)c[5] << 16)
+                | ((uint32_t)c[6] << 8) | c[7]);
+        return;
+    }
+    if ((c[0] != 0xc7) && (c[0] != 0xc8))
+    {
+        // other commands are not used here
+        return;
+    }
+    size = ((uint32_t)c[4] << 16) | ((uint32_t)c[5] << 8) | c[6];
+    if (c[0] == 0xc8)
+    {
+        out_data_(winc_.mem, SIM_MEM_SIZE, winc_.address, size);
+    }
+    else
+    {
+        winc_.left = size;
+        winc_.state = SIM_DATA_CMD;
+    }
+}
+
+/**
+ * @brief One byte on the bus: @mosi in, the returned byte out
+ */
+static uint8_t sim_exchange_(uint8_t mosi)
+{
+    // while answering, the master clocks dummy bytes
+    if (winc_.out_head != winc_.out_tail)
+    {
+        return winc_.out[winc_.out_head++ % SIM_OUT_SIZE];
+    }
+    switch (winc_.state)
+    {
+    case SIM_IDLE:
+        if (mosi == 0x00)
+        {
+            break;      // a read past the answer
+        }
+        winc_.cmd_len = cmd_len_(mosi);
+        if (winc_.cmd_len == 0)
+        {
+            printf("unknown command %02x\r\n", mosi);
+            winc_.error_num++;
+            break;
+        }
+        winc_.cmd_len -= crc_on_() ? 0 : 1;
+        winc_.cmd[0] = mosi;
+        winc_.cmd_num = 1;
+        winc_.state = SIM_CMD;
+        break;
+    case SIM_CMD:
+        winc_.cmd[winc_.cmd_num++] = mosi;
+        if (winc_.cmd_num == winc_.cmd_len)
+        {
+            winc_.cmd_num = 0;
+            sim_command_();
+        }
+        break;
+    case SIM_DATA_CMD:
+        if ((mosi & 0xf0) != 0xf0)
+        {
+            printf("bad data packet command %02x\r\n", mosi);
+            winc_.error_num++;
+            winc_.state = SIM_IDLE;
+            break;
+        }
+        winc_.pkt_left = (winc_.left < pkt_sz_()) ? winc_.left : pkt_sz_();
+        winc_.crc = 0xffff;
+        winc_.state = SIM_DATA;
+        break;
+    case SIM_DATA:
+        winc_.mem[winc_.address++ % SIM_MEM_SIZE] = mosi;
+        winc_.crc = crc16_(winc_.crc, mosi);
+        winc_.left--;
+        if ((--winc_.pkt_left == 0) && crc_on_())
+        {
+            winc_.crc_left = 2;
+            winc_.state = SIM_DATA_CRC;
+        }
+        else if (winc_.pkt_left == 0)
+        {
+            winc_.state = (winc_.left != 0) ? SIM_DATA_CMD : SIM_IDLE;
+        }
+        break;
+    case SIM_DATA_CRC:
+        winc_.crc_rx = (uint16_t)((winc_.crc_rx << 8) | mosi);
+        if (--winc_.crc_left == 0)
+        {
+            if (winc_.crc_rx != winc_.crc)
+            {
+                printf("data packet: bad CRC16 %04x, expected %04x\r\n", winc_.crc_rx, winc_.crc);
+                winc_.error_num++;
+            }
+            winc_.state = (winc_.left != 0) ? SIM_DATA_CMD : SIM_IDLE;
+        }
+        break;
+    }
+    return 0xff;
+}
+
+/******************************************************************************
+ * kb_gpio, kb_spi and the BSP of the host
+ ******************************************************************************/
+
+void kb_gpio_init(kb_gpio_port_t port, kb_gpio_pin_t pin, kb_gpio_init_t *gpio_init)
+{
+}
+
+void kb_gpio_set(kb_gpio_port_t port, kb_gpio_pin_t pin, kb_gpio_state_t state)
+{
+    if ((port == WINC_SPI_CS_PORT) && (pin == WINC_SPI_CS_PIN))
+    {
+        if ((state == GPIO_PIN_RESET) && !bus_.is_selected)
+        {
+            bus_.cs_num++;
+        }
+        bus_.is_selected = (state == GPIO_PIN_RESET);
+    }
+}
+
+int kb_spi_init(kb_spi_t spi, kb_spi_init_t *settings)
+{
+    return KB_OK;
+}
+
+int kb_spi_dma_init(kb_spi_t spi)
+{
+    return KB_OK;
+}
+
+int kb_spi_mosi_pin(kb_spi_t spi, kb_gpio_port_t port, kb_gpio_pin_t pin, kb_gpio_pull_t pull)
+{
+    return KB_OK;
+}
+
+int kb_spi_miso_pin(kb_spi_t spi, kb_gpio_port_t port, kb_gpio_pin_t pin, kb_gpio_pull_t pull)
+{
+    return KB_OK;
+}
+
+int kb_spi_sck_pin(kb_spi_t spi, kb_gpio_port_t port, kb_gpio_pin_t pin, kb_gpio_pull_t pull)
+{
+    return KB_OK;
+}
+
+int kb_spi_sendreceive(kb_spi_t spi, uint8_t *tx_buf, uint8_t *rx_buf, uint16_t size)
+{
+    uint16_t i;
+
+    if ((spi != WINC_SPI) || !bus_.is_selected)
+    {
+        printf("transfer without the WINC1500 selected\r\n");
+        winc_.error_num++;
+        return KB_ERROR;
+    }
+    bus_.call_num++;
+    bus_.byte_num += size;
+    for (i = 0; i < size; i++)
+    {
+        rx_buf[i] = sim_exchange_(tx_buf[i]);
+    }
+    return KB_OK;
+}
+
+void nm_bsp_reset(void)
+{
+}
+
+void nm_bsp_sleep(uint32 u32TimeMsec)
+{
+}
+
+/******************************************************************************
+ * Benchmark
+ ******************************************************************************/
+
+static double call_ns_ = 1500.0;
+static double dma_ns_ = 3000.0;
+
+typedef struct {
+    uint32_t cs_num;
+    uint32_t call_num;
+    uint32_t byte_num;
+} bench_count_t;
+
+static void count_start_(void)
+{
+    memset(&bus_, 0, sizeof(bus_));
+}
+
+static bench_count_t count_end_(void)
+{
+    bench_count_t count = {bus_.cs_num, bus_.call_num, bus_.byte_num};
+    return count;
+}
+
+/**
+ * @brief Print the modeled time of the bus traffic of a @size block
+ */
+static void report_(const char *name, uint16_t size, bench_count_t count)
+{
+    // per-byte: 2 calls and 2 bytes clocked per byte
+    double byte_ns = (double)count.byte_num * (2 * call_ns_ + 2 * SIM_BYTE_NS);
+    double block_ns = (double)count.call_num * call_ns_ + (double)count.byte_num * SIM_BYTE_NS;
+    double dma_ns = (double)count.call_num * dma_ns_ + (double)count.byte_num * SIM_BYTE_NS;
+
+    printf("%-6s %5u B: %2u CS, %3u calls, %5u B on bus | per-byte %8.1f us %5.3f MB/s"
+            " | chunk %7.1f us %5.3f MB/s | DMA %7.1f us %5.3f MB/s, CPU %5.1f us\r\n",
+            name, size, count.cs_num, count.call_num, count.byte_num,
+            byte_ns / 1000.0, size * 1000.0 / byte_ns,
+            block_ns / 1000.0, size * 1000.0 / block_ns,
+            dma_ns / 1000.0, size * 1000.0 / dma_ns, count.call_num * dma_ns_ / 1000.0);
+}
+
+int main(int argc, char *argv[])
+{
+    static const uint16_t size_list[] = {4, 64, 256, 1024, 1460, 4096, 8192, 16384};
+    static uint8_t tx[16384];
+    static uint8_t rx[16384];
+    uint32_t failures = 0;
+    uint32_t i, j;
+
+    if (argc > 1)
+    {
+        call_ns_ = atof(argv[1]);
+    }
+    if (argc > 2)
+    {
+        dma_ns_ = atof(argv[2]);
+    }
+    printf("SCK 12 MHz, %.0f ns per blocking call, %.0f ns per DMA transfer (modeled)\r\n",
+            call_ns_, dma_ns_);
+
+    winc_.protocol = SIM_PROTOCOL_RESET;
+    nm_bus_init(NULL);
+    if (nm_spi_init() != M2M_SUCCESS)
+    {
+        printf("nm_spi_init() failed\r\n");
+        failures++;
+    }
+    if ((winc_.protocol & 0x7c) != (SIM_PROTOCOL_CRC | SIM_PROTOCOL_8K))
+    {
+        printf("protocol register %08x: not CRCs on with 8K packets\r\n", winc_.protocol);
+        failures++;
+    }
+    for (i = 0; i < sizeof(size_list) / sizeof(size_list[0]); i++)
+    {
+        uint16_t size = size_list[i];
+        uint32_t address = 0x1000 + 0x10 * i;
+        bench_count_t write_count, read_count;
+
+        for (j = 0; j < size; j++)
+        {
+            tx[j] = (uint8_t)(j * 7 + i);
+        }
+        memset(rx, 0, size);
+
+        count_start_();
+        if (nm_spi_write_block(address, tx, size) != M2M_SUCCESS)
+        {
+            failures++;
+        }
+        write_count = count_end_();
+
+        count_start_();
+        if (nm_spi_read_block(address, rx, size) != M2M_SUCCESS)
+        {
+            failures++;
+        }
+        read_count = count_end_();
+
+        if (memcmp(tx, rx, size) != 0)
+        {
+            printf("%u B: read back differs\r\n", size);
+            failures++;
+        }
+        report_("write", size, write_count);
+        report_("read", size, read_count);
+    }
+
+    // a bit flipped on MISO is caught by the CRC16, and the bus recovers
+    winc_.is_corrupt = 1;
+    if (nm_spi_read_block(0x1000, rx, 256) == M2M_SUCCESS)
+    {
+        printf("corrupted read not detected\r\n");
+        failures++;
+    }
+    if ((nm_spi_read_block(0x1000, rx, 256) != M2M_SUCCESS) || (winc_.reset_num != 1))
+    {
+        printf("no recovery after the corrupted read\r\n");
+        failures++;
+    }
+    printf("corrupted read: detected, %u reset\r\n", winc_.reset_num);
+    failures += winc_.error_num;
+
+    printf("%u failed\r\n", failures);
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,15 @@
+/*
+ * kb_config.h
+ *
+ *  Host build of the WINC1500 SPI benchmark (SpiBench.c): the device of
+ *  the library without the HAL. stm32f4xx.h and stm32f4xx_hal_def.h next
+ *  to it stand in for the CMSIS and HAL headers.
+ */
+
+#ifndef WINC1500_HOST_KB_CONFIG_H_
+#define WINC1500_HOST_KB_CONFIG_H_
+
+#define STM32F446xx
+#define USE_HAL_DRIVER
+
+#endif /* WINC1500_HOST_KB_CONFIG_H_ */
@@ -0,0 +1,69 @@
+/*
+ * stm32f4xx.h
+ *
+ *  Host stand-in for the CMSIS device header: only what kb_gpio.h,
+ *  kb_spi.h and the WINC1500 bus wrapper use. See kb_config.h.
+ */
+
+#ifndef WINC1500_HOST_STM32F4XX_H_
+#define WINC1500_HOST_STM32F4XX_H_
+
+#include <stdint.h>
+
+typedef struct { uint32_t reg; } GPIO_TypeDef;
+typedef struct { uint32_t reg; } SPI_TypeDef;
+
+extern GPIO_TypeDef host_gpio_[8];
+extern SPI_TypeDef host_spi_[4];
+
+#define GPIOA   (&host_gpio_[0])
+#define GPIOB   (&host_gpio_[1])
+#define GPIOC   (&host_gpio_[2])
+#define GPIOD   (&host_gpio_[3])
+#define GPIOE   (&host_gpio_[4])
+#define GPIOF   (&host_gpio_[5])
+#define GPIOG   (&host_gpio_[6])
+#define GPIOH   (&host_gpio_[7])
+#define SPI1    (&host_spi_[0])
+#define SPI2    (&host_spi_[1])
+#define SPI3    (&host_spi_[2])
+#define SPI4    (&host_spi_[3])
+
+#define GPIO_PIN_0      ((uint16_t)0x0001)
+#define GPIO_PIN_1      ((uint16_t)0x0002)
+#define GPIO_PIN_2      ((uint16_t)0x0004)
+#define GPIO_PIN_3      ((uint16_t)0x0008)
+#define GPIO_PIN_4      ((uint16_t)0x0010)
+#define GPIO_PIN_5      ((uint16_t)0x0020)
+#define GPIO_PIN_6      ((uint16_t)0x0040)
+#define GPIO_PIN_7      ((uint16_t)0x0080)
+#define GPIO_PIN_8      ((uint16_t)0x0100)
+#define GPIO_PIN_9      ((uint16_t)0x0200)
+#define GPIO_PIN_10     ((uint16_t)0x0400)
+#define GPIO_PIN_11     ((uint16_t)0x0800)
+#define GPIO_PIN_12     ((uint16_t)0x1000)
+#define GPIO_PIN_13     ((uint16_t)0x2000)
+#define GPIO_PIN_14     ((uint16_t)0x4000)
+#define GPIO_PIN_15     ((uint16_t)0x8000)
+#define GPIO_PIN_All    ((uint16_t)0xFFFF)
+
+#define GPIO_NOPULL                 0x00000000U
+#define GPIO_PULLUP                 0x00000001U
+#define GPIO_PULLDOWN               0x00000002U
+#define GPIO_MODE_OUTPUT_PP         0x00000001U
+#define GPIO_SPEED_FREQ_VERY_HIGH   0x00000003U
+
+typedef struct {
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+    uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+#endif /* WINC1500_HOST_STM32F4XX_H_ */
@@ -0,0 +1,19 @@
+/*
+ * stm32f4xx_hal_def.h
+ *
+ *  Host stand-in for the HAL definitions. See kb_config.h.
+ */
+
+#ifndef WINC1500_HOST_STM32F4XX_HAL_DEF_H_
+#define WINC1500_HOST_STM32F4XX_HAL_DEF_H_
+
+typedef enum {
+    HAL_OK       = 0x00U,
+    HAL_ERROR    = 0x01U,
+    HAL_BUSY     = 0x02U,
+    HAL_TIMEOUT  = 0x03U
+} HAL_StatusTypeDef;
+
+#define HAL_MAX_DELAY      0xFFFFFFFFU
+
+#endif /* WINC1500_HOST_STM32F4XX_HAL_DEF_H_ */
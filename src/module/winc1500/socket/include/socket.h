@@ -662,6 +662,7 @@ typedef struct{
 	uint8					*pu8Buffer;
 	/*!<
 		Pointer to the USER buffer (passed to @ref recv and @ref recvfrom function) containing the received data chunk.
+		After @ref socketRecvPoolInit, it points into a pool block instead whenever one is free. See @ref socketRecvRetain.
 	*/
 	sint16					s16BufferSize;
 	/*!<
@@ -679,6 +680,37 @@ typedef struct{
 }tstrSocketRecvMsg;
 
 
+/*!
+@struct	\
+	tstrSocketRecvStats
+
+@brief	Receive counters, returned by @ref socketRecvStats.
+
+	Chunks in pool blocks are read by the SPI DMA straight into the block and can be kept by the application
+	with @ref socketRecvRetain. Chunks in the USER buffer are overwritten by the next one, so the application
+	has to copy what it keeps.
+*/
+typedef struct{
+	uint32	u32PoolChunks;
+	/*!< Chunks delivered in pool blocks. */
+	uint32	u32PoolBytes;
+	uint32	u32BufferChunks;
+	/*!< Chunks delivered in the USER buffer, to be copied by the application. */
+	uint32	u32BufferBytes;
+	uint32	u32Retained;
+	/*!< Chunks kept by the application with @ref socketRecvRetain instead of copied. */
+	uint32	u32PoolEmpty;
+	/*!< Chunks that found no free block and went to the USER buffer (or were dropped). */
+	uint32	u32Dropped;
+	/*!< Bytes dropped for having neither a free block nor a USER buffer. */
+	uint16	u16BlockSize;
+	uint8	u8BlockNum;
+	uint8	u8BlocksInUse;
+	uint8	u8BlocksInUseMax;
+	/*!< The most blocks in use at once. The pool memory bounds the RAM used for receiving. */
+}tstrSocketRecvStats;
+
+
 /*!
 @typedef \
 	tpfAppSocketCb
@@ -1425,6 +1457,77 @@ NMI_API sint8 connect(SOCKET sock, struct sockaddr *pstrAddr, uint8 u8AddrLen);
 */
 NMI_API sint16 recv(SOCKET sock, void *pvRecvBuf, uint16 u16BufLen, uint32 u32Timeoutmsec);
 /** @} */
+/** @defgroup ReceivePoolFn socketRecvPoolInit
+ *    @ingroup SocketAPI
+ * 	Zero-copy receive. The received data is read into blocks of a pool given by the application and passed to the
+	socket callback in place. The socket layer holds a reference to the block during the callback only; to keep the
+	data longer, the callback takes one with @ref socketRecvRetain and gives it back with @ref socketRecvRelease,
+	from any task, when done. When no block is free, the chunk goes to the USER buffer of @ref recv as before.
+	The pool memory bounds the RAM taken by received data.
+ */
+ /**@{*/
+/*!
+@fn	\
+	NMI_API sint8 socketRecvPoolInit(uint8 *pu8Memory, uint16 u16BlockSize, uint8 u8BlockNum);
+
+@param [in]	pu8Memory
+				u16BlockSize * u8BlockNum bytes, resident in memory (global buffer).
+
+@param [in]	u16BlockSize
+				Largest chunk passed to the callback. Larger receptions are delivered in several chunks.
+
+@param [in]	u8BlockNum
+				Number of blocks, at most 32.
+
+@return
+	SOCK_ERR_NO_ERROR, or SOCK_ERR_INVALID_ARG for a bad pool.
+	With the pool, @ref recv and @ref recvfrom also accept a NULL buffer.
+\section Example
+@code
+	static uint8 gau8RxPool[8 * 1460];
+
+	socketRecvPoolInit(gau8RxPool, 1460, 8);
+	...
+	case SOCKET_MSG_RECV:
+		{
+			tstrSocketRecvMsg	*pstrRx = (tstrSocketRecvMsg*)pvMsg;
+
+			if((pstrRx->s16BufferSize > 0) && (socketRecvRetain(pstrRx->pu8Buffer) == SOCK_ERR_NO_ERROR))
+			{
+				// the telemetry task calls socketRecvRelease(pu8Buffer) when it is done
+				xQueueSend(xTelemetryQueue, &pstrRx->pu8Buffer, 0);
+			}
+		}
+		break;
+@endcode
+*/
+NMI_API sint8 socketRecvPoolInit(uint8 *pu8Memory, uint16 u16BlockSize, uint8 u8BlockNum);
+/*!
+@fn	\
+	NMI_API sint8 socketRecvRetain(uint8 *pu8Buffer);
+
+@brief	Keep the block of a received chunk after the callback returns. Called in the socket callback.
+@param [in]	pu8Buffer
+				Anywhere in the chunk, e.g. pu8Buffer of @ref tstrSocketRecvMsg.
+@return
+	SOCK_ERR_NO_ERROR, or SOCK_ERR_INVALID_ARG if the chunk is not in a pool block (it is in the USER buffer).
+*/
+NMI_API sint8 socketRecvRetain(uint8 *pu8Buffer);
+/*!
+@fn	\
+	NMI_API sint8 socketRecvRelease(uint8 *pu8Buffer);
+
+@brief	Give back a block kept with @ref socketRecvRetain. Safe from any task.
+*/
+NMI_API sint8 socketRecvRelease(uint8 *pu8Buffer);
+/*!
+@fn	\
+	NMI_API void socketRecvStats(tstrSocketRecvStats *pstrStats);
+
+@brief	Copy out the receive counters, reset by @ref socketRecvPoolInit.
+*/
+NMI_API void socketRecvStats(tstrSocketRecvStats *pstrStats);
+/** @} */
 /** @defgroup ReceiveFromSocketFn recvfrom
  *   @ingroup SocketAPI
  * 	Recieves data from a UDP Scoket.
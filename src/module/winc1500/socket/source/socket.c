@@ -48,6 +48,7 @@ INCLUDES
 #include "driver/source/m2m_hif.h"
 #include "socket/source/socket_internal.h"
 #include "driver/include/m2m_types.h"
+#include "kb_pool.h"
 
 /*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*
 MACROS
@@ -120,6 +121,11 @@ volatile tpfAppResolveCb		gpfAppResolveCb;
 volatile uint8					gbSocketInit = 0;
 volatile tpfPingCb				gfpPingCb;
 
+/* Receive blocks of socketRecvPoolInit */
+static kb_pool_t				gstrRecvPool;
+static uint8					gbRecvPoolInit = 0;
+static tstrSocketRecvStats		gstrRecvStats;
+
 /*********************************************************************
 Function
 		Socket_ReadSocketData
@@ -143,30 +149,72 @@ Date
 NMI_API void Socket_ReadSocketData(SOCKET sock, tstrSocketRecvMsg *pstrRecv,uint8 u8SocketMsg,
 								  uint32 u32StartAddress,uint16 u16ReadCount)
 {
-	if((u16ReadCount > 0) && (gastrSockets[sock].pu8UserBuffer != NULL) && (gastrSockets[sock].u16UserBufferSize > 0) && (gastrSockets[sock].bIsUsed == 1))
+	uint8	bHasBuffer = (gastrSockets[sock].pu8UserBuffer != NULL) && (gastrSockets[sock].u16UserBufferSize > 0);
+
+	if((u16ReadCount > 0) && (bHasBuffer || gbRecvPoolInit) && (gastrSockets[sock].bIsUsed == 1))
 	{
 		uint32	u32Address = u32StartAddress;
 		uint16	u16Read;
-		sint16	s16Diff;
+		uint16	u16Size;
+		uint8	*pu8Buffer;
+		uint8	*pu8Block;
 		uint8	u8SetRxDone;
 
 		pstrRecv->u16RemainingSize = u16ReadCount;
 		do
 		{
+			/* Into a pool block if there is one free, so the application can keep
+			the chunk without copying it. Otherwise into the recv buffer.
+			*/
+			pu8Block = NULL;
+			if(gbRecvPoolInit)
+			{
+				pu8Block = kb_pool_alloc(&gstrRecvPool);
+				if(pu8Block == NULL)
+					gstrRecvStats.u32PoolEmpty++;
+			}
+			if(pu8Block != NULL)
+			{
+				pu8Buffer	= pu8Block;
+				u16Size		= (uint16)gstrRecvPool.block_size;
+			}
+			else if(bHasBuffer)
+			{
+				pu8Buffer	= gastrSockets[sock].pu8UserBuffer;
+				u16Size		= gastrSockets[sock].u16UserBufferSize;
+			}
+			else
+			{
+				M2M_ERR("No receive block, %d bytes dropped\n", u16ReadCount);
+				gstrRecvStats.u32Dropped += u16ReadCount;
+				hif_receive(0, NULL, 0, 1);
+				break;
+			}
+
 			u8SetRxDone = 1;
 			u16Read = u16ReadCount;
-			s16Diff	= u16Read - gastrSockets[sock].u16UserBufferSize;
-			if(s16Diff > 0)
+			if(u16Read > u16Size)
 			{
 				u8SetRxDone = 0;
-				u16Read		= gastrSockets[sock].u16UserBufferSize;
+				u16Read		= u16Size;
 			}
-			if(hif_receive(u32Address, gastrSockets[sock].pu8UserBuffer, u16Read, u8SetRxDone) == M2M_SUCCESS)
+			if(hif_receive(u32Address, pu8Buffer, u16Read, u8SetRxDone) == M2M_SUCCESS)
 			{
-				pstrRecv->pu8Buffer			= gastrSockets[sock].pu8UserBuffer;
+				pstrRecv->pu8Buffer			= pu8Buffer;
 				pstrRecv->s16BufferSize		= u16Read;
 				pstrRecv->u16RemainingSize	-= u16Read;
 
+				if(pu8Block != NULL)
+				{
+					gstrRecvStats.u32PoolChunks++;
+					gstrRecvStats.u32PoolBytes += u16Read;
+				}
+				else
+				{
+					gstrRecvStats.u32BufferChunks++;
+					gstrRecvStats.u32BufferBytes += u16Read;
+				}
+
 				if (gpfAppSocketCb)
 					gpfAppSocketCb(sock,u8SocketMsg, pstrRecv);
 
@@ -176,11 +224,94 @@ NMI_API void Socket_ReadSocketData(SOCKET sock, tstrSocketRecvMsg *pstrRecv,uint
 			else
 			{
 				M2M_INFO("(ERRR)Current <%d>\n", u16ReadCount);
-				break;
+				u16ReadCount = 0;
 			}
+			/* The application took its own reference if it keeps the chunk */
+			if(pu8Block != NULL)
+				kb_pool_release(&gstrRecvPool, pu8Block);
 		}while(u16ReadCount != 0);
 	}
 }
+
+/*********************************************************************
+Function
+		socketRecvPoolInit
+
+Description
+		Receive into blocks of pu8Memory from now on.
+
+Return
+		SOCK_ERR_NO_ERROR, or SOCK_ERR_INVALID_ARG for a bad pool.
+*********************************************************************/
+sint8 socketRecvPoolInit(uint8 *pu8Memory, uint16 u16BlockSize, uint8 u8BlockNum)
+{
+	gbRecvPoolInit = 0;
+	if(kb_pool_init(&gstrRecvPool, pu8Memory, u16BlockSize, u8BlockNum) != 0)
+		return SOCK_ERR_INVALID_ARG;
+	m2m_memset((uint8*)&gstrRecvStats, 0, sizeof(tstrSocketRecvStats));
+	gbRecvPoolInit = 1;
+	return SOCK_ERR_NO_ERROR;
+}
+
+/*********************************************************************
+Function
+		socketRecvRetain
+
+Description
+		Keep the pool block of a received chunk after the callback.
+
+Return
+		SOCK_ERR_NO_ERROR, or SOCK_ERR_INVALID_ARG if pu8Buffer is not in a
+		pool block in use (e.g. it is the recv buffer).
+*********************************************************************/
+sint8 socketRecvRetain(uint8 *pu8Buffer)
+{
+	if(!gbRecvPoolInit || (kb_pool_retain(&gstrRecvPool, pu8Buffer) != 0))
+		return SOCK_ERR_INVALID_ARG;
+	gstrRecvStats.u32Retained++;
+	return SOCK_ERR_NO_ERROR;
+}
+
+/*********************************************************************
+Function
+		socketRecvRelease
+
+Description
+		Give back a block kept with socketRecvRetain.
+
+Return
+		SOCK_ERR_NO_ERROR, or SOCK_ERR_INVALID_ARG if pu8Buffer is not in a
+		pool block in use.
+*********************************************************************/
+sint8 socketRecvRelease(uint8 *pu8Buffer)
+{
+	if(!gbRecvPoolInit || (kb_pool_release(&gstrRecvPool, pu8Buffer) != 0))
+		return SOCK_ERR_INVALID_ARG;
+	return SOCK_ERR_NO_ERROR;
+}
+
+/*********************************************************************
+Function
+		socketRecvStats
+
+Description
+		Copy out the receive counters.
+
+Return
+		None.
+*********************************************************************/
+void socketRecvStats(tstrSocketRecvStats *pstrStats)
+{
+	m2m_memcpy((uint8*)pstrStats, (uint8*)&gstrRecvStats, sizeof(tstrSocketRecvStats));
+	if(gbRecvPoolInit)
+	{
+		pstrStats->u16BlockSize		= (uint16)gstrRecvPool.block_size;
+		pstrStats->u8BlockNum		= (uint8)gstrRecvPool.block_num;
+		pstrStats->u8BlocksInUse	= (uint8)kb_pool_in_use(&gstrRecvPool);
+		pstrStats->u8BlocksInUseMax	= (uint8)gstrRecvPool.in_use_max;
+	}
+}
+
 /*********************************************************************
 Function
 		m2m_ip_cb
@@ -823,7 +954,7 @@ sint16 recv(SOCKET sock, void *pvRecvBuf, uint16 u16BufLen, uint32 u32Timeoutmse
 {
 	sint16	s16Ret = SOCK_ERR_INVALID_ARG;
 	
-	if((sock >= 0) && (pvRecvBuf != NULL) && (u16BufLen != 0) && (gastrSockets[sock].bIsUsed == 1))
+	if((sock >= 0) && (((pvRecvBuf != NULL) && (u16BufLen != 0)) || gbRecvPoolInit) && (gastrSockets[sock].bIsUsed == 1))
 	{
 		s16Ret = SOCK_ERR_NO_ERROR;
 		gastrSockets[sock].pu8UserBuffer 		= (uint8*)pvRecvBuf;
@@ -923,7 +1054,7 @@ Date
 sint16 recvfrom(SOCKET sock, void *pvRecvBuf, uint16 u16BufLen, uint32 u32Timeoutmsec)
 {
 	sint16	s16Ret = SOCK_ERR_NO_ERROR;
-	if((sock >= 0) && (pvRecvBuf != NULL) && (u16BufLen != 0) && (gastrSockets[sock].bIsUsed == 1))
+	if((sock >= 0) && (((pvRecvBuf != NULL) && (u16BufLen != 0)) || gbRecvPoolInit) && (gastrSockets[sock].bIsUsed == 1))
 	{
 		if(gastrSockets[sock].bIsUsed)
 		{
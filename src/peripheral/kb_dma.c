@@ -0,0 +1,120 @@
+/*
+ * kb_dma.c
+ */
+
+#include "kb_dma.h"
+
+// base name change. Used with kb_msg(). See @kb_base.h
+#ifdef KB_MSG_BASE
+    #undef KB_MSG_BASE
+    #define KB_MSG_BASE "DMA"
+#endif
+
+#define DMA_STREAM_NUM  16
+
+static DMA_Stream_TypeDef * const stream_list_[DMA_STREAM_NUM] = {
+    DMA1_Stream0, DMA1_Stream1, DMA1_Stream2, DMA1_Stream3,
+    DMA1_Stream4, DMA1_Stream5, DMA1_Stream6, DMA1_Stream7,
+    DMA2_Stream0, DMA2_Stream1, DMA2_Stream2, DMA2_Stream3,
+    DMA2_Stream4, DMA2_Stream5, DMA2_Stream6, DMA2_Stream7
+};
+
+static const IRQn_Type irq_list_[DMA_STREAM_NUM] = {
+    DMA1_Stream0_IRQn, DMA1_Stream1_IRQn, DMA1_Stream2_IRQn, DMA1_Stream3_IRQn,
+    DMA1_Stream4_IRQn, DMA1_Stream5_IRQn, DMA1_Stream6_IRQn, DMA1_Stream7_IRQn,
+    DMA2_Stream0_IRQn, DMA2_Stream1_IRQn, DMA2_Stream2_IRQn, DMA2_Stream3_IRQn,
+    DMA2_Stream4_IRQn, DMA2_Stream5_IRQn, DMA2_Stream6_IRQn, DMA2_Stream7_IRQn
+};
+
+static DMA_HandleTypeDef *handle_list_[DMA_STREAM_NUM];
+
+static int stream_index_(DMA_Stream_TypeDef *stream)
+{
+    int i;
+    for (i = 0; i < DMA_STREAM_NUM; i++)
+    {
+        if (stream_list_[i] == stream)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int kb_dma_init(DMA_HandleTypeDef *handle, uint32_t priority)
+{
+    int idx = stream_index_(handle->Instance);
+    if (idx < 0)
+    {
+        KB_DEBUG_ERROR("Wrong DMA stream selected!\r\n");
+        return KB_ERROR;
+    }
+    if ((handle_list_[idx] != NULL) && (handle_list_[idx] != handle))
+    {
+        KB_DEBUG_ERROR("DMA stream %d is already used!\r\n", idx);
+        return KB_BUSY;
+    }
+
+    if (idx < 8)
+    {
+        __DMA1_CLK_ENABLE();
+    }
+    else
+    {
+        __DMA2_CLK_ENABLE();
+    }
+    int8_t result = HAL_DMA_Init(handle);
+    KB_CONVERT_STATUS(result);
+    if (result != KB_OK)
+    {
+        return result;
+    }
+
+    handle_list_[idx] = handle;
+    HAL_NVIC_SetPriority(irq_list_[idx], priority, 0);
+    HAL_NVIC_EnableIRQ(irq_list_[idx]);
+    return KB_OK;
+}
+
+int kb_dma_deinit(DMA_HandleTypeDef *handle)
+{
+    int idx = stream_index_(handle->Instance);
+    if ((idx < 0) || (handle_list_[idx] != handle))
+    {
+        return KB_ERROR;
+    }
+    HAL_NVIC_DisableIRQ(irq_list_[idx]);
+    handle_list_[idx] = NULL;
+    int8_t result = HAL_DMA_DeInit(handle);
+    KB_CONVERT_STATUS(result);
+    return (kb_status_t)result;
+}
+
+/******************************************************************************
+ * Interrupt Handlers
+ ******************************************************************************/
+
+static void dma_irq_(int idx)
+{
+    if (NULL != handle_list_[idx])
+    {
+        HAL_DMA_IRQHandler(handle_list_[idx]);
+    }
+}
+
+void DMA1_Stream0_IRQHandler(void) { dma_irq_(0); }
+void DMA1_Stream1_IRQHandler(void) { dma_irq_(1); }
+void DMA1_Stream2_IRQHandler(void) { dma_irq_(2); }
+void DMA1_Stream3_IRQHandler(void) { dma_irq_(3); }
+void DMA1_Stream4_IRQHandler(void) { dma_irq_(4); }
+void DMA1_Stream5_IRQHandler(void) { dma_irq_(5); }
+void DMA1_Stream6_IRQHandler(void) { dma_irq_(6); }
+void DMA1_Stream7_IRQHandler(void) { dma_irq_(7); }
+void DMA2_Stream0_IRQHandler(void) { dma_irq_(8); }
+void DMA2_Stream1_IRQHandler(void) { dma_irq_(9); }
+void DMA2_Stream2_IRQHandler(void) { dma_irq_(10); }
+void DMA2_Stream3_IRQHandler(void) { dma_irq_(11); }
+void DMA2_Stream4_IRQHandler(void) { dma_irq_(12); }
+void DMA2_Stream5_IRQHandler(void) { dma_irq_(13); }
+void DMA2_Stream6_IRQHandler(void) { dma_irq_(14); }
+void DMA2_Stream7_IRQHandler(void) { dma_irq_(15); }
@@ -0,0 +1,36 @@
+/*
+ * kb_dma.h
+ *
+ *  Shared DMA stream interrupts. A driver that uses a stream (kb_uart, ...)
+ *  fills a DMA_HandleTypeDef and calls kb_dma_init(). The stream interrupt
+ *  handlers live here and forward to HAL_DMA_IRQHandler() of the handle, so
+ *  that two drivers never define the same DMAx_Streamy_IRQHandler().
+ */
+
+#ifndef PERIPHERAL_KB_DMA_H_
+#define PERIPHERAL_KB_DMA_H_
+
+#include "kb_common_source.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Enable the clock of the DMA controller, initialize @handle and
+ *        enable the interrupt of its stream
+ * @param priority  NVIC preemption priority of the stream interrupt
+ * @return KB_OK, KB_BUSY if the stream is used by another handle
+ */
+int kb_dma_init(DMA_HandleTypeDef *handle, uint32_t priority);
+
+/**
+ * @brief Disable the stream interrupt and release the stream
+ */
+int kb_dma_deinit(DMA_HandleTypeDef *handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PERIPHERAL_KB_DMA_H_ */
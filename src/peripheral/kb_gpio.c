@@ -7,6 +7,7 @@
 
 #include "kb_common_source.h"
 #include "kb_gpio.h"
+#include "kb_periph.h"
 
 // base name change. Used with kb_msg(). See @kb_base.h
 #ifdef KB_MSG_BASE
@@ -14,6 +15,9 @@
     #define KB_MSG_BASE "GPIO"
 #endif
 
+#define GPIO_PORT_NUM   8
+
+static int pin_index_(kb_gpio_pin_t pin);
 static int register_callback_(kb_gpio_pin_t pin, void (*callback)(void));
 static int set_isr_(kb_gpio_pin_t pin, uint8_t enable);
 static void (*callback_list_[])(void);
@@ -47,42 +51,16 @@ void kb_gpio_toggle(kb_gpio_port_t port, kb_gpio_pin_t pin)
 
 void kb_gpio_enable_clk(kb_gpio_port_t port)
 {
-    if(port == GPIOA)
-    {
-        __GPIOA_CLK_ENABLE();
-    }
-    else if(port == GPIOB)
-    {
-        __GPIOB_CLK_ENABLE();
-    }
-    else if(port == GPIOC)
-    {
-        __GPIOC_CLK_ENABLE();
-    }
-    else if(port == GPIOD)
-    {
-        __GPIOD_CLK_ENABLE();
-    }
-    else if(port == GPIOE)
-    {
-        __GPIOE_CLK_ENABLE();
-    }
-    else if(port == GPIOF)
-    {
-        __GPIOF_CLK_ENABLE();
-    }
-    else if(port == GPIOG)
-    {
-        __GPIOG_CLK_ENABLE();
-    }
-    else if(port == GPIOH)
-    {
-        __GPIOH_CLK_ENABLE();
-    }
-    else
+    // GPIOA to GPIOH are 1 KB apart and enabled by bit 0 to 7 of AHB1ENR
+    uint32_t offset = (uint32_t)(uintptr_t)port - GPIOA_BASE;
+    uint32_t idx = offset >> 10;
+    if (((offset & 0x3FF) != 0) || (idx >= GPIO_PORT_NUM))
     {
         KB_DEBUG_ERROR("Wrong port selected for clock!\r\n");
+        return;
     }
+    kb_periph_clk_t clk = {&RCC->AHB1ENR, RCC_AHB1ENR_GPIOAEN << idx};
+    kb_periph_clk_enable(&clk);
     return;
 }
 
@@ -129,79 +107,32 @@ int kb_gpio_isr_disable(kb_gpio_port_t port, kb_gpio_pin_t pin)
  * Privates
  ******************************************************************************/
 
-static int register_callback_(kb_gpio_pin_t pin, void (*callback)(void))
+// EXTI interrupt of each pin
+static const IRQn_Type irq_list_[16] = {
+    EXTI0_IRQn, EXTI1_IRQn, EXTI2_IRQn, EXTI3_IRQn, EXTI4_IRQn,
+    EXTI9_5_IRQn, EXTI9_5_IRQn, EXTI9_5_IRQn, EXTI9_5_IRQn, EXTI9_5_IRQn,
+    EXTI15_10_IRQn, EXTI15_10_IRQn, EXTI15_10_IRQn, EXTI15_10_IRQn, EXTI15_10_IRQn, EXTI15_10_IRQn
+};
+
+/**
+ * @brief Number of a single pin: PIN_0 -> 0, ..., PIN_15 -> 15
+ * @return the number, or -1 if @pin is not exactly one pin
+ */
+static int pin_index_(kb_gpio_pin_t pin)
 {
-    // Set NVIC and put the callback
-    IRQn_Type irq_num;
-    int idx;
-    switch(pin)
+    if ((pin == 0) || (pin > PIN_15) || ((pin & (pin - 1)) != 0))
     {
-    case PIN_0:
-        irq_num = EXTI0_IRQn;
-        idx = 0;
-        break;
-    case PIN_1:
-        irq_num = EXTI1_IRQn;
-        idx = 1;
-        break;
-    case PIN_2:
-        irq_num = EXTI2_IRQn;
-        idx = 2;
-        break;
-    case PIN_3:
-        irq_num = EXTI3_IRQn;
-        idx = 3;
-        break;
-    case PIN_4:
-        irq_num = EXTI4_IRQn;
-        idx = 4;
-        break;
-    case PIN_5:
-        irq_num = EXTI9_5_IRQn;
-        idx = 5;
-        break;
-    case PIN_6:
-        irq_num = EXTI9_5_IRQn;
-        idx = 6;
-        break;
-    case PIN_7:
-        irq_num = EXTI9_5_IRQn;
-        idx = 7;
-        break;
-    case PIN_8:
-        irq_num = EXTI9_5_IRQn;
-        idx = 8;
-        break;
-    case PIN_9:
-        irq_num = EXTI9_5_IRQn;
-        idx = 9;
-        break;
-    case PIN_10:
-        irq_num = EXTI15_10_IRQn;
-        idx = 10;
-        break;
-    case PIN_11:
-        irq_num = EXTI15_10_IRQn;
-        idx = 11;
-        break;
-    case PIN_12:
-        irq_num = EXTI15_10_IRQn;
-        idx = 12;
-        break;
-    case PIN_13:
-        irq_num = EXTI15_10_IRQn;
-        idx = 13;
-        break;
-    case PIN_14:
-        irq_num = EXTI15_10_IRQn;
-        idx = 14;
-        break;
-    case PIN_15:
-        irq_num = EXTI15_10_IRQn;
-        idx = 15;
-        break;
-    default:
         KB_DEBUG_ERROR("Wrong Pin selected!\r\n");
+        return -1;
+    }
+    return __builtin_ctz(pin);
+}
+
+static int register_callback_(kb_gpio_pin_t pin, void (*callback)(void))
+{
+    int idx = pin_index_(pin);
+    if (idx < 0)
+    {
         return KB_ERROR;
     }
     if(NULL != callback_list_[idx])
@@ -214,79 +145,13 @@ static int register_callback_(kb_gpio_pin_t pin, void (*callback)(void))
 
 static int set_isr_(kb_gpio_pin_t pin, uint8_t enable)
 {
-    // Set NVIC and put the callback
-    IRQn_Type irq_num;
-    int idx;
-    switch(pin)
+    // Set NVIC
+    int idx = pin_index_(pin);
+    if (idx < 0)
     {
-    case PIN_0:
-        irq_num = EXTI0_IRQn;
-        idx = 0;
-        break;
-    case PIN_1:
-        irq_num = EXTI1_IRQn;
-        idx = 1;
-        break;
-    case PIN_2:
-        irq_num = EXTI2_IRQn;
-        idx = 2;
-        break;
-    case PIN_3:
-        irq_num = EXTI3_IRQn;
-        idx = 3;
-        break;
-    case PIN_4:
-        irq_num = EXTI4_IRQn;
-        idx = 4;
-        break;
-    case PIN_5:
-        irq_num = EXTI9_5_IRQn;
-        idx = 5;
-        break;
-    case PIN_6:
-        irq_num = EXTI9_5_IRQn;
-        idx = 6;
-        break;
-    case PIN_7:
-        irq_num = EXTI9_5_IRQn;
-        idx = 7;
-        break;
-    case PIN_8:
-        irq_num = EXTI9_5_IRQn;
-        idx = 8;
-        break;
-    case PIN_9:
-        irq_num = EXTI9_5_IRQn;
-        idx = 9;
-        break;
-    case PIN_10:
-        irq_num = EXTI15_10_IRQn;
-        idx = 10;
-        break;
-    case PIN_11:
-        irq_num = EXTI15_10_IRQn;
-        idx = 11;
-        break;
-    case PIN_12:
-        irq_num = EXTI15_10_IRQn;
-        idx = 12;
-        break;
-    case PIN_13:
-        irq_num = EXTI15_10_IRQn;
-        idx = 13;
-        break;
-    case PIN_14:
-        irq_num = EXTI15_10_IRQn;
-        idx = 14;
-        break;
-    case PIN_15:
-        irq_num = EXTI15_10_IRQn;
-        idx = 15;
-        break;
-    default:
-        KB_DEBUG_ERROR("Wrong Pin selected!\r\n");
         return KB_ERROR;
     }
+    IRQn_Type irq_num = irq_list_[idx];
     HAL_NVIC_SetPriority(irq_num, 15, 0);  // TODO: Find a better group number
 
     // enable interrupt
@@ -8,6 +8,14 @@
 #include "kb_common_source.h"
 #include "kb_i2c.h"
 #include "kb_alternate_pins.h"
+#include "kb_periph.h"
+#include "kb_dma.h"
+#include "kb_tick.h"
+#include "kb_prof.h"
+#ifdef KB_USE_FREERTOS
+    #include "FreeRTOS.h"
+    #include "task.h"
+#endif
 
 // base name change. Used with kb_msg(). See @kb_base.h
 #ifdef KB_MSG_BASE
@@ -15,6 +23,7 @@
     #define KB_MSG_BASE "I2C"
 #endif
 
+static int get_index_(kb_i2c_t i2c);
 static I2C_HandleTypeDef *get_handler (kb_i2c_t i2c);
 static void enable_i2c_clk_ (kb_i2c_t i2c);
 
@@ -22,10 +31,63 @@ static void enable_i2c_clk_ (kb_i2c_t i2c);
     static I2C_HandleTypeDef i2c_1_h_ = {.Instance = I2C1};
     static I2C_HandleTypeDef i2c_2_h_ = {.Instance = I2C2};
     static I2C_HandleTypeDef i2c_3_h_ = {.Instance = I2C3};
+
+    // Handle, clock, IRQs and DMA streams of each I2C. See the DMA request
+    // mapping of RM0390. The streams avoid those of USART2 (the terminal);
+    // I2C1 and I2C2 share DMA1_Stream7 for TX, so the second one to start
+    // the asynchronous mode writes with interrupts.
+    static const struct {
+        I2C_HandleTypeDef *handler;
+        kb_periph_clk_t clk;
+        IRQn_Type ev_irq;
+        IRQn_Type er_irq;
+        DMA_Stream_TypeDef *tx_stream;
+        uint32_t tx_channel;
+        DMA_Stream_TypeDef *rx_stream;
+        uint32_t rx_channel;
+    } i2c_list_[] = {
+        {&i2c_1_h_, {&RCC->APB1ENR, RCC_APB1ENR_I2C1EN}, I2C1_EV_IRQn, I2C1_ER_IRQn,
+                DMA1_Stream7, DMA_CHANNEL_1, DMA1_Stream0, DMA_CHANNEL_1},
+        {&i2c_2_h_, {&RCC->APB1ENR, RCC_APB1ENR_I2C2EN}, I2C2_EV_IRQn, I2C2_ER_IRQn,
+                DMA1_Stream7, DMA_CHANNEL_7, DMA1_Stream3, DMA_CHANNEL_7},
+        {&i2c_3_h_, {&RCC->APB1ENR, RCC_APB1ENR_I2C3EN}, I2C3_EV_IRQn, I2C3_ER_IRQn,
+                DMA1_Stream4, DMA_CHANNEL_3, DMA1_Stream2, DMA_CHANNEL_3}
+    };
+
+    // index + 1 of i2c_list_ by the slot of the instance. See kb_periph.h
+    static const uint8_t slot_list_[] = {
+        [KB_PERIPH_SLOT(I2C1_BASE)] = 1,
+        [KB_PERIPH_SLOT(I2C2_BASE)] = 2,
+        [KB_PERIPH_SLOT(I2C3_BASE)] = 3
+    };
 #else
     #error "Please define device! " __FILE__ "\n"
 #endif
 
+#define I2C_NUM     (sizeof(i2c_list_) / sizeof(i2c_list_[0]))
+
+// State of the asynchronous mode, see kb_i2c_async_init()
+typedef struct {
+    kb_i2c_queue_t queue;
+    DMA_HandleTypeDef tx_dma;
+    DMA_HandleTypeDef rx_dma;
+    uint8_t has_tx_dma;
+    uint8_t has_rx_dma;
+    uint8_t idx;
+    uint8_t is_write_then_read;     // the read is left after the write
+    uint8_t is_enabled;
+} i2c_async_t;
+
+static i2c_async_t async_list_[I2C_NUM];
+
+static int async_start_(void *bus, kb_i2c_xfer_t *xfer);
+static uint32_t async_lock_(void);
+static void async_unlock_(uint32_t primask);
+static int transfer_(int idx, kb_i2c_xfer_t *xfer, uint32_t timeout);
+static uint16_t mem_size_(uint8_t mem_address_size);
+
+static const kb_i2c_queue_ops_t async_ops_ = {async_start_, async_lock_, async_unlock_};
+
 
 int kb_i2c_init(kb_i2c_t i2c, kb_i2c_init_t *settings)
 {
@@ -107,11 +169,18 @@ inline int kb_i2c_send(kb_i2c_t i2c, uint16_t address_target, uint8_t* buf, uint
 
 int kb_i2c_send_timeout(kb_i2c_t i2c, uint16_t address_target, uint8_t* buf, uint16_t size, uint32_t timeout)
 {
+    KB_PROF_ZONE("i2c_send");
     // select handler
-    I2C_HandleTypeDef* handler = get_handler(i2c);
-    if (NULL == handler) {
+    int idx = get_index_(i2c);
+    if (idx < 0) {
         return KB_ERROR;
     }
+    if (async_list_[idx].is_enabled) {
+        // wait in the queue behind the asynchronous transactions
+        kb_i2c_xfer_t xfer = {.address = address_target, .tx_buf = buf, .tx_size = size};
+        return transfer_(idx, &xfer, timeout);
+    }
+    I2C_HandleTypeDef* handler = i2c_list_[idx].handler;
     // target address is needed to be shit by 1
     address_target <<= 1;
 
@@ -134,10 +203,16 @@ int kb_i2c_receive(kb_i2c_t i2c, uint16_t address_target, uint8_t* buf, uint16_t
 int kb_i2c_receive_timeout(kb_i2c_t i2c, uint16_t address_target, uint8_t* buf, uint16_t size, uint32_t timeout)
 {
     // select handler
-    I2C_HandleTypeDef* handler = get_handler(i2c);
-    if (NULL == handler) {
+    int idx = get_index_(i2c);
+    if (idx < 0) {
         return KB_ERROR;
     }
+    if (async_list_[idx].is_enabled) {
+        // wait in the queue behind the asynchronous transactions
+        kb_i2c_xfer_t xfer = {.address = address_target, .rx_buf = buf, .rx_size = size};
+        return transfer_(idx, &xfer, timeout);
+    }
+    I2C_HandleTypeDef* handler = i2c_list_[idx].handler;
     // target address is needed to be shit by 1
     address_target <<= 1;
 
@@ -150,49 +225,437 @@ int kb_i2c_receive_timeout(kb_i2c_t i2c, uint16_t address_target, uint8_t* buf,
     return  status;
 }
 
+inline int kb_i2c_mem_read(kb_i2c_t i2c, uint16_t address_target, uint16_t mem_address,
+        uint8_t mem_address_size, uint8_t *buf, uint16_t size)
+{
+    return kb_i2c_mem_read_timeout(i2c, address_target, mem_address, mem_address_size, buf, size, TIMEOUT_MAX);
+}
+
+
+int kb_i2c_mem_read_timeout(kb_i2c_t i2c, uint16_t address_target, uint16_t mem_address,
+        uint8_t mem_address_size, uint8_t *buf, uint16_t size, uint32_t timeout)
+{
+    // select handler
+    int idx = get_index_(i2c);
+    if ((idx < 0) || (mem_address_size < 1) || (mem_address_size > 2)) {
+        return KB_ERROR;
+    }
+    if (async_list_[idx].is_enabled) {
+        kb_i2c_xfer_t xfer = {.address = address_target, .rx_buf = buf, .rx_size = size,
+                .mem_address = mem_address, .mem_address_size = mem_address_size};
+        return transfer_(idx, &xfer, timeout);
+    }
+
+    // the register address, a repeated start, then the read
+    int8_t status = HAL_I2C_Mem_Read(i2c_list_[idx].handler, address_target << 1, mem_address,
+            mem_size_(mem_address_size), buf, size, timeout);
+    KB_CONVERT_STATUS(status);
+    if (status != KB_OK)
+    {
+        KB_DEBUG_ERROR("Error in reading a register.\r\n");
+    }
+    return  status;
+}
+
+
+inline int kb_i2c_mem_write(kb_i2c_t i2c, uint16_t address_target, uint16_t mem_address,
+        uint8_t mem_address_size, uint8_t *buf, uint16_t size)
+{
+    return kb_i2c_mem_write_timeout(i2c, address_target, mem_address, mem_address_size, buf, size, TIMEOUT_MAX);
+}
+
+
+int kb_i2c_mem_write_timeout(kb_i2c_t i2c, uint16_t address_target, uint16_t mem_address,
+        uint8_t mem_address_size, uint8_t *buf, uint16_t size, uint32_t timeout)
+{
+    KB_PROF_ZONE("i2c_mem_write");
+    // select handler
+    int idx = get_index_(i2c);
+    if ((idx < 0) || (mem_address_size < 1) || (mem_address_size > 2)) {
+        return KB_ERROR;
+    }
+    if (async_list_[idx].is_enabled) {
+        kb_i2c_xfer_t xfer = {.address = address_target, .tx_buf = buf, .tx_size = size,
+                .mem_address = mem_address, .mem_address_size = mem_address_size};
+        return transfer_(idx, &xfer, timeout);
+    }
+
+    int8_t status = HAL_I2C_Mem_Write(i2c_list_[idx].handler, address_target << 1, mem_address,
+            mem_size_(mem_address_size), buf, size, timeout);
+    KB_CONVERT_STATUS(status);
+    if (status != KB_OK)
+    {
+        KB_DEBUG_ERROR("Error in writing a register.\r\n");
+    }
+    return  status;
+}
+
 /******************************************************************************
- * Private Functions
+ * Asynchronous mode
  ******************************************************************************/
 
-static I2C_HandleTypeDef *get_handler (kb_i2c_t i2c)
+static void dma_config_(DMA_HandleTypeDef *dma, DMA_Stream_TypeDef *stream, uint32_t channel,
+        uint32_t direction)
+{
+    dma->Instance = stream;
+    dma->Init.Channel = channel;
+    dma->Init.Direction = direction;
+    dma->Init.PeriphInc = DMA_PINC_DISABLE;
+    dma->Init.MemInc = DMA_MINC_ENABLE;
+    dma->Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    dma->Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    dma->Init.Mode = DMA_NORMAL;
+    dma->Init.Priority = DMA_PRIORITY_MEDIUM;
+    dma->Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+}
+
+int kb_i2c_async_init(kb_i2c_t i2c)
+{
+    int idx = get_index_(i2c);
+    if (idx < 0)
+    {
+        return KB_ERROR;
+    }
+    i2c_async_t *async = &async_list_[idx];
+    I2C_HandleTypeDef *handler = i2c_list_[idx].handler;
+    if (async->is_enabled)
+    {
+        return KB_BUSY;
+    }
+    async->idx = (uint8_t)idx;
+    kb_i2c_queue_init(&async->queue, &async_ops_, async);
+
+    // without a free stream, that direction runs with interrupts
+    dma_config_(&async->tx_dma, i2c_list_[idx].tx_stream, i2c_list_[idx].tx_channel, DMA_MEMORY_TO_PERIPH);
+    dma_config_(&async->rx_dma, i2c_list_[idx].rx_stream, i2c_list_[idx].rx_channel, DMA_PERIPH_TO_MEMORY);
+    async->has_tx_dma = (kb_dma_init(&async->tx_dma, KB_I2C_IRQ_PRIORITY) == KB_OK);
+    async->has_rx_dma = (kb_dma_init(&async->rx_dma, KB_I2C_IRQ_PRIORITY) == KB_OK);
+    if (async->has_tx_dma)
+    {
+        __HAL_LINKDMA(handler, hdmatx, async->tx_dma);
+    }
+    if (async->has_rx_dma)
+    {
+        __HAL_LINKDMA(handler, hdmarx, async->rx_dma);
+    }
+
+    HAL_NVIC_SetPriority(i2c_list_[idx].ev_irq, KB_I2C_IRQ_PRIORITY, 0);
+    HAL_NVIC_SetPriority(i2c_list_[idx].er_irq, KB_I2C_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(i2c_list_[idx].ev_irq);
+    HAL_NVIC_EnableIRQ(i2c_list_[idx].er_irq);
+    async->is_enabled = 1;
+    return KB_OK;
+}
+
+int kb_i2c_submit(kb_i2c_t i2c, kb_i2c_xfer_t *xfer)
+{
+    int idx = get_index_(i2c);
+    if ((idx < 0) || !async_list_[idx].is_enabled)
+    {
+        return KB_ERROR;
+    }
+    return kb_i2c_queue_submit(&async_list_[idx].queue, xfer);
+}
+
+int kb_i2c_wait(kb_i2c_xfer_t *xfer, uint32_t timeout)
+{
+    uint32_t start = kb_tick_ms();
+    while (xfer->status == KB_BUSY)
+    {
+        if ((kb_tick_ms() - start) >= timeout)
+        {
+            return KB_TIMEOUT;
+        }
+    }
+    return xfer->status;
+}
+
+int kb_i2c_async_reset(kb_i2c_t i2c)
+{
+    int idx = get_index_(i2c);
+    if ((idx < 0) || !async_list_[idx].is_enabled)
+    {
+        return KB_ERROR;
+    }
+    i2c_async_t *async = &async_list_[idx];
+    I2C_HandleTypeDef *handler = i2c_list_[idx].handler;
+
+    // stop the interrupts and the DMA, then reset the peripheral, which
+    // also clears a BUSY flag left by a target holding SDA
+    HAL_NVIC_DisableIRQ(i2c_list_[idx].ev_irq);
+    HAL_NVIC_DisableIRQ(i2c_list_[idx].er_irq);
+    if (async->has_tx_dma)
+    {
+        HAL_DMA_Abort(&async->tx_dma);
+    }
+    if (async->has_rx_dma)
+    {
+        HAL_DMA_Abort(&async->rx_dma);
+    }
+    SET_BIT(handler->Instance->CR1, I2C_CR1_SWRST);
+    CLEAR_BIT(handler->Instance->CR1, I2C_CR1_SWRST);
+    int8_t status = HAL_I2C_Init(handler);
+    KB_CONVERT_STATUS(status);
+    HAL_NVIC_EnableIRQ(i2c_list_[idx].ev_irq);
+    HAL_NVIC_EnableIRQ(i2c_list_[idx].er_irq);
+
+    kb_i2c_queue_abort(&async->queue, KB_TIMEOUT);
+    return status;
+}
+
+#ifdef KB_USE_FREERTOS
+void kb_i2c_notify_task(kb_i2c_xfer_t *xfer)
+{
+    BaseType_t is_woken = pdFALSE;
+    vTaskNotifyGiveFromISR((TaskHandle_t)xfer->context, &is_woken);
+    portYIELD_FROM_ISR(is_woken);
+}
+#endif
+
+/**
+ * @brief Submit @xfer and wait for it. On a timeout @xfer, which lives on
+ *        the caller's stack, must leave the queue: still waiting, it is
+ *        taken out alone; running, the bus is reset
+ */
+static int transfer_(int idx, kb_i2c_xfer_t *xfer, uint32_t timeout)
+{
+    int status = kb_i2c_queue_submit(&async_list_[idx].queue, xfer);
+    if (status != KB_OK)
+    {
+        return status;
+    }
+    status = kb_i2c_wait(xfer, timeout);
+    if (status == KB_TIMEOUT)
+    {
+        status = kb_i2c_queue_cancel(&async_list_[idx].queue, xfer, KB_TIMEOUT);
+        if (status == KB_BUSY)
+        {
+            KB_DEBUG_ERROR("Timeout. Resetting the bus.\r\n");
+            kb_i2c_async_reset(i2c_list_[idx].handler->Instance);
+        }
+        else if (status == KB_OK)
+        {
+            KB_DEBUG_ERROR("Timeout in the queue.\r\n");
+        }
+        // KB_ERROR: it completed meanwhile
+        status = xfer->status;
+    }
+    return status;
+}
+
+static int async_start_(void *bus, kb_i2c_xfer_t *xfer)
 {
-    if (i2c == I2C1)
+    i2c_async_t *async = (i2c_async_t *)bus;
+    I2C_HandleTypeDef *handler = i2c_list_[async->idx].handler;
+    uint16_t address = xfer->address << 1;  // target address is needed to be shift by 1
+    uint8_t *tx_buf = (uint8_t *)xfer->tx_buf;
+    int8_t status;
+
+    async->is_write_then_read = 0;
+    if (xfer->mem_address_size != 0)
+    {
+        // the register address, then the data or a repeated start and the read
+        uint16_t mem_size = mem_size_(xfer->mem_address_size);
+        if (xfer->rx_size == 0)
+        {
+            if (async->has_tx_dma && (xfer->tx_size >= KB_I2C_DMA_MIN_SIZE))
+            {
+                status = HAL_I2C_Mem_Write_DMA(handler, address, xfer->mem_address, mem_size, tx_buf, xfer->tx_size);
+            }
+            else
+            {
+                status = HAL_I2C_Mem_Write_IT(handler, address, xfer->mem_address, mem_size, tx_buf, xfer->tx_size);
+            }
+        }
+        else
+        {
+            if (async->has_rx_dma && (xfer->rx_size >= KB_I2C_DMA_MIN_SIZE))
+            {
+                status = HAL_I2C_Mem_Read_DMA(handler, address, xfer->mem_address, mem_size, xfer->rx_buf, xfer->rx_size);
+            }
+            else
+            {
+                status = HAL_I2C_Mem_Read_IT(handler, address, xfer->mem_address, mem_size, xfer->rx_buf, xfer->rx_size);
+            }
+        }
+    }
+    else if (xfer->rx_size == 0)
     {
-        return &i2c_1_h_;
+        if (async->has_tx_dma && (xfer->tx_size >= KB_I2C_DMA_MIN_SIZE))
+        {
+            status = HAL_I2C_Master_Transmit_DMA(handler, address, tx_buf, xfer->tx_size);
+        }
+        else
+        {
+            status = HAL_I2C_Master_Transmit_IT(handler, address, tx_buf, xfer->tx_size);
+        }
     }
-    else if (i2c == I2C2)
+    else if (xfer->tx_size == 0)
     {
-        return &i2c_2_h_;
+        if (async->has_rx_dma && (xfer->rx_size >= KB_I2C_DMA_MIN_SIZE))
+        {
+            status = HAL_I2C_Master_Receive_DMA(handler, address, xfer->rx_buf, xfer->rx_size);
+        }
+        else
+        {
+            status = HAL_I2C_Master_Receive_IT(handler, address, xfer->rx_buf, xfer->rx_size);
+        }
     }
-    else if (i2c == I2C3)
+    else if (xfer->tx_size <= 2)
     {
-        return &i2c_3_h_;
+        // a register address: the HAL writes it and reads with a repeated start
+        uint16_t mem_address = (xfer->tx_size == 1) ? tx_buf[0] : ((tx_buf[0] << 8) | tx_buf[1]);
+        uint16_t mem_size = mem_size_(xfer->tx_size);
+        if (async->has_rx_dma && (xfer->rx_size >= KB_I2C_DMA_MIN_SIZE))
+        {
+            status = HAL_I2C_Mem_Read_DMA(handler, address, mem_address, mem_size, xfer->rx_buf, xfer->rx_size);
+        }
+        else
+        {
+            status = HAL_I2C_Mem_Read_IT(handler, address, mem_address, mem_size, xfer->rx_buf, xfer->rx_size);
+        }
     }
     else
+    {
+        // a longer write without a stop, then the read in HAL_I2C_MasterTxCpltCallback()
+        async->is_write_then_read = 1;
+        status = HAL_I2C_Master_Sequential_Transmit_IT(handler, address, tx_buf, xfer->tx_size, I2C_FIRST_FRAME);
+    }
+    KB_CONVERT_STATUS(status);
+    return status;
+}
+
+static uint16_t mem_size_(uint8_t mem_address_size)
+{
+    return (mem_address_size == 1) ? I2C_MEMADD_SIZE_8BIT : I2C_MEMADD_SIZE_16BIT;
+}
+
+static uint32_t async_lock_(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
+}
+
+static void async_unlock_(uint32_t primask)
+{
+    __set_PRIMASK(primask);
+}
+
+static i2c_async_t *async_of_handler_(I2C_HandleTypeDef *handler)
+{
+    int idx = kb_periph_index(handler->Instance, slot_list_, sizeof(slot_list_));
+    if ((idx < 0) || !async_list_[idx].is_enabled)
+    {
+        return NULL;
+    }
+    return &async_list_[idx];
+}
+
+/******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static int get_index_(kb_i2c_t i2c)
+{
+    int idx = kb_periph_index(i2c, slot_list_, sizeof(slot_list_));
+    if (idx < 0)
     {
         KB_DEBUG_ERROR("Wrong I2C device selected!\r\n");
+    }
+    return idx;
+}
+
+
+static I2C_HandleTypeDef *get_handler (kb_i2c_t i2c)
+{
+    int idx = get_index_(i2c);
+    if (idx < 0)
+    {
         return NULL;
     }
+    return i2c_list_[idx].handler;
 }
 
 
 static void enable_i2c_clk_ (kb_i2c_t i2c)
 {
-    if (i2c == I2C1)
+    int idx = get_index_(i2c);
+    if (idx < 0)
+    {
+        return;
+    }
+    kb_periph_clk_enable(&i2c_list_[idx].clk);
+}
+
+/******************************************************************************
+ * Interrupt Handlers
+ ******************************************************************************/
+
+void I2C1_EV_IRQHandler(void) { HAL_I2C_EV_IRQHandler(&i2c_1_h_); }
+void I2C1_ER_IRQHandler(void) { HAL_I2C_ER_IRQHandler(&i2c_1_h_); }
+void I2C2_EV_IRQHandler(void) { HAL_I2C_EV_IRQHandler(&i2c_2_h_); }
+void I2C2_ER_IRQHandler(void) { HAL_I2C_ER_IRQHandler(&i2c_2_h_); }
+void I2C3_EV_IRQHandler(void) { HAL_I2C_EV_IRQHandler(&i2c_3_h_); }
+void I2C3_ER_IRQHandler(void) { HAL_I2C_ER_IRQHandler(&i2c_3_h_); }
+
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    i2c_async_t *async = async_of_handler_(hi2c);
+    if (async == NULL)
     {
-        __I2C1_CLK_ENABLE();
+        return;
     }
-    else if (i2c == I2C2)
+    kb_i2c_xfer_t *xfer = async->queue.head;
+    if (async->is_write_then_read)
     {
-        __I2C2_CLK_ENABLE();
+        async->is_write_then_read = 0;
+        if (HAL_I2C_Master_Sequential_Receive_IT(hi2c, xfer->address << 1, xfer->rx_buf,
+                xfer->rx_size, I2C_LAST_FRAME) == HAL_OK)
+        {
+            return;
+        }
+        kb_i2c_queue_done(&async->queue, KB_ERROR);
+        return;
     }
-    else if (i2c == I2C3)
+    kb_i2c_queue_done(&async->queue, KB_OK);
+}
+
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    i2c_async_t *async = async_of_handler_(hi2c);
+    if (async != NULL)
     {
-        __I2C3_CLK_ENABLE();
+        kb_i2c_queue_done(&async->queue, KB_OK);
     }
-    else
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    i2c_async_t *async = async_of_handler_(hi2c);
+    if (async != NULL)
     {
-        KB_DEBUG_ERROR("Wrong I2C device selected!\r\n");
+        kb_i2c_queue_done(&async->queue, KB_OK);
+    }
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    i2c_async_t *async = async_of_handler_(hi2c);
+    if (async != NULL)
+    {
+        kb_i2c_queue_done(&async->queue, KB_OK);
+    }
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    // NACK (AF), bus error, arbitration lost, DMA error. The HAL has sent
+    // the stop and is ready again
+    i2c_async_t *async = async_of_handler_(hi2c);
+    if (async != NULL)
+    {
+        async->is_write_then_read = 0;
+        kb_i2c_queue_done(&async->queue, KB_ERROR);
     }
-    return;
 }
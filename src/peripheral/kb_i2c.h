@@ -10,6 +10,7 @@
 
 #include "kb_common_header.h"
 #include "kb_gpio.h"
+#include "kb_i2c_queue.h"
 
 
 #if defined(STM32)
@@ -22,6 +23,16 @@ typedef struct{
     uint32_t	frequency;
 }kb_i2c_init_t;
 
+// Asynchronous mode (kb_i2c_async_init()): NVIC priority of the I2C and its
+// DMA streams
+#ifndef KB_I2C_IRQ_PRIORITY
+    #define KB_I2C_IRQ_PRIORITY     6
+#endif
+// Shorter transfers use interrupts, which cost less than setting up the DMA
+#ifndef KB_I2C_DMA_MIN_SIZE
+    #define KB_I2C_DMA_MIN_SIZE     4
+#endif
+
 #ifdef __cplusplus
 extern "C"{
 #endif
@@ -36,15 +47,51 @@ int kb_i2c_send_timeout(kb_i2c_t i2c, uint16_t address_target, uint8_t *buf, uin
 
 int kb_i2c_receive(kb_i2c_t i2c, uint16_t address_target, uint8_t* buf, uint16_t size);
 int kb_i2c_receive_timeout(kb_i2c_t i2c, uint16_t address_target, uint8_t* buf, uint16_t size, uint32_t timeout);
-/*
-HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout);
-HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout);
-HAL_StatusTypeDef HAL_I2C_Slave_Transmit(I2C_HandleTypeDef *hi2c, uint8_t *pData, uint16_t Size, uint32_t Timeout);
-HAL_StatusTypeDef HAL_I2C_Slave_Receive(I2C_HandleTypeDef *hi2c, uint8_t *pData, uint16_t Size, uint32_t Timeout);
-HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
-HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
-HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint32_t Trials, uint32_t Timeout);
-*/
+
+/**
+ * Asynchronous mode. After kb_i2c_init(), transactions (kb_i2c_xfer_t, see
+ * kb_i2c_queue.h) are queued per bus and run one after another by DMA or
+ * interrupts. Each one ends with its callback, from the interrupt.
+ * kb_i2c_send()/kb_i2c_receive() then wait in the same queue; on a timeout
+ * they leave it, and reset the bus only if theirs was running.
+ * kb_i2c_mem_read()/kb_i2c_mem_write() as well.
+ * This mode uses the I2Cx_EV/ER_IRQHandler()s, HAL_I2C_MasterTxCpltCallback(),
+ * HAL_I2C_MasterRxCpltCallback(), HAL_I2C_MemTxCpltCallback(),
+ * HAL_I2C_MemRxCpltCallback() and HAL_I2C_ErrorCallback().
+ */
+int kb_i2c_async_init(kb_i2c_t i2c);
+int kb_i2c_submit(kb_i2c_t i2c, kb_i2c_xfer_t *xfer);
+/**
+ * @brief Busy-wait for the end of @xfer
+ * @return its status, or KB_TIMEOUT while it is still queued
+ */
+int kb_i2c_wait(kb_i2c_xfer_t *xfer, uint32_t timeout);
+/**
+ * @brief Stop the bus and complete every queued transaction with KB_TIMEOUT
+ */
+int kb_i2c_async_reset(kb_i2c_t i2c);
+#ifdef KB_USE_FREERTOS
+/**
+ * @brief A callback that gives a notification to the task in xfer->context
+ *        (a TaskHandle_t), for ulTaskNotifyTake()
+ */
+void kb_i2c_notify_task(kb_i2c_xfer_t *xfer);
+#endif
+
+/**
+ * Register access: @mem_address (@mem_address_size bytes, 1 or 2, sent MSB
+ * first) is written, then @size bytes are written after it, or read after
+ * a repeated start. One transaction; @size > 1 is a burst over the
+ * registers that follow, for targets that auto-increment the address.
+ */
+int kb_i2c_mem_read(kb_i2c_t i2c, uint16_t address_target, uint16_t mem_address,
+        uint8_t mem_address_size, uint8_t *buf, uint16_t size);
+int kb_i2c_mem_read_timeout(kb_i2c_t i2c, uint16_t address_target, uint16_t mem_address,
+        uint8_t mem_address_size, uint8_t *buf, uint16_t size, uint32_t timeout);
+int kb_i2c_mem_write(kb_i2c_t i2c, uint16_t address_target, uint16_t mem_address,
+        uint8_t mem_address_size, uint8_t *buf, uint16_t size);
+int kb_i2c_mem_write_timeout(kb_i2c_t i2c, uint16_t address_target, uint16_t mem_address,
+        uint8_t mem_address_size, uint8_t *buf, uint16_t size, uint32_t timeout);
 
 #ifdef __cplusplus
 }
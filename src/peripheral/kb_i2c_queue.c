@@ -0,0 +1,234 @@
+/*
+ * kb_i2c_queue.c
+ *
+ *  The queue is a singly linked list through the descriptors; head is the
+ *  running transaction. Only the list and is_running are touched under the
+ *  lock; the bus is started and the callbacks are called outside of it.
+ */
+
+#include "kb_i2c_queue.h"
+#include <stddef.h>
+
+// values of kb_status_t, without the device headers
+#define STATUS_OK_      0
+#define STATUS_ERROR_   (-1)
+#define STATUS_BUSY_    (-2)
+
+static uint32_t lock_(kb_i2c_queue_t *queue)
+{
+    return (queue->ops->lock != NULL) ? queue->ops->lock() : 0;
+}
+
+static void unlock_(kb_i2c_queue_t *queue, uint32_t state)
+{
+    if (queue->ops->unlock != NULL)
+    {
+        queue->ops->unlock(state);
+    }
+}
+
+/**
+ * @brief Take the running transaction @xfer off the queue and report it
+ */
+static void complete_(kb_i2c_queue_t *queue, kb_i2c_xfer_t *xfer, int status)
+{
+    uint32_t state = lock_(queue);
+    queue->head = xfer->next;
+    if (queue->head == NULL)
+    {
+        queue->tail = NULL;
+    }
+    queue->is_running = 0;
+    unlock_(queue, state);
+
+    xfer->next = NULL;
+    if (status == STATUS_OK_)
+    {
+        queue->done_count++;
+    }
+    else
+    {
+        queue->error_count++;
+    }
+    xfer->status = (int8_t)status;
+    if (xfer->callback != NULL)
+    {
+        xfer->callback(xfer);
+    }
+}
+
+/**
+ * @brief Start the head of the queue if the bus is idle. A transaction the
+ *        bus refuses to start fails and the next one is tried
+ */
+static void kick_(kb_i2c_queue_t *queue)
+{
+    kb_i2c_xfer_t *xfer;
+    uint32_t state;
+
+    while (1)
+    {
+        state = lock_(queue);
+        if (queue->is_running || (queue->head == NULL))
+        {
+            unlock_(queue, state);
+            return;
+        }
+        queue->is_running = 1;
+        xfer = queue->head;
+        unlock_(queue, state);
+
+        if (queue->ops->start(queue->bus, xfer) == STATUS_OK_)
+        {
+            return;
+        }
+        complete_(queue, xfer, STATUS_ERROR_);
+    }
+}
+
+void kb_i2c_queue_init(kb_i2c_queue_t *queue, const kb_i2c_queue_ops_t *ops, void *bus)
+{
+    queue->ops = ops;
+    queue->bus = bus;
+    queue->head = NULL;
+    queue->tail = NULL;
+    queue->is_running = 0;
+    queue->done_count = 0;
+    queue->error_count = 0;
+    queue->retry_count = 0;
+}
+
+int kb_i2c_queue_submit(kb_i2c_queue_t *queue, kb_i2c_xfer_t *xfer)
+{
+    uint32_t state;
+
+    if (((xfer->tx_size == 0) && (xfer->rx_size == 0))
+            || ((xfer->tx_size != 0) && (xfer->tx_buf == NULL))
+            || ((xfer->rx_size != 0) && (xfer->rx_buf == NULL))
+            || (xfer->mem_address_size > 2)
+            || ((xfer->mem_address_size != 0) && (xfer->tx_size != 0) && (xfer->rx_size != 0)))
+    {
+        return STATUS_ERROR_;
+    }
+    if (xfer->status == STATUS_BUSY_)
+    {
+        return STATUS_BUSY_;
+    }
+    xfer->status = STATUS_BUSY_;
+    xfer->attempts_left = xfer->retries;
+    xfer->next = NULL;
+
+    state = lock_(queue);
+    if (queue->tail == NULL)
+    {
+        queue->head = xfer;
+    }
+    else
+    {
+        queue->tail->next = xfer;
+    }
+    queue->tail = xfer;
+    unlock_(queue, state);
+
+    kick_(queue);
+    return STATUS_OK_;
+}
+
+void kb_i2c_queue_done(kb_i2c_queue_t *queue, int status)
+{
+    kb_i2c_xfer_t *xfer = queue->head;
+
+    if (!queue->is_running || (xfer == NULL))
+    {
+        return;
+    }
+    while ((status != STATUS_OK_) && (xfer->attempts_left > 0))
+    {
+        xfer->attempts_left--;
+        queue->retry_count++;
+        if (queue->ops->start(queue->bus, xfer) == STATUS_OK_)
+        {
+            return;
+        }
+    }
+    complete_(queue, xfer, status);
+    kick_(queue);
+}
+
+void kb_i2c_queue_abort(kb_i2c_queue_t *queue, int status)
+{
+    kb_i2c_xfer_t *xfer;
+    kb_i2c_xfer_t *next;
+    uint32_t state;
+
+    // detach the list first, so that what the callbacks submit runs normally
+    state = lock_(queue);
+    xfer = queue->head;
+    queue->head = NULL;
+    queue->tail = NULL;
+    queue->is_running = 0;
+    unlock_(queue, state);
+
+    while (xfer != NULL)
+    {
+        next = xfer->next;
+        xfer->next = NULL;
+        queue->error_count++;
+        xfer->status = (int8_t)status;
+        if (xfer->callback != NULL)
+        {
+            xfer->callback(xfer);
+        }
+        xfer = next;
+    }
+}
+
+int kb_i2c_queue_cancel(kb_i2c_queue_t *queue, kb_i2c_xfer_t *xfer, int status)
+{
+    kb_i2c_xfer_t *prev = NULL;
+    kb_i2c_xfer_t *cur;
+    uint32_t state;
+
+    state = lock_(queue);
+    if ((xfer == queue->head) && queue->is_running)
+    {
+        unlock_(queue, state);
+        return STATUS_BUSY_;
+    }
+    for (cur = queue->head; (cur != NULL) && (cur != xfer); cur = cur->next)
+    {
+        prev = cur;
+    }
+    if (cur == NULL)
+    {
+        unlock_(queue, state);
+        return STATUS_ERROR_;
+    }
+    if (prev == NULL)
+    {
+        queue->head = xfer->next;
+    }
+    else
+    {
+        prev->next = xfer->next;
+    }
+    if (queue->tail == xfer)
+    {
+        queue->tail = prev;
+    }
+    unlock_(queue, state);
+
+    xfer->next = NULL;
+    queue->error_count++;
+    xfer->status = (int8_t)status;
+    if (xfer->callback != NULL)
+    {
+        xfer->callback(xfer);
+    }
+    return STATUS_OK_;
+}
+
+int kb_i2c_queue_is_busy(const kb_i2c_queue_t *queue)
+{
+    return (queue->head != NULL);
+}
@@ -0,0 +1,125 @@
+/*
+ * kb_i2c_queue.h
+ *
+ *  Queue of I2C transactions of one bus. The caller owns the transaction
+ *  descriptors (kb_i2c_xfer_t); the queue links them in submission order,
+ *  starts one at a time through the bus operations and, when the bus
+ *  reports the end of one, completes it and starts the next.
+ *  kb_i2c.c drives it with the HAL (DMA or interrupts); it is plain C so
+ *  that it also runs against a simulated bus on the host (see
+ *  host/peripheral/I2cBusSim.c).
+ */
+
+#ifndef PERIPHERAL_KB_I2C_QUEUE_H_
+#define PERIPHERAL_KB_I2C_QUEUE_H_
+
+#include <stdint.h>
+
+typedef struct kb_i2c_xfer_s kb_i2c_xfer_t;
+
+/**
+ * Called once per transaction when it ends, from the interrupt that ended
+ * it (or from the submitting context if the bus refused to start it).
+ * xfer->status tells the result. The descriptor may be submitted again.
+ */
+typedef void (*kb_i2c_callback_t)(kb_i2c_xfer_t *xfer);
+
+/**
+ * A write, a read, or a write then a read with a repeated start (e.g. a
+ * register address then its value). With mem_address_size, the register
+ * address is sent first and then either the write data or, after a
+ * repeated start, the read (not both). Start from a zeroed descriptor, fill
+ * the fields above the line before kb_i2c_queue_submit(), and do not touch
+ * the descriptor or its buffers until it completes.
+ */
+struct kb_i2c_xfer_s {
+    uint16_t address;               // 7-bit target address
+    const uint8_t *tx_buf;          // written first. NULL if tx_size is 0
+    uint16_t tx_size;
+    uint8_t *rx_buf;                // read after the write. NULL if rx_size is 0
+    uint16_t rx_size;
+    uint16_t mem_address;           // register address, if mem_address_size
+    uint8_t mem_address_size;       // 0, 1 or 2 bytes
+    uint8_t retries;                // extra attempts after an error
+    kb_i2c_callback_t callback;     // NULL for none
+    void *context;                  // for the callback
+    /* ---- */
+    volatile int8_t status;         // KB_BUSY while queued or running, then KB_OK / KB_ERROR / KB_TIMEOUT
+    uint8_t attempts_left;
+    kb_i2c_xfer_t *next;
+};
+
+/**
+ * What the queue needs from a bus
+ */
+typedef struct {
+    /**
+     * @brief Start @xfer. The bus calls kb_i2c_queue_done() when it ends
+     * @return KB_OK if it started
+     */
+    int (*start)(void *bus, kb_i2c_xfer_t *xfer);
+    /**
+     * @brief Keep the bus interrupt from running the queue, e.g. mask the
+     *        interrupts. May be NULL if submit and done never preempt
+     *        each other
+     * @return what unlock() needs to restore
+     */
+    uint32_t (*lock)(void);
+    void (*unlock)(uint32_t state);
+} kb_i2c_queue_ops_t;
+
+typedef struct {
+    const kb_i2c_queue_ops_t *ops;
+    void *bus;
+    kb_i2c_xfer_t *head;            // the running transaction when is_running
+    kb_i2c_xfer_t *tail;
+    uint8_t is_running;
+    uint32_t done_count;            // transactions completed with KB_OK
+    uint32_t error_count;           // transactions completed with an error
+    uint32_t retry_count;           // attempts repeated after an error
+} kb_i2c_queue_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void kb_i2c_queue_init(kb_i2c_queue_t *queue, const kb_i2c_queue_ops_t *ops, void *bus);
+
+/**
+ * @brief Queue @xfer behind the others and start it if the bus is idle
+ * @return KB_OK, KB_BUSY if @xfer is already queued, KB_ERROR if it is
+ *         empty, a buffer is missing or the register access is invalid
+ */
+int kb_i2c_queue_submit(kb_i2c_queue_t *queue, kb_i2c_xfer_t *xfer);
+
+/**
+ * @brief Called by the bus, usually from its interrupt, when the running
+ *        transaction ended with @status. Retries it or completes it, then
+ *        starts the next one
+ */
+void kb_i2c_queue_done(kb_i2c_queue_t *queue, int status);
+
+/**
+ * @brief Complete every queued transaction with @status, the running one
+ *        included. Stop the bus first (e.g. after a timeout)
+ */
+void kb_i2c_queue_abort(kb_i2c_queue_t *queue, int status);
+
+/**
+ * @brief Take @xfer, which waits behind others, off the queue and complete
+ *        it with @status. The running transaction and the bus are left alone
+ * @return KB_OK, KB_BUSY if @xfer is running (stop the bus and abort
+ *         instead), KB_ERROR if it is not queued, e.g. it has completed
+ */
+int kb_i2c_queue_cancel(kb_i2c_queue_t *queue, kb_i2c_xfer_t *xfer, int status);
+
+/**
+ * @return 1 if a transaction is queued or running
+ */
+int kb_i2c_queue_is_busy(const kb_i2c_queue_t *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PERIPHERAL_KB_I2C_QUEUE_H_ */
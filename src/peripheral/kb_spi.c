@@ -8,6 +8,10 @@
 #include "kb_common_source.h"
 #include "kb_spi.h"
 #include "kb_alternate_pins.h"
+#include "kb_periph.h"
+#include "kb_dma.h"
+#include "kb_tick.h"
+#include "kb_prof.h"
 
 // base name change. Used with kb_msg(). See @kb_base.h
 #ifdef KB_MSG_BASE
@@ -15,6 +19,7 @@
     #define KB_MSG_BASE "SPI"
 #endif
 
+static int get_index_(kb_spi_t spi);
 static uint32_t get_bus_freq_(kb_spi_t spi);
 static SPI_HandleTypeDef *get_handler (kb_spi_t spi);
 static void enable_spi_clk_ (kb_spi_t spi);
@@ -32,10 +37,57 @@ static const struct prescaler_ prescaler_table_ [];
     static SPI_HandleTypeDef spi_2_h_ = {.Instance = SPI2};
     static SPI_HandleTypeDef spi_3_h_ = {.Instance = SPI3};
     static SPI_HandleTypeDef spi_4_h_ = {.Instance = SPI4};
+
+    // Handle, clock, bus, IRQ and DMA streams of each SPI. See the DMA
+    // request mapping of RM0390. SPI3 avoids DMA1_Stream5 of USART2 (the
+    // terminal); SPI2 has no choice but the streams of I2C2/I2C3 RX/TX and
+    // SPI4 shares DMA2_Stream3 with SPI1, so the second one to start the
+    // DMA mode stays blocking.
+    static const struct {
+        SPI_HandleTypeDef *handler;
+        kb_periph_clk_t clk;
+        uint8_t apb;
+        IRQn_Type irq;
+        DMA_Stream_TypeDef *tx_stream;
+        uint32_t tx_channel;
+        DMA_Stream_TypeDef *rx_stream;
+        uint32_t rx_channel;
+    } spi_list_[] = {
+        {&spi_1_h_, {&RCC->APB2ENR, RCC_APB2ENR_SPI1EN}, 2, SPI1_IRQn,
+                DMA2_Stream3, DMA_CHANNEL_3, DMA2_Stream0, DMA_CHANNEL_3},
+        {&spi_2_h_, {&RCC->APB1ENR, RCC_APB1ENR_SPI2EN}, 1, SPI2_IRQn,
+                DMA1_Stream4, DMA_CHANNEL_0, DMA1_Stream3, DMA_CHANNEL_0},
+        {&spi_3_h_, {&RCC->APB1ENR, RCC_APB1ENR_SPI3EN}, 1, SPI3_IRQn,
+                DMA1_Stream7, DMA_CHANNEL_0, DMA1_Stream2, DMA_CHANNEL_0},
+        {&spi_4_h_, {&RCC->APB2ENR, RCC_APB2ENR_SPI4EN}, 2, SPI4_IRQn,
+                DMA2_Stream4, DMA_CHANNEL_5, DMA2_Stream3, DMA_CHANNEL_5}
+    };
+
+    // index + 1 of spi_list_ by the slot of the instance. See kb_periph.h
+    static const uint8_t slot_list_[] = {
+        [KB_PERIPH_SLOT(SPI1_BASE)] = 1,
+        [KB_PERIPH_SLOT(SPI2_BASE)] = 2,
+        [KB_PERIPH_SLOT(SPI3_BASE)] = 3,
+        [KB_PERIPH_SLOT(SPI4_BASE)] = 4
+    };
 #else
     #error "Please define device! " __FILE__ "\n"
 #endif
 
+#define SPI_NUM     (sizeof(spi_list_) / sizeof(spi_list_[0]))
+
+// State of the DMA mode, see kb_spi_dma_init()
+typedef struct {
+    DMA_HandleTypeDef tx_dma;
+    DMA_HandleTypeDef rx_dma;
+    volatile int8_t status;         // KB_BUSY while a transfer runs
+    uint8_t is_enabled;
+} spi_dma_t;
+
+static spi_dma_t dma_list_[SPI_NUM];
+
+static int dma_transfer_(int idx, uint8_t *tx_buf, uint8_t *rx_buf, uint16_t size, uint32_t timeout);
+
 
 int kb_spi_init(kb_spi_t spi, kb_spi_init_t *settings)
 {
@@ -212,11 +264,16 @@ inline int kb_spi_send(kb_spi_t spi, uint8_t* buf, uint16_t size)
 
 int kb_spi_send_timeout(kb_spi_t spi, uint8_t *buf, uint16_t size, uint32_t timeout)
 {
+    KB_PROF_ZONE("spi_send");
     // select handler
-    SPI_HandleTypeDef* handler = get_handler(spi);
-    if (NULL == handler) {
+    int idx = get_index_(spi);
+    if (idx < 0) {
         return KB_ERROR;
     }
+    SPI_HandleTypeDef* handler = spi_list_[idx].handler;
+    if (dma_list_[idx].is_enabled && (size >= KB_SPI_DMA_MIN_SIZE)) {
+        return dma_transfer_(idx, buf, NULL, size, timeout);
+    }
 
     int8_t status = HAL_SPI_Transmit(handler, buf, size, timeout);
     KB_CONVERT_STATUS(status);
@@ -236,10 +293,14 @@ int kb_spi_receive(kb_spi_t spi, uint8_t* buf, uint16_t size)
 int kb_spi_receive_timeout(kb_spi_t spi, uint8_t *buf, uint16_t size, uint32_t timeout)
 {
     // select handler
-    SPI_HandleTypeDef* handler = get_handler(spi);
-    if (NULL == handler) {
+    int idx = get_index_(spi);
+    if (idx < 0) {
         return KB_ERROR;
     }
+    SPI_HandleTypeDef* handler = spi_list_[idx].handler;
+    if (dma_list_[idx].is_enabled && (size >= KB_SPI_DMA_MIN_SIZE)) {
+        return dma_transfer_(idx, NULL, buf, size, timeout);
+    }
 
     int8_t status = HAL_SPI_Receive(handler, buf, size, timeout);
     KB_CONVERT_STATUS(status);
@@ -258,12 +319,16 @@ inline int kb_spi_sendreceive(kb_spi_t spi, uint8_t *tx_buf, uint8_t *rx_buf, ui
 
 int kb_spi_sendreceive_timeout(kb_spi_t spi, uint8_t *tx_buf, uint8_t *rx_buf, uint16_t size, uint32_t timeout)
 {
-
+    KB_PROF_ZONE("spi_sendreceive");
     // select handler
-    SPI_HandleTypeDef* handler = get_handler(spi);
-    if (NULL == handler) {
+    int idx = get_index_(spi);
+    if (idx < 0) {
         return KB_ERROR;
     }
+    SPI_HandleTypeDef* handler = spi_list_[idx].handler;
+    if (dma_list_[idx].is_enabled && (size >= KB_SPI_DMA_MIN_SIZE)) {
+        return dma_transfer_(idx, tx_buf, rx_buf, size, timeout);
+    }
 
     int8_t status = HAL_SPI_TransmitReceive(handler, tx_buf, rx_buf, size, timeout);
     KB_CONVERT_STATUS(status);
@@ -274,75 +339,213 @@ int kb_spi_sendreceive_timeout(kb_spi_t spi, uint8_t *tx_buf, uint8_t *rx_buf, u
 }
 
 /******************************************************************************
- * Private Functions
+ * DMA mode
  ******************************************************************************/
 
-static uint32_t get_bus_freq_(kb_spi_t spi)
+static void dma_config_(DMA_HandleTypeDef *dma, DMA_Stream_TypeDef *stream, uint32_t channel,
+        uint32_t direction)
+{
+    dma->Instance = stream;
+    dma->Init.Channel = channel;
+    dma->Init.Direction = direction;
+    dma->Init.PeriphInc = DMA_PINC_DISABLE;
+    dma->Init.MemInc = DMA_MINC_ENABLE;
+    dma->Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    dma->Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    dma->Init.Mode = DMA_NORMAL;
+    dma->Init.Priority = DMA_PRIORITY_HIGH;
+    dma->Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+}
+
+int kb_spi_dma_init(kb_spi_t spi)
 {
-    if ((spi == SPI2) || (spi == SPI3))
-    {	// APB1: SPI2, SPI3
-        return HAL_RCC_GetPCLK1Freq();
+    int idx = get_index_(spi);
+    if (idx < 0)
+    {
+        return KB_ERROR;
     }
-    else if ((spi == SPI1) || (spi == SPI4))
-    {	// APB2: SPI1, SPI4
-        return HAL_RCC_GetPCLK2Freq();
+    spi_dma_t *dma = &dma_list_[idx];
+    SPI_HandleTypeDef *handler = spi_list_[idx].handler;
+    if (dma->is_enabled)
+    {
+        return KB_OK;
     }
-    KB_DEBUG_ERROR("Wrong SPI device! Find a correct one.\r\n");
-    return 0;
-}
 
+    // a full-duplex transfer needs both streams
+    dma_config_(&dma->tx_dma, spi_list_[idx].tx_stream, spi_list_[idx].tx_channel, DMA_MEMORY_TO_PERIPH);
+    dma_config_(&dma->rx_dma, spi_list_[idx].rx_stream, spi_list_[idx].rx_channel, DMA_PERIPH_TO_MEMORY);
+    if (kb_dma_init(&dma->tx_dma, KB_SPI_IRQ_PRIORITY) != KB_OK)
+    {
+        KB_DEBUG_WARNING("TX DMA stream is used. Staying blocking.\r\n");
+        return KB_BUSY;
+    }
+    if (kb_dma_init(&dma->rx_dma, KB_SPI_IRQ_PRIORITY) != KB_OK)
+    {
+        KB_DEBUG_WARNING("RX DMA stream is used. Staying blocking.\r\n");
+        kb_dma_deinit(&dma->tx_dma);
+        return KB_BUSY;
+    }
+    __HAL_LINKDMA(handler, hdmatx, dma->tx_dma);
+    __HAL_LINKDMA(handler, hdmarx, dma->rx_dma);
+
+    // overrun and mode faults
+    HAL_NVIC_SetPriority(spi_list_[idx].irq, KB_SPI_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(spi_list_[idx].irq);
+    dma->status = KB_OK;
+    dma->is_enabled = 1;
+    return KB_OK;
+}
 
-static SPI_HandleTypeDef *get_handler (kb_spi_t spi)
+/**
+ * @brief Run a transfer by DMA and wait for its end. @tx_buf or @rx_buf is
+ *        NULL for a receive or a send
+ */
+static int dma_transfer_(int idx, uint8_t *tx_buf, uint8_t *rx_buf, uint16_t size, uint32_t timeout)
 {
-    if (spi == SPI1)
+    spi_dma_t *dma = &dma_list_[idx];
+    SPI_HandleTypeDef *handler = spi_list_[idx].handler;
+    int8_t status;
+
+    dma->status = KB_BUSY;
+    if (rx_buf == NULL)
     {
-        return &spi_1_h_;
+        status = HAL_SPI_Transmit_DMA(handler, tx_buf, size);
     }
-    else if (spi == SPI2)
+    else if (tx_buf == NULL)
     {
-        return &spi_2_h_;
+        status = HAL_SPI_Receive_DMA(handler, rx_buf, size);
     }
-    else if (spi == SPI3)
+    else
     {
-        return &spi_3_h_;
+        status = HAL_SPI_TransmitReceive_DMA(handler, tx_buf, rx_buf, size);
     }
-    else if (spi == SPI4)
+    KB_CONVERT_STATUS(status);
+    if (status != KB_OK)
     {
-        return &spi_4_h_;
+        dma->status = KB_OK;
+        KB_DEBUG_ERROR("Error in starting DMA.\r\n");
+        return status;
     }
-    else
+
+    uint32_t start = kb_tick_ms();
+    while (dma->status == KB_BUSY)
     {
-        KB_DEBUG_ERROR("Wrong SPI device selected!\r\n");
-        return NULL;
+        if ((kb_tick_ms() - start) >= timeout)
+        {
+            HAL_SPI_DMAStop(handler);
+            dma->status = KB_OK;
+            KB_DEBUG_ERROR("Timeout in DMA transfer.\r\n");
+            return KB_TIMEOUT;
+        }
+    }
+    if (dma->status != KB_OK)
+    {
+        KB_DEBUG_ERROR("Error in DMA transfer.\r\n");
     }
+    return dma->status;
 }
 
+/******************************************************************************
+ * Private Functions
+ ******************************************************************************/
 
-static void enable_spi_clk_ (kb_spi_t spi)
+static int get_index_(kb_spi_t spi)
 {
-    if (spi == SPI1)
+    int idx = kb_periph_index(spi, slot_list_, sizeof(slot_list_));
+    if (idx < 0)
     {
-        __SPI1_CLK_ENABLE();
+        KB_DEBUG_ERROR("Wrong SPI device selected!\r\n");
     }
-    else if (spi == SPI2)
+    return idx;
+}
+
+
+static uint32_t get_bus_freq_(kb_spi_t spi)
+{
+    int idx = get_index_(spi);
+    if (idx < 0)
     {
-        __SPI2_CLK_ENABLE();
+        return 0;
     }
-    else if (spi == SPI3)
+    // APB1: SPI2, SPI3. APB2: SPI1, SPI4
+    return (spi_list_[idx].apb == 1) ? HAL_RCC_GetPCLK1Freq() : HAL_RCC_GetPCLK2Freq();
+}
+
+
+static SPI_HandleTypeDef *get_handler (kb_spi_t spi)
+{
+    int idx = get_index_(spi);
+    if (idx < 0)
     {
-        __SPI3_CLK_ENABLE();
+        return NULL;
     }
-    else if (spi == SPI4)
+    return spi_list_[idx].handler;
+}
+
+
+static void enable_spi_clk_ (kb_spi_t spi)
+{
+    int idx = get_index_(spi);
+    if (idx < 0)
     {
-        __SPI4_CLK_ENABLE();
+        return;
     }
-    else
+    kb_periph_clk_enable(&spi_list_[idx].clk);
+}
+
+
+/******************************************************************************
+ * Interrupt Handlers and HAL callbacks
+ ******************************************************************************/
+
+static void dma_done_(SPI_HandleTypeDef *hspi, int8_t status)
+{
+    int idx = kb_periph_index(hspi->Instance, slot_list_, sizeof(slot_list_));
+    if ((idx >= 0) && dma_list_[idx].is_enabled)
     {
-        KB_DEBUG_ERROR("Wrong SPI device selected!\r\n");
+        dma_list_[idx].status = status;
     }
-    return;
 }
 
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    dma_done_(hspi, KB_OK);
+}
+
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    dma_done_(hspi, KB_OK);
+}
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    dma_done_(hspi, KB_OK);
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    dma_done_(hspi, KB_ERROR);
+}
+
+void SPI1_IRQHandler(void)
+{
+    HAL_SPI_IRQHandler(&spi_1_h_);
+}
+
+void SPI2_IRQHandler(void)
+{
+    HAL_SPI_IRQHandler(&spi_2_h_);
+}
+
+void SPI3_IRQHandler(void)
+{
+    HAL_SPI_IRQHandler(&spi_3_h_);
+}
+
+void SPI4_IRQHandler(void)
+{
+    HAL_SPI_IRQHandler(&spi_4_h_);
+}
 
 #if defined(STM32F446xx)
     static const uint8_t prescaler_table_size_ = 8;
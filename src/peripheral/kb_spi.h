@@ -29,6 +29,15 @@ typedef struct{
     kb_spi_polarity_t polarity;
 }kb_spi_init_t;
 
+// NVIC preemption priority of the SPI and DMA interrupts in DMA mode
+#ifndef KB_SPI_IRQ_PRIORITY
+    #define KB_SPI_IRQ_PRIORITY     6
+#endif
+// Shorter transfers stay blocking, which costs less than setting up the DMA
+#ifndef KB_SPI_DMA_MIN_SIZE
+    #define KB_SPI_DMA_MIN_SIZE     8
+#endif
+
 #ifdef __cplusplus
 extern "C"{
 #endif
@@ -45,6 +54,18 @@ int kb_spi_receive_timeout(kb_spi_t spi, uint8_t *buf, uint16_t size, uint32_t t
 int kb_spi_sendreceive(kb_spi_t spi, uint8_t *tx_buf, uint8_t *rx_buf, uint16_t size);
 int kb_spi_sendreceive_timeout(kb_spi_t spi, uint8_t *tx_buf, uint8_t *rx_buf, uint16_t size, uint32_t timeout);
 
+/**
+ * DMA mode. After kb_spi_init(), kb_spi_send(), kb_spi_receive() and
+ * kb_spi_sendreceive() of KB_SPI_DMA_MIN_SIZE bytes or more run by DMA and
+ * wait for its end, or stop it on a timeout. Shorter ones stay blocking.
+ * This mode uses the SPIx_IRQHandler()s, HAL_SPI_TxCpltCallback(),
+ * HAL_SPI_RxCpltCallback(), HAL_SPI_TxRxCpltCallback() and
+ * HAL_SPI_ErrorCallback().
+ * @return KB_OK, KB_BUSY if a DMA stream of the SPI is used by another
+ *         driver; the SPI then stays blocking
+ */
+int kb_spi_dma_init(kb_spi_t spi);
+
 #ifdef __cplusplus
 }
 #endif
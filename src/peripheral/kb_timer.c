@@ -8,6 +8,7 @@
 #include "kb_common_source.h"
 #include "kb_timer.h"
 #include "kb_alternate_pins.h"
+#include "kb_periph.h"
 
 // base name change. Used with kb_msg(). See @kb_base.h
 #ifdef KB_MSG_BASE
@@ -15,6 +16,7 @@
     #define KB_MSG_BASE "TIMER"
 #endif
 
+static int get_index_(kb_timer_t timer);
 static uint32_t get_bus_freq_(kb_timer_t timer);
 static TIM_HandleTypeDef *get_handler (kb_timer_t timer);
 static void enable_timer_clk_ (kb_timer_t timer);
@@ -34,6 +36,28 @@ static void enable_timer_clk_ (kb_timer_t timer);
     static TIM_HandleTypeDef timer_12_h_ = {.Instance = TIM12};
     static TIM_HandleTypeDef timer_13_h_ = {.Instance = TIM13};
     static TIM_HandleTypeDef timer_14_h_ = {.Instance = TIM14};
+
+    // Handle, clock and bus of each timer, in the order of kb_timer_t
+    static const struct {
+        TIM_HandleTypeDef *handler;
+        kb_periph_clk_t clk;
+        uint8_t apb;
+    } timer_list_[] = {
+        {&timer_1_h_, {&RCC->APB2ENR, RCC_APB2ENR_TIM1EN}, 2},
+        {&timer_2_h_, {&RCC->APB1ENR, RCC_APB1ENR_TIM2EN}, 1},
+        {&timer_3_h_, {&RCC->APB1ENR, RCC_APB1ENR_TIM3EN}, 1},
+        {&timer_4_h_, {&RCC->APB1ENR, RCC_APB1ENR_TIM4EN}, 1},
+        {&timer_5_h_, {&RCC->APB1ENR, RCC_APB1ENR_TIM5EN}, 1},
+        {&timer_6_h_, {&RCC->APB1ENR, RCC_APB1ENR_TIM6EN}, 1},
+        {&timer_7_h_, {&RCC->APB1ENR, RCC_APB1ENR_TIM7EN}, 1},
+        {&timer_8_h_, {&RCC->APB2ENR, RCC_APB2ENR_TIM8EN}, 2},
+        {&timer_9_h_, {&RCC->APB2ENR, RCC_APB2ENR_TIM9EN}, 2},
+        {&timer_10_h_, {&RCC->APB2ENR, RCC_APB2ENR_TIM10EN}, 2},
+        {&timer_11_h_, {&RCC->APB2ENR, RCC_APB2ENR_TIM11EN}, 2},
+        {&timer_12_h_, {&RCC->APB1ENR, RCC_APB1ENR_TIM12EN}, 1},
+        {&timer_13_h_, {&RCC->APB1ENR, RCC_APB1ENR_TIM13EN}, 1},
+        {&timer_14_h_, {&RCC->APB1ENR, RCC_APB1ENR_TIM14EN}, 1}
+    };
 #else
     #error "Please define device!"
 #endif
@@ -149,13 +173,25 @@ int kb_pwm_permyriad(kb_timer_t timer, kb_timer_ch_t channel, uint16_t duty_cycl
         return KB_ERROR;
     }
 
-    // make configuration
-    TIM_OC_InitTypeDef config;
-    config.OCMode = TIM_OCMODE_PWM1;
-    config.OCPolarity = TIM_OCPOLARITY_HIGH;
-    config.OCFastMode = TIM_OCFAST_DISABLE;
-    config.OCIdleState = TIM_OCIDLESTATE_RESET;
-    config.OCNIdleState = TIM_OCNIDLESTATE_RESET;
+    uint32_t hal_channel;
+    switch (channel)
+    {
+    case CH_1:
+        hal_channel = TIM_CHANNEL_1;
+        break;
+    case CH_2:
+        hal_channel = TIM_CHANNEL_2;
+        break;
+    case CH_3:
+        hal_channel = TIM_CHANNEL_3;
+        break;
+    case CH_4:
+        hal_channel = TIM_CHANNEL_4;
+        break;
+    default:
+        KB_DEBUG_ERROR("Choose correct channel!\r\n");
+        return KB_ERROR;
+    }
 
     // setting duty cycle
     if(duty_cycle_permyriad > 10000)
@@ -165,9 +201,25 @@ int kb_pwm_permyriad(kb_timer_t timer, kb_timer_ch_t channel, uint16_t duty_cycl
     }
     uint16_t period = handler->Init.Period;
     uint16_t pulse_width = ((uint32_t)period * duty_cycle_permyriad)/10000;
+
+    // while the channel is running only the compare register changes, because
+    // HAL_TIM_PWM_ConfigChannel() disables the output. Fast enough for a control loop.
+    if (handler->Instance->CCER & (TIM_CCER_CC1E << hal_channel))
+    {
+        __HAL_TIM_SET_COMPARE(handler, hal_channel, pulse_width);
+        return KB_OK;
+    }
+
+    // make configuration
+    TIM_OC_InitTypeDef config;
+    config.OCMode = TIM_OCMODE_PWM1;
+    config.OCPolarity = TIM_OCPOLARITY_HIGH;
+    config.OCFastMode = TIM_OCFAST_DISABLE;
+    config.OCIdleState = TIM_OCIDLESTATE_RESET;
+    config.OCNIdleState = TIM_OCNIDLESTATE_RESET;
     config.Pulse = pulse_width;
 
-    int8_t status = HAL_TIM_PWM_ConfigChannel(handler, &config, channel);
+    int8_t status = HAL_TIM_PWM_ConfigChannel(handler, &config, hal_channel);
     KB_CONVERT_STATUS(status);
     if(KB_OK != status)
     {
@@ -262,7 +314,15 @@ int kb_encoder_init(kb_timer_t timer, kb_encoder_init_t *setting)
     }
     enable_timer_clk_(timer);
 
-    handler->Init.Period = 0xffffffff; //0xFFFF
+    // TIM2 and TIM5 are 32-bit, the others are 16-bit and wrap at 0xFFFF
+    if ((timer == TIMER2) || (timer == TIMER5))
+    {
+        handler->Init.Period = 0xffffffff;
+    }
+    else
+    {
+        handler->Init.Period = 0xffff;
+    }
     handler->Init.Prescaler = setting->prescaler;
     handler->Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
     handler->Init.RepetitionCounter = 0;
@@ -378,161 +438,64 @@ int32_t kb_encoder_count(kb_timer_t timer)
  * Private Functions
  ******************************************************************************/
 
+static int get_index_(kb_timer_t timer)
+{
+    if ((unsigned int)timer >= sizeof(timer_list_) / sizeof(timer_list_[0]))
+    {
+        KB_DEBUG_ERROR("Wrong Timer device selected!\r\n");
+        return -1;
+    }
+    return (int)timer;
+}
+
+
 static uint32_t get_bus_freq_(kb_timer_t timer)
 {
     RCC_ClkInitTypeDef rcc_config;
     uint32_t flash_latency;
     uint8_t timer_multiplier = 1;
+    int idx = get_index_(timer);
+    if (idx < 0)
+    {
+        return 0;
+    }
     HAL_RCC_GetClockConfig(&rcc_config, &flash_latency);
-    if ((timer == TIMER2) || (timer == TIMER3) || (timer == TIMER4) || (timer == TIMER5) || (timer == TIMER6)
-            || (timer == TIMER7) || (timer == TIMER12) || (timer == TIMER13) || (timer == TIMER14))
-    {	// APB1
+    if (timer_list_[idx].apb == 1)
+    {	// APB1: TIM2 to TIM7, TIM12 to TIM14
         if(rcc_config.APB1CLKDivider != RCC_HCLK_DIV1)
         {	// See RCC datasheet
             timer_multiplier = 2;
         }
         return HAL_RCC_GetPCLK1Freq() * timer_multiplier;
     }
-    else if ((timer == TIMER1) || (timer == TIMER8) || (timer == TIMER9) || (timer == TIMER10) || (timer == TIMER11))
-    {	// APB2
+    else
+    {	// APB2: TIM1, TIM8 to TIM11
         if(rcc_config.APB2CLKDivider != RCC_HCLK_DIV1)
         {	// See RCC datasheet
             timer_multiplier = 2;
         }
         return HAL_RCC_GetPCLK2Freq() * timer_multiplier;
     }
-    KB_DEBUG_ERROR("Wrong TIM device! Find a correct one.\r\n");
-    return 0;
 }
 
 
 static TIM_HandleTypeDef *get_handler (kb_timer_t timer)
 {
-    if (timer == TIMER1)
-    {
-        return &timer_1_h_;
-    }
-    else if (timer == TIMER2)
+    int idx = get_index_(timer);
+    if (idx < 0)
     {
-        return &timer_2_h_;
-    }
-    else if (timer == TIMER3)
-    {
-        return &timer_3_h_;
-    }
-    else if (timer == TIMER4)
-    {
-        return &timer_4_h_;
-    }
-    else if (timer == TIMER5)
-    {
-        return &timer_5_h_;
-    }
-    else if (timer == TIMER6)
-    {
-        return &timer_6_h_;
-    }
-    else if (timer == TIMER7)
-    {
-        return &timer_7_h_;
-    }
-    else if (timer == TIMER8)
-    {
-        return &timer_8_h_;
-    }
-    else if (timer == TIMER9)
-    {
-        return &timer_9_h_;
-    }
-    else if (timer == TIMER10)
-    {
-        return &timer_10_h_;
-    }
-    else if (timer == TIMER11)
-    {
-        return &timer_11_h_;
-    }
-    else if (timer == TIMER12)
-    {
-        return &timer_12_h_;
-    }
-    else if (timer == TIMER13)
-    {
-        return &timer_13_h_;
-    }
-    else if (timer == TIMER14)
-    {
-        return &timer_14_h_;
-    }
-    else
-    {
-        KB_DEBUG_ERROR("Wrong Timer device selected!\r\n");
         return NULL;
     }
+    return timer_list_[idx].handler;
 }
 
 
 static void enable_timer_clk_ (kb_timer_t timer)
 {
-    if (timer == TIMER1)
-    {
-        __TIM1_CLK_ENABLE();
-    }
-    else if (timer == TIMER2)
-    {
-        __TIM2_CLK_ENABLE();
-    }
-    else if (timer == TIMER3)
-    {
-        __TIM3_CLK_ENABLE();
-    }
-    else if (timer == TIMER4)
-    {
-        __TIM4_CLK_ENABLE();
-    }
-    else if (timer == TIMER5)
-    {
-        __TIM5_CLK_ENABLE();
-    }
-    else if (timer == TIMER6)
-    {
-        __TIM6_CLK_ENABLE();
-    }
-    else if (timer == TIMER7)
-    {
-        __TIM7_CLK_ENABLE();
-    }
-    else if (timer == TIMER8)
-    {
-        __TIM8_CLK_ENABLE();
-    }
-    else if (timer == TIMER9)
-    {
-        __TIM9_CLK_ENABLE();
-    }
-    else if (timer == TIMER10)
-    {
-        __TIM10_CLK_ENABLE();
-    }
-    else if (timer == TIMER11)
-    {
-        __TIM11_CLK_ENABLE();
-    }
-    else if (timer == TIMER12)
-    {
-        __TIM12_CLK_ENABLE();
-    }
-    else if (timer == TIMER13)
-    {
-        __TIM13_CLK_ENABLE();
-    }
-    else if (timer == TIMER14)
-    {
-        __TIM14_CLK_ENABLE();
-    }
-    else
+    int idx = get_index_(timer);
+    if (idx < 0)
     {
-        KB_DEBUG_ERROR("Wrong Timer device!\r\n");
+        return;
     }
-    return;
+    kb_periph_clk_enable(&timer_list_[idx].clk);
 }
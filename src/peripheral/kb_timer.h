@@ -72,6 +72,7 @@ int 	kb_encoder_init(kb_timer_t timer, kb_encoder_init_t *setting);
 int 	kb_encoder_start(kb_timer_t timer);
 int 	kb_encoder_stop(kb_timer_t timer);
 int32_t kb_encoder_set(kb_timer_t timer, int32_t input);
+// raw counter: it wraps at 0xFFFF except on TIMER2 and TIMER5 (32-bit)
 int32_t kb_encoder_count(kb_timer_t timer);
 
 #ifdef __cplusplus
@@ -8,6 +8,10 @@
 #include "kb_common_source.h"
 #include "kb_uart.h"
 #include "kb_alternate_pins.h"
+#include "kb_dma.h"
+#include "kb_periph.h"
+#include "kb_ring.h"
+#include "kb_tick.h"
 #include <string.h>
 
 // base name change. Used with kb_msg(). See @kb_base.h
@@ -27,52 +31,97 @@
     #error "Please define device! " __FILE__ "\n"
 #endif
 
+// State of the non-blocking mode, see kb_uart_async_init()
+typedef struct {
+    UART_HandleTypeDef *handler;
+    DMA_HandleTypeDef tx_dma;
+    DMA_HandleTypeDef rx_dma;
+    kb_ring_t tx_ring;
+    kb_ring_t rx_ring;
+    uint8_t rx_dma_buffer[KB_UART_RX_DMA_SIZE];
+    uint32_t rx_dma_pos;        // bytes of rx_dma_buffer already moved
+    volatile uint32_t tx_chunk; // bytes in the running TX DMA transfer, 0 when idle
+    uint8_t is_enabled;
+    kb_uart_stats_t stats;
+} uart_async_t;
 
-int kb_uart_init(kb_uart_t uart, uint32_t baud_rate)
+// Handle, clock, IRQ and DMA streams of each UART. See the DMA request
+// mapping of RM0390
+typedef struct {
+    USART_TypeDef *instance;
+    UART_HandleTypeDef *handler;
+    kb_periph_clk_t clk;
+    IRQn_Type irq;
+    DMA_Stream_TypeDef *tx_stream;
+    uint32_t tx_channel;
+    DMA_Stream_TypeDef *rx_stream;
+    uint32_t rx_channel;
+} uart_hw_t;
+
+#define UART_NUM    6
+
+static const uart_hw_t hw_list_[UART_NUM] = {
+    {USART1, &uart_1_h_, {&RCC->APB2ENR, RCC_APB2ENR_USART1EN}, USART1_IRQn,
+            DMA2_Stream7, DMA_CHANNEL_4, DMA2_Stream5, DMA_CHANNEL_4},
+    {USART2, &uart_2_h_, {&RCC->APB1ENR, RCC_APB1ENR_USART2EN}, USART2_IRQn,
+            DMA1_Stream6, DMA_CHANNEL_4, DMA1_Stream5, DMA_CHANNEL_4},
+    {USART3, &uart_3_h_, {&RCC->APB1ENR, RCC_APB1ENR_USART3EN}, USART3_IRQn,
+            DMA1_Stream3, DMA_CHANNEL_4, DMA1_Stream1, DMA_CHANNEL_4},
+    {UART4,  &uart_4_h_, {&RCC->APB1ENR, RCC_APB1ENR_UART4EN}, UART4_IRQn,
+            DMA1_Stream4, DMA_CHANNEL_4, DMA1_Stream2, DMA_CHANNEL_4},
+    {UART5,  &uart_5_h_, {&RCC->APB1ENR, RCC_APB1ENR_UART5EN}, UART5_IRQn,
+            DMA1_Stream7, DMA_CHANNEL_4, DMA1_Stream0, DMA_CHANNEL_4},
+    {USART6, &uart_6_h_, {&RCC->APB2ENR, RCC_APB2ENR_USART6EN}, USART6_IRQn,
+            DMA2_Stream6, DMA_CHANNEL_5, DMA2_Stream1, DMA_CHANNEL_5}
+};
+
+// index + 1 of hw_list_ by the slot of the instance. See kb_periph.h
+static const uint8_t slot_list_[] = {
+    [KB_PERIPH_SLOT(USART1_BASE)] = 1,
+    [KB_PERIPH_SLOT(USART2_BASE)] = 2,
+    [KB_PERIPH_SLOT(USART3_BASE)] = 3,
+    [KB_PERIPH_SLOT(UART4_BASE)] = 4,
+    [KB_PERIPH_SLOT(UART5_BASE)] = 5,
+    [KB_PERIPH_SLOT(USART6_BASE)] = 6
+};
+
+static uart_async_t async_list_[UART_NUM];
+
+static int uart_index_(kb_uart_t uart)
 {
-    // select handler
-    UART_HandleTypeDef* handler;
-    if(uart == USART1)
-    {
-        handler = &uart_1_h_;
-        __USART1_CLK_ENABLE();
-        handler->Instance = USART1;
-    }
-    else if(uart == USART2)
-    {
-        handler = &uart_2_h_;
-        __USART2_CLK_ENABLE();
-        handler->Instance = USART2;
+    return kb_periph_index(uart, slot_list_, sizeof(slot_list_));
+}
 
-    }
-    else if(uart == USART3)
-    {
-        handler = &uart_3_h_;
-        __USART3_CLK_ENABLE();
-        handler->Instance = USART3;
-    }
-    else if(uart == UART4)
-    {
-        handler = &uart_4_h_;
-        __UART4_CLK_ENABLE();
-        handler->Instance = UART4;
-    }
-    else if(uart == UART5)
-    {
-        handler = &uart_5_h_;
-        __UART5_CLK_ENABLE();
-        handler->Instance = UART5;
-    }
-    else if(uart == USART6)
+static uart_async_t *get_async_(kb_uart_t uart)
+{
+    int idx = uart_index_(uart);
+    if ((idx < 0) || !async_list_[idx].is_enabled)
     {
-        handler = &uart_6_h_;
-        __USART6_CLK_ENABLE();
-        handler->Instance = USART6;
+        return NULL;
     }
-    else
+    return &async_list_[idx];
+}
+
+static uart_async_t *async_of_handler_(UART_HandleTypeDef *handler)
+{
+    return get_async_(handler->Instance);
+}
+
+static int send_async_(uart_async_t *async, const uint8_t *buffer, uint32_t size, uint32_t timeout);
+static int receive_async_(uart_async_t *async, uint8_t *buffer, uint32_t size, uint32_t timeout);
+
+
+int kb_uart_init(kb_uart_t uart, uint32_t baud_rate)
+{
+    // select handler
+    int idx = uart_index_(uart);
+    if (idx < 0)
     {
         return KB_ERROR;
     }
+    UART_HandleTypeDef* handler = hw_list_[idx].handler;
+    kb_periph_clk_enable(&hw_list_[idx].clk);
+    handler->Instance = hw_list_[idx].instance;
 
     handler->Init.BaudRate = baud_rate;
     handler->Init.WordLength = UART_WORDLENGTH_8B;
@@ -128,81 +177,406 @@ int kb_uart_rx_pin(kb_uart_t uart, kb_gpio_port_t port, kb_gpio_pin_t pin, kb_gp
 int kb_uart_send(kb_uart_t uart, uint8_t *buffer, uint16_t size, uint32_t timeout)
 {
     // select handler
-    UART_HandleTypeDef* handler;
-    if(uart == USART1)
+    int idx = uart_index_(uart);
+    if (idx < 0)
+    {
+        return KB_ERROR;
+    }
+    if (async_list_[idx].is_enabled)
+    {
+        return send_async_(&async_list_[idx], buffer, size, timeout);
+    }
+    UART_HandleTypeDef* handler = hw_list_[idx].handler;
+
+    int8_t result = HAL_UART_Transmit(handler, buffer, size, timeout);
+    KB_CONVERT_STATUS(result);
+    return  (kb_status_t)result;
+}
+
+int kb_uart_send_str(kb_uart_t uart, char *str, uint32_t timeout)
+{
+    return	kb_uart_send(uart, (uint8_t *)str, (uint16_t)strlen(str), timeout);
+}
+
+int kb_uart_receive(kb_uart_t uart, uint8_t *buffer, uint16_t size, uint32_t timeout)
+{
+    // select handler
+    int idx = uart_index_(uart);
+    if (idx < 0)
     {
-        handler = &uart_1_h_;
+        return KB_ERROR;
     }
-    else if(uart == USART2)
+    if (async_list_[idx].is_enabled)
     {
-        handler = &uart_2_h_;
+        return receive_async_(&async_list_[idx], buffer, size, timeout);
     }
-    else if(uart == USART3)
+    UART_HandleTypeDef* handler = hw_list_[idx].handler;
+
+    int8_t result = HAL_UART_Receive(handler, buffer, size, 0);
+    KB_CONVERT_STATUS(result);
+    return  (kb_status_t)result;
+}
+
+/******************************************************************************
+ * Non-blocking mode
+ ******************************************************************************/
+
+/**
+ * @brief Start the next TX DMA transfer from the TX ring, if idle. Called
+ *        from the UART interrupt, or with the interrupts masked
+ */
+static void tx_start_(uart_async_t *async)
+{
+    const uint8_t *data;
+    uint32_t size;
+
+    if (async->tx_chunk != 0)
     {
-        handler = &uart_3_h_;
+        return;
     }
-    else if(uart == UART4)
+    size = kb_ring_peek(&async->tx_ring, &data);
+    if (size == 0)
     {
-        handler = &uart_4_h_;
+        return;
     }
-    else if(uart == UART5)
+    if (size > 0xFFFF)
     {
-        handler = &uart_5_h_;
+        size = 0xFFFF;
     }
-    else if(uart == USART6)
+    async->tx_chunk = size;
+    if (HAL_UART_Transmit_DMA(async->handler, (uint8_t *)data, (uint16_t)size) != HAL_OK)
     {
-        handler = &uart_6_h_;
+        async->tx_chunk = 0;
+        async->stats.errors++;
     }
-    else
+}
+
+static void tx_kick_(uart_async_t *async)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    tx_start_(async);
+    __set_PRIMASK(primask);
+}
+
+static void rx_push_(uart_async_t *async, uint32_t from, uint32_t to)
+{
+    uint32_t size = to - from;
+    uint32_t written = kb_ring_write(&async->rx_ring, &async->rx_dma_buffer[from], size);
+    async->stats.rx_bytes += size;
+    async->stats.rx_dropped += size - written;
+}
+
+/**
+ * @brief Move what the RX DMA received since the last call to the RX ring.
+ *        Called from the UART and the DMA interrupts
+ */
+static void rx_drain_(uart_async_t *async)
+{
+    uint32_t pos = KB_UART_RX_DMA_SIZE - __HAL_DMA_GET_COUNTER(&async->rx_dma);
+    if (pos >= KB_UART_RX_DMA_SIZE)
     {
-        return KB_ERROR;
+        pos = 0;
+    }
+    if (pos > async->rx_dma_pos)
+    {
+        rx_push_(async, async->rx_dma_pos, pos);
     }
+    else if (pos < async->rx_dma_pos)
+    {
+        // the circular DMA wrapped around
+        rx_push_(async, async->rx_dma_pos, KB_UART_RX_DMA_SIZE);
+        rx_push_(async, 0, pos);
+    }
+    async->rx_dma_pos = pos;
+}
 
-    int8_t result = HAL_UART_Transmit(handler, buffer, size, timeout);
+static int rx_start_(uart_async_t *async)
+{
+    async->rx_dma_pos = 0;
+    // an overrun left from an error would stop the DMA again at once
+    __HAL_UART_CLEAR_OREFLAG(async->handler);
+    int8_t result = HAL_UART_Receive_DMA(async->handler, async->rx_dma_buffer, KB_UART_RX_DMA_SIZE);
     KB_CONVERT_STATUS(result);
-    return  (kb_status_t)result;
+    if (result == KB_OK)
+    {
+        __HAL_UART_CLEAR_IDLEFLAG(async->handler);
+        __HAL_UART_ENABLE_IT(async->handler, UART_IT_IDLE);
+    }
+    return result;
 }
 
-int kb_uart_send_str(kb_uart_t uart, char *str, uint32_t timeout)
+static void dma_config_(DMA_HandleTypeDef *dma, DMA_Stream_TypeDef *stream, uint32_t channel,
+        uint32_t direction, uint32_t mode)
 {
-    return	kb_uart_send(uart, (uint8_t *)str, (uint16_t)strlen(str), timeout);
+    dma->Instance = stream;
+    dma->Init.Channel = channel;
+    dma->Init.Direction = direction;
+    dma->Init.PeriphInc = DMA_PINC_DISABLE;
+    dma->Init.MemInc = DMA_MINC_ENABLE;
+    dma->Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    dma->Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    dma->Init.Mode = mode;
+    dma->Init.Priority = DMA_PRIORITY_LOW;
+    dma->Init.FIFOMode = DMA_FIFOMODE_DISABLE;
 }
 
-int kb_uart_receive(kb_uart_t uart, uint8_t *buffer, uint16_t size, uint32_t timeout)
+int kb_uart_async_init(kb_uart_t uart, uint8_t *tx_buffer, uint32_t tx_size,
+        uint8_t *rx_buffer, uint32_t rx_size)
 {
+    int idx = uart_index_(uart);
+    if (idx < 0)
+    {
+        return KB_ERROR;
+    }
+    const uart_hw_t *hw = &hw_list_[idx];
+    uart_async_t *async = &async_list_[idx];
+    if (async->is_enabled)
+    {
+        return KB_BUSY;
+    }
+    if ((kb_ring_init(&async->tx_ring, tx_buffer, tx_size) != 0)
+            || (kb_ring_init(&async->rx_ring, rx_buffer, rx_size) != 0))
+    {
+        KB_DEBUG_ERROR("The ring sizes must be powers of two!\r\n");
+        return KB_ERROR;
+    }
+    async->handler = hw->handler;
+    async->tx_chunk = 0;
+    memset(&async->stats, 0, sizeof(async->stats));
 
-    // select handler
-    UART_HandleTypeDef* handler;
-    if(uart == USART1)
+    dma_config_(&async->tx_dma, hw->tx_stream, hw->tx_channel, DMA_MEMORY_TO_PERIPH, DMA_NORMAL);
+    dma_config_(&async->rx_dma, hw->rx_stream, hw->rx_channel, DMA_PERIPH_TO_MEMORY, DMA_CIRCULAR);
+    int result = kb_dma_init(&async->tx_dma, KB_UART_IRQ_PRIORITY);
+    if (result != KB_OK)
     {
-        handler = &uart_1_h_;
+        return result;
     }
-    else if(uart == USART2)
+    result = kb_dma_init(&async->rx_dma, KB_UART_IRQ_PRIORITY);
+    if (result != KB_OK)
     {
-        handler = &uart_2_h_;
+        kb_dma_deinit(&async->tx_dma);
+        return result;
     }
-    else if(uart == USART3)
+    __HAL_LINKDMA(async->handler, hdmatx, async->tx_dma);
+    __HAL_LINKDMA(async->handler, hdmarx, async->rx_dma);
+
+    HAL_NVIC_SetPriority(hw->irq, KB_UART_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(hw->irq);
+    async->is_enabled = 1;
+    return rx_start_(async);
+}
+
+/**
+ * @brief Put bytes in the TX ring with interrupts masked, since the senders
+ *        may be several tasks and interrupt handlers and the ring takes one
+ *        producer at a time. With @whole, all @size bytes or none
+ * @return bytes put in the ring
+ */
+static uint32_t tx_put_(uart_async_t *async, const uint8_t *buffer, uint32_t size, int whole)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t written = 0;
+    __disable_irq();
+    if (!whole || (kb_ring_space(&async->tx_ring) >= size))
     {
-        handler = &uart_3_h_;
+        written = kb_ring_write(&async->tx_ring, buffer, size);
     }
-    else if(uart == UART4)
+    __set_PRIMASK(primask);
+    return written;
+}
+
+uint32_t kb_uart_write(kb_uart_t uart, const uint8_t *buffer, uint32_t size)
+{
+    uart_async_t *async = get_async_(uart);
+    if (async == NULL)
     {
-        handler = &uart_4_h_;
+        return 0;
     }
-    else if(uart == UART5)
+    size = tx_put_(async, buffer, size, 0);
+    tx_kick_(async);
+    return size;
+}
+
+uint32_t kb_uart_read(kb_uart_t uart, uint8_t *buffer, uint32_t size)
+{
+    uart_async_t *async = get_async_(uart);
+    if (async == NULL)
     {
-        handler = &uart_5_h_;
+        return 0;
     }
-    else if(uart == USART6)
+    return kb_ring_read(&async->rx_ring, buffer, size);
+}
+
+uint32_t kb_uart_available(kb_uart_t uart)
+{
+    uart_async_t *async = get_async_(uart);
+    if (async == NULL)
+    {
+        return 0;
+    }
+    return kb_ring_count(&async->rx_ring);
+}
+
+int kb_uart_flush(kb_uart_t uart, uint32_t timeout)
+{
+    uart_async_t *async = get_async_(uart);
+    if (async == NULL)
+    {
+        return KB_ERROR;
+    }
+    uint32_t start = kb_tick_ms();
+    while ((kb_ring_count(&async->tx_ring) != 0) || (async->tx_chunk != 0))
     {
-        handler = &uart_6_h_;
+        if ((kb_tick_ms() - start) >= timeout)
+        {
+            return KB_TIMEOUT;
+        }
     }
-    else
+    return KB_OK;
+}
+
+int kb_uart_get_stats(kb_uart_t uart, kb_uart_stats_t *stats)
+{
+    uart_async_t *async = get_async_(uart);
+    if (async == NULL)
     {
         return KB_ERROR;
     }
+    *stats = async->stats;
+    stats->tx_pending = kb_ring_count(&async->tx_ring);
+    stats->rx_pending = kb_ring_count(&async->rx_ring);
+    stats->tx_high_water = async->tx_ring.high_water;
+    stats->rx_high_water = async->rx_ring.high_water;
+    return KB_OK;
+}
 
-    int8_t result = HAL_UART_Receive(handler, buffer, size, 0);
-    KB_CONVERT_STATUS(result);
-    return  (kb_status_t)result;
+static int send_async_(uart_async_t *async, const uint8_t *buffer, uint32_t size, uint32_t timeout)
+{
+    uint32_t start = kb_tick_ms();
+    uint32_t sent = 0;
+    // the ring drains only from the UART and DMA interrupts
+    int can_wait = (__get_IPSR() == 0) && (__get_PRIMASK() == 0) && (__get_BASEPRI() == 0);
+    // wait only while the TX ring is full. A send goes in whole, so that
+    // other senders do not cut into it, or in pieces of the ring size
+    while (1)
+    {
+        uint32_t piece = size - sent;
+        if (piece > async->tx_ring.size)
+        {
+            piece = async->tx_ring.size;
+        }
+        sent += tx_put_(async, &buffer[sent], piece, 1);
+        tx_kick_(async);
+        if (sent == size)
+        {
+            return KB_OK;
+        }
+        if (!can_wait)
+        {
+            // drop the rest rather than spin on a ring that cannot drain
+            __atomic_fetch_add(&async->stats.tx_dropped, size - sent, __ATOMIC_RELAXED);
+            return KB_BUSY;
+        }
+        if ((kb_tick_ms() - start) >= timeout)
+        {
+            return KB_TIMEOUT;
+        }
+    }
+}
+
+static int receive_async_(uart_async_t *async, uint8_t *buffer, uint32_t size, uint32_t timeout)
+{
+    uint32_t start = kb_tick_ms();
+    // nothing is taken out of the ring unless all of it came
+    while (kb_ring_count(&async->rx_ring) < size)
+    {
+        if ((kb_tick_ms() - start) >= timeout)
+        {
+            return KB_TIMEOUT;
+        }
+    }
+    kb_ring_read(&async->rx_ring, buffer, size);
+    return KB_OK;
+}
+
+/******************************************************************************
+ * Interrupt Handlers
+ ******************************************************************************/
+
+static void uart_irq_(int idx)
+{
+    uart_async_t *async = &async_list_[idx];
+    UART_HandleTypeDef *handler = hw_list_[idx].handler;
+
+    if (async->is_enabled && (__HAL_UART_GET_FLAG(handler, UART_FLAG_IDLE) != RESET)
+            && (__HAL_UART_GET_IT_SOURCE(handler, UART_IT_IDLE) != RESET))
+    {
+        // the line went idle: hand over a short message without waiting
+        // for the DMA buffer to fill
+        __HAL_UART_CLEAR_IDLEFLAG(handler);
+        rx_drain_(async);
+    }
+    HAL_UART_IRQHandler(handler);
+}
+
+void USART1_IRQHandler(void) { uart_irq_(0); }
+void USART2_IRQHandler(void) { uart_irq_(1); }
+void USART3_IRQHandler(void) { uart_irq_(2); }
+void UART4_IRQHandler(void) { uart_irq_(3); }
+void UART5_IRQHandler(void) { uart_irq_(4); }
+void USART6_IRQHandler(void) { uart_irq_(5); }
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    uart_async_t *async = async_of_handler_(huart);
+    if (async == NULL)
+    {
+        return;
+    }
+    // chain the next transfer: what was written while this one ran
+    async->stats.tx_bytes += async->tx_chunk;
+    kb_ring_skip(&async->tx_ring, async->tx_chunk);
+    async->tx_chunk = 0;
+    tx_start_(async);
+}
+
+void HAL_UART_RxHalfCpltCallback(UART_HandleTypeDef *huart)
+{
+    uart_async_t *async = async_of_handler_(huart);
+    if (async != NULL)
+    {
+        rx_drain_(async);
+    }
+}
+
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+    uart_async_t *async = async_of_handler_(huart);
+    if (async != NULL)
+    {
+        rx_drain_(async);
+    }
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    uart_async_t *async = async_of_handler_(huart);
+    if (async == NULL)
+    {
+        return;
+    }
+    async->stats.errors++;
+    // The HAL stops the RX DMA on an error. Keep what came and restart.
+    if (huart->RxState == HAL_UART_STATE_READY)
+    {
+        rx_drain_(async);
+        rx_start_(async);
+    }
+    // A failed TX transfer is sent again
+    if ((huart->gState == HAL_UART_STATE_READY) && (async->tx_chunk != 0))
+    {
+        async->tx_chunk = 0;
+        tx_start_(async);
+    }
 }
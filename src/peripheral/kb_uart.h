@@ -19,6 +19,29 @@
     #error "Please define device driver! " __FILE__ "(e.g. USE_HAL_DRIVER)\n"
 #endif
 
+// Non-blocking mode (kb_uart_async_init()): NVIC priority of the UART and
+// its DMA streams. Both are equal so that they never preempt each other.
+#ifndef KB_UART_IRQ_PRIORITY
+    #define KB_UART_IRQ_PRIORITY    6
+#endif
+// Bytes the RX DMA lands in before they are moved to the RX ring, on half
+// transfer, transfer complete and idle line.
+#ifndef KB_UART_RX_DMA_SIZE
+    #define KB_UART_RX_DMA_SIZE     32
+#endif
+
+typedef struct {
+    uint32_t tx_bytes;          // bytes sent
+    uint32_t rx_bytes;          // bytes received, including the dropped ones
+    uint32_t tx_pending;        // bytes in the TX ring, not sent yet
+    uint32_t rx_pending;        // bytes in the RX ring, not read yet
+    uint32_t tx_high_water;     // most bytes ever in the TX ring
+    uint32_t rx_high_water;
+    uint32_t rx_dropped;        // bytes lost because the RX ring was full
+    uint32_t tx_dropped;        // bytes kb_uart_send() dropped, not allowed to wait
+    uint32_t errors;            // overrun, noise, framing and DMA errors
+} kb_uart_stats_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -31,6 +54,29 @@ int kb_uart_send(kb_uart_t uart, uint8_t *buffer, uint16_t size, uint32_t timeou
 int kb_uart_send_str(kb_uart_t uart, char *str, uint32_t timeout);
 int kb_uart_receive(kb_uart_t uart, uint8_t *buffer, uint16_t size, uint32_t timeout);
 
+/**
+ * Non-blocking mode. After kb_uart_init(), the UART sends from a TX ring by
+ * DMA, one transfer after another, and the RX DMA fills an RX ring.
+ * kb_uart_send() and kb_uart_receive() then use the rings and only wait
+ * while the TX ring is full or the RX ring lacks data.
+ * Any task or interrupt handler may send: bytes go in the TX ring with
+ * interrupts masked, a kb_uart_send() whole (in pieces of the ring size if
+ * larger), so sends do not interleave. In an interrupt handler or with
+ * interrupts masked kb_uart_send() does not wait for room, which only the
+ * UART and DMA interrupts make; it drops what does not fit (tx_dropped)
+ * and returns KB_BUSY. The RX ring is read from one context at a time.
+ * This mode uses HAL_UART_TxCpltCallback(), HAL_UART_RxCpltCallback(),
+ * HAL_UART_RxHalfCpltCallback() and HAL_UART_ErrorCallback().
+ * The ring sizes must be powers of two.
+ */
+int kb_uart_async_init(kb_uart_t uart, uint8_t *tx_buffer, uint32_t tx_size,
+        uint8_t *rx_buffer, uint32_t rx_size);
+uint32_t kb_uart_write(kb_uart_t uart, const uint8_t *buffer, uint32_t size);
+uint32_t kb_uart_read(kb_uart_t uart, uint8_t *buffer, uint32_t size);
+uint32_t kb_uart_available(kb_uart_t uart);
+int kb_uart_flush(kb_uart_t uart, uint32_t timeout);
+int kb_uart_get_stats(kb_uart_t uart, kb_uart_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
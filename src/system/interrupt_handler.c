@@ -8,6 +8,7 @@
 #include "kb_common_source.h"
 #include "interrupt_handler.h"
 #include "kb_tick.h"
+#include "kb_time.h"
 #include "faults.h"
 
 #ifndef KB_USE_FREERTOS // Learn how to combine this with FreeRTOS
@@ -53,6 +54,10 @@ void SysTick_Handler (void)
 	// DO NOT loop, just return.
 	// Useful in case someone (like STM HAL) inadvertently enables SysTick.
 	kb_tick_inc_ms();
+	// keeps the 64-bit cycle count across wraps of CYCCNT
+	kb_time_update();
+	// Calls HAL_SYSTICK_Callback(), e.g. the 1 kHz motion control of WolfieMouse
+	HAL_SYSTICK_IRQHandler();
 
 #ifdef KB_USE_FREERTOS
 	// FreeRTOS Tick handler
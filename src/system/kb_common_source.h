@@ -41,8 +41,14 @@
         #define KB_DEBUG_MSG(msg, ...)	trace_printf("KB_LIB:" KB_MSG_BASE ":%d:" msg, __LINE__ , ##__VA_ARGS__)
         #define KB_DEBUG_WARNING(msg, ...)	trace_printf("KB_LIB:" KB_MSG_BASE ":%d:Warning:" msg, __LINE__ , ##__VA_ARGS__)
         #define KB_DEBUG_ERROR(msg, ...)	trace_printf("KB_LIB:" KB_MSG_BASE ":%d:Error: " msg, __LINE__ , ##__VA_ARGS__)
+    #elif defined(KB_DEBUG_TO_LOG)
+        // deferred: printed by kb_log_flush() or kb-log-decode. Arguments of 32 bits at most
+        #include "kb_log.h"
+        #define KB_DEBUG_MSG(msg, ...)	KB_LOG("KB_LIB:" KB_MSG_BASE ":%d:" msg, __LINE__ , ##__VA_ARGS__)
+        #define KB_DEBUG_WARNING(msg, ...)	KB_LOG("KB_LIB:" KB_MSG_BASE ":%d:Warning:" msg, __LINE__ , ##__VA_ARGS__)
+        #define KB_DEBUG_ERROR(msg, ...)	KB_LOG("KB_LIB:" KB_MSG_BASE ":%d:Error: " msg, __LINE__ , ##__VA_ARGS__)
     #else
-        #error "Define either DEBUG_TO_SEMIHOSTING or DEBUG_TO_TERMINAL. If you didn't set up Terminal, you may prefer DEBUG_TO_SEMIHOSTING."
+        #error "Define DEBUG_TO_SEMIHOSTING, DEBUG_TO_TERMINAL or DEBUG_TO_LOG. If you didn't set up Terminal, you may prefer DEBUG_TO_SEMIHOSTING."
     #endif
 #else
     #define KB_DEBUG_MSG(msg, ...)
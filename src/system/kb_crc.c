@@ -0,0 +1,356 @@
+/*
+ * kb_crc.c
+ *
+ *  Slice-by-4: the CRC of 4 bytes is the XOR of 4 lookups, one per byte,
+ *  each in the table of that byte followed by the zero bytes after it. The
+ *  lookups do not depend on each other, so they overlap in the pipeline
+ *  instead of waiting for the CRC of the previous byte as the byte-at-a-time
+ *  loop does. CRC-7 runs left-aligned in 8 bits so both use the same scheme.
+ */
+
+#include "kb_crc.h"
+
+#if defined(KB_CRC_HW)
+    #include "kb_common_source.h"
+    #if !defined(CRC_CR_POLYSIZE)
+        #error "KB_CRC_HW needs a CRC unit with a programmable polynomial"
+    #endif
+#endif
+
+// CRC-7 tables, left-aligned (poly 0x09 << 1). [k][x]: byte x followed by k zero bytes
+static const uint8_t crc7_table_[4][256] = {
+    {
+        0x00, 0x12, 0x24, 0x36, 0x48, 0x5a, 0x6c, 0x7e, 0x90, 0x82, 0xb4, 0xa6, 0xd8, 0xca, 0xfc, 0xee,
+        0x32, 0x20, 0x16, 0x04, 0x7a, 0x68, 0x5e, 0x4c, 0xa2, 0xb0, 0x86, 0x94, 0xea, 0xf8, 0xce, 0xdc,
+        0x64, 0x76, 0x40, 0x52, 0x2c, 0x3e, 0x08, 0x1a, 0xf4, 0xe6, 0xd0, 0xc2, 0xbc, 0xae, 0x98, 0x8a,
+        0x56, 0x44, 0x72, 0x60, 0x1e, 0x0c, 0x3a, 0x28, 0xc6, 0xd4, 0xe2, 0xf0, 0x8e, 0x9c, 0xaa, 0xb8,
+        0xc8, 0xda, 0xec, 0xfe, 0x80, 0x92, 0xa4, 0xb6, 0x58, 0x4a, 0x7c, 0x6e, 0x10, 0x02, 0x34, 0x26,
+        0xfa, 0xe8, 0xde, 0xcc, 0xb2, 0xa0, 0x96, 0x84, 0x6a, 0x78, 0x4e, 0x5c, 0x22, 0x30, 0x06, 0x14,
+        0xac, 0xbe, 0x88, 0x9a, 0xe4, 0xf6, 0xc0, 0xd2, 0x3c, 0x2e, 0x18, 0x0a, 0x74, 0x66, 0x50, 0x42,
+        0x9e, 0x8c, 0xba, 0xa8, 0xd6, 0xc4, 0xf2, 0xe0, 0x0e, 0x1c, 0x2a, 0x38, 0x46, 0x54, 0x62, 0x70,
+        0x82, 0x90, 0xa6, 0xb4, 0xca, 0xd8, 0xee, 0xfc, 0x12, 0x00, 0x36, 0x24, 0x5a, 0x48, 0x7e, 0x6c,
+        0xb0, 0xa2, 0x94, 0x86, 0xf8, 0xea, 0xdc, 0xce, 0x20, 0x32, 0x04, 0x16, 0x68, 0x7a, 0x4c, 0x5e,
+        0xe6, 0xf4, 0xc2, 0xd0, 0xae, 0xbc, 0x8a, 0x98, 0x76, 0x64, 0x52, 0x40, 0x3e, 0x2c, 0x1a, 0x08,
+        0xd4, 0xc6, 0xf0, 0xe2, 0x9c, 0x8e, 0xb8, 0xaa, 0x44, 0x56, 0x60, 0x72, 0x0c, 0x1e, 0x28, 0x3a,
+        0x4a, 0x58, 0x6e, 0x7c, 0x02, 0x10, 0x26, 0x34, 0xda, 0xc8, 0xfe, 0xec, 0x92, 0x80, 0xb6, 0xa4,
+        0x78, 0x6a, 0x5c, 0x4e, 0x30, 0x22, 0x14, 0x06, 0xe8, 0xfa, 0xcc, 0xde, 0xa0, 0xb2, 0x84, 0x96,
+        0x2e, 0x3c, 0x0a, 0x18, 0x66, 0x74, 0x42, 0x50, 0xbe, 0xac, 0x9a, 0x88, 0xf6, 0xe4, 0xd2, 0xc0,
+        0x1c, 0x0e, 0x38, 0x2a, 0x54, 0x46, 0x70, 0x62, 0x8c, 0x9e, 0xa8, 0xba, 0xc4, 0xd6, 0xe0, 0xf2
+    },
+    {
+        0x00, 0x16, 0x2c, 0x3a, 0x58, 0x4e, 0x74, 0x62, 0xb0, 0xa6, 0x9c, 0x8a, 0xe8, 0xfe, 0xc4, 0xd2,
+        0x72, 0x64, 0x5e, 0x48, 0x2a, 0x3c, 0x06, 0x10, 0xc2, 0xd4, 0xee, 0xf8, 0x9a, 0x8c, 0xb6, 0xa0,
+        0xe4, 0xf2, 0xc8, 0xde, 0xbc, 0xaa, 0x90, 0x86, 0x54, 0x42, 0x78, 0x6e, 0x0c, 0x1a, 0x20, 0x36,
+        0x96, 0x80, 0xba, 0xac, 0xce, 0xd8, 0xe2, 0xf4, 0x26, 0x30, 0x0a, 0x1c, 0x7e, 0x68, 0x52, 0x44,
+        0xda, 0xcc, 0xf6, 0xe0, 0x82, 0x94, 0xae, 0xb8, 0x6a, 0x7c, 0x46, 0x50, 0x32, 0x24, 0x1e, 0x08,
+        0xa8, 0xbe, 0x84, 0x92, 0xf0, 0xe6, 0xdc, 0xca, 0x18, 0x0e, 0x34, 0x22, 0x40, 0x56, 0x6c, 0x7a,
+        0x3e, 0x28, 0x12, 0x04, 0x66, 0x70, 0x4a, 0x5c, 0x8e, 0x98, 0xa2, 0xb4, 0xd6, 0xc0, 0xfa, 0xec,
+        0x4c, 0x5a, 0x60, 0x76, 0x14, 0x02, 0x38, 0x2e, 0xfc, 0xea, 0xd0, 0xc6, 0xa4, 0xb2, 0x88, 0x9e,
+        0xa6, 0xb0, 0x8a, 0x9c, 0xfe, 0xe8, 0xd2, 0xc4, 0x16, 0x00, 0x3a, 0x2c, 0x4e, 0x58, 0x62, 0x74,
+        0xd4, 0xc2, 0xf8, 0xee, 0x8c, 0x9a, 0xa0, 0xb6, 0x64, 0x72, 0x48, 0x5e, 0x3c, 0x2a, 0x10, 0x06,
+        0x42, 0x54, 0x6e, 0x78, 0x1a, 0x0c, 0x36, 0x20, 0xf2, 0xe4, 0xde, 0xc8, 0xaa, 0xbc, 0x86, 0x90,
+        0x30, 0x26, 0x1c, 0x0a, 0x68, 0x7e, 0x44, 0x52, 0x80, 0x96, 0xac, 0xba, 0xd8, 0xce, 0xf4, 0xe2,
+        0x7c, 0x6a, 0x50, 0x46, 0x24, 0x32, 0x08, 0x1e, 0xcc, 0xda, 0xe0, 0xf6, 0x94, 0x82, 0xb8, 0xae,
+        0x0e, 0x18, 0x22, 0x34, 0x56, 0x40, 0x7a, 0x6c, 0xbe, 0xa8, 0x92, 0x84, 0xe6, 0xf0, 0xca, 0xdc,
+        0x98, 0x8e, 0xb4, 0xa2, 0xc0, 0xd6, 0xec, 0xfa, 0x28, 0x3e, 0x04, 0x12, 0x70, 0x66, 0x5c, 0x4a,
+        0xea, 0xfc, 0xc6, 0xd0, 0xb2, 0xa4, 0x9e, 0x88, 0x5a, 0x4c, 0x76, 0x60, 0x02, 0x14, 0x2e, 0x38
+    },
+    {
+        0x00, 0x5e, 0xbc, 0xe2, 0x6a, 0x34, 0xd6, 0x88, 0xd4, 0x8a, 0x68, 0x36, 0xbe, 0xe0, 0x02, 0x5c,
+        0xba, 0xe4, 0x06, 0x58, 0xd0, 0x8e, 0x6c, 0x32, 0x6e, 0x30, 0xd2, 0x8c, 0x04, 0x5a, 0xb8, 0xe6,
+        0x66, 0x38, 0xda, 0x84, 0x0c, 0x52, 0xb0, 0xee, 0xb2, 0xec, 0x0e, 0x50, 0xd8, 0x86, 0x64, 0x3a,
+        0xdc, 0x82, 0x60, 0x3e, 0xb6, 0xe8, 0x0a, 0x54, 0x08, 0x56, 0xb4, 0xea, 0x62, 0x3c, 0xde, 0x80,
+        0xcc, 0x92, 0x70, 0x2e, 0xa6, 0xf8, 0x1a, 0x44, 0x18, 0x46, 0xa4, 0xfa, 0x72, 0x2c, 0xce, 0x90,
+        0x76, 0x28, 0xca, 0x94, 0x1c, 0x42, 0xa0, 0xfe, 0xa2, 0xfc, 0x1e, 0x40, 0xc8, 0x96, 0x74, 0x2a,
+        0xaa, 0xf4, 0x16, 0x48, 0xc0, 0x9e, 0x7c, 0x22, 0x7e, 0x20, 0xc2, 0x9c, 0x14, 0x4a, 0xa8, 0xf6,
+        0x10, 0x4e, 0xac, 0xf2, 0x7a, 0x24, 0xc6, 0x98, 0xc4, 0x9a, 0x78, 0x26, 0xae, 0xf0, 0x12, 0x4c,
+        0x8a, 0xd4, 0x36, 0x68, 0xe0, 0xbe, 0x5c, 0x02, 0x5e, 0x00, 0xe2, 0xbc, 0x34, 0x6a, 0x88, 0xd6,
+        0x30, 0x6e, 0x8c, 0xd2, 0x5a, 0x04, 0xe6, 0xb8, 0xe4, 0xba, 0x58, 0x06, 0x8e, 0xd0, 0x32, 0x6c,
+        0xec, 0xb2, 0x50, 0x0e, 0x86, 0xd8, 0x3a, 0x64, 0x38, 0x66, 0x84, 0xda, 0x52, 0x0c, 0xee, 0xb0,
+        0x56, 0x08, 0xea, 0xb4, 0x3c, 0x62, 0x80, 0xde, 0x82, 0xdc, 0x3e, 0x60, 0xe8, 0xb6, 0x54, 0x0a,
+        0x46, 0x18, 0xfa, 0xa4, 0x2c, 0x72, 0x90, 0xce, 0x92, 0xcc, 0x2e, 0x70, 0xf8, 0xa6, 0x44, 0x1a,
+        0xfc, 0xa2, 0x40, 0x1e, 0x96, 0xc8, 0x2a, 0x74, 0x28, 0x76, 0x94, 0xca, 0x42, 0x1c, 0xfe, 0xa0,
+        0x20, 0x7e, 0x9c, 0xc2, 0x4a, 0x14, 0xf6, 0xa8, 0xf4, 0xaa, 0x48, 0x16, 0x9e, 0xc0, 0x22, 0x7c,
+        0x9a, 0xc4, 0x26, 0x78, 0xf0, 0xae, 0x4c, 0x12, 0x4e, 0x10, 0xf2, 0xac, 0x24, 0x7a, 0x98, 0xc6
+    },
+    {
+        0x00, 0x06, 0x0c, 0x0a, 0x18, 0x1e, 0x14, 0x12, 0x30, 0x36, 0x3c, 0x3a, 0x28, 0x2e, 0x24, 0x22,
+        0x60, 0x66, 0x6c, 0x6a, 0x78, 0x7e, 0x74, 0x72, 0x50, 0x56, 0x5c, 0x5a, 0x48, 0x4e, 0x44, 0x42,
+        0xc0, 0xc6, 0xcc, 0xca, 0xd8, 0xde, 0xd4, 0xd2, 0xf0, 0xf6, 0xfc, 0xfa, 0xe8, 0xee, 0xe4, 0xe2,
+        0xa0, 0xa6, 0xac, 0xaa, 0xb8, 0xbe, 0xb4, 0xb2, 0x90, 0x96, 0x9c, 0x9a, 0x88, 0x8e, 0x84, 0x82,
+        0x92, 0x94, 0x9e, 0x98, 0x8a, 0x8c, 0x86, 0x80, 0xa2, 0xa4, 0xae, 0xa8, 0xba, 0xbc, 0xb6, 0xb0,
+        0xf2, 0xf4, 0xfe, 0xf8, 0xea, 0xec, 0xe6, 0xe0, 0xc2, 0xc4, 0xce, 0xc8, 0xda, 0xdc, 0xd6, 0xd0,
+        0x52, 0x54, 0x5e, 0x58, 0x4a, 0x4c, 0x46, 0x40, 0x62, 0x64, 0x6e, 0x68, 0x7a, 0x7c, 0x76, 0x70,
+        0x32, 0x34, 0x3e, 0x38, 0x2a, 0x2c, 0x26, 0x20, 0x02, 0x04, 0x0e, 0x08, 0x1a, 0x1c, 0x16, 0x10,
+        0x36, 0x30, 0x3a, 0x3c, 0x2e, 0x28, 0x22, 0x24, 0x06, 0x00, 0x0a, 0x0c, 0x1e, 0x18, 0x12, 0x14,
+        0x56, 0x50, 0x5a, 0x5c, 0x4e, 0x48, 0x42, 0x44, 0x66, 0x60, 0x6a, 0x6c, 0x7e, 0x78, 0x72, 0x74,
+        0xf6, 0xf0, 0xfa, 0xfc, 0xee, 0xe8, 0xe2, 0xe4, 0xc6, 0xc0, 0xca, 0xcc, 0xde, 0xd8, 0xd2, 0xd4,
+        0x96, 0x90, 0x9a, 0x9c, 0x8e, 0x88, 0x82, 0x84, 0xa6, 0xa0, 0xaa, 0xac, 0xbe, 0xb8, 0xb2, 0xb4,
+        0xa4, 0xa2, 0xa8, 0xae, 0xbc, 0xba, 0xb0, 0xb6, 0x94, 0x92, 0x98, 0x9e, 0x8c, 0x8a, 0x80, 0x86,
+        0xc4, 0xc2, 0xc8, 0xce, 0xdc, 0xda, 0xd0, 0xd6, 0xf4, 0xf2, 0xf8, 0xfe, 0xec, 0xea, 0xe0, 0xe6,
+        0x64, 0x62, 0x68, 0x6e, 0x7c, 0x7a, 0x70, 0x76, 0x54, 0x52, 0x58, 0x5e, 0x4c, 0x4a, 0x40, 0x46,
+        0x04, 0x02, 0x08, 0x0e, 0x1c, 0x1a, 0x10, 0x16, 0x34, 0x32, 0x38, 0x3e, 0x2c, 0x2a, 0x20, 0x26
+    }
+};
+
+// CRC-16 tables (poly 0x1021). [k][x]: byte x followed by k zero bytes
+static const uint16_t crc16_table_[4][256] = {
+    {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+        0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+        0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
+        0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
+        0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
+        0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
+        0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
+        0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
+        0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
+        0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
+        0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
+        0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
+        0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
+        0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
+        0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
+        0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
+        0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
+        0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
+        0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
+        0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
+        0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
+        0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+        0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
+        0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
+        0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
+        0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
+        0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
+        0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
+        0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
+        0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
+        0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
+        0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0
+    },
+    {
+        0x0000, 0x3331, 0x6662, 0x5553, 0xccc4, 0xfff5, 0xaaa6, 0x9997,
+        0x89a9, 0xba98, 0xefcb, 0xdcfa, 0x456d, 0x765c, 0x230f, 0x103e,
+        0x0373, 0x3042, 0x6511, 0x5620, 0xcfb7, 0xfc86, 0xa9d5, 0x9ae4,
+        0x8ada, 0xb9eb, 0xecb8, 0xdf89, 0x461e, 0x752f, 0x207c, 0x134d,
+        0x06e6, 0x35d7, 0x6084, 0x53b5, 0xca22, 0xf913, 0xac40, 0x9f71,
+        0x8f4f, 0xbc7e, 0xe92d, 0xda1c, 0x438b, 0x70ba, 0x25e9, 0x16d8,
+        0x0595, 0x36a4, 0x63f7, 0x50c6, 0xc951, 0xfa60, 0xaf33, 0x9c02,
+        0x8c3c, 0xbf0d, 0xea5e, 0xd96f, 0x40f8, 0x73c9, 0x269a, 0x15ab,
+        0x0dcc, 0x3efd, 0x6bae, 0x589f, 0xc108, 0xf239, 0xa76a, 0x945b,
+        0x8465, 0xb754, 0xe207, 0xd136, 0x48a1, 0x7b90, 0x2ec3, 0x1df2,
+        0x0ebf, 0x3d8e, 0x68dd, 0x5bec, 0xc27b, 0xf14a, 0xa419, 0x9728,
+        0x8716, 0xb427, 0xe174, 0xd245, 0x4bd2, 0x78e3, 0x2db0, 0x1e81,
+        0x0b2a, 0x381b, 0x6d48, 0x5e79, 0xc7ee, 0xf4df, 0xa18c, 0x92bd,
+        0x8283, 0xb1b2, 0xe4e1, 0xd7d0, 0x4e47, 0x7d76, 0x2825, 0x1b14,
+        0x0859, 0x3b68, 0x6e3b, 0x5d0a, 0xc49d, 0xf7ac, 0xa2ff, 0x91ce,
+        0x81f0, 0xb2c1, 0xe792, 0xd4a3, 0x4d34, 0x7e05, 0x2b56, 0x1867,
+        0x1b98, 0x28a9, 0x7dfa, 0x4ecb, 0xd75c, 0xe46d, 0xb13e, 0x820f,
+        0x9231, 0xa100, 0xf453, 0xc762, 0x5ef5, 0x6dc4, 0x3897, 0x0ba6,
+        0x18eb, 0x2bda, 0x7e89, 0x4db8, 0xd42f, 0xe71e, 0xb24d, 0x817c,
+        0x9142, 0xa273, 0xf720, 0xc411, 0x5d86, 0x6eb7, 0x3be4, 0x08d5,
+        0x1d7e, 0x2e4f, 0x7b1c, 0x482d, 0xd1ba, 0xe28b, 0xb7d8, 0x84e9,
+        0x94d7, 0xa7e6, 0xf2b5, 0xc184, 0x5813, 0x6b22, 0x3e71, 0x0d40,
+        0x1e0d, 0x2d3c, 0x786f, 0x4b5e, 0xd2c9, 0xe1f8, 0xb4ab, 0x879a,
+        0x97a4, 0xa495, 0xf1c6, 0xc2f7, 0x5b60, 0x6851, 0x3d02, 0x0e33,
+        0x1654, 0x2565, 0x7036, 0x4307, 0xda90, 0xe9a1, 0xbcf2, 0x8fc3,
+        0x9ffd, 0xaccc, 0xf99f, 0xcaae, 0x5339, 0x6008, 0x355b, 0x066a,
+        0x1527, 0x2616, 0x7345, 0x4074, 0xd9e3, 0xead2, 0xbf81, 0x8cb0,
+        0x9c8e, 0xafbf, 0xfaec, 0xc9dd, 0x504a, 0x637b, 0x3628, 0x0519,
+        0x10b2, 0x2383, 0x76d0, 0x45e1, 0xdc76, 0xef47, 0xba14, 0x8925,
+        0x991b, 0xaa2a, 0xff79, 0xcc48, 0x55df, 0x66ee, 0x33bd, 0x008c,
+        0x13c1, 0x20f0, 0x75a3, 0x4692, 0xdf05, 0xec34, 0xb967, 0x8a56,
+        0x9a68, 0xa959, 0xfc0a, 0xcf3b, 0x56ac, 0x659d, 0x30ce, 0x03ff
+    },
+    {
+        0x0000, 0x3730, 0x6e60, 0x5950, 0xdcc0, 0xebf0, 0xb2a0, 0x8590,
+        0xa9a1, 0x9e91, 0xc7c1, 0xf0f1, 0x7561, 0x4251, 0x1b01, 0x2c31,
+        0x4363, 0x7453, 0x2d03, 0x1a33, 0x9fa3, 0xa893, 0xf1c3, 0xc6f3,
+        0xeac2, 0xddf2, 0x84a2, 0xb392, 0x3602, 0x0132, 0x5862, 0x6f52,
+        0x86c6, 0xb1f6, 0xe8a6, 0xdf96, 0x5a06, 0x6d36, 0x3466, 0x0356,
+        0x2f67, 0x1857, 0x4107, 0x7637, 0xf3a7, 0xc497, 0x9dc7, 0xaaf7,
+        0xc5a5, 0xf295, 0xabc5, 0x9cf5, 0x1965, 0x2e55, 0x7705, 0x4035,
+        0x6c04, 0x5b34, 0x0264, 0x3554, 0xb0c4, 0x87f4, 0xdea4, 0xe994,
+        0x1dad, 0x2a9d, 0x73cd, 0x44fd, 0xc16d, 0xf65d, 0xaf0d, 0x983d,
+        0xb40c, 0x833c, 0xda6c, 0xed5c, 0x68cc, 0x5ffc, 0x06ac, 0x319c,
+        0x5ece, 0x69fe, 0x30ae, 0x079e, 0x820e, 0xb53e, 0xec6e, 0xdb5e,
+        0xf76f, 0xc05f, 0x990f, 0xae3f, 0x2baf, 0x1c9f, 0x45cf, 0x72ff,
+        0x9b6b, 0xac5b, 0xf50b, 0xc23b, 0x47ab, 0x709b, 0x29cb, 0x1efb,
+        0x32ca, 0x05fa, 0x5caa, 0x6b9a, 0xee0a, 0xd93a, 0x806a, 0xb75a,
+        0xd808, 0xef38, 0xb668, 0x8158, 0x04c8, 0x33f8, 0x6aa8, 0x5d98,
+        0x71a9, 0x4699, 0x1fc9, 0x28f9, 0xad69, 0x9a59, 0xc309, 0xf439,
+        0x3b5a, 0x0c6a, 0x553a, 0x620a, 0xe79a, 0xd0aa, 0x89fa, 0xbeca,
+        0x92fb, 0xa5cb, 0xfc9b, 0xcbab, 0x4e3b, 0x790b, 0x205b, 0x176b,
+        0x7839, 0x4f09, 0x1659, 0x2169, 0xa4f9, 0x93c9, 0xca99, 0xfda9,
+        0xd198, 0xe6a8, 0xbff8, 0x88c8, 0x0d58, 0x3a68, 0x6338, 0x5408,
+        0xbd9c, 0x8aac, 0xd3fc, 0xe4cc, 0x615c, 0x566c, 0x0f3c, 0x380c,
+        0x143d, 0x230d, 0x7a5d, 0x4d6d, 0xc8fd, 0xffcd, 0xa69d, 0x91ad,
+        0xfeff, 0xc9cf, 0x909f, 0xa7af, 0x223f, 0x150f, 0x4c5f, 0x7b6f,
+        0x575e, 0x606e, 0x393e, 0x0e0e, 0x8b9e, 0xbcae, 0xe5fe, 0xd2ce,
+        0x26f7, 0x11c7, 0x4897, 0x7fa7, 0xfa37, 0xcd07, 0x9457, 0xa367,
+        0x8f56, 0xb866, 0xe136, 0xd606, 0x5396, 0x64a6, 0x3df6, 0x0ac6,
+        0x6594, 0x52a4, 0x0bf4, 0x3cc4, 0xb954, 0x8e64, 0xd734, 0xe004,
+        0xcc35, 0xfb05, 0xa255, 0x9565, 0x10f5, 0x27c5, 0x7e95, 0x49a5,
+        0xa031, 0x9701, 0xce51, 0xf961, 0x7cf1, 0x4bc1, 0x1291, 0x25a1,
+        0x0990, 0x3ea0, 0x67f0, 0x50c0, 0xd550, 0xe260, 0xbb30, 0x8c00,
+        0xe352, 0xd462, 0x8d32, 0xba02, 0x3f92, 0x08a2, 0x51f2, 0x66c2,
+        0x4af3, 0x7dc3, 0x2493, 0x13a3, 0x9633, 0xa103, 0xf853, 0xcf63
+    },
+    {
+        0x0000, 0x76b4, 0xed68, 0x9bdc, 0xcaf1, 0xbc45, 0x2799, 0x512d,
+        0x85c3, 0xf377, 0x68ab, 0x1e1f, 0x4f32, 0x3986, 0xa25a, 0xd4ee,
+        0x1ba7, 0x6d13, 0xf6cf, 0x807b, 0xd156, 0xa7e2, 0x3c3e, 0x4a8a,
+        0x9e64, 0xe8d0, 0x730c, 0x05b8, 0x5495, 0x2221, 0xb9fd, 0xcf49,
+        0x374e, 0x41fa, 0xda26, 0xac92, 0xfdbf, 0x8b0b, 0x10d7, 0x6663,
+        0xb28d, 0xc439, 0x5fe5, 0x2951, 0x787c, 0x0ec8, 0x9514, 0xe3a0,
+        0x2ce9, 0x5a5d, 0xc181, 0xb735, 0xe618, 0x90ac, 0x0b70, 0x7dc4,
+        0xa92a, 0xdf9e, 0x4442, 0x32f6, 0x63db, 0x156f, 0x8eb3, 0xf807,
+        0x6e9c, 0x1828, 0x83f4, 0xf540, 0xa46d, 0xd2d9, 0x4905, 0x3fb1,
+        0xeb5f, 0x9deb, 0x0637, 0x7083, 0x21ae, 0x571a, 0xccc6, 0xba72,
+        0x753b, 0x038f, 0x9853, 0xeee7, 0xbfca, 0xc97e, 0x52a2, 0x2416,
+        0xf0f8, 0x864c, 0x1d90, 0x6b24, 0x3a09, 0x4cbd, 0xd761, 0xa1d5,
+        0x59d2, 0x2f66, 0xb4ba, 0xc20e, 0x9323, 0xe597, 0x7e4b, 0x08ff,
+        0xdc11, 0xaaa5, 0x3179, 0x47cd, 0x16e0, 0x6054, 0xfb88, 0x8d3c,
+        0x4275, 0x34c1, 0xaf1d, 0xd9a9, 0x8884, 0xfe30, 0x65ec, 0x1358,
+        0xc7b6, 0xb102, 0x2ade, 0x5c6a, 0x0d47, 0x7bf3, 0xe02f, 0x969b,
+        0xdd38, 0xab8c, 0x3050, 0x46e4, 0x17c9, 0x617d, 0xfaa1, 0x8c15,
+        0x58fb, 0x2e4f, 0xb593, 0xc327, 0x920a, 0xe4be, 0x7f62, 0x09d6,
+        0xc69f, 0xb02b, 0x2bf7, 0x5d43, 0x0c6e, 0x7ada, 0xe106, 0x97b2,
+        0x435c, 0x35e8, 0xae34, 0xd880, 0x89ad, 0xff19, 0x64c5, 0x1271,
+        0xea76, 0x9cc2, 0x071e, 0x71aa, 0x2087, 0x5633, 0xcdef, 0xbb5b,
+        0x6fb5, 0x1901, 0x82dd, 0xf469, 0xa544, 0xd3f0, 0x482c, 0x3e98,
+        0xf1d1, 0x8765, 0x1cb9, 0x6a0d, 0x3b20, 0x4d94, 0xd648, 0xa0fc,
+        0x7412, 0x02a6, 0x997a, 0xefce, 0xbee3, 0xc857, 0x538b, 0x253f,
+        0xb3a4, 0xc510, 0x5ecc, 0x2878, 0x7955, 0x0fe1, 0x943d, 0xe289,
+        0x3667, 0x40d3, 0xdb0f, 0xadbb, 0xfc96, 0x8a22, 0x11fe, 0x674a,
+        0xa803, 0xdeb7, 0x456b, 0x33df, 0x62f2, 0x1446, 0x8f9a, 0xf92e,
+        0x2dc0, 0x5b74, 0xc0a8, 0xb61c, 0xe731, 0x9185, 0x0a59, 0x7ced,
+        0x84ea, 0xf25e, 0x6982, 0x1f36, 0x4e1b, 0x38af, 0xa373, 0xd5c7,
+        0x0129, 0x779d, 0xec41, 0x9af5, 0xcbd8, 0xbd6c, 0x26b0, 0x5004,
+        0x9f4d, 0xe9f9, 0x7225, 0x0491, 0x55bc, 0x2308, 0xb8d4, 0xce60,
+        0x1a8e, 0x6c3a, 0xf7e6, 0x8152, 0xd07f, 0xa6cb, 0x3d17, 0x4ba3
+    }
+};
+
+#if defined(KB_CRC_HW)
+static uint8_t is_hw_ = 0;
+
+static void hw_start_(uint32_t polysize, uint32_t poly, uint32_t init)
+{
+    CRC->POL = poly;
+    CRC->INIT = init;
+    CRC->CR = polysize | CRC_CR_RESET;
+}
+
+static void hw_feed_(const uint8_t *buf, uint32_t len)
+{
+    while (len--)
+    {
+        *(__IO uint8_t *)&CRC->DR = *buf++;
+    }
+}
+
+static uint8_t hw_crc7_(uint8_t crc, const uint8_t *buf, uint32_t len)
+{
+    hw_start_(CRC_CR_POLYSIZE, 0x09, crc);
+    hw_feed_(buf, len);
+    return (uint8_t)(CRC->DR & 0x7f);
+}
+
+static uint16_t hw_crc16_(uint16_t crc, const uint8_t *buf, uint32_t len)
+{
+    hw_start_(CRC_CR_POLYSIZE_0, 0x1021, crc);
+    hw_feed_(buf, len);
+    return (uint16_t)CRC->DR;
+}
+#endif
+
+int kb_crc_init(void)
+{
+#if defined(KB_CRC_HW)
+    uint8_t test[64];
+    uint32_t i;
+
+    __HAL_RCC_CRC_CLK_ENABLE();
+    for (i = 0; i < sizeof(test); i++)
+    {
+        test[i] = (uint8_t)(i * 151 + 7);
+    }
+    is_hw_ = (hw_crc7_(KB_CRC7_INIT, test, sizeof(test))
+                    == kb_crc7_sw(KB_CRC7_INIT, test, sizeof(test)))
+            && (hw_crc16_(KB_CRC16_INIT, test, sizeof(test))
+                    == kb_crc16_sw(KB_CRC16_INIT, test, sizeof(test)));
+    return is_hw_ ? 0 : -1;
+#else
+    return -1;
+#endif
+}
+
+uint8_t kb_crc7(uint8_t crc, const uint8_t *buf, uint32_t len)
+{
+#if defined(KB_CRC_HW)
+    if (is_hw_)
+    {
+        return hw_crc7_(crc, buf, len);
+    }
+#endif
+    return kb_crc7_sw(crc, buf, len);
+}
+
+uint16_t kb_crc16(uint16_t crc, const uint8_t *buf, uint32_t len)
+{
+#if defined(KB_CRC_HW)
+    if (is_hw_)
+    {
+        return hw_crc16_(crc, buf, len);
+    }
+#endif
+    return kb_crc16_sw(crc, buf, len);
+}
+
+uint8_t kb_crc7_bytewise(uint8_t crc, const uint8_t *buf, uint32_t len)
+{
+    uint8_t c = (uint8_t)(crc << 1);
+
+    while (len--)
+    {
+        c = crc7_table_[0][c ^ *buf++];
+    }
+    return c >> 1;
+}
+
+uint16_t kb_crc16_bytewise(uint16_t crc, const uint8_t *buf, uint32_t len)
+{
+    while (len--)
+    {
+        crc = (uint16_t)(crc << 8) ^ crc16_table_[0][(crc >> 8) ^ *buf++];
+    }
+    return crc;
+}
+
+uint8_t kb_crc7_sw(uint8_t crc, const uint8_t *buf, uint32_t len)
+{
+    uint8_t c = (uint8_t)(crc << 1);
+
+    while (len >= 4)
+    {
+        c = crc7_table_[3][c ^ buf[0]] ^ crc7_table_[2][buf[1]]
+                ^ crc7_table_[1][buf[2]] ^ crc7_table_[0][buf[3]];
+        buf += 4;
+        len -= 4;
+    }
+    return kb_crc7_bytewise(c >> 1, buf, len);
+}
+
+uint16_t kb_crc16_sw(uint16_t crc, const uint8_t *buf, uint32_t len)
+{
+    while (len >= 4)
+    {
+        crc = crc16_table_[3][(crc >> 8) ^ buf[0]] ^ crc16_table_[2][(crc & 0xff) ^ buf[1]]
+                ^ crc16_table_[1][buf[2]] ^ crc16_table_[0][buf[3]];
+        buf += 4;
+        len -= 4;
+    }
+    return kb_crc16_bytewise(crc, buf, len);
+}
@@ -0,0 +1,65 @@
+/*
+ * kb_crc.h
+ *
+ *  CRC-7 and CRC-16 of the WINC1500 SPI protocol (the same as SD/MMC),
+ *  both MSB first. The software path is table driven, 4 bytes per step
+ *  (slice-by-4), with byte-at-a-time versions as its reference.
+ *
+ *  With KB_CRC_HW defined, kb_crc_init() moves kb_crc7() and kb_crc16() to
+ *  the CRC unit, after checking it against the software path. That needs a
+ *  CRC unit with a programmable polynomial; the one of the STM32F4 only
+ *  computes the Ethernet CRC-32. The unit is shared, so in that mode the
+ *  calls must not preempt each other.
+ *
+ *  Without KB_CRC_HW it is plain C without the HAL, so it also builds on the
+ *  host (see host/system/CrcCheck.c).
+ */
+
+#ifndef SYSTEM_KB_CRC_H_
+#define SYSTEM_KB_CRC_H_
+
+#include <stdint.h>
+
+// Start values of the WINC1500 SPI protocol
+#define KB_CRC7_INIT        0x7f
+#define KB_CRC16_INIT       0xffff
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Use the CRC unit if KB_CRC_HW is defined and it agrees with the
+ *        software path on a test message
+ * @return 0 (KB_OK) if the CRC unit is used, -1 (KB_ERROR) if the software
+ *         path stays in use
+ */
+int kb_crc_init(void);
+
+/**
+ * @brief CRC-7 (x^7 + x^3 + 1) of @buf, continuing from @crc
+ * @param crc KB_CRC7_INIT, or the result over the previous bytes
+ * @return 7-bit CRC. The byte sent after a WINC1500 command is (crc << 1)
+ */
+uint8_t kb_crc7(uint8_t crc, const uint8_t *buf, uint32_t len);
+
+/**
+ * @brief CRC-16/ITU-T (x^16 + x^12 + x^5 + 1) of @buf, continuing from @crc
+ * @param crc KB_CRC16_INIT, or the result over the previous bytes
+ * @return 16-bit CRC, sent high byte first
+ */
+uint16_t kb_crc16(uint16_t crc, const uint8_t *buf, uint32_t len);
+
+/* Software path, a table lookup per byte. Also used for the tails */
+uint8_t kb_crc7_bytewise(uint8_t crc, const uint8_t *buf, uint32_t len);
+uint16_t kb_crc16_bytewise(uint16_t crc, const uint8_t *buf, uint32_t len);
+
+/* Software path, 4 bytes per step */
+uint8_t kb_crc7_sw(uint8_t crc, const uint8_t *buf, uint32_t len);
+uint16_t kb_crc16_sw(uint16_t crc, const uint8_t *buf, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SYSTEM_KB_CRC_H_ */
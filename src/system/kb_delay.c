@@ -0,0 +1,294 @@
+/*
+ * kb_delay.c
+ *
+ *  The timer counts microseconds in one-pulse mode and stops at the update
+ *  event, which wakes the waiter. timer_busy_ gives it to one wait at a
+ *  time; the others block on ticks or spin. A FreeRTOS task waits on a
+ *  semaphore rather than on its notification, which the task may use for
+ *  its own events (e.g. the WINC1500 HIF task).
+ */
+
+#include "kb_common_source.h"
+#include "kb_delay.h"
+#include "kb_tick.h"
+#include "kb_time.h"
+#include <string.h>
+
+#ifdef KB_USE_FREERTOS
+    #include "FreeRTOS.h"
+    #include "task.h"
+    #include "semphr.h"
+
+static SemaphoreHandle_t timer_sem_ = NULL;
+#endif
+
+#define TIMER_MAX_US    0xffff
+
+static volatile uint8_t ready_ = 0;
+static volatile uint8_t timer_busy_ = 0;
+static volatile uint8_t timer_fired_ = 0;
+static kb_delay_stats_t stats_;
+
+/* Only a thread with unmasked interrupts is woken by the timer */
+static int can_sleep_(void)
+{
+    return (__get_IPSR() == 0) && (__get_PRIMASK() == 0) && (__get_BASEPRI() == 0);
+}
+
+static void count_spin_(void *caller, uint64_t cycles, int whole)
+{
+    uint32_t primask = __get_PRIMASK();
+    int i;
+
+    __disable_irq();
+    if (whole)
+    {
+        stats_.spin_num++;
+    }
+    stats_.spin_cycles += cycles;
+    for (i = 0; i < KB_DELAY_SITE_NUM; i++)
+    {
+        kb_delay_site_t *site = &stats_.sites[i];
+        if (site->caller == NULL)
+        {
+            site->caller = caller;
+        }
+        if (site->caller == caller)
+        {
+            site->num++;
+            site->spin_cycles += cycles;
+            break;
+        }
+    }
+    if (i == KB_DELAY_SITE_NUM)
+    {
+        stats_.other_cycles += cycles;
+    }
+    __set_PRIMASK(primask);
+}
+
+static int timer_take_(void)
+{
+    return __atomic_exchange_n(&timer_busy_, 1, __ATOMIC_ACQUIRE) == 0;
+}
+
+static void timer_give_(void)
+{
+    KB_DELAY_TIMER->DIER = 0;
+    KB_DELAY_TIMER->CR1 = 0;
+    __atomic_store_n(&timer_busy_, 0, __ATOMIC_RELEASE);
+}
+
+static void timer_start_(uint64_t us)
+{
+    TIM_TypeDef *timer = KB_DELAY_TIMER;
+
+    if (us > TIMER_MAX_US)
+    {   // the wait goes on after the wake-up
+        us = TIMER_MAX_US;
+    }
+    timer_fired_ = 0;
+    // URS: the update generated here loads PSC and ARR without an interrupt
+    timer->CR1 = TIM_CR1_OPM | TIM_CR1_URS;
+    timer->ARR = (uint32_t)us - 1;
+    timer->EGR = TIM_EGR_UG;
+    timer->SR = 0;
+    timer->DIER = TIM_DIER_UIE;
+    timer->CR1 = TIM_CR1_OPM | TIM_CR1_URS | TIM_CR1_CEN;
+}
+
+/* Sleep until the timer fires. Masked, so it cannot fire between the check
+ * and the WFI; a pending interrupt still ends the WFI */
+static void timer_sleep_(void)
+{
+    __disable_irq();
+    while (!timer_fired_)
+    {
+        __DSB();
+        __WFI();
+        __enable_irq();
+        __ISB();
+        __disable_irq();
+    }
+    __enable_irq();
+}
+
+#ifdef KB_USE_FREERTOS
+/* Block the task until the timer fires. @return 0 if the scheduler does not
+ * run, and the caller has to wait another way */
+static int rtos_block_(uint64_t left_us)
+{
+    const uint64_t tick_us = 1000u * portTICK_PERIOD_MS;
+
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
+    {
+        return 0;
+    }
+    if (left_us >= 2 * tick_us)
+    {   // vTaskDelay(n) ends within (n - 1, n] tick periods
+        uint64_t ticks = left_us / tick_us - 1;
+        vTaskDelay((TickType_t)(ticks < (portMAX_DELAY >> 1) ? ticks : (portMAX_DELAY >> 1)));
+    }
+    else if (timer_take_())
+    {
+        (void)xSemaphoreTake(timer_sem_, 0);    // a give of an earlier wait
+        timer_start_(left_us - KB_DELAY_WAKE_US);
+        (void)xSemaphoreTake(timer_sem_, (TickType_t)(left_us / tick_us + 2));
+        timer_give_();
+    }
+    else
+    {
+        return 0;
+    }
+    __atomic_fetch_add(&stats_.block_num, 1, __ATOMIC_RELAXED);
+    return 1;
+}
+#endif
+
+/* Wait until the cycle count @end, sleeping while it is worth it */
+static void delay_(uint64_t end, void *caller)
+{
+    uint64_t now;
+    uint64_t start;
+    int slept = 0;
+
+    while (ready_ && (now = kb_time_cycles()) < end)
+    {
+        uint64_t left_us = kb_time_cycles_to_us(end - now);
+
+        if (left_us < KB_DELAY_SPIN_MAX_US || !can_sleep_())
+        {
+            break;
+        }
+#ifdef KB_USE_FREERTOS
+        if (rtos_block_(left_us))
+        {
+            slept = 1;
+            continue;
+        }
+        if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+        {   // the timer is busy: WFI would keep other tasks out too
+            break;
+        }
+#endif
+        if (!timer_take_())
+        {
+            break;
+        }
+        timer_start_(left_us - KB_DELAY_WAKE_US);
+        timer_sleep_();
+        timer_give_();
+        __atomic_fetch_add(&stats_.sleep_num, 1, __ATOMIC_RELAXED);
+        slept = 1;
+    }
+
+    start = kb_time_cycles();
+    now = start;
+    while (now < end)
+    {
+        now = kb_time_cycles();
+    }
+    if (now != start)
+    {
+        count_spin_(caller, now - start, !slept);
+    }
+}
+
+void kb_delay_init(void)
+{
+    RCC_ClkInitTypeDef rcc_config;
+    uint32_t flash_latency;
+    uint32_t clock = HAL_RCC_GetPCLK1Freq();
+
+    HAL_RCC_GetClockConfig(&rcc_config, &flash_latency);
+    if (rcc_config.APB1CLKDivider != RCC_HCLK_DIV1)
+    {   // See RCC datasheet
+        clock *= 2;
+    }
+    ready_ = 0;
+    KB_DELAY_TIMER_CLK_ENABLE();
+    KB_DELAY_TIMER->CR1 = 0;
+    KB_DELAY_TIMER->PSC = clock / 1000000u - 1;     // 1 MHz
+#ifdef KB_USE_FREERTOS
+    if (timer_sem_ == NULL)
+    {
+        timer_sem_ = xSemaphoreCreateBinary();
+    }
+    if (timer_sem_ == NULL)
+    {   // no heap: keep spinning
+        return;
+    }
+#endif
+    HAL_NVIC_SetPriority(KB_DELAY_TIMER_IRQn, KB_DELAY_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(KB_DELAY_TIMER_IRQn);
+    ready_ = 1;
+}
+
+void kb_delay_stats(kb_delay_stats_t *stats)
+{
+    uint32_t primask = __get_PRIMASK();
+    int i;
+    int j;
+
+    __disable_irq();
+    *stats = stats_;
+    __set_PRIMASK(primask);
+    // insertion sort, by spin_cycles descending
+    for (i = 1; i < KB_DELAY_SITE_NUM; i++)
+    {
+        kb_delay_site_t site = stats->sites[i];
+        for (j = i; j > 0 && stats->sites[j - 1].spin_cycles < site.spin_cycles; j--)
+        {
+            stats->sites[j] = stats->sites[j - 1];
+        }
+        stats->sites[j] = site;
+    }
+}
+
+void kb_delay_stats_reset(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    memset(&stats_, 0, sizeof(stats_));
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Delay system in microseconds
+ * @param delay_us   time to delay in microseconds
+ */
+void kb_delay_us(volatile uint32_t delay_us)
+{
+    delay_(kb_time_cycles() + kb_time_us_to_cycles(delay_us), __builtin_return_address(0));
+}
+
+/*
+ * Overloading original HAL_Delay() in stm32f4xx_hal.c
+ */
+void HAL_Delay(__IO uint32_t Delay)
+{
+    if (!ready_)
+    {   // before kb_tick_update_f_cpu_mhz(), the cycle count may not run
+        uint32_t tickstart = HAL_GetTick();
+        while ((HAL_GetTick() - tickstart) < Delay)
+        {
+        }
+        return;
+    }
+    delay_(kb_time_cycles() + kb_time_us_to_cycles((uint64_t)Delay * 1000u), __builtin_return_address(0));
+}
+
+void KB_DELAY_TIMER_IRQHandler(void)
+{
+    KB_DELAY_TIMER->SR = 0;
+    timer_fired_ = 1;
+#ifdef KB_USE_FREERTOS
+    if (timer_sem_ != NULL)
+    {
+        BaseType_t is_woken = pdFALSE;
+        xSemaphoreGiveFromISR(timer_sem_, &is_woken);
+        portYIELD_FROM_ISR(is_woken);
+    }
+#endif
+}
@@ -0,0 +1,92 @@
+/*
+ * kb_delay.h
+ *
+ *  Delays that do not keep the core busy. kb_delay_us() and HAL_Delay()
+ *  (kb_delay_ms()) pick a way to wait by the time left:
+ *   - with the FreeRTOS scheduler running, the calling task blocks: in
+ *     vTaskDelay() for whole ticks, then on the one-shot timer for the rest,
+ *     so other tasks run meanwhile;
+ *   - before the scheduler runs, the core sleeps in WFI until the one-shot
+ *     timer (or any other interrupt) wakes it;
+ *   - below KB_DELAY_SPIN_MAX_US, in an interrupt handler, with interrupts
+ *     masked, or while the timer serves another wait, it spins on the cycle
+ *     counter (kb_time.h).
+ *  The end of a wait is a time of kb_time_cycles(), which counts through
+ *  the WFI sleep as kb_time_init() sets DBGMCU_CR.DBG_SLEEP. A wake-up comes
+ *  KB_DELAY_WAKE_US early and spins the last microseconds, so a delay is
+ *  never shorter than asked; it is longer by the spin loop exit (a few
+ *  cycles) or, when the wake-up was late, by an interrupt handler or a
+ *  higher-priority task running at the end.
+ *
+ *  The one-shot timer is KB_DELAY_TIMER, TIM7 by default; do not use it with
+ *  kb_timer then. The cycles spent spinning are counted per caller, see
+ *  kb_delay_stats().
+ */
+
+#ifndef SYSTEM_KB_DELAY_H_
+#define SYSTEM_KB_DELAY_H_
+
+#include "kb_common_header.h"
+
+// One-shot timer: a basic timer on APB1
+#ifndef KB_DELAY_TIMER
+    #define KB_DELAY_TIMER              TIM7
+    #define KB_DELAY_TIMER_IRQn         TIM7_IRQn
+    #define KB_DELAY_TIMER_IRQHandler   TIM7_IRQHandler
+    #define KB_DELAY_TIMER_CLK_ENABLE() __HAL_RCC_TIM7_CLK_ENABLE()
+#endif
+// NVIC preemption priority of the timer. Numerically not below
+// configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY, it wakes FreeRTOS tasks
+#ifndef KB_DELAY_IRQ_PRIORITY
+    #define KB_DELAY_IRQ_PRIORITY       6
+#endif
+// Shorter waits spin: sleeping and waking cost about as much
+#ifndef KB_DELAY_SPIN_MAX_US
+    #define KB_DELAY_SPIN_MAX_US        20
+#endif
+// Wake-up latency to make up by spinning: interrupt entry and a task switch
+#ifndef KB_DELAY_WAKE_US
+    #define KB_DELAY_WAKE_US            4
+#endif
+// Callers whose spinning is counted apart
+#ifndef KB_DELAY_SITE_NUM
+    #define KB_DELAY_SITE_NUM           8
+#endif
+
+typedef struct {
+    void *caller;           // return address of the delay call (addr2line)
+    uint32_t num;           // calls that spun
+    uint64_t spin_cycles;
+} kb_delay_site_t;
+
+typedef struct {
+    uint32_t spin_num;      // waits spun from start to end
+    uint32_t sleep_num;     // WFI until the timer
+    uint32_t block_num;     // blocked FreeRTOS tasks, ticks or the timer
+    uint64_t spin_cycles;   // all spinning, wake-up tails included
+    uint64_t other_cycles;  // spinning of callers not in sites[]
+    kb_delay_site_t sites[KB_DELAY_SITE_NUM];   // most spinning first
+} kb_delay_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Set up the one-shot timer for the core clock. Called by
+ *        kb_tick_update_f_cpu_mhz(), again after a clock change. Until then
+ *        the delays spin
+ */
+void kb_delay_init(void);
+
+/**
+ * @brief Copy the counters, the callers sorted by the cycles they spun
+ */
+void kb_delay_stats(kb_delay_stats_t *stats);
+void kb_delay_stats_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SYSTEM_KB_DELAY_H_ */
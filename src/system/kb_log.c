@@ -0,0 +1,166 @@
+/*
+ * kb_log.c
+ *
+ *  Multi-producer single-consumer ring of 32-bit words. A producer
+ *  reserves the words of its record by moving head_ with compare-and-swap,
+ *  fills them and writes the first word last, which makes the record
+ *  visible; the first word is never 0. The consumer reads at tail_ while
+ *  the first word is not 0, clears the words and then moves tail_, so the
+ *  ring is all 0 outside the records. A producer interrupted between
+ *  reserve and commit holds back the records behind it, not the others.
+ *
+ *  kb_ring (src/system/kb_ring.h) is single-producer, hence this one.
+ */
+
+#include "kb_log.h"
+#include "kb_time.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MASK_           (KB_LOG_SIZE - 1)
+#define LINE_SIZE_      128
+
+#if (KB_LOG_SIZE & MASK_) != 0
+    #error "KB_LOG_SIZE must be a power of two"
+#endif
+
+// start of the format strings, given by the linker
+extern const char __start_kb_log_fmt[];
+
+static uint32_t words_[KB_LOG_SIZE];
+static uint32_t head_ = 0;          // reserved by the producers
+static uint32_t tail_ = 0;          // moved by the consumer only
+static uint32_t dropped_ = 0;
+static uint32_t dropped_reported_ = 0;
+
+int kb_log_write(const char *format, int argc, ...)
+{
+    uint32_t n = (uint32_t)argc + 2;
+    uint32_t time = kb_time_counter();
+    uint32_t head = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+    va_list args;
+    uint32_t i;
+
+    if ((argc < 0) || (argc > KB_LOG_ARG_MAX))
+    {
+        return -1;
+    }
+    do
+    {
+        if (head + n - __atomic_load_n(&tail_, __ATOMIC_ACQUIRE) > KB_LOG_SIZE)
+        {
+            __atomic_fetch_add(&dropped_, 1, __ATOMIC_RELAXED);
+            return -1;
+        }
+    } while (!__atomic_compare_exchange_n(&head_, &head, head + n, 1,
+            __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    words_[(head + 1) & MASK_] = time;
+    va_start(args, argc);
+    for (i = 2; i < n; i++)
+    {
+        words_[(head + i) & MASK_] = va_arg(args, uint32_t);
+    }
+    va_end(args);
+    // commit
+    __atomic_store_n(&words_[head & MASK_],
+            (n << 24) | (uint32_t)(format - __start_kb_log_fmt), __ATOMIC_RELEASE);
+    return 0;
+}
+
+uint32_t kb_log_read(uint32_t *words, uint32_t size)
+{
+    uint32_t tail = tail_;
+    uint32_t count = 0;
+    uint32_t i;
+
+    while (1)
+    {
+        uint32_t word0 = __atomic_load_n(&words_[tail & MASK_], __ATOMIC_ACQUIRE);
+        uint32_t n = KB_LOG_RECORD_WORDS(word0);
+
+        if ((word0 == 0) || (count + n > size))
+        {
+            break;
+        }
+        for (i = 0; i < n; i++)
+        {
+            words[count + i] = words_[(tail + i) & MASK_];
+            words_[(tail + i) & MASK_] = 0;
+        }
+        count += n;
+        tail += n;
+        __atomic_store_n(&tail_, tail, __ATOMIC_RELEASE);
+    }
+    return count;
+}
+
+int kb_log_format(const uint32_t *record, char *text, uint32_t size)
+{
+    const char *format = __start_kb_log_fmt + KB_LOG_RECORD_FORMAT(record[0]);
+    uint32_t args[KB_LOG_ARG_MAX] = {0};
+    uint32_t n = KB_LOG_RECORD_WORDS(record[0]);
+    int len;
+    int i;
+
+    for (i = 0; i < (int)n - 2; i++)
+    {
+        args[i] = record[2 + i];
+    }
+    len = snprintf(text, size, "%10lu ", (unsigned long)record[1]);
+    if ((len < 0) || ((uint32_t)len >= size))
+    {
+        return len;
+    }
+    // the extra arguments are not read
+    len += snprintf(text + len, size - len, format, args[0], args[1], args[2], args[3],
+            args[4], args[5], args[6], args[7]);
+    // the line ending is the writer's
+    for (i = strlen(text); (i > 0) && ((text[i - 1] == '\r') || (text[i - 1] == '\n')); i--)
+    {
+        text[i - 1] = '\0';
+    }
+    return len;
+}
+
+void kb_log_flush(int (*write_line)(const char *line))
+{
+    uint32_t records[4 * KB_LOG_RECORD_MAX];
+    char line[LINE_SIZE_];
+    uint32_t dropped;
+    uint32_t count;
+    uint32_t i;
+
+    while ((count = kb_log_read(records, 4 * KB_LOG_RECORD_MAX)) > 0)
+    {
+        for (i = 0; i < count; i += KB_LOG_RECORD_WORDS(records[i]))
+        {
+            kb_log_format(&records[i], line, sizeof(line));
+            write_line(line);
+        }
+    }
+    dropped = __atomic_load_n(&dropped_, __ATOMIC_RELAXED);
+    if (dropped != dropped_reported_)
+    {
+        snprintf(line, sizeof(line), "kb_log: %lu dropped",
+                (unsigned long)(dropped - dropped_reported_));
+        write_line(line);
+        dropped_reported_ = dropped;
+    }
+}
+
+uint32_t kb_log_dropped(void)
+{
+    return __atomic_load_n(&dropped_, __ATOMIC_RELAXED);
+}
+
+void kb_log_reset(void)
+{
+    memset(words_, 0, sizeof(words_));
+    head_ = 0;
+    tail_ = 0;
+    dropped_ = 0;
+    dropped_reported_ = 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * kb_log.h
+ *
+ *  Deferred binary log. KB_LOG("fmt", args...) does not format: it puts the
+ *  format string in the section kb_log_fmt and writes a record of its
+ *  offset there, the cycle counter (kb_time_counter()) and the raw
+ *  arguments to a lock-free ring, a few dozen cycles from any task or
+ *  interrupt handler. The text is made later, either
+ *   - on the target by kb_log_flush(), from a low-priority task or the idle
+ *     hook, or
+ *   - on a Linux host by kb-log-decode (host/system/LogDecode.c), from
+ *     the words of kb_log_read() sent out as they are (UART, ITM, a memory
+ *     dump) and the format strings in the ELF file of the firmware.
+ *
+ *  Arguments are read as 32-bit words: integers up to long, char and
+ *  pointers, at most KB_LOG_ARG_MAX. No float, double or long long. %s is
+ *  formatted at flush time, so only for strings that live that long, e.g.
+ *  literals; kb-log-decode finds them in the ELF file.
+ *
+ *  A record is (n << 24 | offset of the format string), the time, then
+ *  n - 2 arguments. A record that does not fit is dropped and counted.
+ *
+ *  Plain C without the HAL, so it also builds on the host with KB_TIME_SIM
+ *  (see host/system/LogCheck.c).
+ */
+
+#ifndef SYSTEM_KB_LOG_H_
+#define SYSTEM_KB_LOG_H_
+
+#include <stdint.h>
+
+// Ring size in 32-bit words, a power of two
+#ifndef KB_LOG_SIZE
+    #define KB_LOG_SIZE         512
+#endif
+#define KB_LOG_ARG_MAX          8
+#define KB_LOG_RECORD_MAX       (KB_LOG_ARG_MAX + 2)
+
+#define KB_LOG_RECORD_WORDS(word0)  ((word0) >> 24)
+#define KB_LOG_RECORD_FORMAT(word0) ((word0) & 0xffffffu)
+
+#define KB_LOG_NARGS2_(_0, _1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+#define KB_LOG_NARGS_(...)  KB_LOG_NARGS2_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+
+/**
+ * @brief Log @format with up to KB_LOG_ARG_MAX 32-bit arguments, printf-like
+ */
+#define KB_LOG(format, ...) \
+    do { \
+        static const char kb_log_format_[] \
+                __attribute__((section("kb_log_fmt"), used)) = format; \
+        kb_log_write(kb_log_format_, KB_LOG_NARGS_(__VA_ARGS__), ##__VA_ARGS__); \
+    } while (0)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Write a record. Use KB_LOG(), which puts @format in its section
+ * @return 0 (KB_OK), -1 (KB_ERROR) if the ring was full and it is dropped
+ */
+int kb_log_write(const char *format, int argc, ...)
+        __attribute__((format(printf, 1, 3)));
+
+/**
+ * @brief Move whole records out of the ring, as they are. One consumer at a
+ *        time, and not with kb_log_flush()
+ * @return words copied to @words, at most @size
+ */
+uint32_t kb_log_read(uint32_t *words, uint32_t size);
+
+/**
+ * @brief Text of a record from kb_log_read(), with the time in cycles in
+ *        front and without a line ending
+ * @return length of the text as snprintf() gives it
+ */
+int kb_log_format(const uint32_t *record, char *text, uint32_t size);
+
+/**
+ * @brief Format and remove all records, a line each to @write_line without
+ *        a line ending, as trace_puts() takes it
+ */
+void kb_log_flush(int (*write_line)(const char *line));
+
+/**
+ * @brief Records dropped as the ring was full
+ */
+uint32_t kb_log_dropped(void);
+
+/**
+ * @brief Empty the ring. Only when nobody logs or reads
+ */
+void kb_log_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SYSTEM_KB_LOG_H_ */
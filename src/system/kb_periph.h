@@ -0,0 +1,58 @@
+/*
+ * kb_periph.h
+ *
+ *  Constant-time lookup of a peripheral instance (USART2, TIM3, GPIOB, ...).
+ *  The peripherals on APB1, APB2 and AHB1 start on 1 KB boundaries from
+ *  PERIPH_BASE, so (instance - PERIPH_BASE) / 1 KB is a small slot number.
+ *  A driver maps the slots of its peripherals to its own index with a table
+ *  built from the base addresses, 0 for any other slot:
+ *
+ *      static const uint8_t slot_list_[] = {
+ *          [KB_PERIPH_SLOT(USART1_BASE)] = 1,
+ *          [KB_PERIPH_SLOT(USART2_BASE)] = 2,
+ *      };
+ *      int idx = kb_periph_index(uart, slot_list_, sizeof(slot_list_));
+ *
+ *  Needs the CMSIS device header (PERIPH_BASE, RCC) before it.
+ */
+
+#ifndef SYSTEM_KB_PERIPH_H_
+#define SYSTEM_KB_PERIPH_H_
+
+#include <stdint.h>
+
+#define KB_PERIPH_SLOT(base)    (((uint32_t)(base) - PERIPH_BASE) >> 10)
+
+// RCC clock enable bit of a peripheral
+typedef struct {
+    volatile uint32_t *enr;     // e.g. &RCC->APB1ENR
+    uint32_t bit;               // e.g. RCC_APB1ENR_USART2EN
+} kb_periph_clk_t;
+
+/**
+ * @brief Index of @instance in a driver's slot table
+ * @return 0 based index, or -1 if @instance is none of the driver's
+ */
+static inline int kb_periph_index(const void *instance, const uint8_t *slot_list, uint32_t slot_num)
+{
+    uint32_t offset = (uint32_t)(uintptr_t)instance - PERIPH_BASE;
+    uint32_t slot = offset >> 10;
+
+    if (((offset & 0x3FF) != 0) || (slot >= slot_num))
+    {
+        return -1;
+    }
+    return (int)slot_list[slot] - 1;
+}
+
+/**
+ * @brief Same as __HAL_RCC_xxx_CLK_ENABLE(): set the bit and read it back,
+ *        which waits until the clock runs
+ */
+static inline void kb_periph_clk_enable(const kb_periph_clk_t *clk)
+{
+    *clk->enr |= clk->bit;
+    (void)*clk->enr;
+}
+
+#endif /* SYSTEM_KB_PERIPH_H_ */
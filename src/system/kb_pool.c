@@ -0,0 +1,109 @@
+/*
+ * kb_pool.c
+ *
+ *  A block is taken by clearing its bit in free_mask and given back by
+ *  setting it, both by compare-and-swap (LDREX/STREX on the Cortex-M4).
+ *  Its count is set before the block is handed out and only reaches zero
+ *  once, in the release that frees it.
+ */
+
+#include "kb_pool.h"
+#include <stddef.h>
+
+#define load_(value)            __atomic_load_n(&(value), __ATOMIC_ACQUIRE)
+
+static int index_(const kb_pool_t *pool, const uint8_t *data)
+{
+    uint32_t offset;
+
+    if ((data < pool->memory) || (pool->block_num == 0))
+    {
+        return -1;
+    }
+    offset = (uint32_t)(data - pool->memory);
+    if (offset >= pool->block_size * pool->block_num)
+    {
+        return -1;
+    }
+    return (int)(offset / pool->block_size);
+}
+
+int kb_pool_init(kb_pool_t *pool, uint8_t *memory, uint32_t block_size, uint32_t block_num)
+{
+    uint32_t i;
+
+    if ((memory == NULL) || (block_size == 0) || (block_num == 0)
+            || (block_num > KB_POOL_MAX_BLOCKS))
+    {
+        return -1;
+    }
+    pool->memory = memory;
+    pool->block_size = block_size;
+    pool->block_num = block_num;
+    for (i = 0; i < KB_POOL_MAX_BLOCKS; i++)
+    {
+        pool->ref[i] = 0;
+    }
+    pool->in_use_max = 0;
+    pool->empty_num = 0;
+    pool->free_mask = (block_num == 32) ? 0xffffffffu : ((1u << block_num) - 1);
+    return 0;
+}
+
+uint8_t *kb_pool_alloc(kb_pool_t *pool)
+{
+    uint32_t mask = load_(pool->free_mask);
+    uint32_t in_use;
+    int i;
+
+    do {
+        if (mask == 0)
+        {
+            __atomic_fetch_add(&pool->empty_num, 1, __ATOMIC_RELAXED);
+            return NULL;
+        }
+        i = __builtin_ctz(mask);
+    } while (!__atomic_compare_exchange_n(&pool->free_mask, &mask, mask & ~(1u << i),
+            0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    __atomic_store_n(&pool->ref[i], 1, __ATOMIC_RELEASE);
+
+    // the mask just swapped out, minus the block taken
+    in_use = pool->block_num - (uint32_t)__builtin_popcount(mask) + 1;
+    if (in_use > pool->in_use_max)
+    {
+        pool->in_use_max = in_use;
+    }
+    return &pool->memory[(uint32_t)i * pool->block_size];
+}
+
+int kb_pool_retain(kb_pool_t *pool, const uint8_t *data)
+{
+    int i = index_(pool, data);
+
+    if ((i < 0) || (load_(pool->ref[i]) == 0))
+    {
+        return -1;
+    }
+    __atomic_fetch_add(&pool->ref[i], 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+int kb_pool_release(kb_pool_t *pool, const uint8_t *data)
+{
+    int i = index_(pool, data);
+
+    if ((i < 0) || (load_(pool->ref[i]) == 0))
+    {
+        return -1;
+    }
+    if (__atomic_sub_fetch(&pool->ref[i], 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        __atomic_fetch_or(&pool->free_mask, 1u << i, __ATOMIC_RELEASE);
+    }
+    return 0;
+}
+
+uint32_t kb_pool_in_use(const kb_pool_t *pool)
+{
+    return pool->block_num - (uint32_t)__builtin_popcount(load_(pool->free_mask));
+}
@@ -0,0 +1,70 @@
+/*
+ * kb_pool.h
+ *
+ *  Pool of fixed-size blocks with a reference count each, to pass received
+ *  data along without copying it: the producer fills a block, every holder
+ *  takes a reference, and the block is free again when the last one is
+ *  released. The memory in use never exceeds the pool.
+ *
+ *  Lock-free: the free blocks are a bitmask changed by compare-and-swap and
+ *  the counts are atomic, so blocks can be released from another task or an
+ *  interrupt handler than the one that allocated them.
+ *
+ *  Plain C without the HAL, so it also builds on the host (see
+ *  host/system/PoolCheck.c).
+ */
+
+#ifndef SYSTEM_KB_POOL_H_
+#define SYSTEM_KB_POOL_H_
+
+#include <stdint.h>
+
+#define KB_POOL_MAX_BLOCKS  32
+
+typedef struct {
+    uint8_t *memory;
+    uint32_t block_size;
+    uint32_t block_num;
+    uint32_t free_mask;                 // bit i set: block i is free
+    uint8_t ref[KB_POOL_MAX_BLOCKS];
+    uint32_t in_use_max;                // most blocks in use at once
+    uint32_t empty_num;                 // kb_pool_alloc() that found none
+} kb_pool_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Use @memory as @block_num blocks of @block_size bytes, all free
+ * @return 0 (KB_OK), or -1 (KB_ERROR) if there are no or too many blocks
+ */
+int kb_pool_init(kb_pool_t *pool, uint8_t *memory, uint32_t block_size, uint32_t block_num);
+
+/**
+ * @brief Take a free block, with a reference count of 1
+ * @return the block, or NULL if all are in use
+ */
+uint8_t *kb_pool_alloc(kb_pool_t *pool);
+
+/**
+ * @brief Take another reference to the block @data points into. Only while
+ *        holding one already
+ * @return 0 (KB_OK), or -1 (KB_ERROR) if @data is not in a block in use
+ */
+int kb_pool_retain(kb_pool_t *pool, const uint8_t *data);
+
+/**
+ * @brief Drop a reference to the block @data points into. The last one
+ *        frees the block
+ * @return 0 (KB_OK), or -1 (KB_ERROR) if @data is not in a block in use
+ */
+int kb_pool_release(kb_pool_t *pool, const uint8_t *data);
+
+uint32_t kb_pool_in_use(const kb_pool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SYSTEM_KB_POOL_H_ */
@@ -0,0 +1,238 @@
+/*
+ * kb_prof.c
+ *
+ *  Bucket i < 2^SUB_BITS holds the value i. Above, a value with its top bit
+ *  at e (e >= SUB_BITS) goes to group g = e - SUB_BITS + 1, bucket
+ *  (g << SUB_BITS) + the SUB_BITS bits below the top one: each power of two
+ *  is split in 2^SUB_BITS equal parts.
+ *
+ *  A zone is updated with interrupts masked, a few dozen cycles, since the
+ *  Cortex-M4 has no 64-bit atomics for the sum.
+ */
+
+#include "kb_prof.h"
+
+#if defined(KB_PROF)
+
+#include "kb_time.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(KB_TIME_SIM)
+    // the host check runs in one thread
+    #define lock_()         0
+    #define unlock_(key)    ((void)(key))
+#else
+    #include "kb_common_source.h"
+
+static inline uint32_t lock_(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
+}
+    #define unlock_(key)    __set_PRIMASK(key)
+#endif
+
+#define SUB_MASK_       ((1u << KB_PROF_SUB_BITS) - 1)
+
+struct kb_prof_zone {
+    const char *name;
+    uint32_t num;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t hist[KB_PROF_BUCKET_NUM];
+};
+
+static kb_prof_zone_t zones_[KB_PROF_ZONE_NUM];
+static int zone_num_ = 0;
+
+static uint32_t bucket_(uint32_t cycles)
+{
+    uint32_t top;
+
+    if (cycles <= SUB_MASK_)
+    {
+        return cycles;
+    }
+    top = 31 - __builtin_clz(cycles);
+    if (top >= KB_PROF_MAX_BITS)
+    {
+        return KB_PROF_BUCKET_NUM - 1;
+    }
+    return ((top - KB_PROF_SUB_BITS + 1) << KB_PROF_SUB_BITS)
+            + ((cycles >> (top - KB_PROF_SUB_BITS)) & SUB_MASK_);
+}
+
+/* The largest value of bucket @idx */
+static uint32_t bucket_max_(uint32_t idx)
+{
+    uint32_t group = idx >> KB_PROF_SUB_BITS;
+    uint32_t width;
+
+    if (group == 0)
+    {
+        return idx;
+    }
+    if (idx == KB_PROF_BUCKET_NUM - 1)
+    {
+        return UINT32_MAX;
+    }
+    width = 1u << (group - 1);
+    return (((1u << KB_PROF_SUB_BITS) + (idx & SUB_MASK_)) << (group - 1)) + width - 1;
+}
+
+kb_prof_zone_t *kb_prof_zone(const char *name)
+{
+    kb_prof_zone_t *zone = NULL;
+    uint32_t key = lock_();
+    int i;
+
+    for (i = 0; i < zone_num_; i++)
+    {
+        if (strcmp(zones_[i].name, name) == 0)
+        {
+            zone = &zones_[i];
+            break;
+        }
+    }
+    if ((zone == NULL) && (zone_num_ < KB_PROF_ZONE_NUM))
+    {
+        zone = &zones_[zone_num_];
+        memset(zone, 0, sizeof(*zone));
+        zone->name = name;
+        zone->min = UINT32_MAX;
+        // kb_prof_stats() looks at zones below zone_num_ without the lock
+        __atomic_store_n(&zone_num_, zone_num_ + 1, __ATOMIC_RELEASE);
+    }
+    unlock_(key);
+    return zone;
+}
+
+void kb_prof_record(kb_prof_zone_t *zone, uint32_t cycles)
+{
+    uint32_t idx = bucket_(cycles);
+    uint32_t key = lock_();
+
+    zone->num++;
+    zone->sum += cycles;
+    if (cycles < zone->min)
+    {
+        zone->min = cycles;
+    }
+    if (cycles > zone->max)
+    {
+        zone->max = cycles;
+    }
+    zone->hist[idx]++;
+    unlock_(key);
+}
+
+kb_prof_scope_t kb_prof_scope_begin(kb_prof_zone_t **zone, const char *name)
+{
+    kb_prof_scope_t scope;
+
+    if (*zone == NULL)
+    {
+        *zone = kb_prof_zone(name);
+    }
+    scope.zone = *zone;
+    scope.start = kb_time_counter();
+    return scope;
+}
+
+void kb_prof_scope_end(kb_prof_scope_t *scope)
+{
+    uint32_t end = kb_time_counter();
+
+    if (scope->zone != NULL)
+    {
+        kb_prof_record(scope->zone, end - scope->start);
+    }
+}
+
+int kb_prof_stats(int idx, kb_prof_stats_t *stats)
+{
+    kb_prof_zone_t *zone;
+    uint32_t rank;
+    uint32_t seen = 0;
+    uint32_t key;
+    uint32_t i;
+
+    if ((idx < 0) || (idx >= __atomic_load_n(&zone_num_, __ATOMIC_ACQUIRE)))
+    {
+        return -1;
+    }
+    zone = &zones_[idx];
+    memset(stats, 0, sizeof(*stats));
+    key = lock_();
+    stats->name = zone->name;
+    stats->num = zone->num;
+    if (stats->num == 0)
+    {
+        unlock_(key);
+        return 0;
+    }
+    stats->min = zone->min;
+    stats->max = zone->max;
+    stats->mean = (uint32_t)(zone->sum / zone->num);
+    // the bucket of the measurement at rank ceil(0.99 * num)
+    rank = (uint32_t)(((uint64_t)zone->num * 99 + 99) / 100);
+    for (i = 0; i < KB_PROF_BUCKET_NUM; i++)
+    {
+        seen += zone->hist[i];
+        if (seen >= rank)
+        {
+            break;
+        }
+    }
+    unlock_(key);
+    stats->p99 = bucket_max_(i);
+    if (stats->p99 > stats->max)
+    {
+        stats->p99 = stats->max;
+    }
+    if (stats->p99 < stats->min)
+    {
+        stats->p99 = stats->min;
+    }
+    return 0;
+}
+
+void kb_prof_reset(void)
+{
+    uint32_t key = lock_();
+    int i;
+
+    for (i = 0; i < zone_num_; i++)
+    {
+        const char *name = zones_[i].name;
+        memset(&zones_[i], 0, sizeof(zones_[i]));
+        zones_[i].name = name;
+        zones_[i].min = UINT32_MAX;
+    }
+    unlock_(key);
+}
+
+void kb_prof_dump(int (*write_line)(const char *line))
+{
+    char line[80];
+    kb_prof_stats_t stats;
+    int i;
+
+    snprintf(line, sizeof(line), "%-16s %8s %10s %10s %10s %10s", "zone", "num",
+            "min", "mean", "p99", "max");
+    write_line(line);
+    for (i = 0; kb_prof_stats(i, &stats) == 0; i++)
+    {
+        snprintf(line, sizeof(line), "%-16.16s %8lu %10lu %10lu %10lu %10lu", stats.name,
+                (unsigned long)stats.num, (unsigned long)stats.min, (unsigned long)stats.mean,
+                (unsigned long)stats.p99, (unsigned long)stats.max);
+        write_line(line);
+    }
+    snprintf(line, sizeof(line), "cycles at %lu Hz", (unsigned long)kb_time_f_cpu_hz());
+    write_line(line);
+}
+
+#endif /* KB_PROF */
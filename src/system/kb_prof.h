@@ -0,0 +1,145 @@
+/*
+ * kb_prof.h
+ *
+ *  Cycle profiler of named zones. KB_PROF_ZONE("name") at the top of a
+ *  block measures the cycles until the block is left, by return or break
+ *  too, into the zone of that name, in C and C++:
+ *
+ *      int kb_spi_send_timeout(...)
+ *      {
+ *          KB_PROF_ZONE("spi_send");
+ *          ...
+ *      }
+ *
+ *  A zone counts the calls and keeps min, max, sum and a histogram with
+ *  2^KB_PROF_SUB_BITS buckets per power of two, so its percentiles are
+ *  upper bounds at most 25% (2 bits) too high. Zones are KB_PROF_ZONE_NUM
+ *  entries of a static table, taken at the first pass of each name; a name
+ *  that does not fit is not measured. The time includes nested zones and
+ *  interrupts, and the two counter reads, a few cycles.
+ *
+ *  kb_prof_dump() prints the table one line at a time, e.g.
+ *
+ *      kb_prof_dump(trace_puts);      // ITM, with a debugger attached
+ *
+ *  Only with KB_PROF defined in kb_config.h; otherwise KB_PROF_ZONE() is
+ *  empty and none of this is built. The cycles are kb_time_counter(), so
+ *  with KB_TIME_SIM it also builds on the host (see
+ *  host/system/ProfCheck.c).
+ */
+
+#ifndef SYSTEM_KB_PROF_H_
+#define SYSTEM_KB_PROF_H_
+
+#if !defined(KB_TIME_SIM)
+    #include "kb_config.h"
+#endif
+
+#if defined(KB_PROF)
+
+#include <stdint.h>
+
+#ifndef KB_PROF_ZONE_NUM
+    #define KB_PROF_ZONE_NUM    8
+#endif
+// Histogram resolution: buckets per power of two
+#ifndef KB_PROF_SUB_BITS
+    #define KB_PROF_SUB_BITS    2
+#endif
+// Longer zones fall in the last bucket; 2^28 cycles is 1.49 s at 180 MHz
+#ifndef KB_PROF_MAX_BITS
+    #define KB_PROF_MAX_BITS    28
+#endif
+#define KB_PROF_BUCKET_NUM  ((KB_PROF_MAX_BITS - KB_PROF_SUB_BITS + 1) << KB_PROF_SUB_BITS)
+
+typedef struct kb_prof_zone kb_prof_zone_t;
+
+typedef struct {
+    kb_prof_zone_t *zone;
+    uint32_t start;
+} kb_prof_scope_t;
+
+typedef struct {
+    const char *name;
+    uint32_t num;
+    uint32_t min;           // in cycles
+    uint32_t max;
+    uint32_t mean;
+    uint32_t p99;
+} kb_prof_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The zone of @name, taken from the table at its first use
+ * @return NULL if the table is full
+ */
+kb_prof_zone_t *kb_prof_zone(const char *name);
+
+/**
+ * @brief Add a measurement of @cycles to @zone
+ */
+void kb_prof_record(kb_prof_zone_t *zone, uint32_t cycles);
+
+/* KB_PROF_ZONE() */
+kb_prof_scope_t kb_prof_scope_begin(kb_prof_zone_t **zone, const char *name);
+void kb_prof_scope_end(kb_prof_scope_t *scope);
+
+/**
+ * @brief Statistics of the zone at @idx of the table
+ * @return 0 (KB_OK), -1 (KB_ERROR) if there is no zone at @idx
+ */
+int kb_prof_stats(int idx, kb_prof_stats_t *stats);
+
+/**
+ * @brief Clear the measurements, keeping the zones
+ */
+void kb_prof_reset(void);
+
+/**
+ * @brief Print the table, a header and a line per zone, in cycles. Each
+ *        line goes to @write_line without a line ending, as trace_puts()
+ *        takes it
+ */
+void kb_prof_dump(int (*write_line)(const char *line));
+
+#ifdef __cplusplus
+}
+
+class kb_prof_scope {
+public:
+    kb_prof_scope(kb_prof_zone_t **zone, const char *name)
+        : scope_(kb_prof_scope_begin(zone, name)) {}
+    ~kb_prof_scope() { kb_prof_scope_end(&scope_); }
+private:
+    kb_prof_scope(const kb_prof_scope &);
+    kb_prof_scope &operator=(const kb_prof_scope &);
+    kb_prof_scope_t scope_;
+};
+#endif
+
+#define KB_PROF_CAT2_(a, b)     a##b
+#define KB_PROF_CAT_(a, b)      KB_PROF_CAT2_(a, b)
+
+#ifdef __cplusplus
+    #define KB_PROF_ZONE(name) \
+        static kb_prof_zone_t *KB_PROF_CAT_(kb_prof_zone_, __LINE__) = 0; \
+        kb_prof_scope KB_PROF_CAT_(kb_prof_scope_, __LINE__)( \
+                &KB_PROF_CAT_(kb_prof_zone_, __LINE__), (name))
+#else
+    #define KB_PROF_ZONE(name) \
+        static kb_prof_zone_t *KB_PROF_CAT_(kb_prof_zone_, __LINE__) = 0; \
+        kb_prof_scope_t KB_PROF_CAT_(kb_prof_scope_, __LINE__) \
+                __attribute__((cleanup(kb_prof_scope_end))) = \
+                kb_prof_scope_begin(&KB_PROF_CAT_(kb_prof_zone_, __LINE__), (name))
+#endif
+
+#else /* KB_PROF */
+
+#define KB_PROF_ZONE(name)
+
+#endif /* KB_PROF */
+
+#endif /* SYSTEM_KB_PROF_H_ */
@@ -0,0 +1,112 @@
+/*
+ * kb_ring.c
+ *
+ *  The data is copied before head is released (store-release) and the
+ *  other side reads the index with load-acquire, so the bytes are visible
+ *  before the index that covers them. On the Cortex-M4 this is a DMB, also
+ *  needed against the DMA.
+ */
+
+#include "kb_ring.h"
+#include <string.h>
+
+#define load_(index)            __atomic_load_n(&(index), __ATOMIC_ACQUIRE)
+#define store_(index, value)    __atomic_store_n(&(index), (value), __ATOMIC_RELEASE)
+
+int kb_ring_init(kb_ring_t *ring, uint8_t *buffer, uint32_t size)
+{
+    if ((buffer == NULL) || (size == 0) || ((size & (size - 1)) != 0))
+    {
+        return -1;
+    }
+    ring->buffer = buffer;
+    ring->size = size;
+    kb_ring_reset(ring);
+    return 0;
+}
+
+void kb_ring_reset(kb_ring_t *ring)
+{
+    ring->head = 0;
+    ring->tail = 0;
+    ring->high_water = 0;
+}
+
+uint32_t kb_ring_count(const kb_ring_t *ring)
+{
+    return load_(ring->head) - load_(ring->tail);
+}
+
+uint32_t kb_ring_space(const kb_ring_t *ring)
+{
+    return ring->size - kb_ring_count(ring);
+}
+
+uint32_t kb_ring_write(kb_ring_t *ring, const uint8_t *data, uint32_t size)
+{
+    uint32_t head = ring->head;
+    uint32_t space = ring->size - (head - load_(ring->tail));
+    uint32_t offset = head & (ring->size - 1);
+    uint32_t first;
+
+    if (size > space)
+    {
+        size = space;
+    }
+    // up to the end of the buffer, then the rest from the start
+    first = ring->size - offset;
+    if (first > size)
+    {
+        first = size;
+    }
+    memcpy(&ring->buffer[offset], data, first);
+    memcpy(ring->buffer, &data[first], size - first);
+    store_(ring->head, head + size);
+
+    if (ring->size - space + size > ring->high_water)
+    {
+        ring->high_water = ring->size - space + size;
+    }
+    return size;
+}
+
+uint32_t kb_ring_read(kb_ring_t *ring, uint8_t *data, uint32_t size)
+{
+    uint32_t tail = ring->tail;
+    uint32_t count = load_(ring->head) - tail;
+    uint32_t offset = tail & (ring->size - 1);
+    uint32_t first;
+
+    if (size > count)
+    {
+        size = count;
+    }
+    first = ring->size - offset;
+    if (first > size)
+    {
+        first = size;
+    }
+    memcpy(data, &ring->buffer[offset], first);
+    memcpy(&data[first], ring->buffer, size - first);
+    store_(ring->tail, tail + size);
+    return size;
+}
+
+uint32_t kb_ring_peek(const kb_ring_t *ring, const uint8_t **data)
+{
+    uint32_t tail = ring->tail;
+    uint32_t count = load_(ring->head) - tail;
+    uint32_t offset = tail & (ring->size - 1);
+
+    *data = &ring->buffer[offset];
+    if (count > ring->size - offset)
+    {
+        count = ring->size - offset;
+    }
+    return count;
+}
+
+void kb_ring_skip(kb_ring_t *ring, uint32_t size)
+{
+    store_(ring->tail, ring->tail + size);
+}
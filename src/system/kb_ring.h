@@ -0,0 +1,77 @@
+/*
+ * kb_ring.h
+ *
+ *  Lock-free single-producer single-consumer byte ring, e.g. between an
+ *  interrupt handler and the main loop. The producer only moves head and the
+ *  consumer only moves tail, so neither needs to disable interrupts.
+ *  head and tail run freely and wrap at 2^32; the size is a power of two so
+ *  that head - tail is always the count.
+ *
+ *  Plain C without the HAL, so it also builds on the host (see
+ *  host/system/RingCheck.c).
+ */
+
+#ifndef SYSTEM_KB_RING_H_
+#define SYSTEM_KB_RING_H_
+
+#include <stdint.h>
+
+typedef struct {
+    uint8_t *buffer;
+    uint32_t size;          // power of two
+    uint32_t head;          // written by the producer only
+    uint32_t tail;          // written by the consumer only
+    uint32_t high_water;    // largest count seen by the producer
+} kb_ring_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Use @buffer of @size bytes as an empty ring
+ * @return 0 (KB_OK), or -1 (KB_ERROR) if size is not a power of two
+ */
+int kb_ring_init(kb_ring_t *ring, uint8_t *buffer, uint32_t size);
+
+/**
+ * @brief Empty the ring. Only when neither side is using it
+ */
+void kb_ring_reset(kb_ring_t *ring);
+
+uint32_t kb_ring_count(const kb_ring_t *ring);
+uint32_t kb_ring_space(const kb_ring_t *ring);
+
+/* Producer side */
+
+/**
+ * @brief Copy as much of @data as fits
+ * @return bytes written
+ */
+uint32_t kb_ring_write(kb_ring_t *ring, const uint8_t *data, uint32_t size);
+
+/* Consumer side */
+
+/**
+ * @brief Copy out up to @size bytes
+ * @return bytes read
+ */
+uint32_t kb_ring_read(kb_ring_t *ring, uint8_t *data, uint32_t size);
+
+/**
+ * @brief The longest run of bytes that can be read in place (e.g. by DMA),
+ *        up to the end of the buffer. Release them with kb_ring_skip()
+ * @return bytes at *data
+ */
+uint32_t kb_ring_peek(const kb_ring_t *ring, const uint8_t **data);
+
+/**
+ * @brief Release @size bytes that were read in place
+ */
+void kb_ring_skip(kb_ring_t *ring, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SYSTEM_KB_RING_H_ */
@@ -7,8 +7,8 @@
 
 #include <kb_common_source.h>
 #include "kb_tick.h"
-
-static uint16_t f_cpu_mhz_;
+#include "kb_time.h"
+#include "kb_delay.h"
 
 #ifndef STM32
 static volatile uint32_t ms_;
@@ -56,83 +56,21 @@ void kb_timer_delay_ms(volatile uint32_t delay_ms)
 	{
 	}
 }
-#else
-
-/*
- * Overloading original HAL_Delay() in stm32f4xx_hal.c
- */
-void HAL_Delay(__IO uint32_t Delay)
-{
-    /**
-     * Added overflow protection on top of the original code.
-     */
-	uint32_t tickstart = 0U;
-	tickstart = HAL_GetTick();
-	uint32_t current = tickstart;
-	// Overflow detection
-	if (((uint32_t)(Delay + tickstart)) < tickstart)
-	{	//overflowed
-		while (current > Delay)
-		{
-			current = HAL_GetTick();
-		}
-		Delay -= UINT32_MAX - tickstart;
-		tickstart = 0;
-	}
-	while((current - tickstart) < Delay)
-	{
-		current = HAL_GetTick();
-	}
-	return;
-}
-
 #endif
 
 void kb_tick_update_f_cpu_mhz(void)
 {
 	SystemCoreClockUpdate();
-	f_cpu_mhz_ = SystemCoreClock/1000000;
+	kb_time_init(SystemCoreClock);
+	kb_delay_init();
 	return;
 }
 /**
  * @brief get current time in microseconds
- * @return current time in microseconds
+ * @return current time in microseconds, wrapping at 2^32 (71 minutes).
+ *         kb_time_us() for the 64-bit value
  */
 uint32_t kb_tick_us(void)
 {
-	uint32_t tmp_ms;
-	volatile uint32_t micros;
-
-	tmp_ms = kb_tick_ms();
-	micros = 1000 - SysTick->VAL/f_cpu_mhz_;
-	micros += tmp_ms*1000;
-	// Millis*1000+(SystemCoreClock/1000-SysTick->VAL)/F_CPU_MHZ;
-	return micros;
-}
-
-/**
- * @brief Delay system in microseconds
- * @param uwInput   time to delay in microseconds
- * @warning Might not accurate depends on compiler code compression rate and clock rate of the MCU.
- */
-void kb_delay_us(volatile uint32_t delay_us)
-{
-	uint32_t start = kb_tick_us();
-	uint32_t current = start;
-	// Overflow case detect.
-	if (((uint32_t)(delay_us + start)) < start)
-	{	//overflowed
-		while (current > delay_us)
-		{
-			current = kb_tick_us();
-		}
-		delay_us -= UINT32_MAX - start;
-		start = 0;
-	}
-	// FIXME: sometimes the current is lower than start. Why?
-	while ((current- start) < delay_us || (current < start))
-	{
-		current = kb_tick_us();
-	}
-	return;
+	return (uint32_t)kb_time_us();
 }
@@ -32,6 +32,7 @@ extern "C" {
 	#define  kb_tick_ms()           HAL_GetTick()
 	#define  kb_delay_ms(delay_ms)  HAL_Delay(delay_ms)
 	uint32_t kb_tick_us(void);
+	// HAL_Delay() and kb_delay_us() sleep or block when they can, see kb_delay.h
 	void     kb_delay_us(volatile uint32_t delay_us);
 #endif
 
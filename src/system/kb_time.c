@@ -0,0 +1,137 @@
+/*
+ * kb_time.c
+ *
+ *  high_ holds bits 62..31 of the time last read. Bit 31 of a new counter
+ *  value either matches bit 0 of high_ (same half of the counter period) or
+ *  not (the next half), which gives the upper bits of the new time; the
+ *  reader then moves high_ forward by compare-and-swap. A reader that loses
+ *  the race leaves high_ to the newer value. high_ is read before the
+ *  counter, so the counter value is never older than high_.
+ *
+ *  The conversions multiply by a 32-bit fixed-point factor instead of
+ *  dividing 64-bit numbers, which the Cortex-M4 does in software. The
+ *  factor is exact to 2^-31 of itself: 15 us a day.
+ */
+
+#include "kb_time.h"
+
+#if defined(KB_TIME_SIM)
+    #define counter_()      kb_time_sim_counter()
+#else
+    #include "kb_common_source.h"
+    #define counter_()      (DWT->CYCCNT)
+#endif
+
+typedef struct {
+    uint32_t mult;          // (unit per second << shift) / f_cpu
+    uint32_t shift;
+} scale_t;
+
+static volatile uint32_t high_ = 0;
+static uint32_t f_cpu_hz_ = 1;
+static scale_t ns_ = {1000000000u, 0};
+static scale_t us_ = {1000000u, 0};
+
+/* The largest shift that keeps the factor in 32 bits */
+static scale_t scale_(uint32_t unit, uint32_t f_cpu_hz)
+{
+    // the factor is below 2^32 while 2^shift is below this
+    uint64_t limit = ((uint64_t)f_cpu_hz << 32) / unit;
+    uint64_t mult;
+    scale_t scale;
+
+    scale.shift = 63 - __builtin_clzll(limit);
+    mult = (((uint64_t)unit << scale.shift) + f_cpu_hz / 2) / f_cpu_hz;
+    if (mult > UINT32_MAX)
+    {
+        scale.shift--;
+        mult = (((uint64_t)unit << scale.shift) + f_cpu_hz / 2) / f_cpu_hz;
+    }
+    scale.mult = (uint32_t)mult;
+    return scale;
+}
+
+/* (cycles * mult) >> shift, the 96-bit product in two halves */
+static uint64_t convert_(uint64_t cycles, scale_t scale)
+{
+    uint64_t high = (cycles >> 32) * scale.mult;
+    uint64_t low = (cycles & UINT32_MAX) * scale.mult;
+
+    if (scale.shift >= 32)
+    {
+        return (high + (low >> 32)) >> (scale.shift - 32);
+    }
+    return (high << (32 - scale.shift)) + (low >> scale.shift);
+}
+
+void kb_time_init(uint32_t f_cpu_hz)
+{
+#if !defined(KB_TIME_SIM)
+    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk))
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    // keep the core clock, and the counter, running in WFI/WFE sleep
+    DBGMCU->CR |= DBGMCU_CR_DBG_SLEEP;
+#endif
+    f_cpu_hz_ = f_cpu_hz;
+    ns_ = scale_(1000000000u, f_cpu_hz);
+    us_ = scale_(1000000u, f_cpu_hz);
+}
+
+uint64_t kb_time_cycles(void)
+{
+    uint32_t high = __atomic_load_n(&high_, __ATOMIC_ACQUIRE);
+    uint32_t counter = counter_();
+    uint32_t now = high + ((counter >> 31) != (high & 1));
+
+    if (now != high)
+    {
+        // fails only if another reader moved it, to now or later
+        __atomic_compare_exchange_n(&high_, &high, now, 0,
+                __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    }
+    return ((uint64_t)now << 31) | (counter & 0x7fffffffu);
+}
+
+uint32_t kb_time_counter(void)
+{
+    return counter_();
+}
+
+uint64_t kb_time_ns(void)
+{
+    return convert_(kb_time_cycles(), ns_);
+}
+
+uint64_t kb_time_us(void)
+{
+    return convert_(kb_time_cycles(), us_);
+}
+
+uint64_t kb_time_cycles_to_ns(uint64_t cycles)
+{
+    return convert_(cycles, ns_);
+}
+
+uint64_t kb_time_cycles_to_us(uint64_t cycles)
+{
+    return convert_(cycles, us_);
+}
+
+uint64_t kb_time_us_to_cycles(uint64_t us)
+{
+    return (us / 1000000u) * f_cpu_hz_ + (us % 1000000u) * f_cpu_hz_ / 1000000u;
+}
+
+uint32_t kb_time_f_cpu_hz(void)
+{
+    return f_cpu_hz_;
+}
+
+void kb_time_update(void)
+{
+    (void)kb_time_cycles();
+}
@@ -0,0 +1,78 @@
+/*
+ * kb_time.h
+ *
+ *  Monotonic 64-bit timebase on the cycle counter of the core (DWT CYCCNT),
+ *  for drivers and profilers to share. At 180 MHz the 32-bit counter wraps
+ *  every 23.8 s; the upper bits are kept in one 32-bit word that readers
+ *  update with compare-and-swap, so any task or interrupt handler can read
+ *  the time without a lock and without disabling interrupts.
+ *
+ *  The extension holds as long as the time is read at least once every
+ *  2^31 cycles (11.9 s at 180 MHz); SysTick_Handler() does it every tick.
+ *
+ *  The counter runs on the core clock, which Sleep mode (WFI, WFE) stops.
+ *  kb_time_init() sets DBGMCU_CR.DBG_SLEEP so that the clock, and the time,
+ *  go on in sleep, at the cost of some of the power the sleep saves. Stop
+ *  and Standby modes stop the counter regardless and are not used with this
+ *  timebase.
+ *
+ *  With KB_TIME_SIM defined the counter is kb_time_sim_counter(), given by
+ *  the program, so it also builds on the host (see
+ *  host/system/TimeCheck.c).
+ */
+
+#ifndef SYSTEM_KB_TIME_H_
+#define SYSTEM_KB_TIME_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Start the cycle counter and take the core clock for the
+ *        conversions. Again after a clock change
+ * @param f_cpu_hz core clock, e.g. SystemCoreClock
+ */
+void kb_time_init(uint32_t f_cpu_hz);
+
+/**
+ * @brief Cycles since the counter started
+ */
+uint64_t kb_time_cycles(void);
+
+/**
+ * @brief The 32-bit counter itself. The difference of two readings is the
+ *        cycles between them if less than 2^32; cheaper than kb_time_cycles()
+ *        for short intervals
+ */
+uint32_t kb_time_counter(void);
+
+uint64_t kb_time_ns(void);
+uint64_t kb_time_us(void);
+
+/**
+ * @brief Convert a number of cycles, e.g. a difference of kb_time_cycles()
+ */
+uint64_t kb_time_cycles_to_ns(uint64_t cycles);
+uint64_t kb_time_cycles_to_us(uint64_t cycles);
+uint64_t kb_time_us_to_cycles(uint64_t us);
+
+uint32_t kb_time_f_cpu_hz(void);
+
+/**
+ * @brief Read the time to keep the extension current. From a periodic
+ *        interrupt, e.g. SysTick
+ */
+void kb_time_update(void);
+
+#if defined(KB_TIME_SIM)
+uint32_t kb_time_sim_counter(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SYSTEM_KB_TIME_H_ */